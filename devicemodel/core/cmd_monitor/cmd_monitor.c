@@ -99,6 +99,8 @@ static void register_socket_message_handlers(struct vmctx *ctx)
 	arg.ctx_arg = ctx;
 	register_command_handler(user_vm_destroy_handler, &arg, DESTROY);
 	register_command_handler(user_vm_blkrescan_handler, &arg, BLKRESCAN);
+	register_command_handler(user_vm_snapshot_handler, &arg, SNAPSHOT);
+	register_command_handler(user_vm_migrate_handler, &arg, MIGRATE);
 }
 
 int init_cmd_monitor(struct vmctx *ctx)
@@ -20,6 +20,8 @@
 #include "vmmapi.h"
 #include "log.h"
 #include "monitor.h"
+#include "mevent.h"
+#include "snapshot.h"
 
 #define SUCCEEDED 0
 #define FAILED -1
@@ -122,3 +124,65 @@ int user_vm_blkrescan_handler(void *arg, void *command_para)
 	}
 	return ret;
 }
+
+int user_vm_snapshot_handler(void *arg, void *command_para)
+{
+	int ret = 0;
+	struct command_parameters *cmd_para = (struct command_parameters *)command_para;
+	struct handler_args *hdl_arg = (struct handler_args *)arg;
+	struct socket_dev *sock = (struct socket_dev *)hdl_arg->channel_arg;
+	struct socket_client *client = NULL;
+	bool cmd_completed = false;
+
+	client = find_socket_client(sock, cmd_para->fd);
+	if (client == NULL)
+		return -1;
+
+	/* a paused VM can't be resumed, so the VM is stopped once saved */
+	ret = vm_snapshot(hdl_arg->ctx_arg, cmd_para->option);
+	if (ret >= 0) {
+		cmd_completed = true;
+		pr_info("%s: setting VM state to %s.\n", __func__, vm_state_to_str(VM_SUSPEND_POWEROFF));
+		vm_set_suspend_mode(VM_SUSPEND_POWEROFF);
+		mevent_notify();
+	} else {
+		pr_err("Failed to save VM snapshot.\n");
+	}
+
+	ret = send_socket_ack(sock, cmd_para->fd, cmd_completed);
+	if (ret < 0) {
+		pr_err("Failed to send ACK by socket.\n");
+	}
+	return ret;
+}
+
+int user_vm_migrate_handler(void *arg, void *command_para)
+{
+	int ret = 0;
+	struct command_parameters *cmd_para = (struct command_parameters *)command_para;
+	struct handler_args *hdl_arg = (struct handler_args *)arg;
+	struct socket_dev *sock = (struct socket_dev *)hdl_arg->channel_arg;
+	struct socket_client *client = NULL;
+	bool cmd_completed = false;
+
+	client = find_socket_client(sock, cmd_para->fd);
+	if (client == NULL)
+		return -1;
+
+	/* the VM runs on in the destination device model */
+	ret = vm_migrate(hdl_arg->ctx_arg, cmd_para->option);
+	if (ret >= 0) {
+		cmd_completed = true;
+		pr_info("%s: setting VM state to %s.\n", __func__, vm_state_to_str(VM_SUSPEND_POWEROFF));
+		vm_set_suspend_mode(VM_SUSPEND_POWEROFF);
+		mevent_notify();
+	} else {
+		pr_err("Failed to migrate VM.\n");
+	}
+
+	ret = send_socket_ack(sock, cmd_para->fd, cmd_completed);
+	if (ret < 0) {
+		pr_err("Failed to send ACK by socket.\n");
+	}
+	return ret;
+}
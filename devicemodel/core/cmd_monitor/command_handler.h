@@ -9,4 +9,6 @@ extern struct socket_dev *sock_server;
 
 int user_vm_destroy_handler(void *arg, void *command_para);
 int user_vm_blkrescan_handler(void *arg, void *command_para);
+int user_vm_snapshot_handler(void *arg, void *command_para);
+int user_vm_migrate_handler(void *arg, void *command_para);
 #endif
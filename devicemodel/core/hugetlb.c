@@ -33,12 +33,19 @@
 #include <sys/mount.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <assert.h>
 #include <log.h>
 #include <linux/memfd.h>
 
 #include "vmmapi.h"
+#include "dm_string.h"
+#include "acrn_mngr.h"
 
 extern char *vmname;
 
@@ -50,6 +57,14 @@ extern char *vmname;
 
 #define MAX_PATH_LEN 256
 
+/* the regions are prefaulted in chunks of at least PREFAULT_CHUNK_SIZE, one huge page at least */
+#define PREFAULT_CHUNK_SIZE	(256 * 1024 * 1024UL)
+#define PREFAULT_THREADS_MAX	64
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE	23
+#endif
+
 /* HugePage Level 1 for 2M page, Level 2 for 1G page*/
 
 #define SYS_PATH_LV1  "/sys/kernel/mm/hugepages/hugepages-2048kB/"
@@ -81,6 +96,8 @@ extern char *vmname;
  *.---if > 0: it's the gap for needed page; if < 0, more free than needed.
  * - nr_pages_path: sys path for total number of pages
  *.- free_pages_path: sys path for number of free pages
+ * - leased: fd is a memfd of the hugetlb broker
+ * - fd_base: offset of the memory of the VM in fd, for a leased slice
  */
 struct hugetlb_info {
 	int fd;
@@ -90,6 +107,8 @@ struct hugetlb_info {
 	size_t biosmem;
 	size_t highmem;
 	unsigned int flags;
+	bool leased;
+	size_t fd_base;
 
 	int pages_delta;
 	char *nr_pages_path;
@@ -133,16 +152,32 @@ struct vm_mmap_mem_region {
 	vm_paddr_t fd_offset;
 	char *hva_base;
 	int fd;
+	size_t pg_size;
 };
 
 static struct vm_mmap_mem_region mmap_mem_regions[16];
 static int mem_idx;
 
+/* chunked work on the regions shared by the worker threads, see run_region_work() */
+struct region_work {
+	int (*op)(char *addr, size_t len, size_t pagesz);
+	int next_chunk;		/* the next chunk to be claimed by a thread */
+	int nr_chunks;
+	int error;		/* the first error hit by a thread */
+};
+
+static int prefault_threads = 1;
+
 static void *ptr;
 static size_t total_size;
 static int hugetlb_lv_max;
 static int lock_fd;
 
+/* socket of the hugetlb broker, see acrnd_hugetlb.h in acrn_manager */
+static struct sockaddr_un broker_addr;
+/* connection to the broker, open as long as the memory is leased */
+static int broker_fd = -1;
+
 static int lock_acrn_hugetlb(void)
 {
 	int ret;
@@ -183,6 +218,8 @@ static void close_hugetlbfs(int level)
 		close(hugetlb_priv[level].fd);
 		hugetlb_priv[level].fd = -1;
 	}
+	hugetlb_priv[level].leased = false;
+	hugetlb_priv[level].fd_base = 0;
 }
 
 static bool should_enable_hugetlb_level(int level)
@@ -210,8 +247,7 @@ static int mmap_hugetlbfs_from_level(struct vmctx *ctx, int level, size_t len,
 		size_t offset, size_t skip, char **addr_out)
 {
 	char *addr;
-	size_t pagesz = 0;
-	int fd, i;
+	int fd;
 
 	if (level >= HUGETLB_LV_MAX) {
 		pr_err("exceed max hugetlb level");
@@ -223,6 +259,7 @@ static int mmap_hugetlbfs_from_level(struct vmctx *ctx, int level, size_t len,
 	}
 
 	fd = hugetlb_priv[level].fd;
+	skip += hugetlb_priv[level].fd_base;
 	addr = mmap(ctx->baseaddr + offset, len, PROT_READ | PROT_WRITE,
 			MAP_SHARED | MAP_FIXED, fd, skip);
 	if (addr == MAP_FAILED)
@@ -237,15 +274,42 @@ static int mmap_hugetlbfs_from_level(struct vmctx *ctx, int level, size_t len,
 	mmap_mem_regions[mem_idx].fd = fd;
 	mmap_mem_regions[mem_idx].fd_offset = skip;
 	mmap_mem_regions[mem_idx].hva_base = addr;
+	mmap_mem_regions[mem_idx].pg_size = hugetlb_priv[level].pg_size;
 	mem_idx++;
 	pr_info("mmap 0x%lx@%p\n", len, addr);
 
-	/* pre-allocate hugepages by touch them */
-	pagesz = hugetlb_priv[level].pg_size;
+	/* the hugepages are pre-allocated by hugetlb_prefault_regions() */
+	return 0;
+}
+
+static size_t prefault_chunk_size(const struct vm_mmap_mem_region *region)
+{
+	return (region->pg_size > PREFAULT_CHUNK_SIZE) ? region->pg_size : PREFAULT_CHUNK_SIZE;
+}
+
+static int prefault_region_chunks(const struct vm_mmap_mem_region *region)
+{
+	size_t chunk_size = prefault_chunk_size(region);
 
-	pr_info("touch %ld pages with pagesz 0x%lx\n", len/pagesz, pagesz);
+	return (region->gpa_end - region->gpa_start + chunk_size - 1) / chunk_size;
+}
 
-	for (i = 0; i < len/pagesz; i++) {
+/*
+ * Pre-allocate the hugepages of [addr, addr + len) by write faulting them, the kernel
+ * zeroes each hugepage at its first fault. MADV_POPULATE_WRITE faults the whole range in
+ * one call and reports a failed allocation as an error instead of a SIGBUS, the pages are
+ * touched one by one on kernels without it.
+ */
+static int prefault_range(char *addr, size_t len, size_t pagesz)
+{
+	size_t i;
+
+	if (madvise(addr, len, MADV_POPULATE_WRITE) == 0)
+		return 0;
+	if (errno != EINVAL)
+		return -errno;
+
+	for (i = 0; i < len / pagesz; i++) {
 		*(volatile char *)addr = *addr;
 		addr += pagesz;
 	}
@@ -253,6 +317,150 @@ static int mmap_hugetlbfs_from_level(struct vmctx *ctx, int level, size_t len,
 	return 0;
 }
 
+/*
+ * Zero [addr, addr + len) in place. Unlike punching the pages out of the memfd, this
+ * keeps the hugepages, so the EPT mappings of the VM stay valid.
+ */
+static int zero_range(char *addr, size_t len, size_t pagesz __attribute__((unused)))
+{
+	memset(addr, 0, len);
+	return 0;
+}
+
+/*
+ * Locate the chunk-th chunk of all the regions, and turn chunk into its index within
+ * its region. The regions are enumerated in the same order by all threads.
+ *
+ * @pre chunk < the chunks of all the regions
+ */
+static struct vm_mmap_mem_region *chunk_to_region(int *chunk)
+{
+	struct vm_mmap_mem_region *region = &mmap_mem_regions[0];
+	int i;
+
+	for (i = 0; i < mem_idx; i++) {
+		region = &mmap_mem_regions[i];
+		if (*chunk < prefault_region_chunks(region))
+			break;
+		*chunk -= prefault_region_chunks(region);
+	}
+	assert(i < mem_idx);
+
+	return region;
+}
+
+static void *region_work_thread(void *arg)
+{
+	struct region_work *work = arg;
+	struct vm_mmap_mem_region *region;
+	size_t chunk_size, offset, len;
+	int chunk, ret;
+
+	while ((chunk = __sync_fetch_and_add(&work->next_chunk, 1)) < work->nr_chunks) {
+		region = chunk_to_region(&chunk);
+
+		chunk_size = prefault_chunk_size(region);
+		offset = chunk * chunk_size;
+		len = region->gpa_end - region->gpa_start - offset;
+		if (len > chunk_size)
+			len = chunk_size;
+
+		ret = work->op(region->hva_base + offset, len, region->pg_size);
+		if (ret < 0) {
+			__sync_bool_compare_and_swap(&work->error, 0, ret);
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Run op over all the mapped regions. The regions are split into chunks that
+ * threads threads, the calling thread included, claim in turn, so the work on
+ * a large VM memory is spread over several CPUs.
+ */
+static int run_region_work(int (*op)(char *, size_t, size_t), const char *name, int threads)
+{
+	struct region_work work = { .op = op, .next_chunk = 0, .nr_chunks = 0, .error = 0 };
+	pthread_t tids[PREFAULT_THREADS_MAX];
+	struct timespec start, end;
+	int i, nr_threads;
+
+	for (i = 0; i < mem_idx; i++)
+		work.nr_chunks += prefault_region_chunks(&mmap_mem_regions[i]);
+
+	nr_threads = (threads < work.nr_chunks) ? threads : work.nr_chunks;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nr_threads - 1; i++) {
+		if (pthread_create(&tids[i], NULL, region_work_thread, &work) != 0) {
+			pr_warn("failed to create %s thread %d\n", name, i);
+			break;
+		}
+		pthread_setname_np(tids[i], name);
+	}
+	nr_threads = i + 1;
+
+	region_work_thread(&work);
+	for (i = 0; i < nr_threads - 1; i++)
+		pthread_join(tids[i], NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	pr_info("%s %d chunks with %d threads in %ld ms\n", name, work.nr_chunks, nr_threads,
+		(end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000);
+	if (work.error < 0)
+		pr_err("%s failed: %d\n", name, work.error);
+
+	return work.error;
+}
+
+/* Pre-allocate the hugepages of all the mapped regions. */
+static int hugetlb_prefault_regions(void)
+{
+	return run_region_work(prefault_range, "prefault", prefault_threads);
+}
+
+/*
+ * Zero the memory of the VM for a warm reset, the mappings of the DM and of the
+ * hypervisor are kept. The VM is paused meanwhile, so all the online CPUs are used.
+ */
+int hugetlb_zero_mem_regions(void)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (cpus < 1)
+		cpus = 1;
+	else if (cpus > PREFAULT_THREADS_MAX)
+		cpus = PREFAULT_THREADS_MAX;
+
+	return run_region_work(zero_range, "memzero", (int)cpus);
+}
+
+int hugetlb_parse_prefault_threads(const char *opt)
+{
+	char *end;
+	int threads;
+
+	if (dm_strtoi(opt, &end, 10, &threads) != 0 || *end != '\0' ||
+			threads < 1 || threads > PREFAULT_THREADS_MAX)
+		return -1;
+
+	prefault_threads = threads;
+	return 0;
+}
+
+int hugetlb_parse_broker(const char *opt)
+{
+	if (!*opt || strnlen(opt, sizeof(broker_addr.sun_path)) >=
+			sizeof(broker_addr.sun_path))
+		return -1;
+
+	broker_addr.sun_family = AF_UNIX;
+	strncpy(broker_addr.sun_path, opt, sizeof(broker_addr.sun_path) - 1);
+	return 0;
+}
+
 static int mmap_hugetlbfs(struct vmctx *ctx, size_t offset,
 		void (*get_param)(struct hugetlb_info *, size_t *, size_t *),
 		size_t (*adj_param)(struct hugetlb_info *, struct hugetlb_info *, int), char **addr)
@@ -267,11 +475,13 @@ static int mmap_hugetlbfs(struct vmctx *ctx, size_t offset,
 		while (len > 0) {
 			ret = mmap_hugetlbfs_from_level(ctx, level, len, offset, skip, addr);
 
-			if (ret < 0 && level > HUGETLB_LV1) {
+			/* a leased slice can't be moved to the lower level */
+			if (ret < 0 && level > HUGETLB_LV1 &&
+					!hugetlb_priv[level].leased) {
 				len = adj_param(
 						&hugetlb_priv[level], &hugetlb_priv[level-1],
 						pg_size);
-			} else if (ret < 0 && level == HUGETLB_LV1) {
+			} else if (ret < 0) {
 				goto done;
 			} else {
 				offset += len;
@@ -598,6 +808,95 @@ void uninit_hugetlb(void)
 	close(lock_fd);
 }
 
+/* lease the memory of each level from the broker, instead of reserving it */
+static int hugetlb_broker_lease(void)
+{
+	char buf[CMSG_SPACE(sizeof(int) * HUGETLB_BROKER_LV_MAX)];
+	struct hugetlb_broker_req req;
+	struct hugetlb_broker_ack ack;
+	struct iovec iov = { .iov_base = &ack, .iov_len = sizeof(ack) };
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	int fds[HUGETLB_BROKER_LV_MAX];
+	int level, i, nr_fds = 0, nr_recv = 0;
+	ssize_t len;
+
+	memset(&req, 0, sizeof(req));
+	req.magic = HUGETLB_BROKER_MAGIC;
+	strncpy(req.vmname, vmname, MAX_VM_NAME_LEN - 1);
+	for (level = HUGETLB_LV1; level < hugetlb_lv_max; level++) {
+		if (hugetlb_priv[level].fd < 0)
+			continue;
+		req.size[level] = hugetlb_priv[level].lowmem +
+				  hugetlb_priv[level].fbmem +
+				  hugetlb_priv[level].biosmem +
+				  hugetlb_priv[level].highmem;
+		if (req.size[level])
+			nr_fds++;
+	}
+
+	broker_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (broker_fd < 0)
+		return -1;
+	if (connect(broker_fd, (struct sockaddr *)&broker_addr, sizeof(broker_addr)) < 0 ||
+		send(broker_fd, &req, sizeof(req), MSG_NOSIGNAL) != sizeof(req)) {
+		pr_err("can't reach hugetlb broker %s: %s\n",
+			broker_addr.sun_path, strerror(errno));
+		goto err;
+	}
+
+	memset(&ack, 0, sizeof(ack));
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = buf;
+	msg.msg_controllen = sizeof(buf);
+	len = recvmsg(broker_fd, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+	if (len > 0) {
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+				continue;
+			nr_recv = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			memcpy(fds, CMSG_DATA(cmsg), nr_recv * sizeof(int));
+		}
+	}
+
+	if (len != sizeof(ack) || ack.magic != HUGETLB_BROKER_MAGIC ||
+		ack.err != 0 || nr_recv != nr_fds) {
+		pr_err("hugetlb broker didn't lease the memory, err: %d\n", ack.err);
+		for (i = 0; i < nr_recv; i++)
+			close(fds[i]);
+		goto err;
+	}
+
+	for (i = 0, level = HUGETLB_LV1; level < hugetlb_lv_max; level++) {
+		if (!req.size[level])
+			continue;
+		close_hugetlbfs(level);
+		hugetlb_priv[level].fd = fds[i++];
+		hugetlb_priv[level].leased = true;
+		hugetlb_priv[level].fd_base = ack.offset[level];
+		pr_info("level %d leased 0x%llx@0x%llx from hugetlb broker\n",
+			level, req.size[level], ack.offset[level]);
+	}
+
+	return 0;
+
+err:
+	close(broker_fd);
+	broker_fd = -1;
+	return -1;
+}
+
+/* give the leased memory back to the broker, once it is unmapped and closed */
+static void hugetlb_broker_release(void)
+{
+	if (broker_fd >= 0) {
+		close(broker_fd);
+		broker_fd = -1;
+	}
+}
+
 int hugetlb_setup_memory(struct vmctx *ctx)
 {
 	int level;
@@ -685,13 +984,19 @@ int hugetlb_setup_memory(struct vmctx *ctx)
 		}
 	}
 
-	lock_acrn_hugetlb();
+	if (broker_addr.sun_path[0] && hugetlb_broker_lease() < 0)
+		pr_warn("reserve hugepages without hugetlb broker\n");
+
+	/* the leased memory is reserved by the broker already */
+	if (broker_fd < 0) {
+		lock_acrn_hugetlb();
 
-	/* it will check each level memory need */
-	has_gap = hugetlb_check_memgap();
-	if (has_gap) {
-		if (!hugetlb_reserve_pages())
-			goto err_lock;
+		/* it will check each level memory need */
+		has_gap = hugetlb_check_memgap();
+		if (has_gap) {
+			if (!hugetlb_reserve_pages())
+				goto err_lock;
+		}
 	}
 
 	/* align up total size with huge page size for vma alignment */
@@ -759,11 +1064,15 @@ int hugetlb_setup_memory(struct vmctx *ctx)
 		goto err_lock;
 	}
 
+	/* pre-allocate hugepages of lowmem, highmem, biosmem and fbmem */
+	if (hugetlb_prefault_regions() < 0)
+		goto err_lock;
+
 	/* resize the memfd to meet with the size requirement and add the
-	 * F_SEAL_SEAL flag
+	 * F_SEAL_SEAL flag, the memfd of the broker is sealed already
 	 */
 	for (level = HUGETLB_LV1; level < hugetlb_lv_max; level++) {
-		if (hugetlb_priv[level].fd > 0) {
+		if (hugetlb_priv[level].fd > 0 && !hugetlb_priv[level].leased) {
 			mem_size_level = hugetlb_priv[level].lowmem +
 					 hugetlb_priv[level].highmem +
 					 hugetlb_priv[level].biosmem +
@@ -783,8 +1092,8 @@ int hugetlb_setup_memory(struct vmctx *ctx)
 		}
 	}
 
-
-	unlock_acrn_hugetlb();
+	if (broker_fd < 0)
+		unlock_acrn_hugetlb();
 
 	/* dump hugepage really setup */
 	pr_info("\nreally setup hugepage with:\n");
@@ -825,7 +1134,8 @@ int hugetlb_setup_memory(struct vmctx *ctx)
 	return 0;
 
 err_lock:
-	unlock_acrn_hugetlb();
+	if (broker_fd < 0)
+		unlock_acrn_hugetlb();
 err:
 	if (ptr) {
 		munmap(ptr, total_size);
@@ -834,6 +1144,7 @@ err:
 	for (level = HUGETLB_LV1; level < hugetlb_lv_max; level++) {
 		close_hugetlbfs(level);
 	}
+	hugetlb_broker_release();
 
 	return -ENOMEM;
 }
@@ -851,6 +1162,7 @@ void hugetlb_unsetup_memory(struct vmctx *ctx)
 	for (level = HUGETLB_LV1; level < hugetlb_lv_max; level++) {
 		close_hugetlbfs(level);
 	}
+	hugetlb_broker_release();
 }
 
 bool
@@ -881,6 +1193,23 @@ vm_find_memfd_region(struct vmctx *ctx, vm_paddr_t gpa,
 	return ret;
 }
 
+int
+hugetlb_walk_mem_regions(hugetlb_region_cb cb, void *arg)
+{
+	struct vm_mmap_mem_region *region;
+	int i, ret;
+
+	for (i = 0; i < mem_idx; i++) {
+		region = &mmap_mem_regions[i];
+		ret = cb(region->gpa_start, region->hva_base,
+			region->gpa_end - region->gpa_start, arg);
+		if (ret != 0)
+			return ret;
+	}
+
+	return 0;
+}
+
 bool vm_allow_dmabuf(struct vmctx *ctx)
 {
 	uint32_t mem_flags;
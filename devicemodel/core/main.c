@@ -37,6 +37,7 @@
 #include <sysexits.h>
 #include <stdbool.h>
 #include <getopt.h>
+#include <time.h>
 
 #include "vmmapi.h"
 #include "sw_load.h"
@@ -58,6 +59,7 @@
 #include "version.h"
 #include "sw_load.h"
 #include "monitor.h"
+#include "acrn_mngr.h"
 #include "ioc.h"
 #include "pm.h"
 #include "atomic.h"
@@ -70,6 +72,7 @@
 #include "vssram.h"
 #include "cmd_monitor.h"
 #include "vdisplay.h"
+#include "snapshot.h"
 
 #define	VM_MAXCPU		16	/* maximum virtual cpus */
 
@@ -100,12 +103,16 @@ bool vtpm2;
 bool is_winvm;
 bool skip_pci_mem64bar_workaround = false;
 bool gfx_ui = false;
+bool warm_reset;
+bool migratable;
 
 static int guest_ncpus;
 static int virtio_msix = 1;
 static bool debugexit_enabled;
 static int pm_notify_channel;
 static bool cmd_monitor;
+static bool hold_start;
+static int mptgen;
 
 static char *progname;
 static const int BSP;
@@ -151,7 +158,8 @@ usage(int code)
 		"       %*s [--vtpm2 sock_path] [--virtio_poll interval]\n"
 		"       %*s [--cpu_affinity lapic_id] [--lapic_pt] [--rtvm] [--windows]\n"
 		"       %*s [--debugexit] [--logger_setting param_setting]\n"
-		"       %*s [--ssram] <vm>\n"
+		"       %*s [--ssram] [--prefault_threads num] [--restore file]\n"
+		"       %*s [--hugetlb_broker sock_path] [--warm_reset] [--migratable] <vm>\n"
 		"       -B: bootargs for kernel\n"
 		"       -E: elf image path\n"
 		"       -h: help\n"
@@ -180,12 +188,17 @@ usage(int code)
 		"       --logger_setting: params like console,level=4;kmsg,level=3\n"
 		"       --windows: support Oracle virtio-blk, virtio-net and virtio-input devices\n"
 		"            for windows guest with secure boot\n"
-		"       --virtio_msi: force virtio to use single-vector MSI\n",
+		"       --virtio_msi: force virtio to use single-vector MSI\n"
+		"       --prefault_threads: # of threads pre-allocating the VM memory, 1 ~ 64\n"
+		"       --restore: start the VM from a snapshot file or unix:<socket path>\n"
+		"       --hugetlb_broker: lease the VM memory from the hugetlb broker of acrnd\n"
+		"       --warm_reset: reset the VM in place, keeping its memory and devices\n"
+		"       --migratable: track the pages written by the VM, so it can be migrated\n",
 		progname, (int)strnlen(progname, PATH_MAX), "", (int)strnlen(progname, PATH_MAX), "",
 		(int)strnlen(progname, PATH_MAX), "", (int)strnlen(progname, PATH_MAX), "",
 		(int)strnlen(progname, PATH_MAX), "", (int)strnlen(progname, PATH_MAX), "",
 		(int)strnlen(progname, PATH_MAX), "", (int)strnlen(progname, PATH_MAX), "",
-		(int)strnlen(progname, PATH_MAX), "");
+		(int)strnlen(progname, PATH_MAX), "", (int)strnlen(progname, PATH_MAX), "");
 
 	exit(code);
 }
@@ -212,7 +225,13 @@ print_version(void)
 void *
 paddr_guest2host(struct vmctx *ctx, uintptr_t gaddr, size_t len)
 {
-	return vm_map_gpa(ctx, gaddr, len);
+	void *hva;
+
+	/* the caller may write through the mapping */
+	hva = vm_map_gpa(ctx, gaddr, len);
+	if (hva != NULL)
+		vm_mark_dirty(gaddr, len);
+	return hva;
 }
 
 int
@@ -249,7 +268,7 @@ start_thread(void *param)
 }
 
 static int
-add_cpu(struct vmctx *ctx, int vcpu_num)
+add_cpu(struct vmctx *ctx, int vcpu_num, bool restored)
 {
 	int i;
 	int error;
@@ -261,7 +280,9 @@ add_cpu(struct vmctx *ctx, int vcpu_num)
 		mt_vmm_info[i].mt_vcpu = i;
 	}
 
-	vm_set_vcpu_regs(ctx, &ctx->bsp_regs);
+	/* a restored BSP resumes from its saved state */
+	if (!restored)
+		vm_set_vcpu_regs(ctx, &ctx->bsp_regs);
 
 	error = pthread_create(&mt_vmm_info[0].mt_thr, NULL,
 	    start_thread, &mt_vmm_info[0]);
@@ -660,6 +681,70 @@ vm_system_reset(struct vmctx *ctx)
 	vm_run(ctx);
 }
 
+/*
+ * Reset the VM without tearing it down, with --warm_reset. The memory stays
+ * mapped, in the DM and in the EPT, and is only wiped, and the PCI devices
+ * are reset in place instead of a deinit/init. A full reset gets here too,
+ * see vm_set_suspend_mode().
+ */
+static void
+vm_warm_reset(struct vmctx *ctx)
+{
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	/* see vm_system_reset() */
+	vm_pause(ctx);
+	vm_clear_ioreq(ctx);
+
+	acrn_writeback_ovmf_nvstorage(ctx);
+
+	/*
+	 * Quiesce all the PCI devices first, so that no backend I/O, e.g. a
+	 * blockif request or a virtio-net tx/rx, writes to the memory after
+	 * it is zeroed. The IRQs of the PCI devices are kept, so is the ioapic
+	 * pin allocation.
+	 */
+	if (pci_reset_vdevs(ctx) != 0)
+		pr_err("%s: failed to reset the PCI devices\n", __func__);
+
+	/* mitigate reset attack, as vm_setup_memory() does */
+	hugetlb_zero_mem_regions();
+
+	atkbdc_deinit(ctx);
+	if (debugexit_enabled)
+		deinit_debugexit();
+	vhpet_deinit(ctx);
+	vpit_deinit(ctx);
+	vrtc_deinit(ctx);
+
+	atkbdc_init(ctx);
+	vrtc_init(ctx);
+	vpit_init(ctx);
+	vhpet_init(ctx);
+	if (debugexit_enabled)
+		init_debugexit();
+
+	vm_reset(ctx);
+	pr_info("%s: setting VM state to %s\n", __func__, vm_state_to_str(VM_SUSPEND_NONE));
+	vm_set_suspend_mode(VM_SUSPEND_NONE);
+
+	/* the guest tables were wiped with the memory */
+	if (mptgen)
+		mptable_build(ctx, guest_ncpus);
+	acpi_build(ctx, guest_ncpus);
+
+	/* set the BSP init state */
+	acrn_sw_load(ctx);
+	vm_set_vcpu_regs(ctx, &ctx->bsp_regs);
+	vm_run(ctx);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	pr_notice("%s: done in %ld ms\n", __func__,
+		(end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000);
+}
+
 static void
 vm_suspend_resume(struct vmctx *ctx)
 {
@@ -726,7 +811,10 @@ vm_loop(struct vmctx *ctx)
 
 		/* RTVM can't be reset */
 		if ((VM_SUSPEND_SYSTEM_RESET == vm_get_suspend_mode()) && (!is_rtvm)) {
-			vm_system_reset(ctx);
+			if (warm_reset)
+				vm_warm_reset(ctx);
+			else
+				vm_system_reset(ctx);
 		}
 
 		if (VM_SUSPEND_SUSPEND == vm_get_suspend_mode()) {
@@ -778,6 +866,11 @@ enum {
 	CMD_OPT_PM_BY_VUART,
 	CMD_OPT_WINDOWS,
 	CMD_OPT_FORCE_VIRTIO_MSI,
+	CMD_OPT_PREFAULT_THREADS,
+	CMD_OPT_RESTORE,
+	CMD_OPT_HUGETLB_BROKER,
+	CMD_OPT_WARM_RESET,
+	CMD_OPT_MIGRATABLE,
 };
 
 static struct option long_options[] = {
@@ -819,6 +912,11 @@ static struct option long_options[] = {
 	{"pm_by_vuart",	required_argument,	0, CMD_OPT_PM_BY_VUART},
 	{"windows",		no_argument,		0, CMD_OPT_WINDOWS},
 	{"virtio_msi",		no_argument,		0, CMD_OPT_FORCE_VIRTIO_MSI},
+	{"prefault_threads",	required_argument,	0, CMD_OPT_PREFAULT_THREADS},
+	{"restore",		required_argument,	0, CMD_OPT_RESTORE},
+	{"hugetlb_broker",	required_argument,	0, CMD_OPT_HUGETLB_BROKER},
+	{"warm_reset",		no_argument,		0, CMD_OPT_WARM_RESET},
+	{"migratable",		no_argument,		0, CMD_OPT_MIGRATABLE},
 	{0,			0,			0,  0  },
 };
 
@@ -828,10 +926,11 @@ int
 main(int argc, char *argv[])
 {
 	int c, error, ret=1;
-	int max_vcpus, mptgen;
+	int max_vcpus;
 	struct vmctx *ctx;
 	size_t memsize;
 	int option_idx = 0;
+	bool restored;
 
 	progname = basename(argv[0]);
 	memsize = 256 * MB;
@@ -1010,6 +1109,24 @@ main(int argc, char *argv[])
 		case CMD_OPT_FORCE_VIRTIO_MSI:
 			virtio_msix = 0;
 			break;
+		case CMD_OPT_PREFAULT_THREADS:
+			if (hugetlb_parse_prefault_threads(optarg) != 0)
+				errx(EX_USAGE, "invalid prefault threads %s", optarg);
+			break;
+		case CMD_OPT_RESTORE:
+			if (acrn_parse_restore(optarg) != 0)
+				errx(EX_USAGE, "invalid restore file %s", optarg);
+			break;
+		case CMD_OPT_HUGETLB_BROKER:
+			if (hugetlb_parse_broker(optarg) != 0)
+				errx(EX_USAGE, "invalid hugetlb broker socket %s", optarg);
+			break;
+		case CMD_OPT_WARM_RESET:
+			warm_reset = true;
+			break;
+		case CMD_OPT_MIGRATABLE:
+			migratable = true;
+			break;
 		case 'h':
 			usage(0);
 		default:
@@ -1030,6 +1147,11 @@ main(int argc, char *argv[])
 	}
 	vmname = argv[0];
 
+	/* set by acrnd for the VMs it keeps ready in a pool */
+	hold_start = (getenv(ACRN_DM_HOLD_ENV) != NULL);
+	if (hold_start)
+		vm_expect_hold();
+
 	if (strnlen(vmname, MAX_VM_NAME_LEN) >= MAX_VM_NAME_LEN) {
 		pr_err("The name of the VM exceeds the maximum length: %u\n", MAX_VM_NAME_LEN - 1);
 		exit(1);
@@ -1083,6 +1205,11 @@ main(int argc, char *argv[])
 			goto dev_fail;
 		}
 
+		if (warm_reset && (is_rtvm || ssram || !pci_vdevs_resettable())) {
+			pr_warn("warm reset isn't supported by the VM, a reset recreates it\n");
+			warm_reset = false;
+		}
+
 		/*
 		 * build the guest tables, MP etc.
 		 */
@@ -1099,11 +1226,31 @@ main(int argc, char *argv[])
 			goto vm_fail;
 		}
 
-		pr_notice("acrn_sw_load\n");
-		error = acrn_sw_load(ctx);
-		if (error) {
-			pr_err("acrn_sw_load failed, error=%d\n", error);
-			goto vm_fail;
+		restored = vm_restore_enabled();
+		if (restored) {
+			pr_notice("vm_restore\n");
+			error = vm_restore(ctx);
+			if (error) {
+				pr_err("vm_restore failed, error=%d\n", error);
+				goto vm_fail;
+			}
+		} else {
+			pr_notice("acrn_sw_load\n");
+			error = acrn_sw_load(ctx);
+			if (error) {
+				pr_err("acrn_sw_load failed, error=%d\n", error);
+				goto vm_fail;
+			}
+		}
+
+		/* only the first start is held, a reset boots the VM right away */
+		if (hold_start) {
+			hold_start = false;
+			pr_notice("wait_for_start\n");
+			if (wait_for_start(ctx) != 0) {
+				ret = 0;
+				goto vm_fail;
+			}
 		}
 
 		/*
@@ -1115,7 +1262,7 @@ main(int argc, char *argv[])
 		 * Add CPU 0
 		 */
 		pr_notice("add_cpu\n");
-		error = add_cpu(ctx, guest_ncpus);
+		error = add_cpu(ctx, guest_ncpus, restored);
 		if (error) {
 			pr_err("add_cpu failed, error=%d\n", error);
 			goto vm_fail;
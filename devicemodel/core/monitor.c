@@ -34,6 +34,7 @@
 
 struct intr_monitor_setting_t {
 	bool enable;
+	bool adaptive;	/* storm detection and delay are done by the hypervisor per interrupt source */
 	uint32_t threshold;    /* intr count in probe_period when intr storm happens */
 	uint32_t probe_period;  /* seconds: the period to probe intr data */
 	uint32_t delay_time;      /* ms: the time to delay each intr injection */
@@ -170,7 +171,19 @@ static void *intr_storm_monitor_thread(void *arg)
 
 static void start_intr_storm_monitor(struct vmctx *ctx)
 {
-	if (intr_monitor_setting.enable) {
+	if (intr_monitor_setting.enable && intr_monitor_setting.adaptive) {
+		struct acrn_intr_monitor *hdr = &intr_data.monitor;
+
+		hdr->cmd = INTR_CMD_SET_ADAPTIVE;
+		hdr->buf_cnt = 2;
+		/* the hypervisor checks the rate per ms */
+		hdr->buffer[0] = (intr_monitor_setting.threshold + 999) / 1000;
+		hdr->buffer[1] = intr_monitor_setting.delay_time * 1000;
+		if (vm_intr_monitor(ctx, hdr))
+			pr_err("failed to enable adaptive interrupt storm mitigation\n");
+		else
+			pr_info("adaptive interrupt storm mitigation enabled\n");
+	} else if (intr_monitor_setting.enable) {
 		int ret = pthread_create(&intr_storm_monitor_pid, NULL, intr_storm_monitor_thread, ctx);
 		if (ret) {
 			pr_err("failed %s %d\n", __func__, __LINE__);
@@ -201,12 +214,28 @@ static void stop_intr_storm_monitor(void)
 .* probe_period: seconds -- the period to probe intr data;
 .* delay_time: ms -- the time to delay each intr injection;
  * delay_duration; us -- the delay duration, after it, intr injection restore to normal
+ *
+ * or "adaptive,threshold,max_delay_time" to let the hypervisor detect the storm of each
+ * interrupt source and back off its injection delay exponentially up to max_delay_time (ms).
 .*/
 int acrn_parse_intr_monitor(const char *opt)
 {
 	uint32_t threshold, period, delay, duration;
 	char *cp;
 
+	if (strncmp(opt, "adaptive,", strlen("adaptive,")) == 0) {
+		if ((!dm_strtoui(opt + strlen("adaptive,"), &cp, 10, &threshold) && *cp == ',') &&
+			(!dm_strtoui(cp + 1, &cp, 10, &delay) && *cp == '\0') && (threshold != 0U)) {
+			intr_monitor_setting.enable = true;
+			intr_monitor_setting.adaptive = true;
+			intr_monitor_setting.threshold = threshold;
+			intr_monitor_setting.delay_time = delay;
+			return 0;
+		}
+		pr_err("%s: not correct, it should be like: --intr_monitor adaptive,10000,1, please check!\n", opt);
+		return -1;
+	}
+
 	if((!dm_strtoui(opt, &cp, 10, &threshold) && *cp == ',') &&
 		(!dm_strtoui(cp + 1, &cp, 10, &period) && *cp == ',') &&
 		(!dm_strtoui(cp + 1, &cp, 10, &delay) && *cp == ',') &&
@@ -338,6 +367,7 @@ static void name(struct mngr_msg *msg, int client_fd, void *param)	\
 }
 
 DEFINE_HANDLER(handle_suspend, suspend);
+DEFINE_HANDLER(handle_continue, unpause);
 
 static void handle_stop(struct mngr_msg *msg, int client_fd, void *param)
 {
@@ -350,7 +380,10 @@ static void handle_stop(struct mngr_msg *msg, int client_fd, void *param)
 	ack.msgid = msg->msgid;
 	ack.timestamp = msg->timestamp;
 
-	if (msg->data.acrnd_stop.force && !is_rtvm) {
+	/* a VM held before its start has nothing to shut down in the guest */
+	if (vm_release_hold(VM_SUSPEND_POWEROFF) == 0) {
+		ack.data.err = 0;
+	} else if (msg->data.acrnd_stop.force && !is_rtvm) {
 		pr_info("%s: setting VM state to %s\n", __func__, vm_state_to_str(VM_SUSPEND_POWEROFF));
 		vm_set_suspend_mode(VM_SUSPEND_POWEROFF);
 		ack.data.err = 0;
@@ -455,7 +488,7 @@ static struct monitor_vm_ops pmc_ops = {
 	.resume     = vm_monitor_resume,
 	.suspend    = NULL,
 	.pause      = NULL,
-	.unpause    = NULL,
+	.unpause    = vm_monitor_unpause,
 	.query      = vm_monitor_query,
 };
 
@@ -490,6 +523,7 @@ int monitor_init(struct vmctx *ctx)
 	ret += mngr_add_handler(monitor_fd, DM_RESUME, handle_resume, NULL);
 	ret += mngr_add_handler(monitor_fd, DM_QUERY, handle_query, NULL);
 	ret += mngr_add_handler(monitor_fd, DM_BLKRESCAN, handle_blkrescan, NULL);
+	ret += mngr_add_handler(monitor_fd, DM_CONTINUE, handle_continue, NULL);
 
 	if (ret) {
 		pr_err("%s %d\r\n", __func__, __LINE__);
@@ -12,6 +12,10 @@
 static pthread_cond_t suspend_cond = PTHREAD_COND_INITIALIZER;
 static pthread_mutex_t suspend_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/* wait_for_start() is still to come, and a stop that came in before it */
+static bool hold_expected;
+static enum vm_suspend_how hold_stop = VM_SUSPEND_NONE;
+
 int
 wait_for_resume(struct vmctx *ctx)
 {
@@ -50,3 +54,75 @@ vm_monitor_query(void *arg)
 {
 	return vm_get_suspend_mode();
 }
+
+/*
+ * Note that the VM will be held by wait_for_start(), so that a stop coming
+ * in while it is still being set up is kept for then instead of being lost.
+ */
+void
+vm_expect_hold(void)
+{
+	pthread_mutex_lock(&suspend_mutex);
+	hold_expected = true;
+	pthread_mutex_unlock(&suspend_mutex);
+}
+
+/*
+ * Hold a VM whose memory, devices and guest software are set up, until
+ * vm_release_hold() is called.
+ *
+ * @return 0 when the VM is to be started, -1 when it is to be stopped.
+ */
+int
+wait_for_start(struct vmctx *ctx)
+{
+	pthread_mutex_lock(&suspend_mutex);
+	hold_expected = false;
+	if (hold_stop != VM_SUSPEND_NONE) {
+		pr_info("%s: setting VM state to %s\n", __func__, vm_state_to_str(hold_stop));
+		vm_set_suspend_mode(hold_stop);
+	} else {
+		pr_info("%s: setting VM state to %s\n", __func__, vm_state_to_str(VM_SUSPEND_HOLD));
+		vm_set_suspend_mode(VM_SUSPEND_HOLD);
+	}
+	while (vm_get_suspend_mode() == VM_SUSPEND_HOLD) {
+		pthread_cond_wait(&suspend_cond, &suspend_mutex);
+	}
+	pthread_mutex_unlock(&suspend_mutex);
+
+	return (vm_get_suspend_mode() == VM_SUSPEND_NONE) ? 0 : -1;
+}
+
+/*
+ * Let a held VM go on with the state how, VM_SUSPEND_NONE to start it.
+ * A stop for a VM that is still being set up to be held is kept until
+ * wait_for_start(), which then returns right away.
+ *
+ * @return 0 on success, -1 if the VM is not held.
+ */
+int
+vm_release_hold(enum vm_suspend_how how)
+{
+	int ret = -1;
+
+	pthread_mutex_lock(&suspend_mutex);
+	if (vm_get_suspend_mode() == VM_SUSPEND_HOLD) {
+		pr_info("%s: setting VM state to %s\n", __func__, vm_state_to_str(how));
+		vm_set_suspend_mode(how);
+		pthread_cond_signal(&suspend_cond);
+		ret = 0;
+	} else if (hold_expected && (how != VM_SUSPEND_NONE)) {
+		pr_info("%s: VM not held yet, keeping %s\n", __func__, vm_state_to_str(how));
+		hold_stop = how;
+		ret = 0;
+	}
+	pthread_mutex_unlock(&suspend_mutex);
+
+	return ret;
+}
+
+int
+vm_monitor_unpause(void *arg)
+{
+	return vm_release_hold(VM_SUSPEND_NONE);
+}
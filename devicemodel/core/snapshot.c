@@ -0,0 +1,802 @@
+/*
+ * Copyright (C) 2022 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * VM snapshot and restore
+ *
+ * A snapshot is taken from a paused VM, once all the virtio backends have
+ * completed the requests they took from the guest. The file holds, in the
+ * order they are restored:
+ *   - guest RAM,
+ *   - the PCI config space and MSI-X table of every emulated PCI device,
+ *   - the transport state of every virtio device,
+ *   - the vLAPIC of every vCPU, the vIOAPIC and the vPIC,
+ *   - the register state of every vCPU.
+ *
+ * A restore is done on a created but not yet started VM, in place of
+ * loading the guest software. The guest RAM is read into the hugetlb
+ * backed guest memory, which the hypervisor has already mapped in EPT,
+ * so it can't be replaced by a copy-on-write mapping of the file.
+ *
+ * A migration sends the same stream to a device model restoring from a
+ * unix socket. Guest RAM is first copied while the VM runs, then the pages
+ * written since the previous pass are sent again, until few enough are
+ * left to send them with the device states once the VM is paused. The
+ * pages written by the guest are logged by the hypervisor, the ones written
+ * by the device model are marked by paddr_guest2host() and only sent in the
+ * last pass, as a backend may still write a page it mapped earlier.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "dm.h"
+#include "vmmapi.h"
+#include "pci_core.h"
+#include "virtio.h"
+#include "snapshot.h"
+#include "log.h"
+
+/* how long to wait for the virtio backends to complete in-flight requests */
+#define SNAPSHOT_QUIESCE_RETRIES	1000
+#define SNAPSHOT_QUIESCE_INTERVAL_US	1000
+
+/* prefix of a snapshot destination or restore source being a unix socket */
+#define SNAPSHOT_UNIX_PREFIX		"unix:"
+
+/* pre-copy passes stop at this count, or once few pages are left to send */
+#define MIGRATE_PASSES_MAX		30
+#define MIGRATE_DIRTY_PAGES_MIN		256UL
+
+#define PCI_VDEV_BDF(dev)	(((dev)->bus << 8) | ((dev)->slot << 3) | (dev)->func)
+
+struct snapshot_pci_state {
+	uint8_t cfgdata[PCI_REGMAX + 1];
+	uint32_t msix_table_count;
+	uint32_t reserved;
+	struct msix_table_entry msix_table[];
+};
+
+struct snapshot_arg {
+	struct vmctx *ctx;
+	int fd;
+};
+
+struct migrate_arg {
+	struct vmctx *ctx;
+	int fd;
+	uint64_t *bitmap;	/* dirty bitmap of a region, from the hypervisor */
+	size_t dirty;		/* dirty pages sent in the pass */
+	bool first;
+	bool last;
+};
+
+static char *restore_path;
+
+/* pages written by the device model during a migration, one bit per page */
+static uint64_t *dm_dirty;
+static size_t dm_dirty_pages;
+static bool dm_dirty_on;
+
+static bool
+is_virtio_vdev(struct pci_vdev *dev)
+{
+	return strncmp(dev->dev_ops->class_name, "virtio-", 7) == 0;
+}
+
+static int
+check_vdev(struct pci_vdev *dev, void *arg)
+{
+	struct virtio_base *base;
+
+	if (strncmp(dev->dev_ops->class_name, "passthru", 8) == 0) {
+		pr_err("%s: passthrough device %s can't be saved\n", __func__, dev->name);
+		return -ENOTSUP;
+	}
+
+	if (is_virtio_vdev(dev)) {
+		base = dev->arg;
+		if (base->backend_type != BACKEND_VBSU) {
+			pr_err("%s: %s backend is not in the device model\n",
+				__func__, dev->name);
+			return -ENOTSUP;
+		}
+	}
+
+	return 0;
+}
+
+static int
+check_migrate_vdev(struct pci_vdev *dev, void *arg)
+{
+	/* the emulated DMA controllers keep guest memory mapped across requests */
+	if ((strcmp(dev->dev_ops->class_name, "ahci") == 0) ||
+	    (strcmp(dev->dev_ops->class_name, "xhci") == 0)) {
+		pr_err("%s: %s can't be migrated\n", __func__, dev->name);
+		return -ENOTSUP;
+	}
+
+	return check_vdev(dev, arg);
+}
+
+static int
+check_vdev_quiesced(struct pci_vdev *dev, void *arg)
+{
+	if (is_virtio_vdev(dev) && !virtio_is_quiesced(dev->arg))
+		return -EBUSY;
+
+	return 0;
+}
+
+static int
+save_ram(vm_paddr_t gpa, char *hva, size_t len, void *arg)
+{
+	struct snapshot_arg *sarg = arg;
+
+	return snapshot_fmt_write_ram(sarg->fd, gpa, hva, len, false);
+}
+
+static int
+save_pci_vdev(struct pci_vdev *dev, void *arg)
+{
+	struct snapshot_arg *sarg = arg;
+	struct snapshot_pci_state *pci;
+	uint32_t count;
+	size_t size;
+	int ret;
+
+	count = (dev->msix.table != NULL) ? dev->msix.table_count : 0U;
+	size = sizeof(*pci) + count * sizeof(struct msix_table_entry);
+	pci = calloc(1, size);
+	if (pci == NULL)
+		return -ENOMEM;
+
+	memcpy(pci->cfgdata, dev->cfgdata, sizeof(pci->cfgdata));
+	pci->msix_table_count = count;
+	if (count != 0U)
+		memcpy(pci->msix_table, dev->msix.table,
+			count * sizeof(struct msix_table_entry));
+
+	ret = snapshot_fmt_write_section(sarg->fd, SNAPSHOT_SEC_PCI,
+			PCI_VDEV_BDF(dev), 0, pci, size);
+	free(pci);
+	return ret;
+}
+
+static int
+save_virtio_vdev(struct pci_vdev *dev, void *arg)
+{
+	struct snapshot_arg *sarg = arg;
+	struct virtio_base_state *state;
+	size_t size;
+	int ret;
+
+	if (!is_virtio_vdev(dev))
+		return 0;
+
+	size = virtio_state_size(dev->arg);
+	state = calloc(1, size);
+	if (state == NULL)
+		return -ENOMEM;
+
+	virtio_save_state(dev->arg, state);
+	ret = snapshot_fmt_write_section(sarg->fd, SNAPSHOT_SEC_VIRTIO,
+			PCI_VDEV_BDF(dev), 0, state, size);
+	free(state);
+	return ret;
+}
+
+static int
+save_irqchip(struct vmctx *ctx, int fd, uint32_t type, uint16_t vcpu_id)
+{
+	struct acrn_irqchip_state state;
+
+	memset(&state, 0, sizeof(state));
+	state.type = type;
+	state.vcpu_id = vcpu_id;
+	if (vm_get_irqchip_state(ctx, &state) != 0)
+		return -1;
+
+	return snapshot_fmt_write_section(fd, SNAPSHOT_SEC_IRQCHIP,
+			(type << 16U) | vcpu_id, 0, &state, sizeof(state));
+}
+
+static int
+save_header(struct vmctx *ctx, int fd)
+{
+	struct snapshot_header hdr;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.ncpus = ctx->vcpu_num;
+	hdr.lowmem = ctx->lowmem;
+	hdr.highmem = ctx->highmem;
+	hdr.biosmem = ctx->biosmem;
+	hdr.fbmem = ctx->fbmem;
+	return snapshot_fmt_write_header(fd, &hdr);
+}
+
+/* Save everything but guest RAM, and end the stream */
+static int
+save_devices(struct vmctx *ctx, int fd)
+{
+	struct acrn_vcpu_state *vcpu;
+	struct snapshot_arg sarg;
+	int i, ret;
+
+	sarg.ctx = ctx;
+	sarg.fd = fd;
+	if ((pci_walk_vdevs(save_pci_vdev, &sarg) != 0) ||
+	    (pci_walk_vdevs(save_virtio_vdev, &sarg) != 0))
+		return -1;
+
+	for (i = 0; i < ctx->vcpu_num; i++) {
+		if (save_irqchip(ctx, fd, ACRN_IRQCHIP_VLAPIC, i) != 0)
+			return -1;
+	}
+	if ((save_irqchip(ctx, fd, ACRN_IRQCHIP_VIOAPIC, 0) != 0) ||
+	    (save_irqchip(ctx, fd, ACRN_IRQCHIP_VPIC, 0) != 0))
+		return -1;
+
+	vcpu = calloc(1, sizeof(*vcpu));
+	if (vcpu == NULL)
+		return -1;
+	ret = 0;
+	for (i = 0; i < ctx->vcpu_num; i++) {
+		memset(vcpu, 0, sizeof(*vcpu));
+		vcpu->vcpu_id = i;
+		ret = vm_get_vcpu_state(ctx, vcpu);
+		if (ret == 0)
+			ret = snapshot_fmt_write_section(fd, SNAPSHOT_SEC_VCPU, i, 0,
+					vcpu, sizeof(*vcpu));
+		if (ret != 0)
+			break;
+	}
+	free(vcpu);
+	if (ret != 0)
+		return -1;
+
+	return snapshot_fmt_finish(fd);
+}
+
+static bool
+is_unix_stream(const char *path)
+{
+	return strncmp(path, SNAPSHOT_UNIX_PREFIX, strlen(SNAPSHOT_UNIX_PREFIX)) == 0;
+}
+
+/*
+ * Open the snapshot stream of path, a file or "unix:<socket path>". To
+ * save, the socket is connected to. To restore, it is listened on until
+ * the saving side connects.
+ */
+static int
+open_stream(const char *path, bool restore)
+{
+	struct sockaddr_un addr;
+	const char *sock_path;
+	int fd, conn;
+
+	if (!is_unix_stream(path)) {
+		if (restore)
+			fd = open(path, O_RDONLY);
+		else
+			fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+		if (fd < 0)
+			pr_err("%s: failed to open %s: %s\n", __func__, path, strerror(errno));
+		return fd;
+	}
+
+	sock_path = path + strlen(SNAPSHOT_UNIX_PREFIX);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strnlen(sock_path, sizeof(addr.sun_path)) >= sizeof(addr.sun_path)) {
+		pr_err("%s: socket path %s is too long\n", __func__, sock_path);
+		return -1;
+	}
+	strncpy(addr.sun_path, sock_path, sizeof(addr.sun_path) - 1);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		pr_err("%s: failed to create socket: %s\n", __func__, strerror(errno));
+		return -1;
+	}
+
+	if (!restore) {
+		if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+			pr_err("%s: failed to connect to %s: %s\n", __func__,
+				sock_path, strerror(errno));
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	unlink(sock_path);
+	if ((bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+	    (listen(fd, 1) != 0)) {
+		pr_err("%s: failed to listen on %s: %s\n", __func__,
+			sock_path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	pr_info("%s: waiting for the VM on %s\n", __func__, sock_path);
+	do {
+		conn = accept(fd, NULL, NULL);
+	} while ((conn < 0) && (errno == EINTR));
+	if (conn < 0)
+		pr_err("%s: failed to accept on %s: %s\n", __func__,
+			sock_path, strerror(errno));
+	close(fd);
+	unlink(sock_path);
+	return conn;
+}
+
+static void
+close_stream(int fd, const char *path, bool failed)
+{
+	close(fd);
+	if (failed && !is_unix_stream(path))
+		unlink(path);
+}
+
+static int
+check_vm(struct vmctx *ctx, pci_vdev_cb check)
+{
+	if (lapic_pt) {
+		pr_err("%s: VM with local APIC passthrough can't be saved\n", __func__);
+		return -1;
+	}
+
+	return pci_walk_vdevs(check, NULL);
+}
+
+/* Pause the VM and let the backends complete the requests they already took */
+static int
+pause_and_quiesce(struct vmctx *ctx)
+{
+	int i, ret;
+
+	vm_pause(ctx);
+
+	/* let the backends complete the requests they already took */
+	for (i = 0; i < SNAPSHOT_QUIESCE_RETRIES; i++) {
+		ret = pci_walk_vdevs(check_vdev_quiesced, NULL);
+		if (ret != -EBUSY)
+			break;
+		usleep(SNAPSHOT_QUIESCE_INTERVAL_US);
+	}
+	if (ret != 0)
+		pr_err("%s: virtio devices are still busy\n", __func__);
+
+	return ret;
+}
+
+int
+vm_snapshot(struct vmctx *ctx, const char *path)
+{
+	struct snapshot_arg sarg;
+	int fd;
+
+	if (check_vm(ctx, check_vdev) != 0)
+		return -1;
+
+	fd = open_stream(path, false);
+	if (fd < 0)
+		return -1;
+
+	if (pause_and_quiesce(ctx) != 0)
+		goto err;
+
+	sarg.ctx = ctx;
+	sarg.fd = fd;
+	if ((save_header(ctx, fd) != 0) ||
+	    (hugetlb_walk_mem_regions(save_ram, &sarg) != 0) ||
+	    (save_devices(ctx, fd) != 0)) {
+		pr_err("%s: failed to save VM to %s: %s\n", __func__, path, strerror(errno));
+		goto err;
+	}
+
+	close_stream(fd, path, false);
+	pr_info("%s: VM saved to %s\n", __func__, path);
+	return 0;
+
+err:
+	close_stream(fd, path, true);
+	return -1;
+}
+
+void
+vm_mark_dirty(uint64_t gpa, size_t len)
+{
+	uint64_t pfn, last;
+
+	if (!__atomic_load_n(&dm_dirty_on, __ATOMIC_ACQUIRE) || (len == 0))
+		return;
+
+	pfn = gpa / SNAPSHOT_RAM_ALIGN;
+	last = (gpa + len - 1) / SNAPSHOT_RAM_ALIGN;
+	if (last >= dm_dirty_pages)
+		last = dm_dirty_pages - 1;
+	for (; pfn <= last; pfn++)
+		__atomic_fetch_or(&dm_dirty[pfn / 64], 1UL << (pfn % 64), __ATOMIC_RELAXED);
+}
+
+static int
+mark_virtio_rings(struct pci_vdev *dev, void *arg)
+{
+	struct vmctx *ctx = arg;
+	struct virtio_base *base;
+	struct virtio_vq_info *vq;
+	int i;
+
+	if (!is_virtio_vdev(dev))
+		return 0;
+
+	/* the used rings are mapped once, when the guest sets up the queues */
+	base = dev->arg;
+	for (i = 0; i < base->vops->nvq; i++) {
+		vq = &base->queues[i];
+		if (!vq_ring_ready(vq))
+			continue;
+		vm_mark_dirty((uint64_t)((char *)vq->used - ctx->baseaddr),
+			sizeof(struct vring_used) +
+			vq->qsize * sizeof(struct vring_used_elem) + sizeof(uint16_t));
+	}
+
+	return 0;
+}
+
+static bool
+is_page_dirty(const uint64_t *bitmap, size_t idx)
+{
+	return (bitmap[idx / 64] & (1UL << (idx % 64))) != 0;
+}
+
+/*
+ * Send a guest memory region: all of it in the first pass, the pages
+ * written since the previous pass later on.
+ */
+static int
+migrate_region(vm_paddr_t gpa, char *hva, size_t len, void *arg)
+{
+	struct migrate_arg *marg = arg;
+	size_t npages, start, i, words, base;
+
+	npages = len / SNAPSHOT_RAM_ALIGN;
+	words = (npages + 63) / 64;
+	memset(marg->bitmap, 0, words * sizeof(uint64_t));
+	if (vm_get_dirty_bitmap(marg->ctx, gpa, len, marg->bitmap) != 0)
+		return -1;
+
+	if (marg->first)
+		return snapshot_fmt_write_ram(marg->fd, gpa, hva, len, false);
+
+	/* the regions are huge page aligned, a word of bitmap is one of dm_dirty */
+	if (marg->last) {
+		base = gpa / SNAPSHOT_RAM_ALIGN / 64;
+		for (i = 0; (i < words) && (base + i < (dm_dirty_pages + 63) / 64); i++)
+			marg->bitmap[i] |= __atomic_load_n(&dm_dirty[base + i], __ATOMIC_RELAXED);
+	}
+
+	i = 0;
+	while (i < npages) {
+		if (!is_page_dirty(marg->bitmap, i)) {
+			i++;
+			continue;
+		}
+		start = i;
+		while ((i < npages) && is_page_dirty(marg->bitmap, i))
+			i++;
+		marg->dirty += i - start;
+		if (snapshot_fmt_write_ram(marg->fd, gpa + start * SNAPSHOT_RAM_ALIGN,
+				hva + start * SNAPSHOT_RAM_ALIGN,
+				(i - start) * SNAPSHOT_RAM_ALIGN, true) != 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static int
+migrate_vm(struct vmctx *ctx, int fd)
+{
+	struct migrate_arg marg;
+	int pass;
+
+	if (save_header(ctx, fd) != 0)
+		return -1;
+
+	memset(&marg, 0, sizeof(marg));
+	marg.ctx = ctx;
+	marg.fd = fd;
+	marg.bitmap = calloc((dm_dirty_pages + 63) / 64, sizeof(uint64_t));
+	if (marg.bitmap == NULL)
+		return -1;
+
+	for (pass = 0; pass < MIGRATE_PASSES_MAX; pass++) {
+		marg.first = (pass == 0);
+		marg.dirty = 0;
+		if (hugetlb_walk_mem_regions(migrate_region, &marg) != 0)
+			goto err;
+		pr_info("%s: pass %d sent %lu dirty pages\n", __func__, pass, marg.dirty);
+		if (!marg.first && (marg.dirty <= MIGRATE_DIRTY_PAGES_MIN))
+			break;
+	}
+
+	if (pause_and_quiesce(ctx) != 0)
+		goto err;
+
+	pci_walk_vdevs(mark_virtio_rings, ctx);
+	marg.first = false;
+	marg.last = true;
+	marg.dirty = 0;
+	if (hugetlb_walk_mem_regions(migrate_region, &marg) != 0)
+		goto err;
+	pr_info("%s: last pass sent %lu dirty pages\n", __func__, marg.dirty);
+
+	free(marg.bitmap);
+	return save_devices(ctx, fd);
+
+err:
+	free(marg.bitmap);
+	return -1;
+}
+
+int
+vm_migrate(struct vmctx *ctx, const char *dest)
+{
+	int fd, ret;
+
+	if (!is_unix_stream(dest)) {
+		pr_err("%s: %s is not a unix socket\n", __func__, dest);
+		return -1;
+	}
+	if (check_vm(ctx, check_migrate_vdev) != 0)
+		return -1;
+
+	/* allocated once, paddr_guest2host() may still be running on it */
+	if (dm_dirty == NULL) {
+		dm_dirty_pages = (ctx->highmem_gpa_base + ctx->highmem) / SNAPSHOT_RAM_ALIGN;
+		dm_dirty = calloc((dm_dirty_pages + 63) / 64, sizeof(uint64_t));
+		if (dm_dirty == NULL)
+			return -1;
+	}
+
+	fd = open_stream(dest, false);
+	if (fd < 0)
+		return -1;
+
+	memset(dm_dirty, 0, ((dm_dirty_pages + 63) / 64) * sizeof(uint64_t));
+	__atomic_store_n(&dm_dirty_on, true, __ATOMIC_RELEASE);
+	ret = vm_set_dirty_log(ctx, true);
+	if (ret == 0) {
+		ret = migrate_vm(ctx, fd);
+		if (ret != 0)
+			pr_err("%s: failed to migrate VM to %s: %s\n", __func__,
+				dest, strerror(errno));
+		vm_set_dirty_log(ctx, false);
+	}
+	__atomic_store_n(&dm_dirty_on, false, __ATOMIC_RELEASE);
+	close(fd);
+
+	if (ret == 0)
+		pr_info("%s: VM migrated to %s\n", __func__, dest);
+	return ret;
+}
+
+struct find_vdev_arg {
+	uint32_t bdf;
+	struct pci_vdev *dev;
+};
+
+static int
+match_vdev(struct pci_vdev *dev, void *arg)
+{
+	struct find_vdev_arg *farg = arg;
+
+	if (PCI_VDEV_BDF(dev) != farg->bdf)
+		return 0;
+
+	farg->dev = dev;
+	return 1;
+}
+
+static struct pci_vdev *
+find_pci_vdev(uint32_t bdf)
+{
+	struct find_vdev_arg farg = { .bdf = bdf, .dev = NULL };
+
+	pci_walk_vdevs(match_vdev, &farg);
+	return farg.dev;
+}
+
+static void
+cfgwrite(struct vmctx *ctx, struct pci_vdev *dev, int reg, int bytes, uint32_t val)
+{
+	int value = (int)val;
+
+	emulate_pci_cfgrw(ctx, 0, 0, dev->bus, dev->slot, dev->func, reg, bytes, &value);
+}
+
+static uint32_t
+cfg32(const uint8_t *cfg, int reg)
+{
+	uint32_t val;
+
+	memcpy(&val, cfg + reg, sizeof(val));
+	return val;
+}
+
+/*
+ * Replay the guest programming of a PCI device through the config space
+ * emulation, so that the BAR mappings and the interrupt setup of the device
+ * model follow: BARs first, then MSI/MSI-X, and the decoding enables last.
+ */
+static int
+restore_pci_vdev(struct vmctx *ctx, uint32_t bdf,
+		 const struct snapshot_pci_state *pci, size_t size)
+{
+	const uint8_t *cfg = pci->cfgdata;
+	struct pci_vdev *dev;
+	uint32_t msgctrl;
+	int i, end, capoff;
+
+	dev = find_pci_vdev(bdf);
+	/* the header is checked before any of its fields is read */
+	if ((dev == NULL) || (size < sizeof(*pci)) ||
+	    (pci->msix_table_count != ((dev->msix.table != NULL) ? dev->msix.table_count : 0)) ||
+	    (size != sizeof(*pci) + pci->msix_table_count * sizeof(struct msix_table_entry))) {
+		pr_err("%s: PCI device %x doesn't match the snapshot\n", __func__, bdf);
+		return -1;
+	}
+
+	for (i = 0; i <= PCI_BARMAX; i++) {
+		if (dev->bar[i].type != PCIBAR_NONE)
+			cfgwrite(ctx, dev, PCIR_BAR(i), 4, cfg32(cfg, PCIR_BAR(i)));
+	}
+	cfgwrite(ctx, dev, PCIR_INTLINE, 1, cfg[PCIR_INTLINE]);
+
+	if (pci_emul_find_capability(dev, PCIY_MSI, &capoff) == 0) {
+		msgctrl = cfg[capoff + PCIR_MSI_CTRL] | (cfg[capoff + PCIR_MSI_CTRL + 1] << 8);
+		end = (msgctrl & PCIM_MSICTRL_64BIT) ? PCIR_MSI_DATA_64BIT : PCIR_MSI_DATA;
+		for (i = PCIR_MSI_ADDR; i <= end; i += 4)
+			cfgwrite(ctx, dev, capoff + i, 4, cfg32(cfg, capoff + i));
+		cfgwrite(ctx, dev, capoff + PCIR_MSI_CTRL, 2, msgctrl);
+	}
+
+	if (pci_emul_find_capability(dev, PCIY_MSIX, &capoff) == 0) {
+		if (pci->msix_table_count != 0U)
+			memcpy(dev->msix.table, pci->msix_table,
+				pci->msix_table_count * sizeof(struct msix_table_entry));
+		cfgwrite(ctx, dev, capoff + PCIR_MSIX_CTRL, 2,
+			cfg[capoff + PCIR_MSIX_CTRL] | (cfg[capoff + PCIR_MSIX_CTRL + 1] << 8));
+	}
+
+	cfgwrite(ctx, dev, PCIR_COMMAND, 2, cfg[PCIR_COMMAND] | (cfg[PCIR_COMMAND + 1] << 8));
+	return 0;
+}
+
+static int
+restore_section(struct vmctx *ctx, int fd, const struct snapshot_section *sec)
+{
+	struct pci_vdev *dev;
+	void *hva, *buf;
+	int ret = -1;
+
+	if ((sec->type == SNAPSHOT_SEC_RAM) || (sec->type == SNAPSHOT_SEC_RAM_ZERO)) {
+		hva = vm_map_gpa(ctx, sec->addr, sec->size);
+		if (hva == NULL) {
+			pr_err("%s: RAM [0x%lx, 0x%lx) is out of the guest memory\n",
+				__func__, sec->addr, sec->addr + sec->size);
+			return -1;
+		}
+		return snapshot_fmt_read_ram(fd, sec, hva);
+	}
+
+	buf = calloc(1, sec->size);
+	if (buf == NULL)
+		return -1;
+	if (snapshot_fmt_read_data(fd, sec, buf, sec->size) != 0)
+		goto out;
+
+	switch (sec->type) {
+	case SNAPSHOT_SEC_PCI:
+		ret = restore_pci_vdev(ctx, sec->id, buf, sec->size);
+		break;
+	case SNAPSHOT_SEC_VIRTIO:
+		dev = find_pci_vdev(sec->id);
+		if ((dev == NULL) || !is_virtio_vdev(dev) ||
+		    (sec->size != virtio_state_size(dev->arg))) {
+			pr_err("%s: virtio device %x doesn't match the snapshot\n",
+				__func__, sec->id);
+			break;
+		}
+		ret = virtio_restore_state(dev->arg, buf);
+		break;
+	case SNAPSHOT_SEC_IRQCHIP:
+		if (sec->size == sizeof(struct acrn_irqchip_state))
+			ret = vm_set_irqchip_state(ctx, buf);
+		break;
+	case SNAPSHOT_SEC_VCPU:
+		if (sec->size == sizeof(struct acrn_vcpu_state))
+			ret = vm_set_vcpu_state(ctx, buf);
+		break;
+	default:
+		pr_err("%s: unknown section type %u\n", __func__, sec->type);
+		break;
+	}
+
+out:
+	free(buf);
+	return ret;
+}
+
+int
+vm_restore(struct vmctx *ctx)
+{
+	struct snapshot_header hdr;
+	struct snapshot_section sec;
+	int fd, ret = -1;
+
+	fd = open_stream(restore_path, true);
+	if (fd < 0) {
+		free(restore_path);
+		restore_path = NULL;
+		return -1;
+	}
+
+	if (snapshot_fmt_read_header(fd, &hdr) != 0) {
+		pr_err("%s: %s is not a VM snapshot\n", __func__, restore_path);
+		goto out;
+	}
+	if ((hdr.ncpus != ctx->vcpu_num) || (hdr.lowmem != ctx->lowmem) ||
+	    (hdr.highmem != ctx->highmem) || (hdr.biosmem != ctx->biosmem) ||
+	    (hdr.fbmem != ctx->fbmem)) {
+		pr_err("%s: vCPUs or memory of the VM don't match %s\n", __func__, restore_path);
+		goto out;
+	}
+
+	for (;;) {
+		if (snapshot_fmt_read_section(fd, &sec) != 0)
+			goto out;
+		if (sec.type == SNAPSHOT_SEC_END)
+			break;
+		if (restore_section(ctx, fd, &sec) != 0) {
+			pr_err("%s: failed to restore section %u:%x of %s\n",
+				__func__, sec.type, sec.id, restore_path);
+			goto out;
+		}
+	}
+
+	pr_info("%s: VM restored from %s\n", __func__, restore_path);
+	ret = 0;
+
+out:
+	close(fd);
+	free(restore_path);
+	restore_path = NULL;
+	return ret;
+}
+
+bool
+vm_restore_enabled(void)
+{
+	return restore_path != NULL;
+}
+
+int
+acrn_parse_restore(const char *path)
+{
+	free(restore_path);
+	restore_path = strdup(path);
+	return (restore_path != NULL) ? 0 : -1;
+}
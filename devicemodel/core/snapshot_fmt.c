@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2022 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Reader and writer of the VM snapshot stream described in snapshot.h.
+ * The stream is only read and written sequentially, so it may be a file
+ * or a socket. Errors are reported by returning -1 with errno set, logging
+ * is left to the caller.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "snapshot.h"
+
+#define SNAPSHOT_ROUNDUP(x, y)	(((x) + ((y) - 1UL)) & ~((y) - 1UL))
+
+static int
+write_all(int fd, const void *buf, size_t len)
+{
+	const char *p = buf;
+	ssize_t ret;
+
+	while (len > 0) {
+		ret = write(fd, p, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		p += ret;
+		len -= (size_t)ret;
+	}
+
+	return 0;
+}
+
+static int
+read_all(int fd, void *buf, size_t len)
+{
+	char *p = buf;
+	ssize_t ret;
+
+	while (len > 0) {
+		ret = read(fd, p, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (ret == 0) {
+			errno = EIO;
+			return -1;
+		}
+		p += ret;
+		len -= (size_t)ret;
+	}
+
+	return 0;
+}
+
+static bool
+is_zero_page(const char *page)
+{
+	return (page[0] == 0) &&
+		(memcmp(page, page + 1, SNAPSHOT_RAM_ALIGN - 1UL) == 0);
+}
+
+int
+snapshot_fmt_write_header(int fd, const struct snapshot_header *hdr)
+{
+	struct snapshot_header h = *hdr;
+
+	h.magic = SNAPSHOT_MAGIC;
+	h.version = SNAPSHOT_VERSION;
+	return write_all(fd, &h, sizeof(h));
+}
+
+int
+snapshot_fmt_write_section(int fd, uint32_t type, uint32_t id,
+			   uint64_t addr, const void *data, size_t size)
+{
+	static const char pad[SNAPSHOT_ALIGN];
+	struct snapshot_section sec;
+	size_t padding;
+
+	sec.type = type;
+	sec.id = id;
+	sec.addr = addr;
+	sec.size = size;
+	padding = SNAPSHOT_ROUNDUP(size, SNAPSHOT_ALIGN) - size;
+
+	if ((write_all(fd, &sec, sizeof(sec)) != 0) ||
+	    (write_all(fd, data, size) != 0) ||
+	    (write_all(fd, pad, padding) != 0))
+		return -1;
+
+	return 0;
+}
+
+int
+snapshot_fmt_write_ram(int fd, uint64_t gpa, const void *hva, size_t size,
+		       bool zero)
+{
+	struct snapshot_section sec;
+	const char *mem = hva;
+	size_t start, end;
+	bool is_zero;
+
+	if ((size % SNAPSHOT_RAM_ALIGN) != 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* a section per run of non-zero pages, and per run of zero pages if asked */
+	start = 0;
+	while (start < size) {
+		is_zero = is_zero_page(mem + start);
+		end = start + SNAPSHOT_RAM_ALIGN;
+		while ((end < size) && (is_zero_page(mem + end) == is_zero))
+			end += SNAPSHOT_RAM_ALIGN;
+
+		if (!is_zero) {
+			if (snapshot_fmt_write_section(fd, SNAPSHOT_SEC_RAM, 0,
+					gpa + start, mem + start, end - start) != 0)
+				return -1;
+		} else if (zero) {
+			/* no payload, the size is the one of the zero run */
+			sec.type = SNAPSHOT_SEC_RAM_ZERO;
+			sec.id = 0;
+			sec.addr = gpa + start;
+			sec.size = end - start;
+			if (write_all(fd, &sec, sizeof(sec)) != 0)
+				return -1;
+		}
+		start = end;
+	}
+
+	return 0;
+}
+
+int
+snapshot_fmt_finish(int fd)
+{
+	if (snapshot_fmt_write_section(fd, SNAPSHOT_SEC_END, 0, 0, NULL, 0) != 0)
+		return -1;
+
+	/* nothing to flush for a socket */
+	if ((fsync(fd) != 0) && (errno != EINVAL))
+		return -1;
+
+	return 0;
+}
+
+int
+snapshot_fmt_read_header(int fd, struct snapshot_header *hdr)
+{
+	if (read_all(fd, hdr, sizeof(*hdr)) != 0)
+		return -1;
+
+	if ((hdr->magic != SNAPSHOT_MAGIC) || (hdr->version != SNAPSHOT_VERSION)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+snapshot_fmt_read_section(int fd, struct snapshot_section *sec)
+{
+	return read_all(fd, sec, sizeof(*sec));
+}
+
+int
+snapshot_fmt_read_data(int fd, const struct snapshot_section *sec,
+		       void *buf, size_t size)
+{
+	char pad[SNAPSHOT_ALIGN];
+
+	if ((sec->size != size) || (sec->type == SNAPSHOT_SEC_RAM_ZERO)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if ((read_all(fd, buf, size) != 0) ||
+	    (read_all(fd, pad, SNAPSHOT_ROUNDUP(size, SNAPSHOT_ALIGN) - size) != 0))
+		return -1;
+
+	return 0;
+}
+
+int
+snapshot_fmt_read_ram(int fd, const struct snapshot_section *sec, void *hva)
+{
+	if (sec->type == SNAPSHOT_SEC_RAM_ZERO) {
+		memset(hva, 0, sec->size);
+		return 0;
+	}
+
+	if ((sec->type != SNAPSHOT_SEC_RAM) || ((sec->size % SNAPSHOT_RAM_ALIGN) != 0)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return read_all(fd, hva, sec->size);
+}
+
+int
+snapshot_fmt_skip(int fd, const struct snapshot_section *sec)
+{
+	char buf[SNAPSHOT_RAM_ALIGN];
+	size_t size, len;
+
+	if (sec->type == SNAPSHOT_SEC_RAM_ZERO)
+		return 0;
+
+	/* read through, the stream may not be seekable */
+	size = SNAPSHOT_ROUNDUP(sec->size, SNAPSHOT_ALIGN);
+	while (size > 0) {
+		len = (size < sizeof(buf)) ? size : sizeof(buf);
+		if (read_all(fd, buf, len) != 0)
+			return -1;
+		size -= len;
+	}
+
+	return 0;
+}
@@ -163,24 +163,17 @@ acrn_parse_ramdisk(char *arg)
 static int
 acrn_prepare_ramdisk(struct vmctx *ctx)
 {
-	FILE *fp;
-	long len;
-	size_t read;
+	size_t len;
 
-	fp = fopen(ramdisk_path, "r");
-	if (fp == NULL) {
+	if (check_image(ramdisk_path, 0, &len) != 0) {
 		pr_err("SW_LOAD ERR: could not open ramdisk file %s\n",
 				ramdisk_path);
 		return -1;
 	}
 
-	fseek(fp, 0, SEEK_END);
-	len = ftell(fp);
-
 	if (len != ramdisk_size) {
 		fprintf(stderr,
 			"SW_LOAD ERR: ramdisk file changed\n");
-		fclose(fp);
 		return -1;
 	}
 
@@ -190,20 +183,13 @@ acrn_prepare_ramdisk(struct vmctx *ctx)
 	if (ctx->lowmem <= (RAMDISK_LOAD_SIZE + 2*KB + KERNEL_LOAD_OFF(ctx))) {
 		pr_err("SW_LOAD ERR: the size of ramdisk file is too big"
 			" file len=0x%lx\n", len);
-		fclose(fp);
 		return -1;
 	}
 
-	fseek(fp, 0, SEEK_SET);
-	read = fread(ctx->baseaddr + RAMDISK_LOAD_OFF(ctx),
-			sizeof(char), len, fp);
-	if (read < len) {
-		pr_err("SW_LOAD ERR: could not read the whole ramdisk file,"
-				" file len=%ld, read %lu\n", len, read);
-		fclose(fp);
+	if (load_image(ramdisk_path, ctx->baseaddr + RAMDISK_LOAD_OFF(ctx), len) != 0) {
+		pr_err("SW_LOAD ERR: could not read the whole ramdisk file\n");
 		return -1;
 	}
-	fclose(fp);
 	pr_info("SW_LOAD: ramdisk %s size %lu copied to guest 0x%lx\n",
 			ramdisk_path, ramdisk_size, RAMDISK_LOAD_OFF(ctx));
 
@@ -213,43 +199,29 @@ acrn_prepare_ramdisk(struct vmctx *ctx)
 static int
 acrn_prepare_kernel(struct vmctx *ctx)
 {
-	FILE *fp;
-	long len;
-	size_t read;
+	size_t len;
 
-	fp = fopen(kernel_path, "r");
-	if (fp == NULL) {
+	if (check_image(kernel_path, 0, &len) != 0) {
 		pr_err("SW_LOAD ERR: could not open kernel file %s\n",
 				kernel_path);
 		return -1;
 	}
 
-	fseek(fp, 0, SEEK_END);
-	len = ftell(fp);
-
 	if (len != kernel_size) {
 		fprintf(stderr,
 			"SW_LOAD ERR: kernel file changed\n");
-		fclose(fp);
 		return -1;
 	}
 
 	if ((len + KERNEL_LOAD_OFF(ctx)) > RAMDISK_LOAD_OFF(ctx)) {
 		pr_err("SW_LOAD ERR: need big system memory to fit image\n");
-		fclose(fp);
 		return -1;
 	}
 
-	fseek(fp, 0, SEEK_SET);
-	read = fread(ctx->baseaddr + KERNEL_LOAD_OFF(ctx),
-			sizeof(char), len, fp);
-	if (read < len) {
-		pr_err("SW_LOAD ERR: could not read the whole kernel file,"
-				" file len=%ld, read %lu\n", len, read);
-		fclose(fp);
+	if (load_image(kernel_path, ctx->baseaddr + KERNEL_LOAD_OFF(ctx), len) != 0) {
+		pr_err("SW_LOAD ERR: could not read the whole kernel file\n");
 		return -1;
 	}
-	fclose(fp);
 	pr_info("SW_LOAD: kernel %s size %lu copied to guest 0x%lx\n",
 			kernel_path, kernel_size, KERNEL_LOAD_OFF(ctx));
 
@@ -28,6 +28,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
 
 #include "vmmapi.h"
 #include "sw_load.h"
@@ -159,6 +163,94 @@ check_image(char *path, size_t size_limit, size_t *size)
 	return 0;
 }
 
+/* images are read into guest memory in chunks of LOAD_CHUNK_SIZE */
+#define LOAD_CHUNK_SIZE		(8 * MB)
+/* alignment of the buffer, file offset and length of an O_DIRECT read */
+#define LOAD_DIRECT_ALIGN	(4 * KB)
+/* smaller images are likely in the page cache already, O_DIRECT would only slow them down */
+#define LOAD_DIRECT_MIN		(64 * MB)
+
+/*
+ * Read up to len bytes at offset off of fd into buf.
+ * Return the number of bytes read, or -1 if nothing could be read.
+ */
+static ssize_t
+read_image_range(int fd, char *buf, off_t off, size_t len)
+{
+	size_t done = 0, chunk;
+	ssize_t ret;
+
+	while (done < len) {
+		chunk = len - done;
+		if (chunk > LOAD_CHUNK_SIZE)
+			chunk = LOAD_CHUNK_SIZE;
+
+		ret = pread(fd, buf + done, chunk, off + done);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			break;
+		done += ret;
+	}
+
+	return (done == 0 && len > 0) ? -1 : done;
+}
+
+/*
+ * Read the size bytes image at path straight into the guest memory at addr.
+ *
+ * Large images have their page aligned bulk read with O_DIRECT, so they don't
+ * fill the page cache with data used once. The rest (all of small images, or
+ * all of it if the file system doesn't support O_DIRECT) is read with large
+ * buffered reads, still without going through a stdio buffer.
+ */
+int
+load_image(char *path, void *addr, size_t size)
+{
+	struct timespec start, end;
+	size_t direct_len = 0;
+	ssize_t done = 0, ret;
+	long ms;
+	int fd;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	if ((size >= LOAD_DIRECT_MIN) && (((uintptr_t)addr & (LOAD_DIRECT_ALIGN - 1)) == 0))
+		direct_len = size & ~(LOAD_DIRECT_ALIGN - 1);
+	if (direct_len > 0) {
+		fd = open(path, O_RDONLY | O_DIRECT);
+		if (fd >= 0) {
+			done = read_image_range(fd, addr, 0, direct_len);
+			if (done < 0)
+				done = 0;
+			close(fd);
+		}
+	}
+
+	if (done < size) {
+		fd = open(path, O_RDONLY);
+		if (fd < 0) {
+			pr_err("SW_LOAD ERR: could not open image file %s\n", path);
+			return -1;
+		}
+		posix_fadvise(fd, done, size - done, POSIX_FADV_SEQUENTIAL);
+		ret = read_image_range(fd, (char *)addr + done, done, size - done);
+		close(fd);
+		if (ret != size - done) {
+			pr_err("SW_LOAD ERR: could not read the whole image file %s,"
+				" file len=%lu, read %ld\n", path, size, (ret > 0) ? (done + ret) : done);
+			return -1;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ms = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+	pr_info("SW_LOAD: %s size %lu loaded in %ld ms (%lu bytes with O_DIRECT)\n",
+		path, size, ms, (size_t)done);
+
+	return 0;
+}
+
 /* Assumption:
  * the range [start, start + size] belongs to one entry of e820 table
  */
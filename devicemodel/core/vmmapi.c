@@ -71,7 +71,8 @@ static const char vm_state_str[VM_SUSPEND_LAST][VM_STATE_STR_LEN] = {
 	[VM_SUSPEND_POWEROFF]		= "POWEROFF",
 	[VM_SUSPEND_SUSPEND]		= "SUSPEND",
 	[VM_SUSPEND_HALT]		= "HALT",
-	[VM_SUSPEND_TRIPLEFAULT]	= "TRIPLEFAULT"
+	[VM_SUSPEND_TRIPLEFAULT]	= "TRIPLEFAULT",
+	[VM_SUSPEND_HOLD]		= "HOLD"
 };
 
 const char *vm_state_to_str(enum vm_suspend_how idx)
@@ -201,6 +202,10 @@ vm_create(const char *name, uint64_t req_buf, int *vcpu_num)
 		create_vm.vm_flag |= GUEST_FLAG_IO_COMPLETION_POLLING;
 	}
 
+	/* the EPT dirty flags are only set up for the VMs which may be migrated */
+	if (migratable)
+		create_vm.vm_flag |= GUEST_FLAG_DIRTY_LOG;
+
 	create_vm.ioreq_buf = req_buf;
 	while (retry > 0) {
 		error = ioctl(ctx->fd, ACRN_IOCTL_CREATE_VM, &create_vm);
@@ -216,6 +221,7 @@ vm_create(const char *name, uint64_t req_buf, int *vcpu_num)
 	}
 
 	*vcpu_num = create_vm.vcpu_num;
+	ctx->vcpu_num = create_vm.vcpu_num;
 	ctx->vmid = create_vm.vmid;
 
 	return ctx;
@@ -490,6 +496,10 @@ static enum vm_suspend_how suspend_mode = VM_SUSPEND_NONE;
 void
 vm_set_suspend_mode(enum vm_suspend_how how)
 {
+	/* a full reset keeps the VM too on a warm reset, see vm_warm_reset() */
+	if ((how == VM_SUSPEND_FULL_RESET) && warm_reset)
+		how = VM_SUSPEND_SYSTEM_RESET;
+
 	pr_notice("VM state changed from[ %s ] to [ %s ]\n", vm_state_to_str(suspend_mode), vm_state_to_str(how));
 	suspend_mode = how;
 }
@@ -699,6 +709,81 @@ vm_set_vcpu_regs(struct vmctx *ctx, struct acrn_vcpu_regs *vcpu_regs)
 	return error;
 }
 
+int
+vm_get_vcpu_state(struct vmctx *ctx, struct acrn_vcpu_state *state)
+{
+	int error;
+	error = ioctl(ctx->fd, ACRN_IOCTL_GET_VCPU_STATE, state);
+	if (error) {
+		pr_err("ACRN_IOCTL_GET_VCPU_STATE ioctl() returned an error: %s\n", errormsg(errno));
+	}
+	return error;
+}
+
+int
+vm_set_vcpu_state(struct vmctx *ctx, struct acrn_vcpu_state *state)
+{
+	int error;
+	error = ioctl(ctx->fd, ACRN_IOCTL_SET_VCPU_STATE, state);
+	if (error) {
+		pr_err("ACRN_IOCTL_SET_VCPU_STATE ioctl() returned an error: %s\n", errormsg(errno));
+	}
+	return error;
+}
+
+int
+vm_get_irqchip_state(struct vmctx *ctx, struct acrn_irqchip_state *state)
+{
+	int error;
+	error = ioctl(ctx->fd, ACRN_IOCTL_GET_IRQCHIP_STATE, state);
+	if (error) {
+		pr_err("ACRN_IOCTL_GET_IRQCHIP_STATE ioctl() returned an error: %s\n", errormsg(errno));
+	}
+	return error;
+}
+
+int
+vm_set_irqchip_state(struct vmctx *ctx, struct acrn_irqchip_state *state)
+{
+	int error;
+	error = ioctl(ctx->fd, ACRN_IOCTL_SET_IRQCHIP_STATE, state);
+	if (error) {
+		pr_err("ACRN_IOCTL_SET_IRQCHIP_STATE ioctl() returned an error: %s\n", errormsg(errno));
+	}
+	return error;
+}
+
+int
+vm_set_dirty_log(struct vmctx *ctx, bool enable)
+{
+	int error, retries = 1000;
+
+	/* the hypervisor backs off while a WBINVD emulation is clearing the dirty flags */
+	while (((error = ioctl(ctx->fd, ACRN_IOCTL_SET_DIRTY_LOG, enable ? 1UL : 0UL)) != 0) &&
+	       (errno == EAGAIN) && (retries-- > 0))
+		usleep(1000);
+	if (error) {
+		pr_err("ACRN_IOCTL_SET_DIRTY_LOG ioctl() returned an error: %s\n", errormsg(errno));
+	}
+	return error;
+}
+
+int
+vm_get_dirty_bitmap(struct vmctx *ctx, vm_paddr_t gpa, size_t size, uint64_t *bitmap)
+{
+	struct acrn_dirty_bitmap dirty;
+	int error;
+
+	dirty.gpa = gpa;
+	dirty.size = size;
+	dirty.bitmap_gpa = (uint64_t)bitmap;
+	error = ioctl(ctx->fd, ACRN_IOCTL_GET_DIRTY_BITMAP, &dirty);
+	if (error) {
+		pr_err("ACRN_IOCTL_GET_DIRTY_BITMAP ioctl() returned an error: %s\n", errormsg(errno));
+	}
+	return error;
+}
+
 int
 vm_get_cpu_state(struct vmctx *ctx, void *state_buf)
 {
@@ -902,6 +902,26 @@ blockif_cancel(struct blockif_ctxt *bc, struct blockif_req *breq)
 	return -EBUSY;
 }
 
+/*
+ * Drop the requests not started yet and wait for the ones in flight, so
+ * that no buffer of the guest is read or written once this returns.
+ */
+void
+blockif_drain(struct blockif_ctxt *bc)
+{
+	struct blockif_elem *be;
+
+	pthread_mutex_lock(&bc->mtx);
+	while ((be = TAILQ_FIRST(&bc->pendq)) != NULL)
+		blockif_complete(bc, be);
+	while (!TAILQ_EMPTY(&bc->busyq)) {
+		pthread_mutex_unlock(&bc->mtx);
+		usleep(10000);
+		pthread_mutex_lock(&bc->mtx);
+	}
+	pthread_mutex_unlock(&bc->mtx);
+}
+
 int
 blockif_close(struct blockif_ctxt *bc)
 {
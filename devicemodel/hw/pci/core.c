@@ -1456,6 +1456,13 @@ pci_emul_ecfg_handler(struct vmctx *ctx, int vcpu, int dir, uint64_t addr,
 #define	BUSIO_ROUNDUP		32
 #define	BUSMEM_ROUNDUP		(1024 * 1024)
 
+static int
+pci_emul_save_init_cfg(struct pci_vdev *dev, void *arg)
+{
+	memcpy(dev->init_cfgdata, dev->cfgdata, sizeof(dev->init_cfgdata));
+	return 0;
+}
+
 int
 init_pci(struct vmctx *ctx)
 {
@@ -1603,6 +1610,7 @@ init_pci(struct vmctx *ctx)
 		}
 	}
 	lpc_pirq_routed();
+	pci_walk_vdevs(pci_emul_save_init_cfg, NULL);
 
 	/*
 	 * The guest physical memory map looks like the following:
@@ -2236,6 +2244,125 @@ pci_walk_lintr(int bus, pci_lintr_cb cb, void *arg)
 	}
 }
 
+int
+pci_walk_vdevs(pci_vdev_cb cb, void *arg)
+{
+	struct businfo *bi;
+	struct funcinfo *fi;
+	int bus, slot, func, ret;
+
+	for (bus = 0; bus < MAXBUSES; bus++) {
+		bi = pci_businfo[bus];
+		if (bi == NULL)
+			continue;
+		for (slot = 0; slot < MAXSLOTS; slot++) {
+			for (func = 0; func < MAXFUNCS; func++) {
+				fi = &bi->slotinfo[slot].si_funcs[func];
+				if (fi->fi_devi == NULL)
+					continue;
+				ret = cb(fi->fi_devi, arg);
+				if (ret != 0)
+					return ret;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int
+pci_emul_check_reset(struct pci_vdev *dev, void *arg)
+{
+	if (dev->dev_ops->vdev_reset == NULL) {
+		pr_notice("%s: %s can't be reset in place\n", __func__, dev->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Check whether all the PCI devices can be reset in place.
+ *
+ * @return true if they all have a vdev_reset callback.
+ */
+bool
+pci_vdevs_resettable(void)
+{
+	return pci_walk_vdevs(pci_emul_check_reset, NULL) == 0;
+}
+
+static void
+pci_emul_reset_cfg(struct vmctx *ctx, struct pci_vdev *dev, int reg, int bytes)
+{
+	uint32_t val = 0;
+
+	memcpy(&val, dev->init_cfgdata + reg, bytes);
+	pci_cfgrw(ctx, 0, 0, dev->bus, dev->slot, dev->func, reg, bytes, &val);
+}
+
+static int
+pci_emul_reset(struct pci_vdev *dev, void *arg)
+{
+	struct vmctx *ctx = arg;
+	uint16_t msgctrl;
+	int i, end, capoff;
+
+	/*
+	 * Replay the config space saved by init_pci() through the config
+	 * write emulation, so the BARs are registered back at their initial
+	 * addresses and MSI/MSI-X and the decoding are set as they were.
+	 */
+	for (i = 0; i <= PCI_BARMAX; i++) {
+		if (dev->bar[i].type != PCIBAR_NONE)
+			pci_emul_reset_cfg(ctx, dev, PCIR_BAR(i), 4);
+	}
+
+	if (pci_emul_find_capability(dev, PCIY_MSI, &capoff) == 0) {
+		msgctrl = *(uint16_t *)(dev->init_cfgdata + capoff + PCIR_MSI_CTRL);
+		end = (msgctrl & PCIM_MSICTRL_64BIT) ? PCIR_MSI_DATA_64BIT : PCIR_MSI_DATA;
+		for (i = PCIR_MSI_ADDR; i <= end; i += 4)
+			pci_emul_reset_cfg(ctx, dev, capoff + i, 4);
+		pci_emul_reset_cfg(ctx, dev, capoff + PCIR_MSI_CTRL, 2);
+	}
+
+	if (pci_emul_find_capability(dev, PCIY_MSIX, &capoff) == 0) {
+		for (i = 0; i < dev->msix.table_count; i++) {
+			dev->msix.table[i].addr = 0;
+			dev->msix.table[i].msg_data = 0;
+			dev->msix.table[i].vector_control = PCIM_MSIX_VCTRL_MASK;
+		}
+		pci_emul_reset_cfg(ctx, dev, capoff + PCIR_MSIX_CTRL, 2);
+	}
+
+	pci_emul_reset_cfg(ctx, dev, PCIR_COMMAND, 2);
+	if (dev->lintr.pin > 0)
+		pci_lintr_deassert(dev);
+
+	/* the registers without side effects, e.g. the latency timer */
+	memcpy(dev->cfgdata, dev->init_cfgdata, sizeof(dev->cfgdata));
+
+	return (*dev->dev_ops->vdev_reset)(ctx, dev);
+}
+
+/**
+ * @brief Reset all the PCI devices in place, for a warm reset of the VM.
+ *
+ * The config space of each device is brought back to its state after
+ * init_pci() and its vdev_reset callback is called. Unlike a
+ * deinit_pci()/init_pci() pair, the backends, threads and BAR allocations
+ * of the devices are kept.
+ *
+ * @pre pci_vdevs_resettable() is true and the VM is paused.
+ *
+ * @return 0 on success, -1 if a device failed to reset.
+ */
+int
+pci_reset_vdevs(struct vmctx *ctx)
+{
+	return pci_walk_vdevs(pci_emul_reset, ctx);
+}
+
 /*
  * Return 1 if the emulated device in 'slot' is a multi-function device.
  * Return 0 otherwise.
@@ -43,6 +43,13 @@ pci_hostbridge_init(struct vmctx *ctx, struct pci_vdev *pi, char *opts)
 	return 0;
 }
 
+/* the host bridge has no state besides its config space */
+static int
+pci_hostbridge_reset(struct vmctx *ctx, struct pci_vdev *pi)
+{
+	return 0;
+}
+
 static int
 pci_amd_hostbridge_init(struct vmctx *ctx, struct pci_vdev *pi, char *opts)
 {
@@ -56,11 +63,13 @@ pci_amd_hostbridge_init(struct vmctx *ctx, struct pci_vdev *pi, char *opts)
 struct pci_vdev_ops pci_ops_amd_hostbridge = {
 	.class_name	= "amd_hostbridge",
 	.vdev_init	= pci_amd_hostbridge_init,
+	.vdev_reset	= pci_hostbridge_reset,
 };
 DEFINE_PCI_DEVTYPE(pci_ops_amd_hostbridge);
 
 struct pci_vdev_ops pci_ops_hostbridge = {
 	.class_name	= "hostbridge",
 	.vdev_init	= pci_hostbridge_init,
+	.vdev_reset	= pci_hostbridge_reset,
 };
 DEFINE_PCI_DEVTYPE(pci_ops_hostbridge);
@@ -439,6 +439,19 @@ pci_lpc_deinit(struct vmctx *ctx, struct pci_vdev *pi, char *opts)
 	lpc_deinit(ctx);
 }
 
+static int
+pci_lpc_reset(struct vmctx *ctx, struct pci_vdev *pi)
+{
+	int unit;
+
+	for (unit = 0; unit < LPC_UART_NUM; unit++) {
+		if (lpc_uart_vdev[unit].enabled)
+			uart_warm_reset(lpc_uart_vdev[unit].uart);
+	}
+
+	return 0;
+}
+
 char *
 lpc_pirq_name(int pin)
 {
@@ -510,6 +523,7 @@ struct pci_vdev_ops pci_ops_lpc = {
 	.class_name		= "lpc",
 	.vdev_init		= pci_lpc_init,
 	.vdev_deinit		= pci_lpc_deinit,
+	.vdev_reset		= pci_lpc_reset,
 	.vdev_write_dsdt	= pci_lpc_write_dsdt,
 	.vdev_cfgwrite		= pci_lpc_cfgwrite,
 	.vdev_barwrite		= pci_lpc_write,
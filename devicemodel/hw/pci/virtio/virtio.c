@@ -1873,6 +1873,39 @@ virtio_pci_write(struct vmctx *ctx, int vcpu, struct pci_vdev *dev,
 		base->vops->name, baridx);
 }
 
+/**
+ * @brief Reset a virtio device in place, on a warm reset of the VM.
+ *
+ * Do what a write of 0 to the device status by the guest driver does, which
+ * brings the device back to its state after init.
+ *
+ * @param ctx Pointer to struct vmctx representing VM context.
+ * @param dev Pointer to struct pci_vdev which emulates a PCI device.
+ *
+ * @return 0 on success.
+ */
+int
+virtio_pci_reset(struct vmctx *ctx, struct pci_vdev *dev)
+{
+	struct virtio_base *base = dev->arg;
+	struct virtio_ops *vops = base->vops;
+
+	if (base->mtx)
+		pthread_mutex_lock(base->mtx);
+
+	base->status = 0;
+	if (vops->set_status)
+		(*vops->set_status)(DEV_STRUCT(base), 0);
+	if (vops->reset)
+		(*vops->reset)(DEV_STRUCT(base));
+	else
+		virtio_reset_dev(base);
+
+	if (base->mtx)
+		pthread_mutex_unlock(base->mtx);
+	return 0;
+}
+
 /**
  * @brief Get the virtio poll parameters
  *
@@ -1895,3 +1928,144 @@ acrn_parse_virtio_poll_interval(const char *optarg)
 
 	return 0;
 }
+
+size_t
+virtio_state_size(struct virtio_base *base)
+{
+	return sizeof(struct virtio_base_state) +
+		base->vops->nvq * sizeof(struct virtio_vq_state);
+}
+
+bool
+virtio_is_quiesced(struct virtio_base *base)
+{
+	struct virtio_vq_info *vq;
+	bool quiesced = true;
+	int i;
+
+	VIRTIO_BASE_LOCK(base);
+	for (i = 0; i < base->vops->nvq; i++) {
+		vq = &base->queues[i];
+		if (vq_ring_ready(vq) && (vq->used->idx != vq->last_avail)) {
+			quiesced = false;
+			break;
+		}
+	}
+	VIRTIO_BASE_UNLOCK(base);
+
+	return quiesced;
+}
+
+void
+virtio_save_state(struct virtio_base *base, struct virtio_base_state *state)
+{
+	struct virtio_vq_state *vqs;
+	struct virtio_vq_info *vq;
+	int i;
+
+	memset(state, 0, virtio_state_size(base));
+
+	VIRTIO_BASE_LOCK(base);
+	state->negotiated_caps = base->negotiated_caps;
+	state->nvq = base->vops->nvq;
+	state->curq = base->curq;
+	state->device_feature_select = base->device_feature_select;
+	state->driver_feature_select = base->driver_feature_select;
+	state->msix_cfg_idx = base->msix_cfg_idx;
+	state->status = base->status;
+	state->isr = base->isr;
+	state->config_generation = base->config_generation;
+
+	for (i = 0; i < base->vops->nvq; i++) {
+		vq = &base->queues[i];
+		vqs = &state->vqs[i];
+		vqs->qsize = vq->qsize;
+		vqs->flags = vq->flags;
+		vqs->last_avail = vq->last_avail;
+		vqs->save_used = vq->save_used;
+		vqs->msix_idx = vq->msix_idx;
+		vqs->enabled = vq->enabled;
+		vqs->pfn = vq->pfn;
+		memcpy(vqs->gpa_desc, vq->gpa_desc, sizeof(vqs->gpa_desc));
+		memcpy(vqs->gpa_avail, vq->gpa_avail, sizeof(vqs->gpa_avail));
+		memcpy(vqs->gpa_used, vq->gpa_used, sizeof(vqs->gpa_used));
+	}
+	VIRTIO_BASE_UNLOCK(base);
+}
+
+int
+virtio_restore_state(struct virtio_base *base,
+		     const struct virtio_base_state *state)
+{
+	const struct virtio_vq_state *vqs;
+	struct virtio_vq_info *vq;
+	struct virtio_ops *vops;
+	int i;
+
+	vops = base->vops;
+	if (state->nvq != vops->nvq) {
+		pr_err("%s: snapshot has %u queues, device has %d\n",
+			vops->name, state->nvq, vops->nvq);
+		return -1;
+	}
+
+	VIRTIO_BASE_LOCK(base);
+	for (i = 0; i < vops->nvq; i++) {
+		vq = &base->queues[i];
+		vqs = &state->vqs[i];
+		vq->qsize = vqs->qsize;
+		vq->msix_idx = vqs->msix_idx;
+		memcpy(vq->gpa_desc, vqs->gpa_desc, sizeof(vq->gpa_desc));
+		memcpy(vq->gpa_avail, vqs->gpa_avail, sizeof(vq->gpa_avail));
+		memcpy(vq->gpa_used, vqs->gpa_used, sizeof(vq->gpa_used));
+
+		if ((vqs->flags & VQ_ALLOC) == 0)
+			continue;
+
+		/* map the rings the same way the guest's last queue setup did */
+		base->curq = i;
+		if (vqs->pfn != 0)
+			virtio_vq_init(base, vqs->pfn);
+		else
+			virtio_vq_enable(base);
+		if (!vq_ring_ready(vq)) {
+			VIRTIO_BASE_UNLOCK(base);
+			return -1;
+		}
+		vq->last_avail = vqs->last_avail;
+		vq->save_used = vqs->save_used;
+	}
+
+	base->curq = state->curq;
+	base->device_feature_select = state->device_feature_select;
+	base->driver_feature_select = state->driver_feature_select;
+	base->msix_cfg_idx = state->msix_cfg_idx;
+	base->isr = state->isr;
+	base->config_generation = state->config_generation;
+
+	base->negotiated_caps = state->negotiated_caps & base->device_caps;
+	if (vops->apply_features)
+		(*vops->apply_features)(DEV_STRUCT(base), base->negotiated_caps);
+	base->status = state->status;
+	if (vops->set_status)
+		(*vops->set_status)(DEV_STRUCT(base), base->status);
+	VIRTIO_BASE_UNLOCK(base);
+
+	if (base->isr)
+		pci_lintr_assert(base->dev);
+
+	/* pick up requests the guest posted after the snapshot was quiesced */
+	if (base->status & VIRTIO_CONFIG_S_DRIVER_OK) {
+		for (i = 0; i < vops->nvq; i++) {
+			vq = &base->queues[i];
+			if (!vq_ring_ready(vq) || !vq_has_descs(vq))
+				continue;
+			if (vq->notify)
+				(*vq->notify)(DEV_STRUCT(base), vq);
+			else if (vops->qnotify)
+				(*vops->qnotify)(DEV_STRUCT(base), vq);
+		}
+	}
+
+	return 0;
+}
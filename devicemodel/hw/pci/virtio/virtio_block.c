@@ -769,10 +769,27 @@ end:
 	return error;
 }
 
+/*
+ * Reset for a warm reset of the VM: the guest memory is zeroed right after,
+ * so the requests still queued in blockif are dropped and the ones in flight
+ * are waited for first. This is done before virtio_pci_reset() takes the
+ * device lock, which the completion of a request needs.
+ */
+static int
+virtio_blk_vdev_reset(struct vmctx *ctx, struct pci_vdev *dev)
+{
+	struct virtio_blk *blk = dev->arg;
+
+	if (!blk->dummy_bctxt)
+		blockif_drain(blk->bc);
+	return virtio_pci_reset(ctx, dev);
+}
+
 struct pci_vdev_ops pci_ops_virtio_blk = {
 	.class_name	= "virtio-blk",
 	.vdev_init	= virtio_blk_init,
 	.vdev_deinit	= virtio_blk_deinit,
+	.vdev_reset	= virtio_blk_vdev_reset,
 	.vdev_barwrite	= virtio_pci_write,
 	.vdev_barread	= virtio_pci_read
 };
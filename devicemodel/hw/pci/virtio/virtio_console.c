@@ -1207,6 +1207,7 @@ struct pci_vdev_ops pci_ops_virtio_console = {
 	.class_name	= "virtio-console",
 	.vdev_init	= virtio_console_init,
 	.vdev_deinit	= virtio_console_deinit,
+	.vdev_reset	= virtio_pci_reset,
 	.vdev_barwrite	= virtio_pci_write,
 	.vdev_barread	= virtio_pci_read
 };
@@ -1546,6 +1546,7 @@ struct pci_vdev_ops pci_ops_virtio_gpio = {
 	.class_name	= "virtio-gpio",
 	.vdev_init	= virtio_gpio_init,
 	.vdev_deinit	= virtio_gpio_deinit,
+	.vdev_reset	= virtio_pci_reset,
 	.vdev_barwrite	= virtio_pci_write,
 	.vdev_barread	= virtio_pci_read,
 	.vdev_write_dsdt	= virtio_gpio_write_dsdt,
@@ -849,6 +849,7 @@ struct pci_vdev_ops pci_ops_virtio_i2c = {
 	.class_name		= "virtio-i2c",
 	.vdev_init		= virtio_i2c_init,
 	.vdev_deinit		= virtio_i2c_deinit,
+	.vdev_reset		= virtio_pci_reset,
 	.vdev_barwrite		= virtio_pci_write,
 	.vdev_barread		= virtio_pci_read,
 	.vdev_write_dsdt	= virtio_i2c_dsdt,
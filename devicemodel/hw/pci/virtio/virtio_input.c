@@ -757,6 +757,7 @@ struct pci_vdev_ops pci_ops_virtio_input = {
 	.class_name	= "virtio-input",
 	.vdev_init	= virtio_input_init,
 	.vdev_deinit	= virtio_input_deinit,
+	.vdev_reset	= virtio_pci_reset,
 	.vdev_barwrite	= virtio_pci_write,
 	.vdev_barread	= virtio_pci_read
 };
@@ -1229,6 +1229,7 @@ struct pci_vdev_ops pci_ops_virtio_net = {
 	.class_name	= "virtio-net",
 	.vdev_init	= virtio_net_init,
 	.vdev_deinit	= virtio_net_deinit,
+	.vdev_reset	= virtio_pci_reset,
 	.vdev_barwrite	= virtio_pci_write,
 	.vdev_barread	= virtio_pci_read
 };
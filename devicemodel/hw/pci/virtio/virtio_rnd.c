@@ -523,6 +523,7 @@ struct pci_vdev_ops pci_ops_virtio_rnd = {
 	.class_name	= "virtio-rnd",
 	.vdev_init	= virtio_rnd_init,
 	.vdev_deinit	= virtio_rnd_deinit,
+	.vdev_reset	= virtio_pci_reset,
 	.vdev_barwrite	= virtio_pci_write,
 	.vdev_barread	= virtio_pci_read
 };
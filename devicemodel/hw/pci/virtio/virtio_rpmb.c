@@ -802,6 +802,7 @@ struct pci_vdev_ops pci_ops_virtio_rpmb = {
 	.class_name	= "virtio-rpmb",
 	.vdev_init	= virtio_rpmb_init,
 	.vdev_deinit	= virtio_rpmb_deinit,
+	.vdev_reset	= virtio_pci_reset,
 	.vdev_barwrite	= virtio_pci_write,
 	.vdev_barread	= virtio_pci_read
 };
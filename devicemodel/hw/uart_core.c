@@ -366,6 +366,22 @@ uart_reset(struct uart_vdev *uart)
 	uart_toggle_intr(uart);
 }
 
+/*
+ * Bring the registers back to their power-on values, on a warm reset of the
+ * VM. The backend is kept.
+ */
+void
+uart_warm_reset(struct uart_vdev *uart)
+{
+	pthread_mutex_lock(&uart->mtx);
+	uart->lcr = 0;
+	uart->mcr = 0;
+	uart->fcr = 0;
+	uart->scr = 0;
+	uart_reset(uart);
+	pthread_mutex_unlock(&uart->mtx);
+}
+
 static void
 uart_drain(int fd, enum ev_type ev, void *arg)
 {
@@ -51,6 +51,8 @@ extern bool pt_tpm2;
 extern bool ssram;
 extern bool vtpm2;
 extern bool is_winvm;
+extern bool warm_reset;
+extern bool migratable;
 
 /**
  * @brief Convert guest physical address to host virtual address
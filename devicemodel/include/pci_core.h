@@ -69,6 +69,12 @@ struct pci_vdev_ops {
 	void	(*vdev_deinit)(struct vmctx *, struct pci_vdev *,
 			char *opts);
 
+	/*
+	 * in-place reset to the state after init, on a warm reset of the VM,
+	 * see pci_reset_vdevs(). Devices without it need a deinit/init.
+	 */
+	int	(*vdev_reset)(struct vmctx *, struct pci_vdev *);
+
 	/* ACPI DSDT enumeration */
 	void	(*vdev_write_dsdt)(struct pci_vdev *);
 
@@ -176,6 +182,7 @@ struct pci_vdev {
 	void	*arg;		/* devemu-private data */
 
 	uint8_t	cfgdata[PCI_REGMAX + 1];
+	uint8_t	init_cfgdata[PCI_REGMAX + 1];	/* cfgdata once init_pci() is done */
 	struct pcibar bar[PCI_BARMAX + 1];
 };
 
@@ -300,6 +307,7 @@ uint32_t get_gpu_rsvmem_size(void);
 
 typedef void (*pci_lintr_cb)(int b, int s, int pin, int pirq_pin,
 			     int ioapic_irq, void *arg);
+typedef int (*pci_vdev_cb)(struct pci_vdev *dev, void *arg);
 
 int	init_pci(struct vmctx *ctx);
 void	deinit_pci(struct vmctx *ctx);
@@ -375,6 +383,9 @@ int	pci_emul_msix_twrite(struct pci_vdev *pi, uint64_t offset, int size,
 uint64_t pci_emul_msix_tread(struct pci_vdev *pi, uint64_t offset, int size);
 int	pci_count_lintr(int bus);
 void	pci_walk_lintr(int bus, pci_lintr_cb cb, void *arg);
+int	pci_walk_vdevs(pci_vdev_cb cb, void *arg);
+bool	pci_vdevs_resettable(void);
+int	pci_reset_vdevs(struct vmctx *ctx);
 void	pci_write_dsdt(void);
 int	pci_bus_configured(int bus);
 int	emulate_pci_cfgrw(struct vmctx *ctx, int vcpu, int in, int bus,
@@ -18,6 +18,7 @@ enum vm_suspend_how {
 	VM_SUSPEND_SUSPEND,
 	VM_SUSPEND_HALT,
 	VM_SUSPEND_TRIPLEFAULT,
+	VM_SUSPEND_HOLD,	/* set up but not started, see ACRN_DM_HOLD_ENV */
 	VM_SUSPEND_LAST
 };
 
@@ -26,5 +27,9 @@ int wait_for_resume(struct vmctx *ctx);
 int vm_resume(struct vmctx *ctx);
 int vm_monitor_resume(void *arg);
 int vm_monitor_query(void *arg);
+void vm_expect_hold(void);
+int wait_for_start(struct vmctx *ctx);
+int vm_release_hold(enum vm_suspend_how how);
+int vm_monitor_unpause(void *arg);
 
 #endif
@@ -81,6 +81,10 @@
 	_IO(ACRN_IOCTL_TYPE, 0x15)
 #define ACRN_IOCTL_SET_VCPU_REGS	\
 	_IOW(ACRN_IOCTL_TYPE, 0x16, struct acrn_vcpu_regs)
+#define ACRN_IOCTL_GET_VCPU_STATE	\
+	_IOWR(ACRN_IOCTL_TYPE, 0x17, struct acrn_vcpu_state)
+#define ACRN_IOCTL_SET_VCPU_STATE	\
+	_IOW(ACRN_IOCTL_TYPE, 0x18, struct acrn_vcpu_state)
 
 /* IRQ and Interrupts */
 #define ACRN_IOCTL_INJECT_MSI		\
@@ -89,6 +93,10 @@
 	_IOW(ACRN_IOCTL_TYPE, 0x24, unsigned long)
 #define ACRN_IOCTL_SET_IRQLINE		\
 	_IOW(ACRN_IOCTL_TYPE, 0x25, __u64)
+#define ACRN_IOCTL_GET_IRQCHIP_STATE	\
+	_IOWR(ACRN_IOCTL_TYPE, 0x26, struct acrn_irqchip_state)
+#define ACRN_IOCTL_SET_IRQCHIP_STATE	\
+	_IOW(ACRN_IOCTL_TYPE, 0x27, struct acrn_irqchip_state)
 
 /* DM ioreq management */
 #define ACRN_IOCTL_NOTIFY_REQUEST_FINISH \
@@ -107,6 +115,11 @@
 	_IOW(ACRN_IOCTL_TYPE, 0x41, struct acrn_vm_memmap)
 #define ACRN_IOCTL_UNSET_MEMSEG		\
 	_IOW(ACRN_IOCTL_TYPE, 0x42, struct acrn_vm_memmap)
+#define ACRN_IOCTL_SET_DIRTY_LOG	\
+	_IOW(ACRN_IOCTL_TYPE, 0x43, __u64)
+/* bitmap_gpa carries the user address of the bitmap, converted by the HSM */
+#define ACRN_IOCTL_GET_DIRTY_BITMAP	\
+	_IOW(ACRN_IOCTL_TYPE, 0x44, struct acrn_dirty_bitmap)
 
 /* PCI assignment*/
 #define ACRN_IOCTL_SET_PTDEV_INTR	\
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2022 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * VM snapshot stream
+ *
+ * A snapshot starts with a struct snapshot_header, followed by a list of
+ * sections terminated by a SNAPSHOT_SEC_END section. Each section is a
+ * struct snapshot_section immediately followed by its payload, padded to
+ * SNAPSHOT_ALIGN. Guest RAM is saved as runs of pages: a SNAPSHOT_SEC_RAM
+ * section carries the content of non-zero pages, a SNAPSHOT_SEC_RAM_ZERO
+ * one has no payload and zeroes its range. The sections are applied in
+ * order, so a range of RAM may be sent several times, the last one wins,
+ * and the ranges never sent keep the zeros of the fresh guest memory.
+ *
+ * The stream is written and read sequentially, it may be a file or a
+ * socket to the restoring device model. The snapshot_fmt_* functions only
+ * deal with the layout and have no dependency on the VM, the device models
+ * or the hypervisor.
+ */
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define SNAPSHOT_MAGIC		0x50414e534e524341UL	/* "ACRNSNAP" */
+#define SNAPSHOT_VERSION	2U
+
+#define SNAPSHOT_ALIGN		8UL
+#define SNAPSHOT_RAM_ALIGN	4096UL
+
+enum snapshot_section_type {
+	SNAPSHOT_SEC_END = 0,
+	SNAPSHOT_SEC_RAM,	/* addr: gpa */
+	SNAPSHOT_SEC_VCPU,	/* id: vcpu id, struct acrn_vcpu_state */
+	SNAPSHOT_SEC_IRQCHIP,	/* id: chip type, struct acrn_irqchip_state */
+	SNAPSHOT_SEC_PCI,	/* id: bdf, PCI config space and MSI-X table */
+	SNAPSHOT_SEC_VIRTIO,	/* id: bdf, struct virtio_base_state */
+	SNAPSHOT_SEC_RAM_ZERO,	/* addr: gpa, size: size of the range, no payload */
+};
+
+struct snapshot_header {
+	uint64_t magic;
+	uint32_t version;
+	uint32_t ncpus;
+	uint64_t lowmem;
+	uint64_t highmem;
+	uint64_t biosmem;
+	uint64_t fbmem;
+};
+
+struct snapshot_section {
+	uint32_t type;
+	uint32_t id;
+	uint64_t addr;
+	uint64_t size;		/* payload size, without padding */
+};
+
+/**
+ * @brief Write the header, at the start of the stream.
+ *
+ * @return 0 on success and -1 on fail.
+ */
+int snapshot_fmt_write_header(int fd, const struct snapshot_header *hdr);
+
+/**
+ * @brief Append a section with its payload.
+ *
+ * @return 0 on success and -1 on fail.
+ */
+int snapshot_fmt_write_section(int fd, uint32_t type, uint32_t id,
+			       uint64_t addr, const void *data, size_t size);
+
+/**
+ * @brief Append the sections of a guest memory range.
+ *
+ * @param fd Snapshot stream.
+ * @param gpa Guest physical address of the range.
+ * @param hva Host virtual address of the range.
+ * @param size Size of the range, a multiple of SNAPSHOT_RAM_ALIGN.
+ * @param zero Whether the pages only holding zeros are sent, as
+ *	       SNAPSHOT_SEC_RAM_ZERO sections. They are needed when the
+ *	       range was sent before.
+ *
+ * @return 0 on success and -1 on fail.
+ */
+int snapshot_fmt_write_ram(int fd, uint64_t gpa, const void *hva, size_t size,
+			   bool zero);
+
+/**
+ * @brief Append the SNAPSHOT_SEC_END section and flush the stream.
+ *
+ * @return 0 on success and -1 on fail.
+ */
+int snapshot_fmt_finish(int fd);
+
+/**
+ * @brief Read and check the file header.
+ *
+ * @return 0 on success and -1 on fail or on an unknown format.
+ */
+int snapshot_fmt_read_header(int fd, struct snapshot_header *hdr);
+
+/**
+ * @brief Read the next section header.
+ *
+ * The payload of the section must then be consumed with
+ * snapshot_fmt_read_data(), snapshot_fmt_read_ram() or snapshot_fmt_skip()
+ * before reading the next section.
+ *
+ * @return 0 on success and -1 on fail.
+ */
+int snapshot_fmt_read_section(int fd, struct snapshot_section *sec);
+
+/**
+ * @brief Read the payload of the current section into buf.
+ *
+ * @param size Size of buf, must be equal to the payload size.
+ *
+ * @return 0 on success and -1 on fail.
+ */
+int snapshot_fmt_read_data(int fd, const struct snapshot_section *sec,
+			   void *buf, size_t size);
+
+/**
+ * @brief Apply the current SNAPSHOT_SEC_RAM or SNAPSHOT_SEC_RAM_ZERO section
+ * to hva, the host virtual address of its range.
+ *
+ * @return 0 on success and -1 on fail.
+ */
+int snapshot_fmt_read_ram(int fd, const struct snapshot_section *sec,
+			  void *hva);
+
+/**
+ * @brief Skip the payload of the current section.
+ *
+ * @return 0 on success and -1 on fail.
+ */
+int snapshot_fmt_skip(int fd, const struct snapshot_section *sec);
+
+struct vmctx;
+
+/**
+ * @brief Pause the VM and save its state into path, a file or
+ * "unix:<socket path>" to a device model restoring from that socket.
+ *
+ * @return 0 on success and -1 on fail.
+ */
+int vm_snapshot(struct vmctx *ctx, const char *path);
+
+/**
+ * @brief Migrate the running VM to the device model restoring from
+ * dest, "unix:<socket path>".
+ *
+ * Guest RAM is copied while the VM runs, then the VM is paused for the
+ * pages left and the device states. The VM stays paused once done.
+ *
+ * @return 0 on success and -1 on fail.
+ */
+int vm_migrate(struct vmctx *ctx, const char *dest);
+
+/**
+ * @brief Log a write of the device model to guest memory, for the migration
+ * in progress if any.
+ */
+void vm_mark_dirty(uint64_t gpa, size_t len);
+
+/**
+ * @brief Restore the state of a created but not yet started VM from the
+ * snapshot set by acrn_parse_restore(), a file or "unix:<socket path>"
+ * to listen on.
+ *
+ * Must be called after the memory and the virtual devices are set up. The
+ * snapshot is only used once, a later reset of the VM boots it normally.
+ *
+ * @return 0 on success and -1 on fail.
+ */
+int vm_restore(struct vmctx *ctx);
+
+/**
+ * @brief Check whether the VM is started from a snapshot.
+ */
+bool vm_restore_enabled(void);
+
+int acrn_parse_restore(const char *path);
+#endif
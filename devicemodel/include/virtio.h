@@ -728,6 +728,19 @@ uint64_t virtio_pci_read(struct vmctx *ctx, int vcpu, struct pci_vdev *dev,
 void virtio_pci_write(struct vmctx *ctx, int vcpu, struct pci_vdev *dev,
 		      int baridx, uint64_t offset, int size, uint64_t value);
 
+/**
+ * @brief Reset a virtio device in place, on a warm reset of the VM.
+ *
+ * Do what a write of 0 to the device status by the guest driver does, it
+ * is the vdev_reset callback of the virtio devices.
+ *
+ * @param ctx Pointer to struct vmctx representing VM context.
+ * @param dev Pointer to struct pci_vdev which emulates a PCI device.
+ *
+ * @return 0 on success.
+ */
+int virtio_pci_reset(struct vmctx *ctx, struct pci_vdev *dev);
+
 /**
  * @brief Set modern BAR (usually 4) to map PCI config registers.
  *
@@ -742,6 +755,88 @@ void virtio_pci_write(struct vmctx *ctx, int vcpu, struct pci_vdev *dev,
  */
 int virtio_set_modern_bar(struct virtio_base *base, bool use_notify_pio);
 
+/**
+ * @brief Transport state of one virtqueue, as kept in a VM snapshot.
+ */
+struct virtio_vq_state {
+	uint16_t qsize;
+	uint16_t flags;
+	uint16_t last_avail;
+	uint16_t save_used;
+	uint16_t msix_idx;
+	uint16_t enabled;
+	uint32_t pfn;
+	uint32_t gpa_desc[2];
+	uint32_t gpa_avail[2];
+	uint32_t gpa_used[2];
+};
+
+/**
+ * @brief Transport state of a virtio device, as kept in a VM snapshot.
+ *
+ * Followed by nvq struct virtio_vq_state.
+ */
+struct virtio_base_state {
+	uint64_t negotiated_caps;
+	uint32_t nvq;
+	uint32_t curq;
+	uint32_t device_feature_select;
+	uint32_t driver_feature_select;
+	uint16_t msix_cfg_idx;
+	uint8_t status;
+	uint8_t isr;
+	uint8_t config_generation;
+	uint8_t reserved[7];
+	struct virtio_vq_state vqs[];
+};
+
+/**
+ * @brief Size of the snapshot state of a virtio device.
+ *
+ * @param base Pointer to struct virtio_base.
+ *
+ * @return size in bytes of struct virtio_base_state with all its queues.
+ */
+size_t virtio_state_size(struct virtio_base *base);
+
+/**
+ * @brief Check that no request is in flight in the device backend.
+ *
+ * Every chain taken from the available ring must have been returned to
+ * the used ring, so that the rings in guest memory fully describe the
+ * device. Only meaningful while the VM is paused.
+ *
+ * @param base Pointer to struct virtio_base.
+ *
+ * @return true if the device is quiesced.
+ */
+bool virtio_is_quiesced(struct virtio_base *base);
+
+/**
+ * @brief Save the transport state of a virtio device.
+ *
+ * @param base Pointer to struct virtio_base.
+ * @param state Buffer of virtio_state_size() bytes.
+ *
+ * @return None
+ */
+void virtio_save_state(struct virtio_base *base, struct virtio_base_state *state);
+
+/**
+ * @brief Restore the transport state of a virtio device.
+ *
+ * Re-maps the rings from guest memory, so guest RAM must be restored first.
+ * Negotiated features and device status are replayed to the device model
+ * through its apply_features and set_status callbacks.
+ *
+ * @param base Pointer to struct virtio_base.
+ * @param state State saved by virtio_save_state().
+ *
+ * @return 0 on success and -1 on mismatch with the device.
+ */
+int virtio_restore_state(struct virtio_base *base,
+			 const struct virtio_base_state *state);
+
 /**
  * @}
  */
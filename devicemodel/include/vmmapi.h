@@ -49,6 +49,7 @@
 struct vmctx {
 	int     fd;
 	int     vmid;
+	int     vcpu_num;
 	int     ioreq_client;
 	uint32_t lowmem_limit;
 	uint64_t highmem_gpa_base;
@@ -125,6 +126,12 @@ bool	init_hugetlb(void);
 void	uninit_hugetlb(void);
 int	hugetlb_setup_memory(struct vmctx *ctx);
 void	hugetlb_unsetup_memory(struct vmctx *ctx);
+int	hugetlb_parse_prefault_threads(const char *opt);
+int	hugetlb_parse_broker(const char *opt);
+int	hugetlb_zero_mem_regions(void);
+typedef int (*hugetlb_region_cb)(vm_paddr_t gpa, char *hva, size_t len,
+				 void *arg);
+int	hugetlb_walk_mem_regions(hugetlb_region_cb cb, void *arg);
 void	*vm_map_gpa(struct vmctx *ctx, vm_paddr_t gaddr, size_t len);
 uint32_t vm_get_lowmem_limit(struct vmctx *ctx);
 size_t	vm_get_lowmem_size(struct vmctx *ctx);
@@ -151,6 +158,12 @@ int	vm_remove_hv_vdev(struct vmctx *ctx, struct acrn_vdev *dev);
 int	acrn_parse_cpu_affinity(char *arg);
 uint64_t vm_get_cpu_affinity_dm(void);
 int	vm_set_vcpu_regs(struct vmctx *ctx, struct acrn_vcpu_regs *cpu_regs);
+int	vm_get_vcpu_state(struct vmctx *ctx, struct acrn_vcpu_state *state);
+int	vm_set_vcpu_state(struct vmctx *ctx, struct acrn_vcpu_state *state);
+int	vm_get_irqchip_state(struct vmctx *ctx, struct acrn_irqchip_state *state);
+int	vm_set_irqchip_state(struct vmctx *ctx, struct acrn_irqchip_state *state);
+int	vm_set_dirty_log(struct vmctx *ctx, bool enable);
+int	vm_get_dirty_bitmap(struct vmctx *ctx, vm_paddr_t gpa, size_t size, uint64_t *bitmap);
 
 int	vm_get_cpu_state(struct vmctx *ctx, void *state_buf);
 int	vm_intr_monitor(struct vmctx *ctx, void *intr_buf);
@@ -36,6 +36,7 @@
 #include <asm/tsc.h>
 #include <ticks.h>
 #include <delay.h>
+#include <boot.h>
 
 #define CPU_UP_TIMEOUT		100U /* millisecond */
 #define CPU_DOWN_TIMEOUT	100U /* millisecond */
@@ -252,6 +253,8 @@ void init_pcpu_post(uint16_t pcpu_id)
 
 		pr_acrnlog("Detect processor: %s", (get_pcpu_info())->model_name);
 
+		print_boot_load_times(get_acrn_boot_info());
+
 		pr_dbg("Core %hu is up", BSP_CPU_ID);
 
 		/* Warn for security feature not ready */
@@ -470,6 +473,8 @@ void cpu_dead(void)
 	int32_t halt = 1;
 	uint16_t pcpu_id = get_pcpu_id();
 
+	/* vCPU context may still be live on this pCPU as it's switched lazily */
+	flush_lazy_ext_context();
 	deinit_sched(pcpu_id);
 	if (bitmap_test(pcpu_id, &pcpu_active_bitmap)) {
 		/* clean up native stuff */
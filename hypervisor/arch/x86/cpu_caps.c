@@ -31,6 +31,10 @@
 /* ADVANCED features: enable them by default if the physical platform support them all, otherwise, disable them all */
 #define APICV_ADVANCED_FEATURE	(VAPIC_FEATURE_VIRT_REG | VAPIC_FEATURE_INTR_DELIVERY | VAPIC_FEATURE_POST_INTR)
 
+/* EPT features */
+#define EPT_FEATURE_BASIC	(1U << 0U)
+#define EPT_FEATURE_PML		(1U << 1U)	/* Page Modification Logging */
+
 static struct cpu_capability {
 	uint8_t apicv_features;
 	uint8_t ept_features;
@@ -234,7 +238,10 @@ static void detect_ept_cap(void)
 		msr_val = msr_read(MSR_IA32_VMX_PROCBASED_CTLS2);
 
 		if (is_ctrl_setting_allowed(msr_val, VMX_PROCBASED_CTLS2_EPT)) {
-			cpu_caps.ept_features = 1U;
+			cpu_caps.ept_features = EPT_FEATURE_BASIC;
+			if (is_ctrl_setting_allowed(msr_val, VMX_PROCBASED_CTLS2_PML)) {
+				cpu_caps.ept_features |= EPT_FEATURE_PML;
+			}
 		}
 	}
 }
@@ -389,7 +396,13 @@ void init_pcpu_capabilities(void)
 
 static bool is_ept_supported(void)
 {
-	return (cpu_caps.ept_features != 0U);
+	return ((cpu_caps.ept_features & EPT_FEATURE_BASIC) != 0U);
+}
+
+/* PML logs the writes that set the EPT dirty flags, it is only usable with EPT A/D */
+bool is_pml_supported(void)
+{
+	return ((cpu_caps.ept_features & EPT_FEATURE_PML) != 0U) && pcpu_has_vmx_ept_vpid_cap(VMX_EPT_AD);
 }
 
 static inline bool is_apicv_basic_feature_supported(void)
@@ -16,6 +16,9 @@
 #include <asm/irq.h>
 #include <asm/guest/optee.h>
 
+/* ptirq entries dequeued and injected per batch by the ptdev softirq */
+#define PTIRQ_SOFTIRQ_BATCH	16U
+
 /*
  * Check if the IRQ is single-destination and return the destination vCPU if so.
  *
@@ -363,7 +366,11 @@ static struct ptirq_remapping_info *add_intx_remapping(struct acrn_vm *vm, uint3
 	DEFINE_INTX_SID(virt_sid, virt_gsi, vgsi_ctlr);
 	uint32_t phys_irq = ioapic_gsi_to_irq(phys_gsi);
 
-	entry = find_ptirq_entry(PTDEV_INTR_INTX, &phys_sid, NULL);
+	/* INTx entries are activated with the irq of their physical GSI */
+	entry = ptirq_find_entry_by_irq(phys_irq);
+	if ((entry != NULL) && ((entry->intr_type != PTDEV_INTR_INTX) || (entry->phys_sid.value != phys_sid.value))) {
+		entry = NULL;
+	}
 	if (entry == NULL) {
 		if (find_ptirq_entry(PTDEV_INTR_INTX, &virt_sid, vm) == NULL) {
 			entry = ptirq_alloc_entry(vm, PTDEV_INTR_INTX);
@@ -383,8 +390,7 @@ static struct ptirq_remapping_info *add_intx_remapping(struct acrn_vm *vm, uint3
 		}
 	} else if (entry->vm != vm) {
 		if (is_service_vm(entry->vm)) {
-			entry->vm = vm;
-			entry->virt_sid.value = virt_sid.value;
+			ptirq_change_entry_owner(entry, vm, &virt_sid);
 			entry->polarity = 0U;
 		} else {
 			pr_err("INTX gsi%d already in vm%d with vgsi%d, not able to add into vm%d with vgsi%d",
@@ -505,39 +511,54 @@ static void ptirq_handle_intx(struct acrn_vm *vm,
 
 void ptirq_softirq(uint16_t pcpu_id)
 {
-	while (1) {
-		struct ptirq_remapping_info *entry = ptirq_dequeue_softirq(pcpu_id);
-		struct msi_info *vmsi;
+	struct ptirq_remapping_info *entries[PTIRQ_SOFTIRQ_BATCH];
+	struct ptirq_remapping_info *entry;
+	struct msi_info *vmsi;
+	uint32_t i, num;
 
-		if (entry == NULL) {
+	do {
+		num = ptirq_dequeue_softirq(pcpu_id, entries, PTIRQ_SOFTIRQ_BATCH);
+		if (num == 0U) {
 			break;
 		}
 
-		vmsi = &entry->vmsi;
-
-		/* skip any inactive entry */
-		if (!is_entry_active(entry)) {
-			/* service next item */
-			continue;
-		}
+		/*
+		 * The PIR/IRR bits of all the entries are set first, each destination vCPU
+		 * gets one posted interrupt notification at the end of the batch.
+		 */
+		vlapic_defer_pi_notification();
+		for (i = 0U; i < num; i++) {
+			entry = entries[i];
+			vmsi = &entry->vmsi;
+
+			/* skip any inactive entry */
+			if (!is_entry_active(entry)) {
+				/* service next item */
+				continue;
+			}
 
-		/* handle real request */
-		if (entry->intr_type == PTDEV_INTR_INTX) {
-			ptirq_handle_intx(entry->vm, entry);
-		} else {
-			if (vmsi != NULL) {
-				/* TODO: vmsi destmode check required */
-				(void)vlapic_inject_msi(entry->vm, vmsi->addr.full, vmsi->data.full);
-				dev_dbg(DBG_LEVEL_PTIRQ, "dev-assign: irq=0x%x MSI VR: 0x%x-0x%x",
-					entry->allocated_pirq, vmsi->data.bits.vector,
-					irq_to_vector(entry->allocated_pirq));
-				dev_dbg(DBG_LEVEL_PTIRQ, " vmsi_addr: 0x%lx vmsi_data: 0x%x",
-					vmsi->addr.full, vmsi->data.full);
+			/* handle real request */
+			if (entry->intr_type == PTDEV_INTR_INTX) {
+				ptirq_handle_intx(entry->vm, entry);
+			} else {
+				if (vmsi != NULL) {
+					/* TODO: vmsi destmode check required */
+					(void)vlapic_inject_msi(entry->vm, vmsi->addr.full, vmsi->data.full);
+					dev_dbg(DBG_LEVEL_PTIRQ, "dev-assign: irq=0x%x MSI VR: 0x%x-0x%x",
+						entry->allocated_pirq, vmsi->data.bits.vector,
+						irq_to_vector(entry->allocated_pirq));
+					dev_dbg(DBG_LEVEL_PTIRQ, " vmsi_addr: 0x%lx vmsi_data: 0x%x",
+						vmsi->addr.full, vmsi->data.full);
+				}
 			}
+
+			handle_x86_tee_int(entry, pcpu_id);
 		}
+		vlapic_flush_pi_notification();
 
-		handle_x86_tee_int(entry, pcpu_id);
-	}
+		per_cpu(ptirq_batch_count, pcpu_id)++;
+		per_cpu(ptirq_inject_count, pcpu_id) += num;
+	} while (num == PTIRQ_SOFTIRQ_BATCH);
 }
 
 void ptirq_intx_ack(struct acrn_vm *vm, uint32_t virt_gsi, enum intx_ctlr vgsi_ctlr)
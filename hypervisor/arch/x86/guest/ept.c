@@ -16,6 +16,7 @@
 #include <logmsg.h>
 #include <trace.h>
 #include <asm/rtct.h>
+#include <asm/per_cpu.h>
 
 #define DBG_LEVEL_EPT	6U
 
@@ -191,6 +192,8 @@ void init_ept_pgtable(struct pgtable *table, uint16_t vm_id)
 	table->pgentry_present = ept_pgentry_present;
 	table->clflush_pagewalk = ept_clflush_pagewalk;
 	table->large_page_support = ept_large_page_support;
+	/* until a secure world shares the PD pages */
+	table->merge_pd_pages = true;
 
 	/* Mitigation for issue "Machine Check Error on Page Size Change" */
 	if (is_ept_force_4k_ipage()) {
@@ -319,21 +322,82 @@ static inline void ept_flush_guest(struct acrn_vm *vm)
 	}
 }
 
+/*
+ * The iommu domain of the VM translates DMA with the normal world EPT,
+ * drop the IOTLB entries of the changed range when it is that EPT being changed.
+ */
+static void ept_flush_iommu(const struct acrn_vm *vm, const uint64_t *pml4_page, uint64_t gpa, uint64_t size)
+{
+	if ((vm->iommu != NULL) && (vm->iommu->trans_table_ptr == hva2hpa(pml4_page))) {
+		iommu_invalidate_range(vm->iommu, gpa, size);
+	}
+}
+
+/*
+ * The EPT updates of a VM only serialize on the locks of the 1G GPA slots they
+ * touch. Each PDPTE subtree belongs to one slot, and a missing PML4E is installed
+ * locklessly by pgtable_add_map(), so updates of disjoint slots run concurrently.
+ * The locks are always taken in ascending order.
+ */
+static uint32_t ept_lock_mask(uint64_t gpa, uint64_t size)
+{
+	uint64_t slot = gpa >> PDPTE_SHIFT;
+	uint64_t last = (size == 0UL) ? slot : ((gpa + size - 1UL) >> PDPTE_SHIFT);
+	uint32_t mask = 0U;
+
+	if ((last - slot) >= EPT_LOCK_SHARDS) {
+		mask = (1U << EPT_LOCK_SHARDS) - 1U;
+	} else {
+		for (; slot <= last; slot++) {
+			mask |= 1U << (uint32_t)(slot % EPT_LOCK_SHARDS);
+		}
+	}
+
+	return mask;
+}
+
+static uint32_t ept_lock_range(struct acrn_vm *vm, uint64_t gpa, uint64_t size)
+{
+	uint32_t mask = ept_lock_mask(gpa, size);
+	uint32_t i;
+
+	for (i = 0U; i < EPT_LOCK_SHARDS; i++) {
+		if ((mask & (1U << i)) != 0U) {
+			spinlock_obtain(&vm->ept_lock[i]);
+		}
+	}
+
+	return mask;
+}
+
+static void ept_unlock_range(struct acrn_vm *vm, uint32_t mask)
+{
+	uint32_t i;
+
+	for (i = 0U; i < EPT_LOCK_SHARDS; i++) {
+		if ((mask & (1U << i)) != 0U) {
+			spinlock_release(&vm->ept_lock[i]);
+		}
+	}
+}
+
 void ept_add_mr(struct acrn_vm *vm, uint64_t *pml4_page,
 	uint64_t hpa, uint64_t gpa, uint64_t size, uint64_t prot_orig)
 {
 	uint64_t prot = prot_orig;
+	uint32_t lock_mask;
 
 	dev_dbg(DBG_LEVEL_EPT, "%s, vm[%d] hpa: 0x%016lx gpa: 0x%016lx size: 0x%016lx prot: 0x%016x\n",
 			__func__, vm->vm_id, hpa, gpa, size, prot);
 
-	spinlock_obtain(&vm->ept_lock);
+	lock_mask = ept_lock_range(vm, gpa, size);
 
 	pgtable_add_map(pml4_page, hpa, gpa, size, prot, &vm->arch_vm.ept_pgtable);
 
-	spinlock_release(&vm->ept_lock);
+	ept_unlock_range(vm, lock_mask);
 
 	ept_flush_guest(vm);
+	ept_flush_iommu(vm, pml4_page, gpa, size);
 }
 
 void ept_modify_mr(struct acrn_vm *vm, uint64_t *pml4_page,
@@ -341,31 +405,89 @@ void ept_modify_mr(struct acrn_vm *vm, uint64_t *pml4_page,
 		uint64_t prot_set, uint64_t prot_clr)
 {
 	uint64_t local_prot = prot_set;
+	uint32_t lock_mask;
 
 	dev_dbg(DBG_LEVEL_EPT, "%s,vm[%d] gpa 0x%lx size 0x%lx\n", __func__, vm->vm_id, gpa, size);
 
-	spinlock_obtain(&vm->ept_lock);
+	lock_mask = ept_lock_range(vm, gpa, size);
 
 	pgtable_modify_or_del_map(pml4_page, gpa, size, local_prot, prot_clr, &(vm->arch_vm.ept_pgtable), MR_MODIFY);
 
-	spinlock_release(&vm->ept_lock);
+	ept_unlock_range(vm, lock_mask);
 
 	ept_flush_guest(vm);
+	ept_flush_iommu(vm, pml4_page, gpa, size);
+}
+
+/* a memory region update split into its 1G GPA slots, each one locked by a single EPT lock */
+struct ept_mr_work {
+	struct acrn_vm *vm;
+	uint64_t *pml4_page;
+	uint64_t hpa;
+	uint64_t gpa;
+	uint64_t size;
+	uint64_t prot_set;
+	uint64_t prot_clr;
+	bool add;
+};
+
+static uint64_t ept_mr_slots(uint64_t gpa, uint64_t size)
+{
+	return (((gpa + size + PDPTE_SIZE) - 1UL) >> PDPTE_SHIFT) - (gpa >> PDPTE_SHIFT);
+}
+
+static void ept_mr_work_slot(void *data, uint64_t chunk)
+{
+	const struct ept_mr_work *work = (const struct ept_mr_work *)data;
+	uint64_t start = (work->gpa & PDPTE_MASK) + (chunk << PDPTE_SHIFT);
+	uint64_t end = start + PDPTE_SIZE;
+
+	start = max(start, work->gpa);
+	end = min(end, work->gpa + work->size);
+	if (work->add) {
+		ept_add_mr(work->vm, work->pml4_page, work->hpa + (start - work->gpa), start, end - start, work->prot_set);
+	} else {
+		ept_modify_mr(work->vm, work->pml4_page, start, end - start, work->prot_set, work->prot_clr);
+	}
 }
+
+void ept_add_mr_parallel(struct acrn_vm *vm, uint64_t *pml4_page, uint64_t hpa,
+		uint64_t gpa, uint64_t size, uint64_t prot, uint64_t helper_mask)
+{
+	struct ept_mr_work work = { vm, pml4_page, hpa, gpa, size, prot, 0UL, true };
+
+	if (size != 0UL) {
+		smp_call_split(helper_mask, ept_mr_work_slot, &work, ept_mr_slots(gpa, size));
+	}
+}
+
+void ept_modify_mr_parallel(struct acrn_vm *vm, uint64_t *pml4_page, uint64_t gpa,
+		uint64_t size, uint64_t prot_set, uint64_t prot_clr, uint64_t helper_mask)
+{
+	struct ept_mr_work work = { vm, pml4_page, 0UL, gpa, size, prot_set, prot_clr, false };
+
+	if (size != 0UL) {
+		smp_call_split(helper_mask, ept_mr_work_slot, &work, ept_mr_slots(gpa, size));
+	}
+}
+
 /**
  * @pre [gpa,gpa+size) has been mapped into host physical memory region
  */
 void ept_del_mr(struct acrn_vm *vm, uint64_t *pml4_page, uint64_t gpa, uint64_t size)
 {
+	uint32_t lock_mask;
+
 	dev_dbg(DBG_LEVEL_EPT, "%s,vm[%d] gpa 0x%lx size 0x%lx\n", __func__, vm->vm_id, gpa, size);
 
-	spinlock_obtain(&vm->ept_lock);
+	lock_mask = ept_lock_range(vm, gpa, size);
 
 	pgtable_modify_or_del_map(pml4_page, gpa, size, 0UL, 0UL, &(vm->arch_vm.ept_pgtable), MR_DEL);
 
-	spinlock_release(&vm->ept_lock);
+	ept_unlock_range(vm, lock_mask);
 
 	ept_flush_guest(vm);
+	ept_flush_iommu(vm, pml4_page, gpa, size);
 }
 
 /**
@@ -481,3 +603,712 @@ void walk_ept_table(struct acrn_vm *vm, pge_handler cb)
 		}
 	}
 }
+
+void ept_get_page_sizes(struct acrn_vm *vm, struct acrn_ept_page_sizes *sizes)
+{
+	struct pgtable_stats stats;
+	uint32_t lock_mask;
+
+	lock_mask = ept_lock_range(vm, 0UL, ~0UL);
+	pgtable_get_stats((const uint64_t *)vm->arch_vm.nworld_eptp, &vm->arch_vm.ept_pgtable, &stats);
+	ept_unlock_range(vm, lock_mask);
+
+	sizes->pages_4k = stats.leaves[IA32E_PT];
+	sizes->pages_2m = stats.leaves[IA32E_PD];
+	sizes->pages_1g = stats.leaves[IA32E_PDPT];
+	sizes->table_pages = stats.table_pages;
+}
+
+/* A flush of the guest memory shared by the current pCPU and the helper pCPUs */
+struct ept_flush_work {
+	struct acrn_vm *vm;
+	const uint64_t *ept_root;
+	bool dirty_only;	/* skip the pages whose dirty flag is clear */
+	bool clear_dirty;	/* clear the dirty flag of the flushed pages */
+	int64_t next_chunk;	/* the next chunk to be claimed by a walker */
+};
+
+static void ept_flush_work_leaf(const struct ept_flush_work *work, uint64_t *pge, uint64_t size)
+{
+	if (!work->dirty_only || ((*pge & EPT_DIRTY) != 0UL)) {
+		if (work->clear_dirty) {
+			/* other fields of the entry may be updated under the EPT locks at the same time */
+			bitmap_clear_lock(EPT_DIRTY_POS, pge);
+		}
+		ept_flush_leaf_page(pge, size);
+	}
+}
+
+/*
+ * The EPT is split into chunks of one large PDPTE or PDE, or one PT page. All walkers
+ * enumerate the present chunks in the same order and each one only flushes the chunks
+ * it claims from work->next_chunk, so a chunk is flushed once however many walkers run.
+ */
+static void ept_flush_work_walk(struct ept_flush_work *work, bool preemptible)
+{
+	const struct pgtable *table = &work->vm->arch_vm.ept_pgtable;
+	uint64_t *pml4e, *pdpte, *pde, *pte;
+	uint64_t i, j, k, m;
+	int64_t seq = 0L;
+	int64_t claim = atomic_inc64_return(&work->next_chunk) - 1L;
+
+	for (i = 0UL; i < PTRS_PER_PML4E; i++) {
+		pml4e = pml4e_offset((uint64_t *)work->ept_root, i << PML4E_SHIFT);
+		if (table->pgentry_present(*pml4e) == 0UL) {
+			continue;
+		}
+		for (j = 0UL; j < PTRS_PER_PDPTE; j++) {
+			pdpte = pdpte_offset(pml4e, j << PDPTE_SHIFT);
+			if (table->pgentry_present(*pdpte) == 0UL) {
+				continue;
+			}
+			if (pdpte_large(*pdpte) != 0UL) {
+				if (seq == claim) {
+					ept_flush_work_leaf(work, pdpte, PDPTE_SIZE);
+					claim = atomic_inc64_return(&work->next_chunk) - 1L;
+				}
+				seq++;
+				continue;
+			}
+			for (k = 0UL; k < PTRS_PER_PDE; k++) {
+				pde = pde_offset(pdpte, k << PDE_SHIFT);
+				if (table->pgentry_present(*pde) == 0UL) {
+					continue;
+				}
+				if (seq == claim) {
+					if (pde_large(*pde) != 0UL) {
+						ept_flush_work_leaf(work, pde, PDE_SIZE);
+					} else {
+						for (m = 0UL; m < PTRS_PER_PTE; m++) {
+							pte = pte_offset(pde, m << PTE_SHIFT);
+							if (table->pgentry_present(*pte) != 0UL) {
+								ept_flush_work_leaf(work, pte, PTE_SIZE);
+							}
+						}
+					}
+					claim = atomic_inc64_return(&work->next_chunk) - 1L;
+				}
+				seq++;
+			}
+			/* Same as walk_ept_table(), give chance to release CPU if not in interrupt context */
+			if (preemptible && need_reschedule(get_pcpu_id())) {
+				schedule();
+			}
+		}
+	}
+
+	/* the CLFLUSHOPTs issued by this walker are only ordered by a fence */
+	cpu_write_memory_barrier();
+}
+
+/* run in interrupt context of the helper pCPUs */
+static void ept_flush_work_helper(void *data)
+{
+	ept_flush_work_walk((struct ept_flush_work *)data, false);
+}
+
+static void ept_flush_work_sync(__unused void *data)
+{
+}
+
+/*
+ * The DM and its backends write the memory of a post-launched VM, passthrough devices DMA
+ * into the memory of the Service VM and of the VMs they are assigned to, and the ivshmem
+ * peers write the shared memory through their own EPTs, so WBINVD of such a VM keeps
+ * flushing all its memory.
+ *
+ * @pre vm != NULL
+ */
+bool ept_wbinvd_dirty_only_usable(const struct acrn_vm *vm)
+{
+	const struct acrn_vm_config *vm_config = get_vm_config(vm->vm_id);
+	const struct acrn_vm_pci_dev_config *dev_config;
+	bool ret = !is_postlaunched_vm(vm) && !is_service_vm(vm);
+	uint16_t i;
+
+	for (i = 0U; ret && (i < vm_config->pci_dev_num); i++) {
+		dev_config = &vm_config->pci_devs[i];
+		if ((dev_config->emu_type == PCI_DEV_TYPE_PTDEV) || (dev_config->shm_region_name[0] != '\0')) {
+			ret = false;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @pre vm != NULL
+ */
+void ept_hv_write_done(struct acrn_vm *vm)
+{
+	atomic_inc32(&vm->arch_vm.hv_write_gen);
+}
+
+/**
+ * @pre vm != NULL
+ */
+void ept_flush_guest_cache(struct acrn_vm *vm, uint64_t helper_mask)
+{
+	struct ept_flush_work work;
+	struct smp_call_token token;
+	uint32_t hv_write_gen = *(volatile const uint32_t *)&vm->arch_vm.hv_write_gen;
+
+	/* paired with the wait in ept_set_dirty_log(), the dirty flags belong to the log once it is enabled */
+	atomic_inc32(&vm->arch_vm.dirty_log.flushing);
+
+	work.vm = vm;
+	work.ept_root = (const uint64_t *)get_eptp(vm);
+	/* the dirty flags of the post-launched VMs logging them serve the log only */
+	work.clear_dirty = vm->arch_vm.ept_ad_enabled && !vm->arch_vm.dirty_log.enabled &&
+		ept_wbinvd_dirty_only_usable(vm);
+	/*
+	 * Writes to the secure world memory, before the first flush, e.g. image loading, or by
+	 * the hypervisor since the last flush are not tracked. A hypervisor write done after
+	 * hv_write_gen is read above makes the next flush a full one.
+	 */
+	work.dirty_only = vm->arch_vm.wbinvd_dirty_tracked && work.clear_dirty &&
+		(work.ept_root == vm->arch_vm.nworld_eptp) && (hv_write_gen == vm->arch_vm.wbinvd_hv_write_gen);
+	work.next_chunk = 0L;
+	if (work.clear_dirty && (work.ept_root == vm->arch_vm.nworld_eptp)) {
+		vm->arch_vm.wbinvd_dirty_tracked = true;
+		vm->arch_vm.wbinvd_hv_write_gen = hv_write_gen;
+	}
+
+	if (helper_mask != 0UL) {
+		if (work.clear_dirty) {
+			/*
+			 * The notification kicks the vCPUs out of non-root mode, once the calls are done
+			 * on the helper pCPUs, the vCPUs running there will not write the guest memory
+			 * with a stale cached dirty flag before they handle their pending requests.
+			 */
+			smp_call_function_async(helper_mask, ept_flush_work_sync, NULL, &token);
+			smp_call_wait(&token);
+		}
+		smp_call_function_async(helper_mask, ept_flush_work_helper, &work, &token);
+	}
+
+	ept_flush_work_walk(&work, true);
+
+	if (helper_mask != 0UL) {
+		smp_call_wait(&token);
+	}
+
+	if (work.clear_dirty) {
+		/* Drop the cached translations with the dirty flag set before the vCPUs write again */
+		ept_flush_guest(vm);
+	}
+
+	atomic_dec32(&vm->arch_vm.dirty_log.flushing);
+}
+
+/**
+ * @pre vm != NULL
+ */
+void ept_dirty_log_init(struct acrn_vm *vm)
+{
+	struct ept_dirty_log *log = &vm->arch_vm.dirty_log;
+
+	(void)memset(log, 0U, sizeof(*log));
+	spinlock_init(&log->lock);
+}
+
+/* Walk all the guest memory at the next harvests, log->lock must be held */
+static void dirty_log_walk_all(struct ept_dirty_log *log)
+{
+	log->nr_walk = 1U;
+	log->walk[0].start = 0UL;
+	log->walk[0].end = MAX_PHY_ADDRESS_SPACE;
+	/* the walk finds the pages of the logged GPAs too */
+	log->count = 0U;
+}
+
+/* log->lock must be held */
+static void dirty_log_add(struct ept_dirty_log *log, uint64_t gpa)
+{
+	if (log->count < EPT_DIRTY_LOG_ENTRIES) {
+		log->gpa[log->cur][log->count] = gpa;
+		log->count++;
+	} else {
+		dirty_log_walk_all(log);
+	}
+}
+
+/*
+ * Move the GPAs logged by the PML of vcpu to the log of the VM, the VMCS of vcpu
+ * must be the current one and log->lock must be held.
+ */
+static void pml_drain(struct ept_dirty_log *log, const struct acrn_vcpu *vcpu)
+{
+	uint32_t index = exec_vmread16(VMX_GUEST_PML_INDEX);
+	uint32_t i;
+
+	/* the index is decremented after each logging, it wraps around to 0xffff once the log is full */
+	i = (index >= PML_ENTRY_NUM) ? 0U : (index + 1U);
+	for (; i < PML_ENTRY_NUM; i++) {
+		dirty_log_add(log, vcpu->arch.pml_buffer[i] & PTE_MASK);
+	}
+	exec_vmwrite16(VMX_GUEST_PML_INDEX, (uint16_t)(PML_ENTRY_NUM - 1U));
+}
+
+/**
+ * @pre vcpu != NULL
+ */
+int32_t pml_full_vmexit_handler(struct acrn_vcpu *vcpu)
+{
+	struct ept_dirty_log *log = &vcpu->vm->arch_vm.dirty_log;
+	uint64_t rflags;
+
+	spinlock_irqsave_obtain(&log->lock, &rflags);
+	if (vcpu->arch.pml_enabled) {
+		pml_drain(log, vcpu);
+	}
+	spinlock_irqrestore_release(&log->lock, rflags);
+
+	/* the write causing the VM exit is not done yet */
+	vcpu_retain_rip(vcpu);
+
+	return 0;
+}
+
+/**
+ * @pre vcpu != NULL
+ */
+void ept_dirty_log_sync_vcpu(struct acrn_vcpu *vcpu)
+{
+	struct ept_dirty_log *log = &vcpu->vm->arch_vm.dirty_log;
+	uint32_t value32;
+	uint64_t rflags;
+	bool enable;
+
+	spinlock_irqsave_obtain(&log->lock, &rflags);
+	enable = log->enabled && log->use_pml;
+	if (enable != vcpu->arch.pml_enabled) {
+		value32 = exec_vmread32(VMX_PROC_VM_EXEC_CONTROLS2);
+		if (enable) {
+			exec_vmwrite64(VMX_PML_ADDR_FULL, hva2hpa(vcpu->arch.pml_buffer));
+			exec_vmwrite16(VMX_GUEST_PML_INDEX, (uint16_t)(PML_ENTRY_NUM - 1U));
+			value32 |= VMX_PROCBASED_CTLS2_PML;
+		} else {
+			value32 &= ~VMX_PROCBASED_CTLS2_PML;
+		}
+		exec_vmwrite32(VMX_PROC_VM_EXEC_CONTROLS2, value32);
+		vcpu->arch.pml_enabled = enable;
+	}
+	spinlock_irqrestore_release(&log->lock, rflags);
+}
+
+/**
+ * @pre vcpu != NULL
+ */
+void ept_dirty_log_stop_vcpu(struct acrn_vcpu *vcpu)
+{
+	struct ept_dirty_log *log = &vcpu->vm->arch_vm.dirty_log;
+	uint64_t rflags;
+
+	spinlock_irqsave_obtain(&log->lock, &rflags);
+	if (vcpu->arch.pml_enabled) {
+		/* the VMCS may not be live on this pCPU, walk the EPT instead of the dropped GPAs */
+		dirty_log_walk_all(log);
+		vcpu->arch.pml_enabled = false;
+	}
+	spinlock_irqrestore_release(&log->lock, rflags);
+}
+
+/* run in interrupt context of the pCPUs of the vCPUs, the VMCS of a vCPU may only be live there */
+static void pml_drain_ipi(void *data)
+{
+	struct acrn_vm *vm = (struct acrn_vm *)data;
+	struct ept_dirty_log *log = &vm->arch_vm.dirty_log;
+	struct acrn_vcpu *vcpu = vcpu_from_pid(vm, get_pcpu_id());
+	void **vmcs_ptr = &get_cpu_var(vmcs_run);
+	void *prev_vmcs = *vmcs_ptr;
+	uint64_t rflags;
+
+	if (vcpu != NULL) {
+		spinlock_irqsave_obtain(&log->lock, &rflags);
+		if (vcpu->arch.pml_enabled) {
+			if (prev_vmcs != (void *)vcpu->arch.vmcs) {
+				load_va_vmcs(vcpu->arch.vmcs);
+				*vmcs_ptr = (void *)vcpu->arch.vmcs;
+			}
+
+			pml_drain(log, vcpu);
+
+			if ((prev_vmcs != NULL) && (prev_vmcs != (void *)vcpu->arch.vmcs)) {
+				load_va_vmcs(prev_vmcs);
+				*vmcs_ptr = prev_vmcs;
+			}
+		}
+		spinlock_irqrestore_release(&log->lock, rflags);
+	}
+}
+
+static uint64_t vm_pcpu_mask(struct acrn_vm *vm)
+{
+	uint16_t i;
+	uint64_t mask = 0UL;
+	struct acrn_vcpu *vcpu;
+
+	foreach_vcpu(i, vm, vcpu) {
+		bitmap_set_nolock(pcpuid_from_vcpu(vcpu), &mask);
+	}
+
+	return mask;
+}
+
+/* log->lock must be held */
+static void dirty_log_set(struct ept_dirty_log *log, bool enable)
+{
+	log->enabled = enable;
+	log->use_pml = enable && is_pml_supported();
+	log->cur = 0U;
+	dirty_log_walk_all(log);
+}
+
+/**
+ * @pre vm != NULL
+ */
+int32_t ept_set_dirty_log(struct acrn_vm *vm, bool enable)
+{
+	struct ept_dirty_log *log = &vm->arch_vm.dirty_log;
+	struct acrn_vcpu *vcpu;
+	uint64_t rflags;
+	uint16_t i;
+	int32_t ret = -EINVAL;
+	bool was_enabled;
+
+	/* the writes of a nested guest go through the shadow EPT, which has no dirty flags of this VM */
+	if (vm->arch_vm.ept_ad_enabled && !is_nvmx_configured(vm)) {
+		if (atomic_cmpxchg32(&log->busy, 0U, 1U) != 0U) {
+			ret = -EBUSY;
+		} else {
+			spinlock_irqsave_obtain(&log->lock, &rflags);
+			was_enabled = log->enabled;
+			dirty_log_set(log, enable);
+			spinlock_irqrestore_release(&log->lock, rflags);
+			ret = 0;
+
+			if (enable && !was_enabled) {
+				/*
+				 * A WBINVD emulation that saw the log disabled may still be clearing the
+				 * dirty flags. The caller holds the VM lock, so don't wait for it here:
+				 * disable the log again and let the caller retry.
+				 */
+				cpu_memory_barrier();
+				if (*(volatile uint32_t *)&log->flushing != 0U) {
+					spinlock_irqsave_obtain(&log->lock, &rflags);
+					dirty_log_set(log, false);
+					spinlock_irqrestore_release(&log->lock, rflags);
+					ret = -EAGAIN;
+				}
+			}
+
+			if (ret == 0) {
+				foreach_vcpu(i, vm, vcpu) {
+					vcpu_make_request(vcpu, ACRN_REQUEST_DIRTY_LOG);
+				}
+			}
+
+			(void)atomic_swap32(&log->busy, 0U);
+		}
+	}
+
+	return ret;
+}
+
+/* A harvest of the dirty pages of [start, end) into the bitmap at bitmap_gpa of bitmap_vm */
+struct dirty_harvest {
+	struct acrn_vm *vm;
+	uint64_t *ept_root;
+	uint64_t start;
+	uint64_t end;
+	struct acrn_vm *bitmap_vm;
+	uint64_t bitmap_gpa;
+	uint64_t word_idx;	/* index of the cached bitmap word */
+	uint64_t word;
+	bool cleared;		/* some dirty flags are cleared */
+};
+
+/*
+ * Get the pages [*first, *last) of [start, end) reported as written by a leaf entry which maps
+ * [leaf_gpa, leaf_gpa + leaf_size), and whether the dirty flag of the entry can be cleared, i.e.
+ * it is set and the leaf is completely in the range. It has no side effect on the entry.
+ */
+static bool dirty_leaf_pages(uint64_t entry, uint64_t leaf_gpa, uint64_t leaf_size,
+		uint64_t start, uint64_t end, uint64_t *first, uint64_t *last)
+{
+	uint64_t leaf_end = leaf_gpa + leaf_size;
+	bool dirty = ((entry & EPT_DIRTY) != 0UL);
+
+	*first = ((leaf_gpa > start) ? leaf_gpa : start) >> PAGE_SHIFT;
+	*last = ((leaf_end < end) ? leaf_end : end) >> PAGE_SHIFT;
+	if (!dirty || (*last < *first)) {
+		*last = *first;
+	}
+
+	return dirty && (leaf_gpa >= start) && (leaf_end <= end);
+}
+
+static void dirty_bitmap_flush(struct dirty_harvest *h)
+{
+	uint64_t gpa = h->bitmap_gpa + (h->word_idx << 3U);
+	uint64_t old = 0UL;
+
+	if (h->word != 0UL) {
+		/* the logged GPAs are not sorted, a word may be harvested more than once */
+		(void)copy_from_gpa(h->bitmap_vm, &old, gpa, sizeof(old));
+		h->word |= old;
+		(void)copy_to_gpa(h->bitmap_vm, &h->word, gpa, sizeof(h->word));
+		h->word = 0UL;
+	}
+}
+
+/* Set the bits of the pages [first, last) in the bitmap */
+static void dirty_bitmap_set(struct dirty_harvest *h, uint64_t first, uint64_t last)
+{
+	uint64_t pos = first - (h->start >> PAGE_SHIFT);
+	uint64_t end = last - (h->start >> PAGE_SHIFT);
+	uint64_t bit, n;
+
+	while (pos < end) {
+		if ((pos >> 6U) != h->word_idx) {
+			dirty_bitmap_flush(h);
+			h->word_idx = pos >> 6U;
+		}
+		bit = pos & 63UL;
+		n = ((end - pos) < (64UL - bit)) ? (end - pos) : (64UL - bit);
+		h->word |= (n == 64UL) ? ~0UL : (((1UL << n) - 1UL) << bit);
+		pos += n;
+	}
+}
+
+/* Return true if the leaf is completely in the range of the harvest */
+static bool dirty_harvest_leaf(struct dirty_harvest *h, uint64_t *pge, uint64_t leaf_gpa, uint64_t leaf_size)
+{
+	uint64_t first, last;
+	bool contained = (leaf_gpa >= h->start) && ((leaf_gpa + leaf_size) <= h->end);
+
+	if (dirty_leaf_pages(*pge, leaf_gpa, leaf_size, h->start, h->end, &first, &last)) {
+		/* other fields of the entry may be updated under the EPT locks at the same time */
+		bitmap_clear_lock(EPT_DIRTY_POS, pge);
+		h->cleared = true;
+	}
+	dirty_bitmap_set(h, first, last);
+
+	return contained;
+}
+
+/* Harvest the leaves mapping [start, end) by their dirty flags */
+static void dirty_harvest_walk(struct dirty_harvest *h, uint64_t start, uint64_t end)
+{
+	const struct pgtable *table = &h->vm->arch_vm.ept_pgtable;
+	uint64_t *pml4e, *pdpte, *pde, *pte;
+	uint64_t addr = start;
+
+	while (addr < end) {
+		pml4e = pml4e_offset(h->ept_root, addr);
+		if (table->pgentry_present(*pml4e) == 0UL) {
+			addr = (addr & PML4E_MASK) + PML4E_SIZE;
+		} else {
+			pdpte = pdpte_offset(pml4e, addr);
+			if (table->pgentry_present(*pdpte) == 0UL) {
+				addr = (addr & PDPTE_MASK) + PDPTE_SIZE;
+			} else if (pdpte_large(*pdpte) != 0UL) {
+				(void)dirty_harvest_leaf(h, pdpte, addr & PDPTE_MASK, PDPTE_SIZE);
+				addr = (addr & PDPTE_MASK) + PDPTE_SIZE;
+			} else {
+				pde = pde_offset(pdpte, addr);
+				if (table->pgentry_present(*pde) == 0UL) {
+					addr = (addr & PDE_MASK) + PDE_SIZE;
+				} else if (pde_large(*pde) != 0UL) {
+					(void)dirty_harvest_leaf(h, pde, addr & PDE_MASK, PDE_SIZE);
+					addr = (addr & PDE_MASK) + PDE_SIZE;
+				} else {
+					pte = pte_offset(pde, addr);
+					if (table->pgentry_present(*pte) != 0UL) {
+						(void)dirty_harvest_leaf(h, pte, addr & PTE_MASK, PTE_SIZE);
+					}
+					addr = (addr & PTE_MASK) + PTE_SIZE;
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Harvest the leaf mapping a GPA logged by PML, return false if the GPA must be kept
+ * in the log for a later harvest of the other part of the leaf.
+ */
+static bool dirty_harvest_gpa(struct dirty_harvest *h, uint64_t gpa)
+{
+	const uint64_t *pge;
+	uint64_t pg_size = 0UL;
+	bool done = true;
+
+	if ((gpa >= h->start) && (gpa < h->end)) {
+		pge = pgtable_lookup_entry(h->ept_root, gpa, &pg_size, &h->vm->arch_vm.ept_pgtable);
+		if (pge != NULL) {
+			done = dirty_harvest_leaf(h, (uint64_t *)pge, gpa & ~(pg_size - 1UL), pg_size);
+		}
+	} else {
+		done = false;
+	}
+
+	return done;
+}
+
+/*
+ * Move the parts of the walk ranges of log in [start, end) to walk[] and return their
+ * number, log->lock must be held.
+ */
+static uint32_t dirty_log_take_walk(struct ept_dirty_log *log, uint64_t start, uint64_t end,
+		struct ept_dirty_range *walk)
+{
+	struct ept_dirty_range left[EPT_DIRTY_WALK_RANGES * 2U];
+	const struct ept_dirty_range *r;
+	uint32_t i, nr = 0U, nr_left = 0U;
+
+	for (i = 0U; i < log->nr_walk; i++) {
+		r = &log->walk[i];
+		if ((r->end <= start) || (r->start >= end)) {
+			left[nr_left] = *r;
+			nr_left++;
+		} else {
+			walk[nr].start = (r->start > start) ? r->start : start;
+			walk[nr].end = (r->end < end) ? r->end : end;
+			nr++;
+			if (r->start < start) {
+				left[nr_left].start = r->start;
+				left[nr_left].end = start;
+				nr_left++;
+			}
+			if (r->end > end) {
+				left[nr_left].start = end;
+				left[nr_left].end = r->end;
+				nr_left++;
+			}
+		}
+	}
+
+	/* otherwise keep all of them, they are walked again by a later harvest */
+	if (nr_left <= EPT_DIRTY_WALK_RANGES) {
+		(void)memcpy_s(log->walk, sizeof(log->walk), left, nr_left * sizeof(left[0]));
+		log->nr_walk = nr_left;
+	}
+
+	return nr;
+}
+
+static bool is_bitmap_mapped(struct acrn_vm *bitmap_vm, uint64_t bitmap_gpa, uint64_t bitmap_size)
+{
+	uint64_t gpa;
+	bool mapped = true;
+
+	for (gpa = bitmap_gpa & PTE_MASK; gpa < (bitmap_gpa + bitmap_size); gpa += PTE_SIZE) {
+		if (gpa2hpa(bitmap_vm, gpa) == INVALID_HPA) {
+			mapped = false;
+			break;
+		}
+	}
+
+	return mapped;
+}
+
+/**
+ * @pre vm != NULL && bitmap_vm != NULL && param != NULL
+ */
+int32_t ept_get_dirty_bitmap(struct acrn_vm *vm, struct acrn_vm *bitmap_vm, const struct acrn_dirty_bitmap *param)
+{
+	struct ept_dirty_log *log = &vm->arch_vm.dirty_log;
+	struct ept_dirty_range walk[EPT_DIRTY_WALK_RANGES];
+	struct dirty_harvest h;
+	uint64_t bitmap_size, mask, rflags;
+	uint32_t nr_walk, count, taken, i;
+	int32_t ret = -EINVAL;
+
+	/* one bit per page, in 64 bits words */
+	bitmap_size = (((param->size >> PAGE_SHIFT) + 63UL) >> 6U) << 3U;
+	if ((param->size != 0UL) && (((param->gpa | param->size) & ~PTE_MASK) == 0UL) &&
+			(param->gpa < MAX_PHY_ADDRESS_SPACE) && (param->size <= (MAX_PHY_ADDRESS_SPACE - param->gpa)) &&
+			is_bitmap_mapped(bitmap_vm, param->bitmap_gpa, bitmap_size)) {
+		if (atomic_cmpxchg32(&log->busy, 0U, 1U) != 0U) {
+			ret = -EBUSY;
+		} else if (log->enabled) {
+			h.vm = vm;
+			h.ept_root = (uint64_t *)vm->arch_vm.nworld_eptp;
+			h.start = param->gpa;
+			h.end = param->gpa + param->size;
+			h.bitmap_vm = bitmap_vm;
+			h.bitmap_gpa = param->bitmap_gpa;
+			h.word_idx = 0UL;
+			h.word = 0UL;
+			h.cleared = false;
+
+			mask = vm_pcpu_mask(vm);
+			if (log->use_pml) {
+				smp_call_function(mask, pml_drain_ipi, vm);
+			}
+
+			spinlock_irqsave_obtain(&log->lock, &rflags);
+			if (log->use_pml) {
+				nr_walk = dirty_log_take_walk(log, h.start, h.end, walk);
+			} else {
+				walk[0].start = h.start;
+				walk[0].end = h.end;
+				nr_walk = 1U;
+			}
+			taken = log->cur;
+			count = log->count;
+			log->cur ^= 1U;
+			log->count = 0U;
+			spinlock_irqrestore_release(&log->lock, rflags);
+
+			for (i = 0U; i < nr_walk; i++) {
+				dirty_harvest_walk(&h, walk[i].start, walk[i].end);
+			}
+
+			for (i = 0U; i < count; i++) {
+				if (!dirty_harvest_gpa(&h, log->gpa[taken][i])) {
+					spinlock_irqsave_obtain(&log->lock, &rflags);
+					dirty_log_add(log, log->gpa[taken][i]);
+					spinlock_irqrestore_release(&log->lock, rflags);
+				}
+			}
+			dirty_bitmap_flush(&h);
+
+			if (h.cleared) {
+				/* the dirty flags don't track the writes since the last WBINVD any more */
+				vm->arch_vm.wbinvd_dirty_tracked = false;
+				/*
+				 * Drop the cached translations with the dirty flag set. Once the calls are
+				 * done, no vCPU writes the guest memory before handling the request, so no
+				 * write after this harvest is missed by the next one.
+				 */
+				ept_flush_guest(vm);
+				smp_call_function(mask, ept_flush_work_sync, NULL);
+			}
+
+			(void)atomic_swap32(&log->busy, 0U);
+			ret = 0;
+		} else {
+			(void)atomic_swap32(&log->busy, 0U);
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @pre vm != NULL && ept_root != NULL
+ */
+uint64_t get_ept_pointer(const struct acrn_vm *vm, const void *ept_root)
+{
+	/* Write-back memory type, 4-level page walk */
+	uint64_t eptp = hva2hpa(ept_root) | (3UL << 3U) | 6UL;
+
+	if (vm->arch_vm.ept_ad_enabled) {
+		eptp |= EPTP_AD_ENABLE;
+	}
+
+	return eptp;
+}
@@ -13,6 +13,7 @@
 #include <asm/guest/vmcs.h>
 #include <asm/mmu.h>
 #include <asm/guest/ept.h>
+#include <asm/notify.h>
 #include <logmsg.h>
 
 struct page_walk_info {
@@ -328,6 +329,9 @@ static inline uint32_t local_copy_gpa(struct acrn_vm *vm, void *h_ptr, uint64_t
 			(void)memcpy_s(g_ptr, len, h_ptr, len);
 		}
 		clac();
+		if (!cp_from_vm) {
+			ept_hv_write_done(vm);
+		}
 	}
 
 	return len;
@@ -428,6 +432,40 @@ int32_t copy_to_gpa(struct acrn_vm *vm, void *h_ptr, uint64_t gpa, uint32_t size
 	return ret;
 }
 
+#define COPY_GPA_CHUNK_SIZE	MEM_2M
+
+struct copy_gpa_work {
+	struct acrn_vm *vm;
+	uint8_t *h_ptr;
+	uint64_t gpa;
+	uint32_t size;
+	int32_t err;
+};
+
+static void copy_to_gpa_chunk(void *data, uint64_t chunk)
+{
+	struct copy_gpa_work *work = (struct copy_gpa_work *)data;
+	uint32_t offset = (uint32_t)chunk * COPY_GPA_CHUNK_SIZE;
+	uint32_t len = min(work->size - offset, COPY_GPA_CHUNK_SIZE);
+
+	if (copy_gpa(work->vm, work->h_ptr + offset, work->gpa + offset, len, 0) != 0) {
+		work->err = -EINVAL;
+	}
+}
+
+int32_t copy_to_gpa_parallel(struct acrn_vm *vm, void *h_ptr, uint64_t gpa, uint32_t size, uint64_t helper_mask)
+{
+	struct copy_gpa_work work = { vm, (uint8_t *)h_ptr, gpa, size, 0 };
+
+	smp_call_split(helper_mask, copy_to_gpa_chunk, &work,
+		((uint64_t)size + COPY_GPA_CHUNK_SIZE - 1UL) / COPY_GPA_CHUNK_SIZE);
+	if (work.err != 0) {
+		pr_err("Unable to copy HPA 0x%llx to GPA 0x%llx in VM%d\n", (uint64_t)h_ptr, gpa, vm->vm_id);
+	}
+
+	return work.err;
+}
+
 int32_t copy_from_gva(struct acrn_vcpu *vcpu, void *h_ptr, uint64_t gva,
 	uint32_t size, uint32_t *err_code, uint64_t *fault_addr)
 {
@@ -9,6 +9,7 @@
 
 #include <types.h>
 #include <asm/guest/vm.h>
+#include <asm/guest/ept.h>
 #include <logmsg.h>
 #include <asm/vmx.h>
 #include <asm/guest/hyperv.h>
@@ -79,6 +80,7 @@ hyperv_setup_tsc_page(const struct acrn_vcpu *vcpu, uint64_t val)
 			}
 			p->tsc_sequence = tsc_seq;
 			clac();
+			ept_hv_write_done(vcpu->vm);
 		}
 	}
 }
@@ -138,6 +140,7 @@ hyperv_setup_hypercall_page(const struct acrn_vcpu *vcpu, uint64_t val)
 				(void)memcpy_s(page_hva, 11U, inst32, 11U);
 			}
 			clac();
+			ept_hv_write_done(vcpu->vm);
 		}
 	}
 }
@@ -64,6 +64,8 @@ static void create_secure_world_ept(struct acrn_vm *vm, uint64_t gpa_orig,
 	/* Unmap gpa_orig~gpa_orig+size from guest normal world ept mapping */
 	ept_del_mr(vm, (uint64_t *)vm->arch_vm.nworld_eptp, gpa_orig, size);
 
+	/* the PD pages of the normal world are shared with the secure world from now on */
+	vm->arch_vm.ept_pgtable.merge_pd_pages = false;
 	vm->arch_vm.sworld_eptp = pgtable_create_trusty_root(&vm->arch_vm.ept_pgtable,
 					vm->arch_vm.nworld_eptp, EPT_RWX, EPT_EXE);
 
@@ -239,16 +241,14 @@ void switch_world(struct acrn_vcpu *vcpu, int32_t next_world)
 	if (next_world == NORMAL_WORLD) {
 		/* load EPTP for next world */
 		exec_vmwrite64(VMX_EPT_POINTER_FULL,
-			hva2hpa(vcpu->vm->arch_vm.nworld_eptp) |
-			(3UL << 3U) | 0x6UL);
+			get_ept_pointer(vcpu->vm, vcpu->vm->arch_vm.nworld_eptp));
 
 #ifndef CONFIG_L1D_FLUSH_VMENTRY_ENABLED
 		cpu_l1d_flush();
 #endif
 	} else {
 		exec_vmwrite64(VMX_EPT_POINTER_FULL,
-			hva2hpa(vcpu->vm->arch_vm.sworld_eptp) |
-			(3UL << 3U) | 0x6UL);
+			get_ept_pointer(vcpu->vm, vcpu->vm->arch_vm.sworld_eptp));
 	}
 
 	/* Update world index */
@@ -377,8 +377,7 @@ bool initialize_trusty(struct acrn_vcpu *vcpu, struct trusty_boot_param *boot_pa
 								TRUSTY_EPT_REBASE_GPA);
 			trusty_base_hpa = vm->sworld_control.sworld_memory.base_hpa;
 
-			exec_vmwrite64(VMX_EPT_POINTER_FULL,
-					hva2hpa(vm->arch_vm.sworld_eptp) | (3UL << 3U) | 0x6UL);
+			exec_vmwrite64(VMX_EPT_POINTER_FULL, get_ept_pointer(vm, vm->arch_vm.sworld_eptp));
 
 			/* save Normal World context */
 			save_world_ctx(vcpu, &vcpu->arch.contexts[NORMAL_WORLD].ext_ctx);
@@ -7,6 +7,7 @@
 #include <types.h>
 #include <errno.h>
 #include <asm/guest/vcpu.h>
+#include <asm/guest/vcpuid.h>
 #include <asm/guest/virq.h>
 #include <asm/lib/bits.h>
 #include <asm/vmx.h>
@@ -17,10 +18,15 @@
 #include <asm/init.h>
 #include <asm/guest/vm.h>
 #include <asm/guest/vmcs.h>
+#include <asm/guest/ept.h>
 #include <asm/mmu.h>
 #include <lib/sprintf.h>
 #include <asm/lapic.h>
 #include <asm/irq.h>
+#include <asm/tsc.h>
+#include <asm/notify.h>
+#include <dm/io_req.h>
+#include <vmexit_latency.h>
 
 /* stack_frame is linked with the sequence of stack operation in arch_switch_to() */
 struct stack_frame {
@@ -234,6 +240,27 @@ void load_iwkey(struct acrn_vcpu *vcpu)
 	}
 }
 
+/*
+ * Give up the lazily held extended context of the vCPU without writing it back,
+ * as its ext_context is going to be re-initialized.
+ *
+ * The owner is checked under the schedule lock of the vCPU's pCPU, so it can't race
+ * with context_switch_in() on that pCPU writing the live state back to this vCPU.
+ * If the vCPU is the running thread of the pCPU (e.g. resume from S3), the live
+ * state still belongs to it.
+ */
+static void release_ext_context(struct acrn_vcpu *vcpu)
+{
+	uint16_t pcpu_id = pcpuid_from_vcpu(vcpu);
+	uint64_t rflag;
+
+	obtain_schedule_lock(pcpu_id, &rflag);
+	if ((per_cpu(whose_ext_ctx, pcpu_id) == vcpu) && (sched_get_current(pcpu_id) != &vcpu->thread_obj)) {
+		per_cpu(whose_ext_ctx, pcpu_id) = NULL;
+	}
+	release_schedule_lock(pcpu_id, rflag);
+}
+
 /* As a vcpu reset internal API, DO NOT touch any vcpu state transition in this function. */
 static void vcpu_reset_internal(struct acrn_vcpu *vcpu, enum reset_mode mode)
 {
@@ -248,7 +275,11 @@ static void vcpu_reset_internal(struct acrn_vcpu *vcpu, enum reset_mode mode)
 	vcpu->arch.lapic_pt_enabled = false;
 	vcpu->arch.irq_window_enabled = false;
 	vcpu->arch.emulating_lock = false;
+	vcpu->arch.restore.pending = false;
+	vcpu->arch.restore.apic_base = 0UL;
+	ept_dirty_log_stop_vcpu(vcpu);
 	(void)memset((void *)vcpu->arch.vmcs, 0U, PAGE_SIZE);
+	release_ext_context(vcpu);
 
 	for (i = 0; i < NR_WORLD; i++) {
 		(void)memset((void *)(&vcpu->arch.contexts[i]), 0U,
@@ -407,6 +438,334 @@ void set_vcpu_regs(struct acrn_vcpu *vcpu, struct acrn_regs *vcpu_regs)
 			vcpu_regs->cr0);
 }
 
+static void save_ext_context(struct acrn_vcpu *vcpu);
+
+static void save_segment_state(struct acrn_segment_state *state, const struct segment_sel *seg)
+{
+	state->selector = seg->selector;
+	state->base = seg->base;
+	state->limit = seg->limit;
+	state->attr = seg->attr;
+}
+
+static void load_segment_state(struct segment_sel *seg, const struct acrn_segment_state *state)
+{
+	seg->selector = state->selector;
+	seg->base = state->base;
+	seg->limit = state->limit;
+	seg->attr = state->attr;
+}
+
+struct vcpu_state_req {
+	struct acrn_vcpu *vcpu;
+	struct acrn_cpu_state *state;
+};
+
+/*
+ * Read the state of a paused vCPU, it runs on the pCPU of the vCPU as the VMCS
+ * and the lazily switched extended context of the vCPU may only be live there.
+ */
+static void read_vcpu_state(void *data)
+{
+	struct vcpu_state_req *req = (struct vcpu_state_req *)data;
+	struct acrn_vcpu *vcpu = req->vcpu;
+	struct acrn_cpu_state *state = req->state;
+	struct run_context *ctx = &(vcpu->arch.contexts[vcpu->arch.cur_context].run_ctx);
+	struct ext_context *ectx = &(vcpu->arch.contexts[vcpu->arch.cur_context].ext_ctx);
+	void **vmcs_ptr = &get_cpu_var(vmcs_run);
+	void *prev_vmcs = *vmcs_ptr;
+	struct segment_sel seg;
+
+	if (prev_vmcs != (void *)vcpu->arch.vmcs) {
+		load_va_vmcs(vcpu->arch.vmcs);
+		*vmcs_ptr = (void *)vcpu->arch.vmcs;
+	}
+
+	if (get_cpu_var(whose_ext_ctx) == vcpu) {
+		save_ext_context(vcpu);
+		/* the live state still belongs to the vCPU */
+		write_xcr(0, ectx->xcr0);
+	}
+
+	(void)memcpy_s((void *)&(state->gprs), sizeof(struct acrn_gp_regs),
+			(void *)&(ctx->cpu_regs), sizeof(struct acrn_gp_regs));
+	state->gprs.rsp = vcpu_get_rsp(vcpu);
+
+	/*
+	 * A vCPU paused in the middle of an I/O emulation re-executes the instruction,
+	 * otherwise the instruction completed by its VM exit handler is skipped.
+	 */
+	state->rip = vcpu_get_rip(vcpu);
+	if (get_io_req_state(vcpu->vm, vcpu->vcpu_id) == ACRN_IOREQ_STATE_FREE) {
+		state->rip += vcpu->arch.inst_len;
+	}
+	state->rflags = vcpu_get_rflags(vcpu);
+	state->cr0 = vcpu_get_cr0(vcpu);
+	state->cr2 = vcpu_get_cr2(vcpu);
+	state->cr3 = exec_vmread(VMX_GUEST_CR3);
+	state->cr4 = vcpu_get_cr4(vcpu);
+	state->ia32_efer = vcpu_get_efer(vcpu);
+	state->dr7 = exec_vmread(VMX_GUEST_DR7);
+
+	save_segment(seg, VMX_GUEST_CS);
+	save_segment_state(&state->cs, &seg);
+	save_segment(seg, VMX_GUEST_SS);
+	save_segment_state(&state->ss, &seg);
+	save_segment(seg, VMX_GUEST_DS);
+	save_segment_state(&state->ds, &seg);
+	save_segment(seg, VMX_GUEST_ES);
+	save_segment_state(&state->es, &seg);
+	save_segment(seg, VMX_GUEST_FS);
+	save_segment_state(&state->fs, &seg);
+	save_segment(seg, VMX_GUEST_GS);
+	save_segment_state(&state->gs, &seg);
+	save_segment(seg, VMX_GUEST_LDTR);
+	save_segment_state(&state->ldtr, &seg);
+	save_segment(seg, VMX_GUEST_TR);
+	save_segment_state(&state->tr, &seg);
+	state->gdtr.base = exec_vmread(VMX_GUEST_GDTR_BASE);
+	state->gdtr.limit = exec_vmread32(VMX_GUEST_GDTR_LIMIT);
+	state->idtr.base = exec_vmread(VMX_GUEST_IDTR_BASE);
+	state->idtr.limit = exec_vmread32(VMX_GUEST_IDTR_LIMIT);
+
+	state->ia32_pat = vcpu_get_guest_msr(vcpu, MSR_IA32_PAT);
+	state->ia32_debugctl = exec_vmread64(VMX_GUEST_IA32_DEBUGCTL_FULL);
+	state->ia32_sysenter_cs = exec_vmread32(VMX_GUEST_IA32_SYSENTER_CS);
+	state->ia32_sysenter_esp = exec_vmread(VMX_GUEST_IA32_SYSENTER_ESP);
+	state->ia32_sysenter_eip = exec_vmread(VMX_GUEST_IA32_SYSENTER_EIP);
+	state->ia32_star = ectx->ia32_star;
+	state->ia32_cstar = ectx->ia32_cstar;
+	state->ia32_lstar = ectx->ia32_lstar;
+	state->ia32_fmask = ectx->ia32_fmask;
+	state->ia32_kernel_gs_base = ectx->ia32_kernel_gs_base;
+	state->ia32_tsc_aux = ectx->tsc_aux;
+	state->ia32_xss = vcpu_get_guest_msr(vcpu, MSR_IA32_XSS);
+	state->xcr0 = ectx->xcr0;
+
+	state->guest_tsc = rdtsc() + exec_vmread64(VMX_TSC_OFFSET_FULL);
+	state->interruptibility = exec_vmread32(VMX_GUEST_INTERRUPTIBILITY_INFO);
+
+	/* events taken by the vCPU but not delivered to the guest yet */
+	state->pending_event_error = 0U;
+	if (vcpu->arch.exception_info.exception != VECTOR_INVALID) {
+		state->pending_event = VMX_INT_INFO_VALID | (VMX_INT_TYPE_HW_EXP << 8U) |
+				vcpu->arch.exception_info.exception;
+		state->pending_event_error = vcpu->arch.exception_info.error;
+	} else if (bitmap_test(ACRN_REQUEST_NMI, &vcpu->arch.pending_req)) {
+		state->pending_event = VMX_INT_INFO_VALID | (VMX_INT_TYPE_NMI << 8U) | IDT_NMI;
+	} else {
+		state->pending_event = vcpu->arch.idt_vectoring_info;
+	}
+
+	if ((prev_vmcs != NULL) && (prev_vmcs != (void *)vcpu->arch.vmcs)) {
+		load_va_vmcs(prev_vmcs);
+		*vmcs_ptr = prev_vmcs;
+	}
+}
+
+/**
+ * @pre vcpu != NULL && state != NULL
+ * @pre vcpu->launched == true && vcpu->state == VCPU_ZOMBIE
+ */
+void get_vcpu_state(struct acrn_vcpu *vcpu, struct acrn_cpu_state *state)
+{
+	struct vcpu_state_req req = { .vcpu = vcpu, .state = state };
+
+	smp_call_function(1UL << pcpuid_from_vcpu(vcpu), read_vcpu_state, &req);
+}
+
+/**
+ * @pre vcpu != NULL
+ */
+bool is_guest_xcr0_valid(struct acrn_vcpu *vcpu, uint64_t xcr0)
+{
+	uint32_t eax = 0xdU, ebx = 0U, ecx = 0U, edx = 0U;
+	uint64_t xcr0_mask;
+	bool valid = false;
+
+	guest_cpuid(vcpu, &eax, &ebx, &ecx, &edx);
+	xcr0_mask = ((uint64_t)edx << 32U) | eax;
+
+	/* bit 0(x87 state) of XCR0 can't be cleared */
+	if (((xcr0 & 0x01UL) != 0UL) && ((xcr0 & XCR0_RESERVED_BITS) == 0UL) && ((xcr0 & ~xcr0_mask) == 0UL)) {
+		/*
+		 * XCR0[2:1] (SSE state & AVX state) can't not be
+		 * set to 10b as it is necessary to set both bits
+		 * to use AVX instructions.
+		 */
+		if ((xcr0 & (XCR0_SSE | XCR0_AVX)) != XCR0_AVX) {
+			/*
+			 * SDM Vol.1 13-4, XCR0[4:3] are associated with MPX state,
+			 * Guest should not set these two bits without MPX support.
+			 * XCR0[7:5] (AVX-512 state) are set all together, along with AVX.
+			 */
+			if (((xcr0 & (XCR0_BNDREGS | XCR0_BNDCSR)) == 0UL) && (((xcr0 & XCR0_AVX512) == 0UL) ||
+					((xcr0 & (XCR0_AVX512 | XCR0_AVX)) == (XCR0_AVX512 | XCR0_AVX)))) {
+				valid = true;
+			}
+		}
+	}
+
+	return valid;
+}
+
+/*
+ * In 64-bit mode, an address is considered to be in canonical form if address bits 63
+ * through to the most-significant implemented bit are set to either all ones or all zeros.
+ */
+static bool is_canonical_addr(uint64_t va, uint64_t cr4)
+{
+	uint32_t addr_width = ((cr4 & CR4_LA57) != 0UL) ? 57U : 48U;
+	uint64_t msb_mask = ~((1UL << addr_width) - 1UL);
+
+	return ((msb_mask & va) == 0UL) || ((msb_mask & va) == msb_mask);
+}
+
+/*
+ * The syscall MSRs and XCR0 are loaded in root mode, where WRMSR and XSETBV fault
+ * on the values the guest itself couldn't load, as XRSTORS does on a malformed area.
+ */
+static bool is_restored_state_valid(struct acrn_vcpu *vcpu, const struct acrn_cpu_state *state,
+		const struct xsave_area *area)
+{
+	const struct cpuinfo_x86 *cpu_info = get_pcpu_info();
+	uint64_t xss_mask = ((uint64_t)cpu_info->cpuid_leaves[FEAT_D_1_EDX] << 32U) | cpu_info->cpuid_leaves[FEAT_D_1_ECX];
+	uint64_t xcomp_bv = area->xsave_hdr.hdr.xcomp_bv;
+	uint32_t mxcsr = (uint32_t)(area->legacy_region[3] & 0xffffffffUL);
+	bool valid = true;
+	uint32_t i;
+
+	if (!is_guest_xcr0_valid(vcpu, state->xcr0) ||
+			((state->ia32_xss & ~xss_mask) != 0UL) || ((mxcsr & 0xffff0000U) != 0U) ||
+			((xcomp_bv & XSAVE_COMPACTED_FORMAT) == 0UL) ||
+			((xcomp_bv & ~(XSAVE_COMPACTED_FORMAT | state->xcr0 | state->ia32_xss)) != 0UL) ||
+			((area->xsave_hdr.hdr.xstate_bv & ~xcomp_bv) != 0UL)) {
+		valid = false;
+	}
+
+	for (i = 2U; i < (XSAVE_HEADER_AREA_SIZE / sizeof(uint64_t)); i++) {
+		if (area->xsave_hdr.value[i] != 0UL) {
+			valid = false;
+		}
+	}
+
+	/* TSC_AUX[63:32] and FMASK[63:32] are reserved */
+	if (!is_canonical_addr(state->ia32_lstar, state->cr4) || !is_canonical_addr(state->ia32_cstar, state->cr4) ||
+			!is_canonical_addr(state->ia32_kernel_gs_base, state->cr4) ||
+			((state->ia32_tsc_aux >> 32U) != 0UL) || ((state->ia32_fmask >> 32U) != 0UL)) {
+		valid = false;
+	}
+
+	return valid;
+}
+
+/**
+ * @pre vcpu != NULL && state != NULL
+ * @pre vcpu->launched == false
+ */
+int32_t set_vcpu_state(struct acrn_vcpu *vcpu, const struct acrn_cpu_state *state)
+{
+	struct run_context *ctx = &(vcpu->arch.contexts[vcpu->arch.cur_context].run_ctx);
+	struct ext_context *ectx = &(vcpu->arch.contexts[vcpu->arch.cur_context].ext_ctx);
+	uint32_t event_type = (state->pending_event & VMX_INT_TYPE_MASK) >> 8U;
+	int32_t ret = -EINVAL;
+
+	release_ext_context(vcpu);
+	if (pcpu_has_cap(X86_FEATURE_XSAVES) && is_restored_state_valid(vcpu, state, &ectx->xs_area)) {
+		(void)memcpy_s((void *)&(ctx->cpu_regs), sizeof(struct acrn_gp_regs),
+				(void *)&(state->gprs), sizeof(struct acrn_gp_regs));
+		vcpu_set_rip(vcpu, state->rip);
+		vcpu_set_rsp(vcpu, state->gprs.rsp);
+		vcpu_set_rflags(vcpu, state->rflags);
+		vcpu_set_efer(vcpu, state->ia32_efer);
+		vcpu_set_cr2(vcpu, state->cr2);
+
+		/* cr0, cr3 and cr4 are written to VMCS by init_vmcs, as set_vcpu_regs() does */
+		ctx->cr0 = state->cr0;
+		ectx->cr3 = state->cr3;
+		ctx->cr4 = state->cr4;
+
+		load_segment_state(&ectx->cs, &state->cs);
+		load_segment_state(&ectx->ss, &state->ss);
+		load_segment_state(&ectx->ds, &state->ds);
+		load_segment_state(&ectx->es, &state->es);
+		load_segment_state(&ectx->fs, &state->fs);
+		load_segment_state(&ectx->gs, &state->gs);
+		load_segment_state(&ectx->ldtr, &state->ldtr);
+		load_segment_state(&ectx->tr, &state->tr);
+		ectx->gdtr.base = state->gdtr.base;
+		ectx->gdtr.limit = state->gdtr.limit;
+		ectx->idtr.base = state->idtr.base;
+		ectx->idtr.limit = state->idtr.limit;
+
+		/* the fields init_vmcs sets to their power-on values, see vcpu_load_restored_state() */
+		ectx->ia32_pat = state->ia32_pat;
+		ectx->ia32_debugctl = state->ia32_debugctl;
+		ectx->ia32_sysenter_cs = (uint32_t)state->ia32_sysenter_cs;
+		ectx->ia32_sysenter_esp = state->ia32_sysenter_esp;
+		ectx->ia32_sysenter_eip = state->ia32_sysenter_eip;
+		ectx->dr7 = state->dr7;
+
+		ectx->ia32_star = state->ia32_star;
+		ectx->ia32_cstar = state->ia32_cstar;
+		ectx->ia32_lstar = state->ia32_lstar;
+		ectx->ia32_fmask = state->ia32_fmask;
+		ectx->ia32_kernel_gs_base = state->ia32_kernel_gs_base;
+		ectx->tsc_aux = state->ia32_tsc_aux;
+		ectx->xcr0 = state->xcr0;
+		vcpu_set_guest_msr(vcpu, MSR_IA32_XSS, state->ia32_xss);
+
+		/* init_vmcs derives the TSC offset from the guest TSC_ADJUST */
+		vcpu_set_guest_msr(vcpu, MSR_IA32_TSC_ADJUST,
+				(state->guest_tsc - rdtsc()) + cpu_msr_read(MSR_IA32_TSC_ADJUST));
+
+		vcpu->arch.exception_info.exception = VECTOR_INVALID;
+		vcpu->arch.idt_vectoring_info = 0U;
+		if ((state->pending_event & VMX_INT_INFO_VALID) != 0U) {
+			if (event_type == VMX_INT_TYPE_HW_EXP) {
+				(void)vcpu_queue_exception(vcpu, state->pending_event & 0xffU, state->pending_event_error);
+			} else if (event_type == VMX_INT_TYPE_NMI) {
+				vcpu_make_request(vcpu, ACRN_REQUEST_NMI);
+			} else {
+				vcpu->arch.idt_vectoring_info = state->pending_event;
+			}
+		}
+
+		set_vcpu_mode(vcpu, state->cs.attr, state->ia32_efer, state->cr0);
+
+		vcpu->arch.restore.interruptibility = state->interruptibility;
+		vcpu->arch.restore.pending = true;
+		ret = 0;
+	} else {
+		init_xsave(vcpu);
+	}
+
+	return ret;
+}
+
+/*
+ * Load the restored state init_vmcs doesn't take from the vCPU context,
+ * it's called on the vCPU's first VM entry, right after init_vmcs.
+ */
+void vcpu_load_restored_state(struct acrn_vcpu *vcpu)
+{
+	const struct ext_context *ectx = &(vcpu->arch.contexts[vcpu->arch.cur_context].ext_ctx);
+
+	if (vcpu->arch.restore.pending) {
+		exec_vmwrite32(VMX_GUEST_IA32_SYSENTER_CS, ectx->ia32_sysenter_cs);
+		exec_vmwrite(VMX_GUEST_IA32_SYSENTER_ESP, ectx->ia32_sysenter_esp);
+		exec_vmwrite(VMX_GUEST_IA32_SYSENTER_EIP, ectx->ia32_sysenter_eip);
+		exec_vmwrite64(VMX_GUEST_IA32_DEBUGCTL_FULL, ectx->ia32_debugctl);
+		vcpu_set_guest_msr(vcpu, MSR_IA32_PAT, ectx->ia32_pat);
+		exec_vmwrite64(VMX_GUEST_IA32_PAT_FULL, ectx->ia32_pat);
+		exec_vmwrite(VMX_GUEST_DR7, ectx->dr7);
+		exec_vmwrite32(VMX_GUEST_INTERRUPTIBILITY_INFO, vcpu->arch.restore.interruptibility);
+
+		vlapic_load_restored_state(vcpu_vlapic(vcpu));
+		vcpu->arch.restore.pending = false;
+	}
+}
+
 static struct acrn_regs realmode_init_vregs = {
 	.gdt = {
 		.limit = 0xFFFFU,
@@ -583,10 +942,17 @@ int32_t create_vcpu(uint16_t pcpu_id, struct acrn_vm *vm, struct acrn_vcpu **rtn
 		 * the same pCPU, so PI's ndst is never changed after startup.
 		 */
 		vcpu->arch.pid.control.bits.ndst = per_cpu(lapic_id, pcpu_id);
+		INIT_LIST_HEAD(&vcpu->arch.pi_blocked_node);
+		vcpu->arch.pi_blocked = false;
 
 		/* Create per vcpu vlapic */
 		vlapic_create(vcpu, pcpu_id);
 
+#ifdef CONFIG_CPUID_PRECOMPUTE_ENABLED
+		/* APIC ID of the vCPU is fixed from now on */
+		init_vcpuid_cache(vcpu);
+#endif
+
 		if (!vm_hide_mtrr(vm)) {
 			init_vmtrr(vcpu);
 		}
@@ -597,6 +963,7 @@ int32_t create_vcpu(uint16_t pcpu_id, struct acrn_vm *vm, struct acrn_vcpu **rtn
 
 		init_xsave(vcpu);
 		vcpu_reset_internal(vcpu, POWER_ON_RESET);
+		vmexit_latency_reset(vcpu);
 		(void)memset((void *)&vcpu->req, 0U, sizeof(struct io_request));
 		vm->hw.created_vcpus++;
 		ret = 0;
@@ -777,8 +1144,11 @@ int32_t run_vcpu(struct acrn_vcpu *vcpu)
  */
 void offline_vcpu(struct acrn_vcpu *vcpu)
 {
+	/* a vCPU paused while blocked in HLT never returns to vcpu_pi_post_block() */
+	vcpu_pi_post_block(vcpu);
 	vlapic_free(vcpu);
 	per_cpu(ever_run_vcpu, pcpuid_from_vcpu(vcpu)) = NULL;
+	release_ext_context(vcpu);
 
 	/* This operation must be atomic to avoid contention with posted interrupt handler */
 	per_cpu(vcpu_array, pcpuid_from_vcpu(vcpu))[vcpu->vm->vm_id] = NULL;
@@ -838,6 +1208,8 @@ void reset_vcpu(struct acrn_vcpu *vcpu, enum reset_mode mode)
 {
 	pr_dbg("vcpu%hu reset", vcpu->vcpu_id);
 
+	/* the vCPU thread restarts from a new stack frame, dequeue it if it was blocked */
+	vcpu_pi_post_block(vcpu);
 	vcpu_reset_internal(vcpu, mode);
 	vcpu_set_state(vcpu, VCPU_INIT);
 }
@@ -863,12 +1235,22 @@ void zombie_vcpu(struct acrn_vcpu *vcpu, enum vcpu_state new_state)
 	}
 }
 
-void save_xsave_area(__unused struct acrn_vcpu *vcpu, struct ext_context *ectx)
+void save_xsave_area(struct acrn_vcpu *vcpu, struct ext_context *ectx)
 {
+	uint64_t rfbm = UINT64_MAX;
+
 	if (pcpu_has_cap(X86_FEATURE_XSAVES)) {
 		ectx->xcr0 = read_xcr(0);
 		write_xcr(0, ectx->xcr0 | XSAVE_SSE);
-		xsaves(&ectx->xs_area, UINT64_MAX);
+		if (pcpu_has_cap(X86_FEATURE_XGETBV1)) {
+			/*
+			 * XGETBV with ECX = 1 returns XCR0 & XINUSE. The user state components which are
+			 * in their initial configuration needn't be saved: their XSTATE_BV bits are cleared
+			 * and XRSTORS initializes them again. Supervisor state components are always saved.
+			 */
+			rfbm = read_xcr(1) | vcpu_get_guest_msr(vcpu, MSR_IA32_XSS);
+		}
+		xsaves(&ectx->xs_area, rfbm);
 	}
 }
 
@@ -893,17 +1275,14 @@ void rstore_xsave_area(const struct acrn_vcpu *vcpu, const struct ext_context *e
 	}
 }
 
-/* TODO:
- * Now we have switch_out and switch_in callbacks for each thread_object, and schedule
- * will call them every thread switch. We can implement lazy context swtich , which
- * only do context swtich when really need.
+/*
+ * Write back the syscall MSRs and XSAVE state live on current pCPU to the
+ * extended context of the vCPU.
  */
-static void context_switch_out(struct thread_object *prev)
+static void save_ext_context(struct acrn_vcpu *vcpu)
 {
-	struct acrn_vcpu *vcpu = container_of(prev, struct acrn_vcpu, thread_obj);
 	struct ext_context *ectx = &(vcpu->arch.contexts[vcpu->arch.cur_context].ext_ctx);
 
-	/* We don't flush TLB as we assume each vcpu has different vpid */
 	ectx->ia32_star = msr_read(MSR_IA32_STAR);
 	ectx->ia32_cstar = msr_read(MSR_IA32_CSTAR);
 	ectx->ia32_lstar = msr_read(MSR_IA32_LSTAR);
@@ -914,13 +1293,9 @@ static void context_switch_out(struct thread_object *prev)
 	save_xsave_area(vcpu, ectx);
 }
 
-static void context_switch_in(struct thread_object *next)
+static void rstore_ext_context(struct acrn_vcpu *vcpu)
 {
-	struct acrn_vcpu *vcpu = container_of(next, struct acrn_vcpu, thread_obj);
 	struct ext_context *ectx = &(vcpu->arch.contexts[vcpu->arch.cur_context].ext_ctx);
-	uint64_t vmsr_val;
-
-	load_vmcs(vcpu);
 
 	msr_write(MSR_IA32_STAR, ectx->ia32_star);
 	msr_write(MSR_IA32_CSTAR, ectx->ia32_cstar);
@@ -929,6 +1304,57 @@ static void context_switch_in(struct thread_object *next)
 	msr_write(MSR_IA32_KERNEL_GS_BASE, ectx->ia32_kernel_gs_base);
 	msr_write(MSR_IA32_TSC_AUX, ectx->tsc_aux);
 
+	rstore_xsave_area(vcpu, ectx);
+}
+
+/*
+ * Write back the extended context live on current pCPU to its owner, it's
+ * called before the pCPU goes offline and loses its register state.
+ */
+void flush_lazy_ext_context(void)
+{
+	uint16_t pcpu_id = get_pcpu_id();
+	struct acrn_vcpu *owner;
+	uint64_t rflag;
+
+	obtain_schedule_lock(pcpu_id, &rflag);
+	owner = per_cpu(whose_ext_ctx, pcpu_id);
+	if (owner != NULL) {
+		save_ext_context(owner);
+		per_cpu(whose_ext_ctx, pcpu_id) = NULL;
+	}
+	release_schedule_lock(pcpu_id, rflag);
+}
+
+/*
+ * Lazy context switch: no vCPU context is saved on switch out, the syscall MSRs
+ * and XSAVE state stay live on the pCPU and are tracked by per_cpu(whose_ext_ctx).
+ * The hypervisor itself never touches them, so they are only written back when a
+ * different vCPU is switched in. Switching back to the vCPU which still owns the
+ * live state (e.g. vCPU -> idle -> same vCPU) skips both the save and the restore.
+ */
+static void context_switch_in(struct thread_object *next)
+{
+	struct acrn_vcpu *vcpu = container_of(next, struct acrn_vcpu, thread_obj);
+	uint16_t pcpu_id = next->pcpu_id;
+	struct acrn_vcpu *owner = per_cpu(whose_ext_ctx, pcpu_id);
+	uint64_t start = rdtsc();
+	uint64_t vmsr_val;
+
+	/* We don't flush TLB as we assume each vcpu has different vpid */
+	load_vmcs(vcpu);
+
+	if (owner != vcpu) {
+		if (owner != NULL) {
+			save_ext_context(owner);
+		}
+		rstore_ext_context(vcpu);
+		per_cpu(whose_ext_ctx, pcpu_id) = vcpu;
+		per_cpu(ext_ctx_switch_count, pcpu_id)++;
+	} else {
+		per_cpu(ext_ctx_lazy_count, pcpu_id)++;
+	}
+
 	if (pcpu_has_cap(X86_FEATURE_WAITPKG)) {
 		vmsr_val = vcpu_get_guest_msr(vcpu, MSR_IA32_UMWAIT_CONTROL);
 		if (vmsr_val != msr_read(MSR_IA32_UMWAIT_CONTROL)) {
@@ -938,7 +1364,7 @@ static void context_switch_in(struct thread_object *next)
 
 	load_iwkey(vcpu);
 
-	rstore_xsave_area(vcpu, ectx);
+	per_cpu(ext_ctx_switch_tsc, pcpu_id) += rdtsc() - start;
 }
 
 
@@ -972,7 +1398,8 @@ int32_t prepare_vcpu(struct acrn_vm *vm, uint16_t pcpu_id)
 		vcpu->thread_obj.pcpu_id = pcpu_id;
 		/* vcpu->thread_obj.notify_mode is initialized in vcpu_reset_internal() when create vcpu */
 		vcpu->thread_obj.host_sp = build_stack_frame(vcpu);
-		vcpu->thread_obj.switch_out = context_switch_out;
+		/* the vCPU context is switched lazily, see context_switch_in() */
+		vcpu->thread_obj.switch_out = NULL;
 		vcpu->thread_obj.switch_in = context_switch_in;
 		vcpu->thread_obj.priority = get_vm_config(vm->vm_id)->vm_prio;
 		init_thread_data(&vcpu->thread_obj);
@@ -1043,6 +1470,91 @@ void vcpu_handle_pi_notification(uint32_t vcpu_index)
 	}
 }
 
+#define PID_NV_SHIFT	16U
+#define PID_NV_MASK	(0xFFUL << PID_NV_SHIFT)
+
+/*
+ * Change the NV of the PID with a locked cmpxchg, as VT-d posts interrupts to
+ * the same 64-bit control word concurrently and may set ON at any time.
+ */
+static void vcpu_pi_set_nv(struct pi_desc *pid, uint32_t nv)
+{
+	uint64_t old_ctrl, new_ctrl;
+
+	do {
+		old_ctrl = pid->control.value;
+		new_ctrl = (old_ctrl & ~PID_NV_MASK) | ((uint64_t)nv << PID_NV_SHIFT);
+	} while (atomic_cmpxchg64(&pid->control.value, old_ctrl, new_ctrl) != old_ctrl);
+}
+
+/*
+ * @brief handle posted interrupt wakeup notification
+ *
+ * Only the vCPUs blocked on current pCPU use POSTED_INTR_WAKEUP_VECTOR as the
+ * NV of their PIDs, so walk the blocked list instead of vcpu_array and wake up
+ * those whose ON bit is set.
+ */
+void vcpu_handle_pi_wakeup(void)
+{
+	struct list_head *pos;
+	struct acrn_vcpu *vcpu;
+	uint64_t rflags;
+
+	spinlock_irqsave_obtain(&get_cpu_var(pi_blocked_lock), &rflags);
+	list_for_each(pos, &get_cpu_var(pi_blocked_vcpus)) {
+		vcpu = container_of(pos, struct acrn_vcpu, arch.pi_blocked_node);
+		if (bitmap_test(POSTED_INTR_ON, &(get_pi_desc(vcpu)->control.value))) {
+			signal_event(&vcpu->events[VCPU_EVENT_VIRTUAL_INTERRUPT]);
+			vcpu_make_request(vcpu, ACRN_REQUEST_EVENT);
+			get_cpu_var(pi_wakeup_count)++;
+		}
+	}
+	spinlock_irqrestore_release(&get_cpu_var(pi_blocked_lock), rflags);
+}
+
+/*
+ * @pre vcpu != NULL
+ * @pre pcpuid_from_vcpu(vcpu) == get_pcpu_id()
+ */
+bool vcpu_pi_pre_block(struct acrn_vcpu *vcpu)
+{
+	struct pi_desc *pid = get_pi_desc(vcpu);
+	uint16_t pcpu_id = pcpuid_from_vcpu(vcpu);
+	uint64_t rflags;
+
+	spinlock_irqsave_obtain(&per_cpu(pi_blocked_lock, pcpu_id), &rflags);
+	list_add_tail(&vcpu->arch.pi_blocked_node, &per_cpu(pi_blocked_vcpus, pcpu_id));
+	vcpu->arch.pi_blocked = true;
+	spinlock_irqrestore_release(&per_cpu(pi_blocked_lock, pcpu_id), rflags);
+
+	vcpu_pi_set_nv(pid, POSTED_INTR_WAKEUP_VECTOR);
+
+	/*
+	 * An interrupt posted before the NV switch notified the per-VM vector,
+	 * and no further notification is sent while ON is set: don't block on it.
+	 */
+	return bitmap_test(POSTED_INTR_ON, &(pid->control.value));
+}
+
+/*
+ * @pre vcpu != NULL
+ */
+void vcpu_pi_post_block(struct acrn_vcpu *vcpu)
+{
+	uint16_t pcpu_id = pcpuid_from_vcpu(vcpu);
+	uint64_t rflags;
+
+	if (vcpu->arch.pi_blocked) {
+		/* software posters notify the vCPU again from now on, see apicv_advanced_accept_intr() */
+		vcpu->arch.pi_blocked = false;
+		vcpu_pi_set_nv(get_pi_desc(vcpu), POSTED_INTR_VECTOR + vcpu->vm->vm_id);
+
+		spinlock_irqsave_obtain(&per_cpu(pi_blocked_lock, pcpu_id), &rflags);
+		list_del_init(&vcpu->arch.pi_blocked_node);
+		spinlock_irqrestore_release(&per_cpu(pi_blocked_lock, pcpu_id), rflags);
+	}
+}
+
 /*
  * @brief Update the state of vCPU and state of vlapic
  *
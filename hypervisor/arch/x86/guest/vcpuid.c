@@ -18,33 +18,94 @@
 #include <asm/rdt.h>
 #include <asm/guest/vcat.h>
 
+/**
+ * @brief Slot of the CPUID leaf in vm->vcpuid_index
+ *
+ * @return VCPUID_INDEX_NUM if the leaf is not direct-mapped
+ */
+static inline uint32_t get_vcpuid_index_slot(uint32_t leaf)
+{
+	uint32_t slot = VCPUID_INDEX_NUM;
+
+	if (leaf < VCPUID_BASIC_LEAF_NUM) {
+		slot = leaf;
+	} else if ((leaf >= VCPUID_HV_LEAF_BASE) && (leaf < (VCPUID_HV_LEAF_BASE + VCPUID_HV_LEAF_NUM))) {
+		slot = VCPUID_BASIC_LEAF_NUM + (leaf - VCPUID_HV_LEAF_BASE);
+	} else if ((leaf >= VCPUID_EXT_LEAF_BASE) && (leaf < (VCPUID_EXT_LEAF_BASE + VCPUID_EXT_LEAF_NUM))) {
+		slot = VCPUID_BASIC_LEAF_NUM + VCPUID_HV_LEAF_NUM + (leaf - VCPUID_EXT_LEAF_BASE);
+	} else {
+		/* not direct-mapped */
+	}
+
+	return slot;
+}
+
+/**
+ * @brief Find the sub-leaf among the nr entries of one leaf starting at vcpuid_entries[first]
+ *
+ * Sub-leaves are mostly stored in order, so vcpuid_entries[first + subleaf] is tried
+ * before scanning the entries of the leaf.
+ *
+ * @pre nr != 0U
+ */
+static inline const struct vcpuid_entry *find_vcpuid_subleaf(const struct acrn_vm *vm,
+					uint32_t first, uint32_t nr, uint32_t subleaf)
+{
+	uint32_t i;
+	const struct vcpuid_entry *entries = &vm->vcpuid_entries[first];
+	const struct vcpuid_entry *found_entry = NULL;
+
+	if ((entries[0].flags & CPUID_CHECK_SUBLEAF) == 0U) {
+		found_entry = &entries[0];
+	} else if ((subleaf < nr) && (entries[subleaf].subleaf == subleaf)) {
+		found_entry = &entries[subleaf];
+	} else {
+		for (i = 0U; i < nr; i++) {
+			if (entries[i].subleaf == subleaf) {
+				found_entry = &entries[i];
+				break;
+			}
+		}
+	}
+
+	return found_entry;
+}
+
 static inline const struct vcpuid_entry *local_find_vcpuid_entry(const struct acrn_vcpu *vcpu,
 					uint32_t leaf, uint32_t subleaf)
 {
-	uint32_t i = 0U, nr, half;
+	uint32_t lo, hi, mid, slot;
 	const struct vcpuid_entry *found_entry = NULL;
-	struct acrn_vm *vm = vcpu->vm;
+	const struct acrn_vm *vm = vcpu->vm;
 
-	nr = vm->vcpuid_entry_nr;
-	half = nr >> 1U;
-	if (vm->vcpuid_entries[half].leaf < leaf) {
-		i = half;
-	}
+	slot = get_vcpuid_index_slot(leaf);
+	if (slot < VCPUID_INDEX_NUM) {
+		const struct vcpuid_leaf_index *index = &vm->vcpuid_index[slot];
 
-	for (; i < nr; i++) {
-		const struct vcpuid_entry *tmp = (const struct vcpuid_entry *)(&vm->vcpuid_entries[i]);
+		if (index->nr != 0U) {
+			found_entry = find_vcpuid_subleaf(vm, index->first, index->nr, subleaf);
+		}
+	} else {
+		/* vcpuid_entries[] is sorted by leaf, binary search for the first entry of the leaf */
+		lo = 0U;
+		hi = vm->vcpuid_entry_nr;
+		while (lo < hi) {
+			mid = (lo + hi) >> 1U;
+			if (vm->vcpuid_entries[mid].leaf < leaf) {
+				lo = mid + 1U;
+			} else {
+				hi = mid;
+			}
+		}
 
-		if (tmp->leaf < leaf) {
-			continue;
-		} else if (tmp->leaf == leaf) {
-			if (((tmp->flags & CPUID_CHECK_SUBLEAF) != 0U) && (tmp->subleaf != subleaf)) {
-				continue;
+		for (hi = lo; hi < vm->vcpuid_entry_nr; hi++) {
+			if (vm->vcpuid_entries[hi].leaf != leaf) {
+				break;
 			}
-			found_entry = tmp;
-			break;
-		} else {
-			/* tmp->leaf > leaf */
-			break;
+		}
+
+		if (hi > lo) {
+			found_entry = find_vcpuid_subleaf(vm, lo, hi - lo, subleaf);
 		}
 	}
 
@@ -102,6 +163,29 @@ static inline int32_t set_vcpuid_entry(struct acrn_vm *vm,
 	return ret;
 }
 
+/**
+ * @brief Build the direct-mapped index of the per-VM vcpuid entries
+ *
+ * The entries of one leaf are contiguous as set_vcpuid_entries() adds them in leaf order.
+ */
+static void build_vcpuid_index(struct acrn_vm *vm)
+{
+	uint32_t i, slot;
+	struct vcpuid_leaf_index *index;
+
+	(void)memset(vm->vcpuid_index, 0U, sizeof(vm->vcpuid_index));
+	for (i = 0U; i < vm->vcpuid_entry_nr; i++) {
+		slot = get_vcpuid_index_slot(vm->vcpuid_entries[i].leaf);
+		if (slot < VCPUID_INDEX_NUM) {
+			index = &vm->vcpuid_index[slot];
+			if (index->nr == 0U) {
+				index->first = (uint8_t)i;
+			}
+			index->nr++;
+		}
+	}
+}
+
 /**
  * initialization of virtual CPUID leaf
  */
@@ -601,18 +685,33 @@ int32_t set_vcpuid_entries(struct acrn_vm *vm)
 		}
 	}
 
+	if (result == 0) {
+		build_vcpuid_index(vm);
+	}
+
 	return result;
 }
 
+#ifdef CONFIG_CPUID_PRECOMPUTE_ENABLED
+static inline void get_vcpuid_regs(const struct vcpuid_regs *regs,
+	uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+{
+	*eax = regs->eax;
+	*ebx = regs->ebx;
+	*ecx = regs->ecx;
+	*edx = regs->edx;
+}
+#endif
+
 static inline bool is_percpu_related(uint32_t leaf)
 {
 	return ((leaf == 0x1U) || (leaf == 0xbU) || (leaf == 0xdU) || (leaf == 0x19U) || (leaf == 0x80000001U));
 }
 
-static void guest_cpuid_01h(struct acrn_vcpu *vcpu, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+/* The part of CPUID.01H which doesn't change once the vCPU is created */
+static void init_guest_cpuid_01h(struct acrn_vcpu *vcpu, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
 {
 	uint32_t apicid = vlapic_get_apicid(vcpu_vlapic(vcpu));
-	uint64_t guest_ia32_misc_enable = vcpu_get_guest_msr(vcpu, MSR_IA32_MISC_ENABLE);
 	uint64_t cr4_reserved_mask = get_cr4_reserved_bits();
 
 	cpuid_subleaf(0x1U, 0x0U, eax, ebx, ecx, edx);
@@ -643,26 +742,6 @@ static void guest_cpuid_01h(struct acrn_vcpu *vcpu, uint32_t *eax, uint32_t *ebx
 		*ecx &= ~CPUID_ECX_PCID;
 	}
 
-	/* guest monitor/mwait is supported only if it is allowed('vm_mwait_cap' is true)
-	 * and MSR_IA32_MISC_ENABLE_MONITOR_ENA bit of guest MSR_IA32_MISC_ENABLE is set,
-	 * else clear cpuid.01h[3].
-	 */
-	*ecx &= ~CPUID_ECX_MONITOR;
-	if (vcpu->vm->arch_vm.vm_mwait_cap &&
-		((guest_ia32_misc_enable & MSR_IA32_MISC_ENABLE_MONITOR_ENA) != 0UL)) {
-		*ecx |= CPUID_ECX_MONITOR;
-	}
-
-	*ecx &= ~CPUID_ECX_OSXSAVE;
-	if ((*ecx & CPUID_ECX_XSAVE) != 0U) {
-		uint64_t cr4;
-		/*read guest CR4*/
-		cr4 = vcpu_get_cr4(vcpu);
-		if ((cr4 & CR4_OSXSAVE) != 0UL) {
-			*ecx |= CPUID_ECX_OSXSAVE;
-		}
-	}
-
 	if ((cr4_reserved_mask & CR4_VME) != 0UL) {
 		*edx &= ~CPUID_EDX_VME;
 	}
@@ -700,7 +779,38 @@ static void guest_cpuid_01h(struct acrn_vcpu *vcpu, uint32_t *eax, uint32_t *ebx
 	}
 }
 
-static void guest_cpuid_0bh(struct acrn_vcpu *vcpu, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+static void guest_cpuid_01h(struct acrn_vcpu *vcpu, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+{
+	uint64_t guest_ia32_misc_enable = vcpu_get_guest_msr(vcpu, MSR_IA32_MISC_ENABLE);
+
+#ifdef CONFIG_CPUID_PRECOMPUTE_ENABLED
+	get_vcpuid_regs(&vcpu->arch.vcpuid_cache.leaf_01h, eax, ebx, ecx, edx);
+#else
+	init_guest_cpuid_01h(vcpu, eax, ebx, ecx, edx);
+#endif
+
+	/* guest monitor/mwait is supported only if it is allowed('vm_mwait_cap' is true)
+	 * and MSR_IA32_MISC_ENABLE_MONITOR_ENA bit of guest MSR_IA32_MISC_ENABLE is set,
+	 * else clear cpuid.01h[3].
+	 */
+	*ecx &= ~CPUID_ECX_MONITOR;
+	if (vcpu->vm->arch_vm.vm_mwait_cap &&
+		((guest_ia32_misc_enable & MSR_IA32_MISC_ENABLE_MONITOR_ENA) != 0UL)) {
+		*ecx |= CPUID_ECX_MONITOR;
+	}
+
+	*ecx &= ~CPUID_ECX_OSXSAVE;
+	if ((*ecx & CPUID_ECX_XSAVE) != 0U) {
+		uint64_t cr4;
+		/*read guest CR4*/
+		cr4 = vcpu_get_cr4(vcpu);
+		if ((cr4 & CR4_OSXSAVE) != 0UL) {
+			*ecx |= CPUID_ECX_OSXSAVE;
+		}
+	}
+}
+
+static void init_guest_cpuid_0bh(struct acrn_vcpu *vcpu, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
 {
 	/* Forward host cpu topology to the guest, guest will know the native platform information such as host cpu topology here */
 	cpuid_subleaf(0x0BU, *ecx, eax, ebx, ecx, edx);
@@ -709,6 +819,21 @@ static void guest_cpuid_0bh(struct acrn_vcpu *vcpu, uint32_t *eax, uint32_t *ebx
 	*edx = vlapic_get_apicid(vcpu_vlapic(vcpu));
 }
 
+static void guest_cpuid_0bh(struct acrn_vcpu *vcpu, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+{
+#ifdef CONFIG_CPUID_PRECOMPUTE_ENABLED
+	const struct vcpuid_cache *cache = &vcpu->arch.vcpuid_cache;
+
+	if (*ecx < cache->nr_0bh) {
+		get_vcpuid_regs(&cache->leaf_0bh[*ecx], eax, ebx, ecx, edx);
+	} else {
+		init_guest_cpuid_0bh(vcpu, eax, ebx, ecx, edx);
+	}
+#else
+	init_guest_cpuid_0bh(vcpu, eax, ebx, ecx, edx);
+#endif
+}
+
 static void guest_cpuid_0dh(__unused struct acrn_vcpu *vcpu, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
 {
 	uint32_t subleaf = *ecx;
@@ -744,13 +869,11 @@ static void guest_cpuid_0dh(__unused struct acrn_vcpu *vcpu, uint32_t *eax, uint
 	}
 }
 
-static void guest_cpuid_19h(struct acrn_vcpu *vcpu, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+static void init_guest_cpuid_19h(uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
 {
 	if (pcpu_has_cap(X86_FEATURE_KEYLOCKER)) {
 		/* Host CR4.KL should be enabled at boot time */
 		cpuid_subleaf(0x19U, 0U, eax, ebx, ecx, edx);
-		/* Guest CR4.KL determines KL_AES_ENABLED */
-		*ebx &= ~(vcpu->arch.cr4_kl_enabled ? 0U : CPUID_EBX_KL_AES_EN);
 		/* Don't support nobackup and randomization parameter of LOADIWKEY */
 		*ecx &= ~(CPUID_ECX_KL_NOBACKUP | CPUID_ECX_KL_RANDOM_KS);
 	} else {
@@ -761,22 +884,25 @@ static void guest_cpuid_19h(struct acrn_vcpu *vcpu, uint32_t *eax, uint32_t *ebx
 	}
 }
 
-static void guest_cpuid_80000001h(const struct acrn_vcpu *vcpu,
+static void guest_cpuid_19h(struct acrn_vcpu *vcpu, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+{
+#ifdef CONFIG_CPUID_PRECOMPUTE_ENABLED
+	get_vcpuid_regs(&vcpu->arch.vcpuid_cache.leaf_19h, eax, ebx, ecx, edx);
+#else
+	init_guest_cpuid_19h(eax, ebx, ecx, edx);
+#endif
+	/* Guest CR4.KL determines KL_AES_ENABLED */
+	*ebx &= ~(vcpu->arch.cr4_kl_enabled ? 0U : CPUID_EBX_KL_AES_EN);
+}
+
+static void init_guest_cpuid_80000001h(const struct acrn_vcpu *vcpu,
 	uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
 {
 	const struct vcpuid_entry *entry_check = find_vcpuid_entry(vcpu, 0x80000000U, 0);
-	uint64_t guest_ia32_misc_enable = vcpu_get_guest_msr(vcpu, MSR_IA32_MISC_ENABLE);
 	uint32_t leaf = 0x80000001U;
 
 	if ((entry_check != NULL) && (entry_check->eax >= leaf)) {
 		cpuid_subleaf(leaf, 0x0U, eax, ebx, ecx, edx);
-		/* SDM Vol4 2.1, XD Bit Disable of MSR_IA32_MISC_ENABLE
-		 * When set to 1, the Execute Disable Bit feature (XD Bit) is disabled and the XD Bit
-		 * extended feature flag will be clear (CPUID.80000001H: EDX[20]=0)
-		 */
-		if ((guest_ia32_misc_enable & MSR_IA32_MISC_ENABLE_XD_DISABLE) != 0UL) {
-			*edx = *edx & ~CPUID_EDX_XD_BIT_AVIL;
-		}
 	} else {
 		*eax = 0U;
 		*ebx = 0U;
@@ -785,6 +911,59 @@ static void guest_cpuid_80000001h(const struct acrn_vcpu *vcpu,
 	}
 }
 
+static void guest_cpuid_80000001h(const struct acrn_vcpu *vcpu,
+	uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+{
+	uint64_t guest_ia32_misc_enable = vcpu_get_guest_msr(vcpu, MSR_IA32_MISC_ENABLE);
+
+#ifdef CONFIG_CPUID_PRECOMPUTE_ENABLED
+	get_vcpuid_regs(&vcpu->arch.vcpuid_cache.leaf_80000001h, eax, ebx, ecx, edx);
+#else
+	init_guest_cpuid_80000001h(vcpu, eax, ebx, ecx, edx);
+#endif
+	/* SDM Vol4 2.1, XD Bit Disable of MSR_IA32_MISC_ENABLE
+	 * When set to 1, the Execute Disable Bit feature (XD Bit) is disabled and the XD Bit
+	 * extended feature flag will be clear (CPUID.80000001H: EDX[20]=0)
+	 */
+	if ((guest_ia32_misc_enable & MSR_IA32_MISC_ENABLE_XD_DISABLE) != 0UL) {
+		*edx = *edx & ~CPUID_EDX_XD_BIT_AVIL;
+	}
+}
+
+#ifdef CONFIG_CPUID_PRECOMPUTE_ENABLED
+/**
+ * @pre vcpu != NULL && vcpu->vm != NULL
+ * @pre the vlapic of the vCPU is created and set_vcpuid_entries() is done for vcpu->vm
+ */
+void init_vcpuid_cache(struct acrn_vcpu *vcpu)
+{
+	uint32_t i;
+	struct vcpuid_regs *regs;
+	struct vcpuid_cache *cache = &vcpu->arch.vcpuid_cache;
+
+	regs = &cache->leaf_01h;
+	init_guest_cpuid_01h(vcpu, &regs->eax, &regs->ebx, &regs->ecx, &regs->edx);
+
+	regs = &cache->leaf_19h;
+	init_guest_cpuid_19h(&regs->eax, &regs->ebx, &regs->ecx, &regs->edx);
+
+	regs = &cache->leaf_80000001h;
+	init_guest_cpuid_80000001h(vcpu, &regs->eax, &regs->ebx, &regs->ecx, &regs->edx);
+
+	/* cache CPUID.0BH sub-leaves until the first invalid level (level type 0) */
+	cache->nr_0bh = 0U;
+	for (i = 0U; i < VCPUID_CACHE_0BH_SUBLEAF_NUM; i++) {
+		regs = &cache->leaf_0bh[i];
+		regs->ecx = i;
+		init_guest_cpuid_0bh(vcpu, &regs->eax, &regs->ebx, &regs->ecx, &regs->edx);
+		cache->nr_0bh = i + 1U;
+		if (((regs->ecx >> 8U) & 0xffU) == 0U) {
+			break;
+		}
+	}
+}
+#endif
+
 static void guest_limit_cpuid(const struct acrn_vcpu *vcpu, uint32_t leaf,
 	uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
 {
@@ -14,6 +14,7 @@
 #include <asm/guest/vcpu.h>
 #include <asm/guest/vmcs.h>
 #include <asm/guest/vm.h>
+#include <asm/guest/ept.h>
 #include <asm/guest/lock_instr_emul.h>
 #include <trace.h>
 #include <logmsg.h>
@@ -366,6 +367,8 @@ int32_t acrn_handle_pending_request(struct acrn_vcpu *vcpu)
 		/* make sure ACRN_REQUEST_INIT_VMCS handler as the first one */
 		if (bitmap_test_and_clear_lock(ACRN_REQUEST_INIT_VMCS, pending_req_bits)) {
 			init_vmcs(vcpu);
+			vcpu_load_restored_state(vcpu);
+			ept_dirty_log_sync_vcpu(vcpu);
 		}
 
 		if (bitmap_test_and_clear_lock(ACRN_REQUEST_TRP_FAULT, pending_req_bits)) {
@@ -387,6 +390,10 @@ int32_t acrn_handle_pending_request(struct acrn_vcpu *vcpu)
 				}
 			}
 
+			if (bitmap_test_and_clear_lock(ACRN_REQUEST_DIRTY_LOG, pending_req_bits)) {
+				ept_dirty_log_sync_vcpu(vcpu);
+			}
+
 			if (bitmap_test_and_clear_lock(ACRN_REQUEST_VPID_FLUSH,	pending_req_bits)) {
 				flush_vpid_single(arch->vpid);
 			}
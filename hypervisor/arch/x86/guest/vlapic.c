@@ -495,6 +495,65 @@ static void apicv_basic_accept_intr(struct acrn_vlapic *vlapic, uint32_t vector,
 	}
 }
 
+/*
+ * Send the posted interrupt notification to the vCPU, or record it to be sent by
+ * vlapic_flush_pi_notification when notifications are deferred on this pCPU.
+ */
+static void apicv_notify_pi(struct acrn_vcpu *vcpu)
+{
+	uint64_t rflags;
+	uint16_t i, num;
+	bool deferred = false;
+
+	/* an interrupt handler may post interrupts in the middle of a deferred batch */
+	CPU_INT_ALL_DISABLE(&rflags);
+	if (get_cpu_var(pi_notify_deferred)) {
+		num = get_cpu_var(pi_notify_num);
+		for (i = 0U; i < num; i++) {
+			if (get_cpu_var(pi_notify_vcpus)[i] == vcpu) {
+				deferred = true;
+				break;
+			}
+		}
+		if (!deferred && (num < MAX_DEFERRED_PI_NOTIFY)) {
+			get_cpu_var(pi_notify_vcpus)[num] = vcpu;
+			get_cpu_var(pi_notify_num) = num + 1U;
+			deferred = true;
+		}
+	}
+	CPU_INT_ALL_RESTORE(rflags);
+
+	if (!deferred) {
+		apicv_trigger_pi_anv(pcpuid_from_vcpu(vcpu), (uint32_t)vcpu->arch.pid.control.bits.nv);
+	}
+}
+
+void vlapic_defer_pi_notification(void)
+{
+	get_cpu_var(pi_notify_deferred) = true;
+}
+
+void vlapic_flush_pi_notification(void)
+{
+	struct acrn_vcpu *vcpus[MAX_DEFERRED_PI_NOTIFY];
+	uint64_t rflags;
+	uint16_t i, num;
+
+	CPU_INT_ALL_DISABLE(&rflags);
+	num = get_cpu_var(pi_notify_num);
+	for (i = 0U; i < num; i++) {
+		vcpus[i] = get_cpu_var(pi_notify_vcpus)[i];
+	}
+	get_cpu_var(pi_notify_num) = 0U;
+	get_cpu_var(pi_notify_deferred) = false;
+	CPU_INT_ALL_RESTORE(rflags);
+
+	for (i = 0U; i < num; i++) {
+		apicv_trigger_pi_anv(pcpuid_from_vcpu(vcpus[i]), (uint32_t)vcpus[i]->arch.pid.control.bits.nv);
+	}
+	get_cpu_var(pi_notify_count) += num;
+}
+
 static void apicv_advanced_accept_intr(struct acrn_vlapic *vlapic, uint32_t vector, bool level)
 {
 	/* update TMR if interrupt trigger mode has changed */
@@ -514,8 +573,12 @@ static void apicv_advanced_accept_intr(struct acrn_vlapic *vlapic, uint32_t vect
 		 */
 		bitmap_set_lock(ACRN_REQUEST_EVENT, &vcpu->arch.pending_req);
 
-		if (get_pcpu_id() != pcpuid_from_vcpu(vcpu)) {
-			apicv_trigger_pi_anv(pcpuid_from_vcpu(vcpu), (uint32_t)vcpu->arch.pid.control.bits.nv);
+		/*
+		 * A vCPU blocked in HLT has been woken up by vlapic_accept_intr(),
+		 * the notification would only hit the wakeup vector again.
+		 */
+		if ((get_pcpu_id() != pcpuid_from_vcpu(vcpu)) && (!vcpu->arch.pi_blocked)) {
+			apicv_notify_pi(vcpu);
 		}
 	}
 }
@@ -1628,6 +1691,123 @@ void vlapic_restore(struct acrn_vlapic *vlapic, const struct lapic_regs *regs)
 	vlapic_write_dcr(vlapic);
 }
 
+/**
+ * @pre vlapic != NULL && state != NULL
+ * @pre the vCPU of the vlapic is paused
+ */
+void vlapic_get_state(const struct acrn_vlapic *vlapic, struct acrn_vlapic_state *state)
+{
+	const uint32_t *page = (const uint32_t *)&(vlapic->apic_page);
+	const struct pi_desc *pid = &(vlapic2vcpu(vlapic)->arch.pid);
+	uint32_t i;
+
+	state->apic_base = vlapic->msr_apicbase;
+	state->tsc_deadline = vlapic_get_tsc_deadline_msr(vlapic);
+	for (i = 0U; i < 256U; i++) {
+		state->regs[i] = page[i << 2U];
+	}
+	state->regs[APIC_OFFSET_TIMER_CCR >> 4U] = vlapic_get_ccr(vlapic);
+
+	/* interrupts posted but not synced to the vIRR yet */
+	for (i = 0U; i < 4U; i++) {
+		state->regs[(APIC_OFFSET_IRR0 >> 4U) + (i << 1U)] |= (uint32_t)pid->pir[i];
+		state->regs[(APIC_OFFSET_IRR0 >> 4U) + (i << 1U) + 1U] |= (uint32_t)(pid->pir[i] >> 32U);
+	}
+}
+
+/**
+ * @pre vlapic != NULL && state != NULL
+ * @pre the vCPU of the vlapic isn't launched
+ */
+void vlapic_set_state(struct acrn_vlapic *vlapic, const struct acrn_vlapic_state *state)
+{
+	struct acrn_vcpu *vcpu = vlapic2vcpu(vlapic);
+	struct lapic_regs *lapic = &(vlapic->apic_page);
+	uint32_t *page = (uint32_t *)lapic;
+	uint32_t i, vector;
+
+	for (i = 0U; i < 256U; i++) {
+		/* ID and version belong to the vlapic of this VM, TMR is set below with the EOI exit bitmap */
+		if ((i != (APIC_OFFSET_ID >> 4U)) && (i != (APIC_OFFSET_VER >> 4U)) &&
+				((i < (APIC_OFFSET_TMR0 >> 4U)) || (i > (APIC_OFFSET_TMR7 >> 4U)))) {
+			page[i << 2U] = state->regs[i];
+		}
+	}
+
+	vlapic_reset_tmr(vlapic);
+	for (vector = 0U; vector < 256U; vector++) {
+		if ((state->regs[(APIC_OFFSET_TMR0 >> 4U) + (vector >> 5U)] & (1U << (vector & 0x1fU))) != 0U) {
+			vlapic_set_tmr(vlapic, vector, true);
+		}
+	}
+
+	vlapic_write_svr(vlapic);
+	vlapic_write_lvt(vlapic, APIC_OFFSET_CMCI_LVT);
+	vlapic_write_lvt(vlapic, APIC_OFFSET_TIMER_LVT);
+	vlapic_write_lvt(vlapic, APIC_OFFSET_THERM_LVT);
+	vlapic_write_lvt(vlapic, APIC_OFFSET_PERF_LVT);
+	vlapic_write_lvt(vlapic, APIC_OFFSET_LINT0_LVT);
+	vlapic_write_lvt(vlapic, APIC_OFFSET_LINT1_LVT);
+	vlapic_write_lvt(vlapic, APIC_OFFSET_ERROR_LVT);
+	vlapic_write_dcr(vlapic);
+	vlapic->vtimer.tmicr = lapic->icr_timer.v;
+	vlapic->isrv = vlapic_find_isrv(vlapic);
+	vlapic->esr_pending = 0U;
+	vlapic->esr_firing = 0;
+
+	/* with posted interrupts, the vIRR is only written by the PI notification */
+	if (is_apicv_advanced_feature_supported()) {
+		for (vector = 0U; vector < 256U; vector++) {
+			if ((lapic->irr[vector >> 5U].v & (1U << (vector & 0x1fU))) != 0U) {
+				(void)apicv_set_intr_ready(vlapic, vector);
+			}
+		}
+		for (i = 0U; i < 8U; i++) {
+			lapic->irr[i].v = 0U;
+		}
+	}
+
+	vcpu_set_guest_msr(vcpu, MSR_IA32_TSC_DEADLINE, state->tsc_deadline);
+	vcpu->arch.restore.apic_base = state->apic_base;
+	vcpu_make_request(vcpu, ACRN_REQUEST_EVENT);
+}
+
+/*
+ * The part of vlapic_set_state() which needs the VMCS of the vCPU,
+ * i.e. the APICv mode and the TSC offset.
+ */
+void vlapic_load_restored_state(struct acrn_vlapic *vlapic)
+{
+	struct acrn_vcpu *vcpu = vlapic2vcpu(vlapic);
+	struct vlapic_timer *vtimer = &(vlapic->vtimer);
+	struct lapic_regs *lapic = &(vlapic->apic_page);
+	uint64_t remains;
+
+	if (vcpu->arch.restore.apic_base != 0UL) {
+		(void)vlapic_set_apicbase(vlapic, vcpu->arch.restore.apic_base);
+	}
+
+	if (vlapic_lvtt_tsc_deadline(vlapic)) {
+		vlapic_set_tsc_deadline_msr(vlapic, vcpu_get_guest_msr(vcpu, MSR_IA32_TSC_DEADLINE));
+	} else if (lapic->ccr_timer.v != 0U) {
+		/* an expired one-shot timer has a zero count and must not fire again */
+		vlapic_write_icrtmr(vlapic);
+		if (lapic->ccr_timer.v < vtimer->tmicr) {
+			remains = (uint64_t)lapic->ccr_timer.v << vtimer->divisor_shift;
+			del_timer(&vtimer->timer);
+			update_timer(&vtimer->timer, cpu_ticks() + remains, vtimer->timer.period_in_cycle);
+			(void)add_timer(&vtimer->timer);
+		}
+	} else {
+		/* No action required. */
+	}
+	lapic->ccr_timer.v = 0U;
+
+	if (is_apicv_advanced_feature_supported()) {
+		exec_vmwrite16(VMX_GUEST_INTR_STATUS, (uint16_t)(vlapic->isrv << 8U));
+	}
+}
+
 uint64_t vlapic_get_apicbase(const struct acrn_vlapic *vlapic)
 {
 	return vlapic->msr_apicbase;
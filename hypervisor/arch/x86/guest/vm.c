@@ -331,8 +331,8 @@ static void prepare_prelaunched_vm_memmap(struct acrn_vm *vm, const struct acrn_
 			/* Do EPT mapping for GPAs that are backed by physical memory */
 			if ((entry->type == E820_TYPE_RAM) || (entry->type == E820_TYPE_ACPI_RECLAIM)
 					|| (entry->type == E820_TYPE_ACPI_NVS)) {
-				ept_add_mr(vm, (uint64_t *)vm->arch_vm.nworld_eptp, base_hpa, entry->baseaddr,
-					entry->length, EPT_RWX | EPT_WB);
+				ept_add_mr_parallel(vm, (uint64_t *)vm->arch_vm.nworld_eptp, base_hpa, entry->baseaddr,
+					entry->length, EPT_RWX | EPT_WB, vm->launch_helpers);
 				base_hpa += entry->length;
 				remaining_hpa_size -= entry->length;
 			}
@@ -476,13 +476,15 @@ static void prepare_service_vm_memmap(struct acrn_vm *vm)
 	}
 
 	/* create real ept map for [0, service_vm_high64_max_ram) with UC */
-	ept_add_mr(vm, pml4_page, 0UL, 0UL, service_vm_high64_max_ram, EPT_RWX | EPT_UNCACHED);
+	ept_add_mr_parallel(vm, pml4_page, 0UL, 0UL, service_vm_high64_max_ram, EPT_RWX | EPT_UNCACHED,
+		vm->launch_helpers);
 
 	/* update ram entries to WB attr */
 	for (i = 0U; i < entries_count; i++) {
 		entry = p_e820 + i;
 		if (entry->type == E820_TYPE_RAM) {
-			ept_modify_mr(vm, pml4_page, entry->baseaddr, entry->length, EPT_WB, EPT_MT_MASK);
+			ept_modify_mr_parallel(vm, pml4_page, entry->baseaddr, entry->length, EPT_WB, EPT_MT_MASK,
+				vm->launch_helpers);
 		}
 	}
 
@@ -608,6 +610,7 @@ int32_t create_vm(uint16_t vm_id, uint64_t pcpu_bitmap, struct acrn_vm_config *v
 	struct acrn_vm *vm = NULL;
 	int32_t status = 0;
 	uint16_t pcpu_id;
+	uint32_t i;
 
 	/* Allocate memory for virtual machine */
 	vm = &vm_array[vm_id];
@@ -663,13 +666,33 @@ int32_t create_vm(uint16_t vm_id, uint64_t pcpu_bitmap, struct acrn_vm_config *v
 	if (status == 0) {
 		prepare_epc_vm_memmap(vm);
 		spinlock_init(&vm->vlapic_mode_lock);
-		spinlock_init(&vm->ept_lock);
+		for (i = 0U; i < EPT_LOCK_SHARDS; i++) {
+			spinlock_init(&vm->ept_lock[i]);
+		}
 		spinlock_init(&vm->emul_mmio_lock);
 		spinlock_init(&vm->arch_vm.iwkey_backup_lock);
 
 		vm->arch_vm.vlapic_mode = VM_VLAPIC_XAPIC;
 		vm->arch_vm.vm_mwait_cap = has_monitor_cap();
+		/*
+		 * WBINVD of a VM is emulated by flushing its memory when an RTVM or software SRAM
+		 * exists, EPT dirty flags reduce it to the pages written since the last WBINVD
+		 * for the VMs no device or other VM writes to. The dirty flags also back the dirty
+		 * page logging of the post-launched VMs which opt in to it. Both require kicking
+		 * all the vCPUs out of non-root mode, which RTVMs and LAPIC passthrough VMs avoid,
+		 * and setting them costs the VM on each first write of a page, so they are only
+		 * enabled for these uses.
+		 */
+		vm->arch_vm.ept_ad_enabled = (((is_software_sram_enabled() || has_rt_vm()) &&
+			ept_wbinvd_dirty_only_usable(vm)) ||
+			(is_postlaunched_vm(vm) && ((vm_config->guest_flags & GUEST_FLAG_DIRTY_LOG) != 0UL)))
+			&& !is_rt_vm(vm) && !is_lapic_pt_configured(vm) && pcpu_has_vmx_ept_vpid_cap(VMX_EPT_AD);
+		vm->arch_vm.wbinvd_dirty_tracked = false;
+		ept_dirty_log_init(vm);
 		vm->intr_inject_delay_delta = 0UL;
+		vm->intr_storm_threshold = 0U;
+		vm->intr_storm_max_delay = 0UL;
+		ptirq_init_vm_hash(vm);
 		vm->nr_emul_mmio_regions = 0U;
 		vm->vcpuid_entry_nr = 0U;
 
@@ -892,6 +915,8 @@ int32_t shutdown_vm(struct acrn_vm *vm)
 void start_vm(struct acrn_vm *vm)
 {
 	struct acrn_vcpu *bsp = NULL;
+	struct acrn_vcpu *vcpu = NULL;
+	uint16_t i;
 
 	vm->state = VM_RUNNING;
 
@@ -899,6 +924,14 @@ void start_vm(struct acrn_vm *vm)
 	bsp = vcpu_from_vid(vm, BSP_CPU_ID);
 	vcpu_make_request(bsp, ACRN_REQUEST_INIT_VMCS);
 	launch_vcpu(bsp);
+
+	/* APs restored by hcall_set_vcpu_state() resume without waiting for INIT-SIPI */
+	foreach_vcpu(i, vm, vcpu) {
+		if ((vcpu != bsp) && vcpu->arch.restore.pending) {
+			vcpu_make_request(vcpu, ACRN_REQUEST_INIT_VMCS);
+			launch_vcpu(vcpu);
+		}
+	}
 }
 
 /**
@@ -935,6 +968,9 @@ int32_t reset_vm(struct acrn_vm *vm)
 	destroy_secure_world(vm, false);
 	vm->sworld_control.flag.active = 0UL;
 	vm->arch_vm.iwkey_backup_status = 0UL;
+	/* the guest images are reloaded without EPT dirty tracking */
+	vm->arch_vm.wbinvd_dirty_tracked = false;
+	ept_dirty_log_init(vm);
 	vm->state = VM_CREATED;
 
 	return ret;
@@ -1019,8 +1055,17 @@ int32_t prepare_vm(uint16_t vm_id, struct acrn_vm_config *vm_config)
 		pr_err("Invalid VM name: %s", vm_config->name);
 		err = -1;
 	} else {
+		/*
+		 * The other pCPUs of the VM have nothing to do till it is started, let them
+		 * share the EPT population and the image copy in their interrupt context.
+		 */
+		vm = &vm_array[vm_id];
+		vm->launch_helpers = vm_config->cpu_affinity & ~(1UL << get_pcpu_id());
+		vm->launch_tsc[VM_LAUNCH_BEGIN] = cpu_ticks();
+
 		/* Service VM and pre-launched VMs launch on all pCPUs defined in vm_config->cpu_affinity */
 		err = create_vm(vm_id, vm_config->cpu_affinity, vm_config, &vm);
+		vm_array[vm_id].launch_tsc[VM_LAUNCH_CREATED] = cpu_ticks();
 	}
 
 	if (err == 0) {
@@ -1049,12 +1094,15 @@ int32_t prepare_vm(uint16_t vm_id, struct acrn_vm_config *vm_config)
 		}
 
 		err = prepare_os_image(vm);
+		vm->launch_tsc[VM_LAUNCH_LOADED] = cpu_ticks();
 
 		if (is_prelaunched_vm(vm)) {
 			loaded_pre_vm_nr++;
 		}
 	}
 
+	vm_array[vm_id].launch_helpers = 0UL;
+
 	return err;
 }
 
@@ -1095,6 +1143,7 @@ void launch_vms(uint16_t pcpu_id)
 						/* Nothing need to do here, REE will start in TEE hypercall */
 					} else {
 						start_vm(get_vm_from_vmid(vm_id));
+						vm_array[vm_id].launch_tsc[VM_LAUNCH_STARTED] = cpu_ticks();
 						pr_acrnlog("Start VM id: %x name: %s", vm_id, vm_config->name);
 					}
 				}
@@ -50,10 +50,18 @@ static const struct hc_dispatch hc_dispatch_table[] = {
 		.handler = hcall_pause_vm},
 	[HC_IDX(HC_SET_VCPU_REGS)] = {
 		.handler = hcall_set_vcpu_regs},
+	[HC_IDX(HC_GET_VCPU_STATE)] = {
+		.handler = hcall_get_vcpu_state},
+	[HC_IDX(HC_SET_VCPU_STATE)] = {
+		.handler = hcall_set_vcpu_state},
 	[HC_IDX(HC_CREATE_VCPU)] = {
 		.handler = hcall_create_vcpu},
 	[HC_IDX(HC_SET_IRQLINE)] = {
 		.handler = hcall_set_irqline},
+	[HC_IDX(HC_GET_IRQCHIP_STATE)] = {
+		.handler = hcall_get_irqchip_state},
+	[HC_IDX(HC_SET_IRQCHIP_STATE)] = {
+		.handler = hcall_set_irqchip_state},
 	[HC_IDX(HC_INJECT_MSI)] = {
 		.handler = hcall_inject_msi},
 	[HC_IDX(HC_SET_IOREQ_BUFFER)] = {
@@ -66,6 +74,10 @@ static const struct hc_dispatch hc_dispatch_table[] = {
 		.handler = hcall_write_protect_page},
 	[HC_IDX(HC_VM_GPA2HPA)] = {
 		.handler = hcall_gpa_to_hpa},
+	[HC_IDX(HC_VM_SET_DIRTY_LOG)] = {
+		.handler = hcall_set_dirty_log},
+	[HC_IDX(HC_VM_GET_DIRTY_BITMAP)] = {
+		.handler = hcall_get_dirty_bitmap},
 	[HC_IDX(HC_ASSIGN_PCIDEV)] = {
 		.handler = hcall_assign_pcidev},
 	[HC_IDX(HC_DEASSIGN_PCIDEV)] = {
@@ -94,6 +106,10 @@ static const struct hc_dispatch hc_dispatch_table[] = {
 		.handler = hcall_profiling_ops},
 	[HC_IDX(HC_GET_HW_INFO)] = {
 		.handler = hcall_get_hw_info},
+	[HC_IDX(HC_GET_VMEXIT_LATENCY)] = {
+		.handler = hcall_get_vmexit_latency},
+	[HC_IDX(HC_GET_EPT_PAGE_SIZES)] = {
+		.handler = hcall_get_ept_page_sizes},
 	[HC_IDX(HC_INITIALIZE_TRUSTY)] = {
 		.handler = hcall_initialize_trusty,
 		.permission_flags = GUEST_FLAG_SECURE_WORLD_ENABLED},
@@ -13,6 +13,7 @@
 #include <asm/vmx.h>
 #include <asm/gdt.h>
 #include <asm/pgtable.h>
+#include <asm/guest/ept.h>
 #include <asm/per_cpu.h>
 #include <asm/cpu_caps.h>
 #include <asm/cpufeatures.h>
@@ -391,11 +392,8 @@ static void init_exec_ctrl(struct acrn_vcpu *vcpu)
 		exec_vmwrite64(VMX_PIR_DESC_ADDR_FULL, hva2hpa(get_pi_desc(vcpu)));
 	}
 
-	/* Load EPTP execution control
-	 * TODO: introduce API to make this data driven based
-	 * on VMX_EPT_VPID_CAP
-	 */
-	value64 = hva2hpa(vm->arch_vm.nworld_eptp) | (3UL << 3U) | 6UL;
+	/* Load EPTP execution control */
+	value64 = get_ept_pointer(vm, vm->arch_vm.nworld_eptp);
 	exec_vmwrite64(VMX_EPT_POINTER_FULL, value64);
 	pr_dbg("VMX_EPT_POINTER: 0x%016lx ", value64);
 
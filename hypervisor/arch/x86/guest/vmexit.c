@@ -24,12 +24,6 @@
 #include <asm/rtcm.h>
 #include <debug/console.h>
 
-/*
- * According to "SDM APPENDIX C VMX BASIC EXIT REASONS",
- * there are 65 Basic Exit Reasons.
- */
-#define NR_VMX_EXIT_REASONS	70U
-
 static int32_t triple_fault_vmexit_handler(struct acrn_vcpu *vcpu);
 static int32_t unhandled_vmexit_handler(struct acrn_vcpu *vcpu);
 static int32_t xsetbv_vmexit_handler(struct acrn_vcpu *vcpu);
@@ -200,7 +194,7 @@ static const struct vm_exit_dispatch dispatch_table[NR_VMX_EXIT_REASONS] = {
 	[VMX_EXIT_REASON_RDSEED] = {
 		.handler = unhandled_vmexit_handler},
 	[VMX_EXIT_REASON_PAGE_MODIFICATION_LOG_FULL] = {
-		.handler = unhandled_vmexit_handler},
+		.handler = pml_full_vmexit_handler},
 	[VMX_EXIT_REASON_XSAVES] = {
 		.handler = unhandled_vmexit_handler},
 	[VMX_EXIT_REASON_XRSTORS] = {
@@ -336,7 +330,11 @@ static int32_t pause_vmexit_handler(__unused struct acrn_vcpu *vcpu)
 static int32_t hlt_vmexit_handler(struct acrn_vcpu *vcpu)
 {
 	if ((vcpu->arch.pending_req == 0UL) && (!vlapic_has_pending_intr(vcpu))) {
-		wait_event(&vcpu->events[VCPU_EVENT_VIRTUAL_INTERRUPT]);
+		/* VT-d posts to the wakeup vector while the vCPU is blocked */
+		if (!vcpu_pi_pre_block(vcpu)) {
+			wait_event(&vcpu->events[VCPU_EVENT_VIRTUAL_INTERRUPT]);
+		}
+		vcpu_pi_post_block(vcpu);
 	}
 	return 0;
 }
@@ -397,23 +395,9 @@ static int32_t xsetbv_vmexit_handler(struct acrn_vcpu *vcpu)
 				val64 = (vcpu_get_gpreg(vcpu, CPU_REG_RAX) & 0xffffffffUL) |
 						(vcpu_get_gpreg(vcpu, CPU_REG_RDX) << 32U);
 
-				/* bit 0(x87 state) of XCR0 can't be cleared */
-				if (((val64 & 0x01UL) != 0UL) && ((val64 & XCR0_RESERVED_BITS) == 0UL)) {
-					/*
-					 * XCR0[2:1] (SSE state & AVX state) can't not be
-					 * set to 10b as it is necessary to set both bits
-					 * to use AVX instructions.
-					 */
-					if ((val64 & (XCR0_SSE | XCR0_AVX)) != XCR0_AVX) {
-						/*
-						 * SDM Vol.1 13-4, XCR0[4:3] are associated with MPX state,
-						 * Guest should not set these two bits without MPX support.
-						 */
-						if ((val64 & (XCR0_BNDREGS | XCR0_BNDCSR)) == 0UL) {
-							write_xcr(0, val64);
-							ret = 0;
-						}
-					}
+				if (is_guest_xcr0_valid(vcpu, val64)) {
+					write_xcr(0, val64);
+					ret = 0;
 				}
 			}
 		}
@@ -429,6 +413,7 @@ static int32_t xsetbv_vmexit_handler(struct acrn_vcpu *vcpu)
 static int32_t wbinvd_vmexit_handler(struct acrn_vcpu *vcpu)
 {
 	uint16_t i;
+	uint64_t helper_mask = 0UL;
 	struct acrn_vcpu *other;
 
 	/* GUEST_FLAG_RT has not set in post-launched RTVM before it has been created */
@@ -436,16 +421,18 @@ static int32_t wbinvd_vmexit_handler(struct acrn_vcpu *vcpu)
 		flush_invalidate_all_cache();
 	} else {
 		if (is_rt_vm(vcpu->vm)) {
-			walk_ept_table(vcpu->vm, ept_flush_leaf_page);
+			ept_flush_guest_cache(vcpu->vm, 0UL);
 		} else {
 			/* Pause other vcpus and let them wait for the wbinvd completion */
 			foreach_vcpu(i, vcpu->vm, other) {
 				if (other != vcpu) {
 					vcpu_make_request(other, ACRN_REQUEST_WAIT_WBINVD);
+					bitmap_set_nolock(pcpuid_from_vcpu(other), &helper_mask);
 				}
 			}
 
-			walk_ept_table(vcpu->vm, ept_flush_leaf_page);
+			/* The pCPUs of the paused vcpus help to flush */
+			ept_flush_guest_cache(vcpu->vm, helper_mask);
 
 			foreach_vcpu(i, vcpu->vm, other) {
 				if (other != vcpu) {
@@ -218,8 +218,8 @@ void init_irq_descs_arch(struct irq_desc descs[])
 	uint32_t i;
 
 	/*
-	 * Fill in #CONFIG_MAX_VM_NUM posted interrupt specific irq and vector pairs
-	 * at runtime
+	 * Fill in #CONFIG_MAX_VM_NUM posted interrupt specific irq and vector pairs,
+	 * and the posted interrupt wakeup pair, at runtime
 	 */
 	for (i = 0U; i < CONFIG_MAX_VM_NUM; i++) {
 		uint32_t idx = i + NR_STATIC_MAPPINGS_1;
@@ -230,6 +230,8 @@ void init_irq_descs_arch(struct irq_desc descs[])
 		irq_static_mappings[idx].irq = POSTED_INTR_IRQ + i;
 		irq_static_mappings[idx].vector = POSTED_INTR_VECTOR + i;
 	}
+	irq_static_mappings[NR_STATIC_MAPPINGS - 1U].irq = POSTED_INTR_WAKEUP_IRQ;
+	irq_static_mappings[NR_STATIC_MAPPINGS - 1U].vector = POSTED_INTR_WAKEUP_VECTOR;
 
 	for (i = 0U; i < NR_IRQS; i++) {
 		irq_data[i].vector = VECTOR_INVALID;
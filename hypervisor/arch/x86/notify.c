@@ -16,7 +16,38 @@
 
 static uint32_t notification_irq = IRQ_INVALID;
 
-static uint64_t smp_call_mask = 0UL;
+/*
+ * Run all the calls queued on current pCPU.
+ *
+ * It may be entered from the notification ISR and from a caller waiting for
+ * its own calls at the same time: each one owns the slots it takes out of
+ * pending_bitmap, so a call is never run twice.
+ */
+static void process_smp_call_queue(uint16_t pcpu_id)
+{
+	struct smp_call_queue *queue = &per_cpu(smp_call_queue, pcpu_id);
+	struct smp_call_info_data *smp_call;
+	struct smp_call_token *token;
+	uint64_t pending;
+	uint16_t slot;
+
+	pending = atomic_readandclear64((uint64_t *)&queue->pending_bitmap);
+	while (pending != 0UL) {
+		slot = ffs64(pending);
+		bitmap_clear_nolock(slot, &pending);
+
+		smp_call = &queue->slots[slot];
+		token = smp_call->token;
+		if (smp_call->func != NULL) {
+			smp_call->func(smp_call->data);
+		}
+		/* release the slot before signaling the completion */
+		bitmap_clear_lock(slot, &queue->busy_bitmap);
+		if (token != NULL) {
+			bitmap_clear_lock(pcpu_id, &token->pending_mask);
+		}
+	}
+}
 
 /* run in interrupt context */
 static void kick_notification(__unused uint32_t irq, __unused void *data)
@@ -24,43 +55,143 @@ static void kick_notification(__unused uint32_t irq, __unused void *data)
 	/* Notification vector is used to kick taget cpu out of non-root mode.
 	 * And it also serves for smp call.
 	 */
-	uint16_t pcpu_id = get_pcpu_id();
+	process_smp_call_queue(get_pcpu_id());
+}
 
-	if (bitmap_test(pcpu_id, &smp_call_mask)) {
-		struct smp_call_info_data *smp_call =
-			&per_cpu(smp_call_info, pcpu_id);
+/*
+ * @pre pcpu_id < MAX_PCPU_NUM
+ */
+static void queue_smp_call(uint16_t pcpu_id, smp_call_func_t func, void *data, struct smp_call_token *token)
+{
+	struct smp_call_queue *queue = &per_cpu(smp_call_queue, pcpu_id);
+	uint16_t self = get_pcpu_id();
+	uint16_t slot;
 
-		if (smp_call->func != NULL) {
-			smp_call->func(smp_call->data);
+	while (true) {
+		slot = ffz64(queue->busy_bitmap);
+		if ((slot < SMP_CALL_QUEUE_SIZE) && !bitmap_test_and_set_lock(slot, &queue->busy_bitmap)) {
+			break;
 		}
-		bitmap_clear_lock(pcpu_id, &smp_call_mask);
+		/*
+		 * The queue is full, the target may be waiting for the calls it has queued on us,
+		 * so keep serving our own queue to avoid a deadlock.
+		 */
+		process_smp_call_queue(self);
+		asm_pause();
 	}
+
+	queue->slots[slot].func = func;
+	queue->slots[slot].data = data;
+	queue->slots[slot].token = token;
+	/* locked OR is a full barrier, the slot is visible before it is marked pending */
+	bitmap_set_lock(slot, &queue->pending_bitmap);
 }
 
-void smp_call_function(uint64_t mask, smp_call_func_t func, void *data)
+/*
+ * Queue the call on each active pCPU of mask and notify them, without waiting for
+ * the completion. If token is not NULL, its bits of the called pCPUs are cleared
+ * as they finish the call. Callers must keep data and token valid until then.
+ * The calls of different callers are independent and run in parallel.
+ */
+void smp_call_function_async(uint64_t mask, smp_call_func_t func, void *data, struct smp_call_token *token)
 {
 	uint16_t pcpu_id;
-	struct smp_call_info_data *smp_call;
+	uint64_t call_mask = 0UL;
 
-	/* wait for previous smp call complete, which may run on other cpus */
-	while (atomic_cmpxchg64(&smp_call_mask, 0UL, mask) != 0UL);
 	pcpu_id = ffs64(mask);
 	while (pcpu_id < MAX_PCPU_NUM) {
 		bitmap_clear_nolock(pcpu_id, &mask);
 		if (is_pcpu_active(pcpu_id)) {
-			smp_call = &per_cpu(smp_call_info, pcpu_id);
-			smp_call->func = func;
-			smp_call->data = data;
+			bitmap_set_nolock(pcpu_id, &call_mask);
 		} else {
 			/* pcpu is not in active, print error */
 			pr_err("pcpu_id %d not in active!", pcpu_id);
-			bitmap_clear_nolock(pcpu_id, &smp_call_mask);
 		}
 		pcpu_id = ffs64(mask);
 	}
-	send_dest_ipi_mask((uint32_t)smp_call_mask, NOTIFY_VCPU_VECTOR);
+
+	if (token != NULL) {
+		token->pending_mask = call_mask;
+	}
+
+	mask = call_mask;
+	pcpu_id = ffs64(mask);
+	while (pcpu_id < MAX_PCPU_NUM) {
+		bitmap_clear_nolock(pcpu_id, &mask);
+		queue_smp_call(pcpu_id, func, data, token);
+		pcpu_id = ffs64(mask);
+	}
+
+	if (call_mask != 0UL) {
+		send_dest_ipi_mask((uint32_t)call_mask, NOTIFY_VCPU_VECTOR);
+	}
+}
+
+bool smp_call_done(const struct smp_call_token *token)
+{
+	return (token->pending_mask == 0UL);
+}
+
+/*
+ * Wait for the completion of an asynchronous call. The calls queued on current
+ * pCPU are served meanwhile, as their callers may be waiting on us in turn.
+ */
+void smp_call_wait(struct smp_call_token *token)
+{
+	uint16_t pcpu_id = get_pcpu_id();
+
+	while (!smp_call_done(token)) {
+		process_smp_call_queue(pcpu_id);
+		asm_pause();
+	}
+}
+
+void smp_call_function(uint64_t mask, smp_call_func_t func, void *data)
+{
+	struct smp_call_token token;
+
+	smp_call_function_async(mask, func, data, &token);
 	/* wait for current smp call complete */
-	wait_sync_change(&smp_call_mask, 0UL);
+	smp_call_wait(&token);
+}
+
+/* claim and run chunks of the work until there is none left */
+static void smp_split_run(void *data)
+{
+	struct smp_split_work *work = (struct smp_split_work *)data;
+	int64_t chunk = atomic_inc64_return(&work->next_chunk) - 1L;
+
+	while ((uint64_t)chunk < work->nr_chunks) {
+		work->func(work->data, (uint64_t)chunk);
+		chunk = atomic_inc64_return(&work->next_chunk) - 1L;
+	}
+}
+
+/*
+ * Run func on every chunk of [0, nr_chunks) exactly once, on current pCPU and
+ * on the helper pCPUs in helper_mask, in their interrupt context. The chunks are
+ * claimed dynamically, so a busy helper only takes a smaller share of the work.
+ * Return once all the chunks are done.
+ *
+ * @pre helper_mask doesn't include current pCPU
+ */
+void smp_call_split(uint64_t helper_mask, smp_split_func_t func, void *data, uint64_t nr_chunks)
+{
+	struct smp_split_work work;
+	struct smp_call_token token;
+
+	work.func = func;
+	work.data = data;
+	work.nr_chunks = nr_chunks;
+	work.next_chunk = 0L;
+
+	if ((helper_mask != 0UL) && (nr_chunks > 1UL)) {
+		smp_call_function_async(helper_mask, smp_split_run, &work, &token);
+		smp_split_run(&work);
+		smp_call_wait(&token);
+	} else {
+		smp_split_run(&work);
+	}
 }
 
 static int32_t request_notification_irq(irq_action_t func, void *data)
@@ -110,10 +241,24 @@ static void handle_pi_notification(uint32_t irq, __unused void *data)
 	vcpu_handle_pi_notification(vcpu_index);
 }
 
+/*
+ * posted interrupt wakeup handler, for the vCPUs blocked on this pCPU
+ */
+static void handle_pi_wakeup(__unused uint32_t irq, __unused void *data)
+{
+	vcpu_handle_pi_wakeup();
+}
+
 /*pre-condition: be called only by BSP initialization proccess*/
 void setup_pi_notification(void)
 {
 	uint32_t i;
+	uint16_t pcpu_id;
+
+	for (pcpu_id = 0U; pcpu_id < get_pcpu_nums(); pcpu_id++) {
+		INIT_LIST_HEAD(&per_cpu(pi_blocked_vcpus, pcpu_id));
+		spinlock_init(&per_cpu(pi_blocked_lock, pcpu_id));
+	}
 
 	for (i = 0U; i < CONFIG_MAX_VM_NUM; i++) {
 		if (request_irq(POSTED_INTR_IRQ + i, handle_pi_notification, NULL, IRQF_NONE) < 0) {
@@ -121,4 +266,8 @@ void setup_pi_notification(void)
 			break;
 		}
 	}
+
+	if (request_irq(POSTED_INTR_WAKEUP_IRQ, handle_pi_wakeup, NULL, IRQF_NONE) < 0) {
+		pr_err("Failed to setup pi wakeup notification");
+	}
 }
@@ -9,6 +9,7 @@
 #include <acrn_hv_defs.h>
 #include <asm/page.h>
 #include <asm/mmu.h>
+#include <asm/lib/atomic.h>
 #include <logmsg.h>
 
 #define DBG_LEVEL_MMU	6U
@@ -373,6 +374,35 @@ static void add_pde(const uint64_t *pdpte, uint64_t paddr_start, uint64_t vaddr_
 	}
 }
 
+/*
+ * Replace a PD page only holding 2MB pages which map a contiguous and 1GB
+ * aligned range with the same attributes by a 1GB page. Such PD pages are left
+ * when a 1GB range is added in several calls, e.g. when the Service VM maps
+ * the memory of a User VM as several regions. The caller flushes the TLB, as
+ * for the page table pages freed on MR_DEL.
+ */
+static void try_to_merge_pd_page(uint64_t *pdpte, const struct pgtable *table)
+{
+	uint64_t *pd_page = pdpte_page_vaddr(*pdpte);
+	uint64_t first = *pd_page;
+	uint64_t index;
+
+	if (table->merge_pd_pages && (table->pgentry_present(first) != 0UL) && (pde_large(first) != 0UL) &&
+		mem_aligned_check(first & PDE_PFN_MASK, PDPTE_SIZE) &&
+		table->large_page_support(IA32E_PDPT, first & ~PDE_PFN_MASK)) {
+		for (index = 1UL; index < PTRS_PER_PDE; index++) {
+			if (pd_page[index] != (first + (index << PDE_SHIFT))) {
+				break;
+			}
+		}
+
+		if (index == PTRS_PER_PDE) {
+			set_pgentry(pdpte, first, table);
+			free_page(table->pool, (void *)pd_page);
+		}
+	}
+}
+
 /*
  * In PDPT level,
  * add [vaddr_start, vaddr_end) to [paddr_base, ...) MT PT mapping
@@ -413,6 +443,7 @@ static void add_pdpte(const uint64_t *pml4e, uint64_t paddr_start, uint64_t vadd
 				}
 			}
 			add_pde(pdpte, paddr, vaddr, vaddr_end, prot, table);
+			try_to_merge_pd_page(pdpte, table);
 		}
 		if (vaddr_next >= vaddr_end) {
 			break;	/* done */
@@ -422,6 +453,25 @@ static void add_pdpte(const uint64_t *pml4e, uint64_t paddr_start, uint64_t vadd
 	}
 }
 
+/*
+ * Callers may update disjoint PDPTE subtrees under the same PML4E concurrently
+ * (see ept_lock_range()), so a missing PML4E is installed with a cmpxchg and the
+ * loser of a race frees its PDPT page and uses the winner's.
+ */
+static void install_pml4e(uint64_t *pml4e, const struct pgtable *table)
+{
+	uint64_t old_entry = *pml4e;
+	void *pdpt_page = alloc_page(table->pool);
+	uint64_t new_entry = hva2hpa(pdpt_page) | table->default_access_right;
+
+	sanitize_pte((uint64_t *)pdpt_page, table);
+	if (atomic_cmpxchg64(pml4e, old_entry, new_entry) == old_entry) {
+		table->clflush_pagewalk(pml4e);
+	} else {
+		free_page(table->pool, pdpt_page);
+	}
+}
+
 /*
  * action: MR_ADD
  * add [vaddr_base, vaddr_base + size ) memory region page table mapping.
@@ -445,8 +495,7 @@ void pgtable_add_map(uint64_t *pml4_page, uint64_t paddr_base, uint64_t vaddr_ba
 		vaddr_next = (vaddr & PML4E_MASK) + PML4E_SIZE;
 		pml4e = pml4e_offset(pml4_page, vaddr);
 		if (table->pgentry_present(*pml4e) == 0UL) {
-			void *pdpt_page = alloc_page(table->pool);
-			construct_pgentry(pml4e, pdpt_page, table->default_access_right, table);
+			install_pml4e(pml4e, table);
 		}
 		add_pdpte(pml4e, paddr, vaddr, vaddr_end, prot, table);
 
@@ -549,3 +598,51 @@ const uint64_t *pgtable_lookup_entry(uint64_t *pml4_page, uint64_t addr, uint64_
 
 	return pret;
 }
+
+/**
+ * @pre (pml4_page != NULL) && (stats != NULL)
+ */
+void pgtable_get_stats(const uint64_t *pml4_page, const struct pgtable *table,
+		struct pgtable_stats *stats)
+{
+	uint64_t i, j, k, l;
+	const uint64_t *pdpt_page, *pd_page, *pt_page;
+
+	(void)memset(stats, 0U, sizeof(*stats));
+	stats->table_pages = 1UL;
+
+	for (i = 0UL; i < PTRS_PER_PML4E; i++) {
+		if (table->pgentry_present(pml4_page[i]) == 0UL) {
+			continue;
+		}
+		stats->table_pages++;
+		pdpt_page = pml4e_page_vaddr(pml4_page[i]);
+		for (j = 0UL; j < PTRS_PER_PDPTE; j++) {
+			if (table->pgentry_present(pdpt_page[j]) == 0UL) {
+				continue;
+			}
+			if (pdpte_large(pdpt_page[j]) != 0UL) {
+				stats->leaves[IA32E_PDPT]++;
+				continue;
+			}
+			stats->table_pages++;
+			pd_page = pdpte_page_vaddr(pdpt_page[j]);
+			for (k = 0UL; k < PTRS_PER_PDE; k++) {
+				if (table->pgentry_present(pd_page[k]) == 0UL) {
+					continue;
+				}
+				if (pde_large(pd_page[k]) != 0UL) {
+					stats->leaves[IA32E_PD]++;
+					continue;
+				}
+				stats->table_pages++;
+				pt_page = pde_page_vaddr(pd_page[k]);
+				for (l = 0UL; l < PTRS_PER_PTE; l++) {
+					if (table->pgentry_present(pt_page[l]) != 0UL) {
+						stats->leaves[IA32E_PT]++;
+					}
+				}
+			}
+		}
+	}
+}
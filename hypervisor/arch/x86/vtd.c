@@ -96,11 +96,22 @@ static inline uint64_t dmar_set_bitslice(uint64_t var, uint64_t mask, uint32_t p
 #define DMAR_INV_IEC_DESC		0x04UL
 #define DMAR_INV_WAIT_DESC		0x05UL
 #define DMAR_INV_STATUS_WRITE		(1UL << DMAR_INV_STATUS_WRITE_SHIFT)
-#define DMAR_INV_STATUS_INCOMPLETE	0UL
-#define DMAR_INV_STATUS_COMPLETED	1UL
+#define DMAR_INV_FENCE_SHIFT		6U
+#define DMAR_INV_FENCE			(1UL << DMAR_INV_FENCE_SHIFT)
 #define DMAR_INV_STATUS_DATA_SHIFT	32U
-#define DMAR_INV_STATUS_DATA		(DMAR_INV_STATUS_COMPLETED << DMAR_INV_STATUS_DATA_SHIFT)
-#define DMAR_INV_WAIT_DESC_LOWER	(DMAR_INV_STATUS_WRITE | DMAR_INV_WAIT_DESC | DMAR_INV_STATUS_DATA)
+#define DMAR_INV_WAIT_DESC_LOWER	(DMAR_INV_STATUS_WRITE | DMAR_INV_WAIT_DESC | DMAR_INV_FENCE)
+
+/* max invalidation descriptors posted with one wait descriptor */
+#define DMAR_QI_BATCH_MAX		16U
+
+/* attempts to post a batch to an invalidation queue with no room for it */
+#define DMAR_QI_POST_RETRIES		3U
+
+/* page-selective IOTLB invalidations above which a range falls back to domain-selective invalidation */
+#define DMAR_IOTLB_PSI_MAX		8U
+
+/* Domain id 0 is reserved in some cases per VT-d */
+#define MAX_DOMAIN_NUM (CONFIG_MAX_VM_NUM + 1)
 
 #define DMAR_IR_ENABLE_EIM_SHIFT	11UL
 #define DMAR_IR_ENABLE_EIM		(1UL << DMAR_IR_ENABLE_EIM_SHIFT)
@@ -132,6 +143,10 @@ struct dmar_drhd_rt {
 	uint64_t irte_reserved_bitmap[MAX_IR_ENTRIES / 64U];
 	uint64_t qi_queue;
 	uint16_t qi_tail;
+	uint32_t qi_seq;		/* status data of the last posted wait descriptor */
+	volatile uint32_t qi_done_seq;	/* status data written back by the last completed wait descriptor */
+	struct iommu_qi_stats qi_stats;
+	uint16_t domain_dev_num[MAX_DOMAIN_NUM];	/* devices attached per domain id */
 
 	uint64_t cap;
 	uint64_t ecap;
@@ -186,9 +201,6 @@ static struct dmar_drhd_rt dmar_drhd_units[MAX_DRHDS];
 static bool iommu_page_walk_coherent = true;
 static struct dmar_info *platform_dmar_info = NULL;
 
-/* Domain id 0 is reserved in some cases per VT-d */
-#define MAX_DOMAIN_NUM (CONFIG_MAX_VM_NUM + 1)
-
 static inline uint16_t vmid_to_domainid(uint16_t vm_id)
 {
 	return vm_id + 1U;
@@ -540,39 +552,204 @@ static struct dmar_drhd_rt *device_to_dmaru(uint8_t bus, uint8_t devfun)
 	return dmaru;
 }
 
-static void dmar_issue_qi_request(struct dmar_drhd_rt *dmar_unit, struct dmar_entry invalidate_desc)
+/*
+ * Invalidation descriptors collected by the caller and posted to the invalidation
+ * queue of one DMAR unit with a single tail register write, followed by one
+ * wait descriptor whose status data is a per-unit sequence number.
+ */
+struct dmar_qi_batch {
+	struct dmar_drhd_rt *dmar_unit;
+	uint32_t num;
+	int32_t err;		/* set once the descriptors of an async post are dropped */
+	struct dmar_entry desc[DMAR_QI_BATCH_MAX];
+};
+
+static inline bool dmar_qi_seq_done(const struct dmar_drhd_rt *dmar_unit, uint32_t seq)
 {
-	struct dmar_entry *invalidate_desc_ptr;
-	uint32_t qi_status = 0U;
-	uint64_t start;
+	/* sequence numbers are compared in a wrap-around safe way */
+	return ((int32_t)(dmar_unit->qi_done_seq - seq) >= 0);
+}
+
+/*
+ * Wait until num descriptors fit in the invalidation queue, nothing may be written
+ * to the queue on a timeout as the hardware still owns the slots past the head.
+ *
+ * @pre spinlock dmar_unit->lock is held
+ */
+static int32_t dmar_qi_wait_space(struct dmar_drhd_rt *dmar_unit, uint32_t num)
+{
+	uint32_t head, free_size;
+	uint64_t start = cpu_ticks();
+	int32_t ret = 0;
+
+	while (true) {
+		head = iommu_read32(dmar_unit, DMAR_IQH_REG) % DMAR_INVALIDATION_QUEUE_SIZE;
+		/* one slot is always kept empty to tell a full queue from an empty one */
+		free_size = ((head + DMAR_INVALIDATION_QUEUE_SIZE) - dmar_unit->qi_tail - DMAR_QI_INV_ENTRY_SIZE) %
+				DMAR_INVALIDATION_QUEUE_SIZE;
+		if (free_size >= (num * DMAR_QI_INV_ENTRY_SIZE)) {
+			break;
+		}
+		if ((cpu_ticks() - start) > TICKS_PER_MS) {
+			pr_err("DMAR QI full! @ %s", __func__);
+			dmar_unit->qi_stats.timeouts++;
+			ret = -ETIMEDOUT;
+			break;
+		}
+		asm_pause();
+	}
+
+	return ret;
+}
+
+static void dmar_qi_batch_init(struct dmar_qi_batch *batch, struct dmar_drhd_rt *dmar_unit)
+{
+	batch->dmar_unit = dmar_unit;
+	batch->num = 0U;
+	batch->err = 0;
+}
+
+/*
+ * Post all the descriptors of the batch and one wait descriptor to the invalidation queue,
+ * and set seq to the sequence number the wait descriptor writes back once all of them complete.
+ * The batch is emptied and can be reused. If the queue has no room for them, nothing is posted,
+ * the batch is kept and -ETIMEDOUT is returned.
+ */
+static int32_t dmar_qi_batch_post(struct dmar_qi_batch *batch, bool async, uint32_t *seq)
+{
+	struct dmar_drhd_rt *dmar_unit = batch->dmar_unit;
+	struct dmar_entry *desc_ptr;
+	uint32_t i;
+	int32_t ret;
 
 	spinlock_obtain(&(dmar_unit->lock));
 
-	invalidate_desc_ptr = (struct dmar_entry *)(dmar_unit->qi_queue + dmar_unit->qi_tail);
+	ret = dmar_qi_wait_space(dmar_unit, batch->num + 1U);
+	if (ret == 0) {
+		for (i = 0U; i < batch->num; i++) {
+			desc_ptr = (struct dmar_entry *)(dmar_unit->qi_queue + dmar_unit->qi_tail);
+			*desc_ptr = batch->desc[i];
+			dmar_unit->qi_tail = (dmar_unit->qi_tail + DMAR_QI_INV_ENTRY_SIZE) %
+					DMAR_INVALIDATION_QUEUE_SIZE;
+		}
+
+		dmar_unit->qi_seq++;
+		*seq = dmar_unit->qi_seq;
+		desc_ptr = (struct dmar_entry *)(dmar_unit->qi_queue + dmar_unit->qi_tail);
+		desc_ptr->hi_64 = hva2hpa((const void *)&(dmar_unit->qi_done_seq));
+		desc_ptr->lo_64 = DMAR_INV_WAIT_DESC_LOWER | ((uint64_t)*seq << DMAR_INV_STATUS_DATA_SHIFT);
+		dmar_unit->qi_tail = (dmar_unit->qi_tail + DMAR_QI_INV_ENTRY_SIZE) % DMAR_INVALIDATION_QUEUE_SIZE;
+
+		iommu_write32(dmar_unit, DMAR_IQT_REG, dmar_unit->qi_tail);
+
+		dmar_unit->qi_stats.submits++;
+		dmar_unit->qi_stats.descs += batch->num;
+		if (async) {
+			dmar_unit->qi_stats.async_submits++;
+		}
+	}
 
-	invalidate_desc_ptr->hi_64 = invalidate_desc.hi_64;
-	invalidate_desc_ptr->lo_64 = invalidate_desc.lo_64;
-	dmar_unit->qi_tail = (dmar_unit->qi_tail + DMAR_QI_INV_ENTRY_SIZE) % DMAR_INVALIDATION_QUEUE_SIZE;
+	spinlock_release(&(dmar_unit->lock));
 
-	invalidate_desc_ptr++;
+	if (ret == 0) {
+		batch->num = 0U;
+	}
 
-	invalidate_desc_ptr->hi_64 = hva2hpa(&qi_status);
-	invalidate_desc_ptr->lo_64 = DMAR_INV_WAIT_DESC_LOWER;
-	dmar_unit->qi_tail = (dmar_unit->qi_tail + DMAR_QI_INV_ENTRY_SIZE) % DMAR_INVALIDATION_QUEUE_SIZE;
+	return ret;
+}
 
-	qi_status = DMAR_INV_STATUS_INCOMPLETE;
-	iommu_write32(dmar_unit, DMAR_IQT_REG, dmar_unit->qi_tail);
+/* Retry posting a batch the invalidation queue has no room for, drop its descriptors if it never fits */
+static int32_t dmar_qi_batch_post_retry(struct dmar_qi_batch *batch, bool async, uint32_t *seq)
+{
+	uint32_t i;
+	int32_t ret = -ETIMEDOUT;
 
-	start = cpu_ticks();
-	while (qi_status != DMAR_INV_STATUS_COMPLETED) {
+	for (i = 0U; (i < DMAR_QI_POST_RETRIES) && (ret != 0); i++) {
+		ret = dmar_qi_batch_post(batch, async, seq);
+	}
+	if (ret != 0) {
+		pr_fatal("DMAR QI dropped %u descriptors! @ %s", batch->num, __func__);
+		batch->num = 0U;
+	}
+
+	return ret;
+}
+
+/* Wait until the wait descriptor carrying seq completes, start is the tick the descriptors were posted at */
+static int32_t dmar_qi_wait(struct dmar_drhd_rt *dmar_unit, uint32_t seq, uint64_t start)
+{
+	uint64_t delta;
+	bool timeout = false;
+
+	while (!dmar_qi_seq_done(dmar_unit, seq)) {
 		if ((cpu_ticks() - start) > TICKS_PER_MS) {
 			pr_err("DMAR OP Timeout! @ %s", __func__);
+			timeout = true;
 			break;
 		}
 		asm_pause();
 	}
+	delta = cpu_ticks() - start;
 
+	spinlock_obtain(&(dmar_unit->lock));
+	dmar_unit->qi_stats.sync_waits++;
+	dmar_unit->qi_stats.total_wait_ticks += delta;
+	if (delta > dmar_unit->qi_stats.max_wait_ticks) {
+		dmar_unit->qi_stats.max_wait_ticks = delta;
+	}
+	if (timeout) {
+		dmar_unit->qi_stats.timeouts++;
+	}
 	spinlock_release(&(dmar_unit->lock));
+
+	return timeout ? -ETIMEDOUT : 0;
+}
+
+/*
+ * Post the batch and wait until the hardware completes all its descriptors, return -ETIMEDOUT
+ * if any descriptor of the batch, including those posted asynchronously once it was full, was
+ * dropped or didn't complete in time.
+ */
+static int32_t dmar_qi_batch_submit(struct dmar_qi_batch *batch)
+{
+	struct dmar_drhd_rt *dmar_unit = batch->dmar_unit;
+	uint64_t start;
+	uint32_t seq = 0U;
+	int32_t ret = 0;
+
+	if (batch->num != 0U) {
+		start = cpu_ticks();
+		ret = dmar_qi_batch_post_retry(batch, false, &seq);
+		if (ret == 0) {
+			ret = dmar_qi_wait(dmar_unit, seq, start);
+		}
+	}
+
+	return (batch->err != 0) ? batch->err : ret;
+}
+
+/*
+ * Post the batch without waiting for its completion, for the paths which don't rely on
+ * the invalidation having taken effect before returning. The wait descriptors are fenced,
+ * so any later submission completes only after this one.
+ */
+static void dmar_qi_batch_submit_async(struct dmar_qi_batch *batch)
+{
+	uint32_t seq;
+
+	if ((batch->num != 0U) && (dmar_qi_batch_post_retry(batch, true, &seq) != 0)) {
+		batch->err = -ETIMEDOUT;
+	}
+}
+
+/* A full batch is posted asynchronously; the fence keeps it ordered before the rest of the batch */
+static void dmar_qi_batch_add(struct dmar_qi_batch *batch, struct dmar_entry desc)
+{
+	if (batch->num == DMAR_QI_BATCH_MAX) {
+		dmar_qi_batch_submit_async(batch);
+	}
+	batch->desc[batch->num] = desc;
+	batch->num++;
 }
 
 /*
@@ -581,7 +758,7 @@ static void dmar_issue_qi_request(struct dmar_drhd_rt *dmar_unit, struct dmar_en
  * fm: function mask
  * cirg: cache-invalidation request granularity
  */
-static void dmar_invalid_context_cache(struct dmar_drhd_rt *dmar_unit,
+static void dmar_invalid_context_cache(struct dmar_qi_batch *batch,
 	uint16_t did, uint16_t sid, uint8_t fm, enum dmar_cirg_type cirg)
 {
 	struct dmar_entry invalidate_desc;
@@ -605,16 +782,11 @@ static void dmar_invalid_context_cache(struct dmar_drhd_rt *dmar_unit,
 	}
 
 	if (invalidate_desc.lo_64 != 0UL) {
-		dmar_issue_qi_request(dmar_unit, invalidate_desc);
+		dmar_qi_batch_add(batch, invalidate_desc);
 	}
 }
 
-static void dmar_invalid_context_cache_global(struct dmar_drhd_rt *dmar_unit)
-{
-	dmar_invalid_context_cache(dmar_unit, 0U, 0U, 0U, DMAR_CIRG_GLOBAL);
-}
-
-static void dmar_invalid_iotlb(struct dmar_drhd_rt *dmar_unit, uint16_t did, uint64_t address, uint8_t am,
+static void dmar_invalid_iotlb(struct dmar_qi_batch *batch, uint16_t did, uint64_t address, uint8_t am,
 			       bool hint, enum dmar_iirg_type iirg)
 {
 	/* set Drain Reads & Drain Writes,
@@ -648,18 +820,58 @@ static void dmar_invalid_iotlb(struct dmar_drhd_rt *dmar_unit, uint16_t did, uin
 	}
 
 	if (invalidate_desc.lo_64 != 0UL) {
-		dmar_issue_qi_request(dmar_unit, invalidate_desc);
+		dmar_qi_batch_add(batch, invalidate_desc);
 	}
 }
 
-/* Invalidate IOTLB globally,
- * all iotlb entries are invalidated,
- * all PASID-cache entries are invalidated,
- * all paging-structure-cache entries are invalidated.
+/*
+ * Address mask of the largest naturally aligned chunk starting at pfn which
+ * doesn't go beyond end_pfn, limited by the max address mask value of the unit.
+ *
+ * @pre pfn < end_pfn
  */
-static void dmar_invalid_iotlb_global(struct dmar_drhd_rt *dmar_unit)
+static uint8_t dmar_iotlb_range_am(uint64_t pfn, uint64_t end_pfn, uint8_t max_am)
 {
-	dmar_invalid_iotlb(dmar_unit, 0U, 0UL, 0U, false, DMAR_IIRG_GLOBAL);
+	uint8_t am = (uint8_t)fls64(end_pfn - pfn);
+
+	if ((pfn != 0UL) && ((uint8_t)ffs64(pfn) < am)) {
+		am = (uint8_t)ffs64(pfn);
+	}
+
+	return min(am, max_am);
+}
+
+/*
+ * Invalidate the IOTLB entries of domain did covering [gpa, gpa + size) with the minimal set of
+ * page-selective invalidations, or with one domain-selective invalidation if the range needs more
+ * than DMAR_IOTLB_PSI_MAX of them or the unit doesn't support page-selective invalidation.
+ *
+ * @pre size != 0
+ */
+static void dmar_invalid_iotlb_range(struct dmar_qi_batch *batch, uint16_t did, uint64_t gpa, uint64_t size)
+{
+	const struct dmar_drhd_rt *dmar_unit = batch->dmar_unit;
+	uint64_t start_pfn = gpa >> PAGE_SHIFT;
+	uint64_t end_pfn = (gpa + size + PAGE_SIZE - 1UL) >> PAGE_SHIFT;
+	uint64_t pfn;
+	uint8_t am, max_am = iommu_cap_max_amask_val(dmar_unit->cap);
+	uint32_t num = 0U;
+
+	if (iommu_cap_pgsel_inv(dmar_unit->cap) != 0U) {
+		for (pfn = start_pfn; (pfn < end_pfn) && (num <= DMAR_IOTLB_PSI_MAX); pfn += (1UL << am)) {
+			am = dmar_iotlb_range_am(pfn, end_pfn, max_am);
+			num++;
+		}
+	}
+
+	if ((num == 0U) || (num > DMAR_IOTLB_PSI_MAX)) {
+		dmar_invalid_iotlb(batch, did, 0UL, 0U, false, DMAR_IIRG_DOMAIN);
+	} else {
+		for (pfn = start_pfn; pfn < end_pfn; pfn += (1UL << am)) {
+			am = dmar_iotlb_range_am(pfn, end_pfn, max_am);
+			dmar_invalid_iotlb(batch, did, pfn << PAGE_SHIFT, am, false, DMAR_IIRG_PAGE);
+		}
+	}
 }
 
 /* @pre dmar_unit->ir_table_addr != NULL */
@@ -684,7 +896,7 @@ static void dmar_set_intr_remap_table(struct dmar_drhd_rt *dmar_unit)
 	spinlock_release(&(dmar_unit->lock));
 }
 
-static void dmar_invalid_iec(struct dmar_drhd_rt *dmar_unit, uint16_t intr_index,
+static void dmar_invalid_iec(struct dmar_qi_batch *batch, uint16_t intr_index,
 				uint8_t index_mask, bool is_global)
 {
 	struct dmar_entry invalidate_desc;
@@ -699,13 +911,27 @@ static void dmar_invalid_iec(struct dmar_drhd_rt *dmar_unit, uint16_t intr_index
 	}
 
 	if (invalidate_desc.lo_64 != 0UL) {
-		dmar_issue_qi_request(dmar_unit, invalidate_desc);
+		dmar_qi_batch_add(batch, invalidate_desc);
 	}
 }
 
-static void dmar_invalid_iec_global(struct dmar_drhd_rt *dmar_unit)
+/* Invalidate context-cache, IOTLB and interrupt entry cache globally with one submission,
+ * all iotlb entries are invalidated,
+ * all PASID-cache entries are invalidated,
+ * all paging-structure-cache entries are invalidated.
+ */
+static void dmar_invalid_caches_global(struct dmar_drhd_rt *dmar_unit)
 {
-	dmar_invalid_iec(dmar_unit, 0U, 0U, true);
+	struct dmar_qi_batch batch;
+
+	dmar_qi_batch_init(&batch, dmar_unit);
+	dmar_invalid_context_cache(&batch, 0U, 0U, 0U, DMAR_CIRG_GLOBAL);
+	dmar_invalid_iotlb(&batch, 0U, 0UL, 0U, false, DMAR_IIRG_GLOBAL);
+	dmar_invalid_iec(&batch, 0U, 0U, true);
+	if (dmar_qi_batch_submit(&batch) != 0) {
+		pr_fatal("%s: failed to invalidate the caches of dmar unit [0x%x]", __func__,
+			dmar_unit->drhd->reg_base_addr);
+	}
 }
 
 /* @pre dmar_unit->root_table_addr != NULL */
@@ -893,6 +1119,10 @@ static void dmar_enable_qi(struct dmar_drhd_rt *dmar_unit)
 	dmar_unit->qi_queue = hva2hpa(get_qi_queue(dmar_unit->index));
 	iommu_write64(dmar_unit, DMAR_IQA_REG, dmar_unit->qi_queue);
 
+	/* the queue head is reset by the IQA write, restart the tail and the sequence as well */
+	dmar_unit->qi_tail = 0U;
+	dmar_unit->qi_seq = 0U;
+	dmar_unit->qi_done_seq = 0U;
 	iommu_write32(dmar_unit, DMAR_IQT_REG, 0U);
 
 	if ((dmar_unit->gcmd & DMA_GCMD_QIE) == 0U) {
@@ -931,9 +1161,7 @@ static void prepare_dmar(struct dmar_drhd_rt *dmar_unit)
 static void enable_dmar(struct dmar_drhd_rt *dmar_unit)
 {
 	dev_dbg(DBG_LEVEL_IOMMU, "enable dmar uint [0x%x]", dmar_unit->drhd->reg_base_addr);
-	dmar_invalid_context_cache_global(dmar_unit);
-	dmar_invalid_iotlb_global(dmar_unit);
-	dmar_invalid_iec_global(dmar_unit);
+	dmar_invalid_caches_global(dmar_unit);
 	dmar_enable_translation(dmar_unit);
 }
 
@@ -949,9 +1177,7 @@ static void suspend_dmar(struct dmar_drhd_rt *dmar_unit)
 {
 	uint32_t i;
 
-	dmar_invalid_context_cache_global(dmar_unit);
-	dmar_invalid_iotlb_global(dmar_unit);
-	dmar_invalid_iec_global(dmar_unit);
+	dmar_invalid_caches_global(dmar_unit);
 
 	disable_dmar(dmar_unit);
 
@@ -1070,6 +1296,10 @@ static int32_t iommu_attach_device(const struct iommu_domain *domain, uint8_t bu
 			context_entry->hi_64 = hi_64;
 			context_entry->lo_64 = lo_64;
 			iommu_flush_cache(context_entry, sizeof(struct dmar_entry));
+
+			spinlock_obtain(&(dmar_unit->lock));
+			dmar_unit->domain_dev_num[vmid_to_domainid(domain->vm_id)]++;
+			spinlock_release(&(dmar_unit->lock));
 			ret = 0;
 		}
 	} else {
@@ -1090,6 +1320,7 @@ static int32_t iommu_detach_device(const struct iommu_domain *domain, uint8_t bu
 	struct dmar_entry *context;
 	struct dmar_entry *root_entry;
 	struct dmar_entry *context_entry;
+	struct dmar_qi_batch batch;
 	/* source id */
 	union pci_bdf sid;
 	int32_t ret = -EINVAL;
@@ -1124,10 +1355,16 @@ static int32_t iommu_detach_device(const struct iommu_domain *domain, uint8_t bu
 			context_entry->hi_64 = 0UL;
 			iommu_flush_cache(context_entry, sizeof(struct dmar_entry));
 
-			dmar_invalid_context_cache(dmar_unit, vmid_to_domainid(domain->vm_id), sid.value, 0U,
+			dmar_qi_batch_init(&batch, dmar_unit);
+			dmar_invalid_context_cache(&batch, vmid_to_domainid(domain->vm_id), sid.value, 0U,
 							DMAR_CIRG_DEVICE);
-			dmar_invalid_iotlb(dmar_unit, vmid_to_domainid(domain->vm_id), 0UL, 0U, false,
+			dmar_invalid_iotlb(&batch, vmid_to_domainid(domain->vm_id), 0UL, 0U, false,
 							DMAR_IIRG_DOMAIN);
+			ret = dmar_qi_batch_submit(&batch);
+
+			spinlock_obtain(&(dmar_unit->lock));
+			dmar_unit->domain_dev_num[vmid_to_domainid(domain->vm_id)]--;
+			spinlock_release(&(dmar_unit->lock));
 		}
 	} else {
 		if (is_dmar_unit_ignored(dmar_unit)) {
@@ -1221,6 +1458,33 @@ int32_t move_pt_device(const struct iommu_domain *from_domain, const struct iomm
 	return status;
 }
 
+/*
+ * @pre domain != NULL
+ */
+void iommu_invalidate_range(const struct iommu_domain *domain, uint64_t gpa, uint64_t size)
+{
+	struct dmar_drhd_rt *dmar_unit;
+	struct dmar_qi_batch batch;
+	uint16_t did = vmid_to_domainid(domain->vm_id);
+	uint32_t i;
+
+	if ((platform_dmar_info != NULL) && (size != 0UL)) {
+		for (i = 0U; i < platform_dmar_info->drhd_count; i++) {
+			dmar_unit = &dmar_drhd_units[i];
+			/* only the units translating DMA of some device in the domain may cache its mappings */
+			if (!dmar_unit->drhd->ignore && (dmar_unit->domain_dev_num[did] != 0U)) {
+				dmar_qi_batch_init(&batch, dmar_unit);
+				dmar_invalid_iotlb_range(&batch, did, gpa, size);
+				/* the EPT is already changed, a device may keep a stale translation */
+				if (dmar_qi_batch_submit(&batch) != 0) {
+					pr_fatal("%s: failed to invalidate the IOTLB of domain %hu, [0x%lx, 0x%lx)",
+						__func__, did, gpa, gpa + size);
+				}
+			}
+		}
+	}
+}
+
 void enable_iommu(void)
 {
 	do_action_for_iommus(enable_dmar);
@@ -1329,6 +1593,7 @@ int32_t dmar_assign_irte(const struct intr_source *intr_src, union dmar_ir_entry
 {
 	struct dmar_drhd_rt *dmar_unit;
 	union dmar_ir_entry *ir_table, *ir_entry;
+	struct dmar_qi_batch batch;
 	union pci_bdf sid;
 	uint64_t trigger_mode;
 	int32_t ret = -EINVAL;
@@ -1381,7 +1646,13 @@ int32_t dmar_assign_irte(const struct intr_source *intr_src, union dmar_ir_entry
 				*ir_entry = *irte;
 			}
 			iommu_flush_cache(ir_entry, sizeof(union dmar_ir_entry));
-			dmar_invalid_iec(dmar_unit, *idx_out, 0U, false);
+			dmar_qi_batch_init(&batch, dmar_unit);
+			dmar_invalid_iec(&batch, *idx_out, 0U, false);
+			/* an error here would make the caller fall back to the compatibility format */
+			if (dmar_qi_batch_submit(&batch) != 0) {
+				pr_fatal("%s: failed to invalidate the interrupt entry cache of IRTE %hu",
+					__func__, *idx_out);
+			}
 		}
 		ret = 0;
 	}
@@ -1393,6 +1664,7 @@ void dmar_free_irte(const struct intr_source *intr_src, uint16_t index)
 {
 	struct dmar_drhd_rt *dmar_unit;
 	union dmar_ir_entry *ir_table, *ir_entry;
+	struct dmar_qi_batch batch;
 	union pci_bdf sid;
 
 	if (intr_src->is_msi) {
@@ -1407,7 +1679,13 @@ void dmar_free_irte(const struct intr_source *intr_src, uint16_t index)
 		ir_entry->bits.remap.present = 0x0UL;
 
 		iommu_flush_cache(ir_entry, sizeof(union dmar_ir_entry));
-		dmar_invalid_iec(dmar_unit, index, 0U, false);
+		/*
+		 * The interrupt source is already quiesced, and whoever reuses this IRTE
+		 * invalidates it synchronously after the fenced async invalidation here.
+		 */
+		dmar_qi_batch_init(&batch, dmar_unit);
+		dmar_invalid_iec(&batch, index, 0U, false);
+		dmar_qi_batch_submit_async(&batch);
 
 		if (!is_irte_reserved(dmar_unit, index)) {
 			spinlock_obtain(&dmar_unit->lock);
@@ -1417,3 +1695,19 @@ void dmar_free_irte(const struct intr_source *intr_src, uint16_t index)
 	}
 
 }
+
+int32_t get_iommu_qi_stats(uint32_t dmar_index, struct iommu_qi_stats *stats)
+{
+	struct dmar_drhd_rt *dmar_unit;
+	int32_t ret = -ENODEV;
+
+	if ((platform_dmar_info != NULL) && (dmar_index < platform_dmar_info->drhd_count)) {
+		dmar_unit = &dmar_drhd_units[dmar_index];
+		spinlock_obtain(&(dmar_unit->lock));
+		*stats = dmar_unit->qi_stats;
+		spinlock_release(&(dmar_unit->lock));
+		ret = 0;
+	}
+
+	return ret;
+}
@@ -10,6 +10,7 @@
 #include <boot.h>
 #include <rtl.h>
 #include <logmsg.h>
+#include <ticks.h>
 
 static struct acrn_boot_info acrn_bi = { 0 };
 
@@ -70,6 +71,29 @@ int32_t sanitize_acrn_boot_info(struct acrn_boot_info *abi)
 	return abi_status;
 }
 
+/**
+ * @pre abi != NULL
+ *
+ * The boot loader measures its load times in TSC cycles, so they can only be
+ * printed once the TSC is calibrated.
+ */
+void print_boot_load_times(const struct acrn_boot_info *abi)
+{
+	uint32_t i;
+	const struct abi_load_time *t;
+
+	for (i = 0U; i < abi->load_times_count; i++) {
+		t = &abi->load_times[i];
+		if (t->mod_idx == ABI_LOAD_HV_IMAGE) {
+			pr_acrnlog("Bootloader loaded hv image: 0x%lx bytes in %luus%s", t->size,
+				ticks_to_us(t->tsc_cycles), ((t->flags & ABI_LOAD_VERIFIED) != 0U) ? ", verified" : "");
+		} else {
+			pr_acrnlog("Bootloader loaded module %u: 0x%lx bytes in %luus%s", t->mod_idx, t->size,
+				ticks_to_us(t->tsc_cycles), ((t->flags & ABI_LOAD_VERIFIED) != 0U) ? ", verified" : "");
+		}
+	}
+}
+
 /*
  * @post retval != NULL
  */
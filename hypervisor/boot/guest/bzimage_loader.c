@@ -353,7 +353,8 @@ static void load_bzimage(struct acrn_vm *vm, struct acrn_vcpu *vcpu,
 				(sw_kernel->kernel_size - prot_code_offset) : 0U;
 
 	/* Copy the protected mode part kernel code to its run-time location */
-	(void)copy_to_gpa(vm, (sw_kernel->kernel_src_addr + prot_code_offset), kernel_load_gpa, prot_code_size);
+	(void)copy_to_gpa_parallel(vm, (sw_kernel->kernel_src_addr + prot_code_offset), kernel_load_gpa,
+		prot_code_size, vm->launch_helpers);
 
 	if (vm->sw.ramdisk_info.size > 0U) {
 		/* Use customer specified ramdisk load addr if it is configured in VM configuration,
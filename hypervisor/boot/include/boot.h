@@ -44,6 +44,17 @@ struct abi_mmap {
 	uint32_t		type;
 };
 
+/* Time taken by the boot loader to load the hv image or a module, when it tells */
+#define ABI_LOAD_HV_IMAGE	0xffffffffU	/* mod_idx of the hv image */
+#define ABI_LOAD_VERIFIED	0x1U		/* its digest was checked */
+
+struct abi_load_time {
+	uint32_t		mod_idx;
+	uint32_t		flags;
+	uint64_t		size;
+	uint64_t		tsc_cycles;
+};
+
 struct acrn_boot_info {
 
 	char			protocol_name[MAX_PROTOCOL_NAME_SIZE];
@@ -58,6 +69,9 @@ struct acrn_boot_info {
 
 	const void		*acpi_rsdp_va;
 	struct efi_info		uefi_info;
+
+	uint32_t		load_times_count;
+	struct abi_load_time	load_times[MAX_MODULE_NUM + 1U];
 };
 
 static inline bool boot_from_uefi(struct acrn_boot_info *abi)
@@ -71,6 +85,7 @@ int32_t init_multiboot_info(uint32_t *registers);
 
 void init_acrn_boot_info(uint32_t *registers);
 int32_t sanitize_acrn_boot_info(struct acrn_boot_info *abi);
+void print_boot_load_times(const struct acrn_boot_info *abi);
 struct acrn_boot_info *get_acrn_boot_info(void);
 
 struct abi_module *get_mod_by_tag(const struct acrn_boot_info *abi, const char *tag);
@@ -70,6 +70,34 @@ static void mb2_efimmap_to_abi(struct acrn_boot_info *abi,
 	abi->uefi_info.memmap_hi = (uint32_t)(((uint64_t)mb2_tag_efimmap->efi_mmap) >> 32U);
 }
 
+/**
+ * @pre abi != NULL && mb2_tag_times != NULL
+ */
+static void mb2_load_times_to_abi(struct acrn_boot_info *abi,
+			const struct multiboot2_tag_acrn_load_times *mb2_tag_times)
+{
+	uint32_t i;
+	const struct multiboot2_acrn_load_time *t = mb2_tag_times->entries;
+
+	/* a tag too short for its own header is ignored, its size would wrap around below */
+	if (mb2_tag_times->size < sizeof(struct multiboot2_tag_acrn_load_times)) {
+		abi->load_times_count = 0U;
+	} else {
+		abi->load_times_count = (mb2_tag_times->size - sizeof(struct multiboot2_tag_acrn_load_times)) /
+				sizeof(struct multiboot2_acrn_load_time);
+	}
+	if (abi->load_times_count > (MAX_MODULE_NUM + 1U)) {
+		abi->load_times_count = MAX_MODULE_NUM + 1U;
+	}
+
+	for (i = 0U; i < abi->load_times_count; i++) {
+		abi->load_times[i].mod_idx = (t + i)->mod_idx;
+		abi->load_times[i].flags = (t + i)->flags;
+		abi->load_times[i].size = (t + i)->size;
+		abi->load_times[i].tsc_cycles = (t + i)->tsc_cycles;
+	}
+}
+
 /**
  * @pre abi != NULL
  */
@@ -115,6 +143,9 @@ int32_t multiboot2_to_acrn_bi(struct acrn_boot_info *abi, void *mb2_info)
 		case MULTIBOOT2_TAG_TYPE_EFI_MMAP:
 			mb2_efimmap_to_abi(abi, (const struct multiboot2_tag_efi_mmap *)mb2_tag);
 			break;
+		case MULTIBOOT2_TAG_TYPE_ACRN_LOAD_TIMES:
+			mb2_load_times_to_abi(abi, (const struct multiboot2_tag_acrn_load_times *)mb2_tag);
+			break;
 		default:
 			if (mb2_tag->type > MULTIBOOT2_TAG_TYPE_LOAD_BASE_ADDR) {
 				ret = -EINVAL;
@@ -13,6 +13,7 @@
 #include <profiling.h>
 #include <sprintf.h>
 #include <trace.h>
+#include <vmexit_latency.h>
 #include <logmsg.h>
 
 void vcpu_thread(struct thread_object *obj)
@@ -45,6 +46,7 @@ void vcpu_thread(struct thread_object *obj)
 		profiling_vmenter_handler(vcpu);
 
 		TRACE_2L(TRACE_VM_ENTER, 0UL, 0UL);
+		vmexit_latency_enter(vcpu);
 		ret = run_vcpu(vcpu);
 		if (ret != 0) {
 			pr_fatal("vcpu resume failed");
@@ -54,6 +56,7 @@ void vcpu_thread(struct thread_object *obj)
 			/* Fatal error happened (resume vcpu failed). Stop the vcpu running. */
 			continue;
 		}
+		vmexit_latency_exit(vcpu);
 		TRACE_2L(TRACE_VM_EXIT, vcpu->arch.exit_reason, vcpu_get_rip(vcpu));
 
 		profiling_pre_vmexit_handler(vcpu);
@@ -395,6 +395,192 @@ int32_t hcall_set_vcpu_regs(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm,
 	return ret;
 }
 
+/*
+ * Snapshot and restore are supported for post-launched VMs with an emulated LAPIC,
+ * the vCPUs of a LAPIC passthrough VM can't be stopped by the hypervisor.
+ */
+static bool is_vm_state_accessible(const struct acrn_vm *vm)
+{
+	return (!is_poweroff_vm(vm)) && is_postlaunched_vm(vm) && (!is_lapic_pt_configured(vm));
+}
+
+/**
+ * @brief get vcpu state
+ *
+ * Get the complete architectural state of a vCPU of a paused VM, including
+ * its XSAVE area.
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param2 guest physical address. This gpa points to
+ *              struct acrn_vcpu_state, with vcpu_id set by the caller
+ *
+ * @pre is_service_vm(vcpu->vm)
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_get_vcpu_state(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm,
+		__unused uint64_t param1, uint64_t param2)
+{
+	struct acrn_vm *vm = vcpu->vm;
+	struct acrn_vcpu_state hdr;
+	struct acrn_cpu_state state;
+	struct acrn_vcpu *target_vcpu;
+	int32_t ret = -1;
+
+	if (is_vm_state_accessible(target_vm) && (target_vm->state == VM_PAUSED) &&
+			(copy_from_gpa(vm, &hdr, param2, offsetof(struct acrn_vcpu_state, regs)) == 0) &&
+			(hdr.vcpu_id < target_vm->hw.created_vcpus)) {
+		target_vcpu = vcpu_from_vid(target_vm, hdr.vcpu_id);
+		(void)memset((void *)&state, 0U, sizeof(state));
+		hdr.flags = 0U;
+		if (target_vcpu->launched) {
+			get_vcpu_state(target_vcpu, &state);
+			hdr.flags |= ACRN_VCPU_STATE_LAUNCHED;
+		}
+
+		if ((copy_to_gpa(vm, &hdr, param2, offsetof(struct acrn_vcpu_state, regs)) == 0) &&
+				(copy_to_gpa(vm, &state, param2 + offsetof(struct acrn_vcpu_state, regs),
+					sizeof(state)) == 0) &&
+				(copy_to_gpa(vm, vcpu_xsave_area(target_vcpu), param2 + offsetof(struct acrn_vcpu_state, xsave_area),
+					ACRN_XSAVE_AREA_SIZE) == 0)) {
+			ret = 0;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief set vcpu state
+ *
+ * Set the complete architectural state of a vCPU before the VM is started,
+ * the vCPU resumes from it instead of its reset state. A vCPU without
+ * ACRN_VCPU_STATE_LAUNCHED in the flags keeps waiting for INIT-SIPI.
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param2 guest physical address. This gpa points to
+ *              struct acrn_vcpu_state
+ *
+ * @pre is_service_vm(vcpu->vm)
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_set_vcpu_state(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm,
+		__unused uint64_t param1, uint64_t param2)
+{
+	struct acrn_vm *vm = vcpu->vm;
+	struct acrn_vcpu_state hdr;
+	struct acrn_cpu_state state;
+	struct acrn_vcpu *target_vcpu;
+	int32_t ret = -1;
+
+	if (is_vm_state_accessible(target_vm) && (target_vm->state == VM_CREATED) &&
+			(copy_from_gpa(vm, &hdr, param2, offsetof(struct acrn_vcpu_state, regs)) == 0) &&
+			(hdr.vcpu_id < target_vm->hw.created_vcpus)) {
+		target_vcpu = vcpu_from_vid(target_vm, hdr.vcpu_id);
+		if ((hdr.flags & ACRN_VCPU_STATE_LAUNCHED) == 0U) {
+			ret = 0;
+		} else if ((copy_from_gpa(vm, &state, param2 + offsetof(struct acrn_vcpu_state, regs),
+					sizeof(state)) == 0) &&
+				is_valid_cr0_cr4(state.cr0, state.cr4) &&
+				(copy_from_gpa(vm, vcpu_xsave_area(target_vcpu),
+					param2 + offsetof(struct acrn_vcpu_state, xsave_area), ACRN_XSAVE_AREA_SIZE) == 0)) {
+			ret = set_vcpu_state(target_vcpu, &state);
+		} else {
+			ret = -EINVAL;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief get irqchip state
+ *
+ * Get the state of the vLAPIC of a vCPU, or the vIOAPIC or vPIC of a paused VM.
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param2 guest physical address. This gpa points to
+ *              struct acrn_irqchip_state, with type and vcpu_id set by the caller
+ *
+ * @pre is_service_vm(vcpu->vm)
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_get_irqchip_state(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm,
+		__unused uint64_t param1, uint64_t param2)
+{
+	struct acrn_vm *vm = vcpu->vm;
+	struct acrn_irqchip_state state;
+	int32_t ret = -1;
+
+	if (is_vm_state_accessible(target_vm) && (target_vm->state == VM_PAUSED) &&
+			(copy_from_gpa(vm, &state, param2, sizeof(state)) == 0)) {
+		if (state.type == ACRN_IRQCHIP_VLAPIC) {
+			if (state.vcpu_id < target_vm->hw.created_vcpus) {
+				vlapic_get_state(vcpu_vlapic(vcpu_from_vid(target_vm, state.vcpu_id)), &state.chip.vlapic);
+				ret = 0;
+			}
+		} else if (state.type == ACRN_IRQCHIP_VIOAPIC) {
+			vioapic_get_state(target_vm, &state.chip.vioapic);
+			ret = 0;
+		} else if (state.type == ACRN_IRQCHIP_VPIC) {
+			vpic_get_state(vm_pic(target_vm), state.chip.vpic);
+			ret = 0;
+		} else {
+			pr_err("%s: invalid irqchip type %u", __func__, state.type);
+		}
+
+		if ((ret == 0) && (copy_to_gpa(vm, &state, param2, sizeof(state)) != 0)) {
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief set irqchip state
+ *
+ * Set the state of the vLAPIC of a vCPU, or the vIOAPIC or vPIC of a VM
+ * before it's started.
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param2 guest physical address. This gpa points to
+ *              struct acrn_irqchip_state
+ *
+ * @pre is_service_vm(vcpu->vm)
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_set_irqchip_state(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm,
+		__unused uint64_t param1, uint64_t param2)
+{
+	struct acrn_vm *vm = vcpu->vm;
+	struct acrn_irqchip_state state;
+	int32_t ret = -1;
+
+	if (is_vm_state_accessible(target_vm) && (target_vm->state == VM_CREATED) &&
+			(copy_from_gpa(vm, &state, param2, sizeof(state)) == 0)) {
+		if (state.type == ACRN_IRQCHIP_VLAPIC) {
+			if (state.vcpu_id < target_vm->hw.created_vcpus) {
+				vlapic_set_state(vcpu_vlapic(vcpu_from_vid(target_vm, state.vcpu_id)), &state.chip.vlapic);
+				ret = 0;
+			}
+		} else if (state.type == ACRN_IRQCHIP_VIOAPIC) {
+			vioapic_set_state(target_vm, &state.chip.vioapic);
+			ret = 0;
+		} else if (state.type == ACRN_IRQCHIP_VPIC) {
+			vpic_set_state(vm_pic(target_vm), state.chip.vpic);
+			ret = 0;
+		} else {
+			pr_err("%s: invalid irqchip type %u", __func__, state.type);
+		}
+	}
+
+	return ret;
+}
+
 int32_t hcall_create_vcpu(__unused struct acrn_vcpu *vcpu, __unused struct acrn_vm *target_vm,
 		__unused uint64_t param1, __unused uint64_t param2)
 {
@@ -761,6 +947,57 @@ int32_t hcall_write_protect_page(struct acrn_vcpu *vcpu, struct acrn_vm *target_
 	return ret;
 }
 
+/**
+ * @brief start or stop the dirty page logging of a VM
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param2 1 to start the logging, 0 to stop it
+ *
+ * @pre is_service_vm(vcpu->vm)
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_set_dirty_log(__unused struct acrn_vcpu *vcpu, struct acrn_vm *target_vm,
+		__unused uint64_t param1, uint64_t param2)
+{
+	int32_t ret = -1;
+
+	if (is_postlaunched_vm(target_vm) && !is_poweroff_vm(target_vm) && (param2 <= 1UL)) {
+		ret = ept_set_dirty_log(target_vm, (param2 == 1UL));
+	}
+
+	return ret;
+}
+
+/**
+ * @brief get and clear the dirty pages of a VM
+ *
+ * Report the pages of a guest physical address range written since the last
+ * call, the dirty page logging of the VM must be started.
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param2 guest physical address. This gpa points to
+ *              struct acrn_dirty_bitmap
+ *
+ * @pre is_service_vm(vcpu->vm)
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_get_dirty_bitmap(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm,
+		__unused uint64_t param1, uint64_t param2)
+{
+	struct acrn_vm *vm = vcpu->vm;
+	struct acrn_dirty_bitmap param;
+	int32_t ret = -1;
+
+	if (is_postlaunched_vm(target_vm) && !is_poweroff_vm(target_vm) &&
+			(copy_from_gpa(vm, &param, param2, sizeof(param)) == 0)) {
+		ret = ept_get_dirty_bitmap(target_vm, vm, &param);
+	}
+
+	return ret;
+}
+
 /**
  * @brief translate guest physical address to host physical address
  *
@@ -1131,21 +1368,33 @@ int32_t hcall_vm_intr_monitor(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm,
 				switch (intr_hdr->cmd) {
 				case INTR_CMD_GET_DATA:
 					intr_hdr->buf_cnt = ptirq_get_intr_data(target_vm,
-						intr_hdr->buffer, intr_hdr->buf_cnt);
+						intr_hdr->buffer, intr_hdr->buf_cnt, false);
+					status = 0;
+					break;
+
+				case INTR_CMD_GET_STORM_DATA:
+					intr_hdr->buf_cnt = ptirq_get_intr_data(target_vm,
+						intr_hdr->buffer, intr_hdr->buf_cnt, true);
+					status = 0;
 					break;
 
 				case INTR_CMD_DELAY_INT:
 					/* buffer[0] is the delay time (in MS), if 0 to cancel delay */
 					target_vm->intr_inject_delay_delta =
 						intr_hdr->buffer[0] * TICKS_PER_MS;
+					status = 0;
+					break;
+
+				case INTR_CMD_SET_ADAPTIVE:
+					status = ptirq_set_storm_adaptive(target_vm, (uint32_t)intr_hdr->buffer[0],
+						(uint32_t)intr_hdr->buffer[1]);
 					break;
 
 				default:
 					/* if cmd wrong it goes here should not happen */
+					status = 0;
 					break;
 				}
-
-				status = 0;
 			}
 			clac();
 		}
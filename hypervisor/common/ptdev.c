@@ -13,18 +13,25 @@
 #include <logmsg.h>
 #include <asm/vtd.h>
 #include <ticks.h>
+#include <errno.h>
 
-#define PTIRQ_ENTRY_HASHBITS	9U
-#define PTIRQ_ENTRY_HASHSIZE	(1U << PTIRQ_ENTRY_HASHBITS)
+#define PTIRQ_PHYS_HASHBITS	10U
+#define PTIRQ_PHYS_HASHSIZE	(1U << PTIRQ_PHYS_HASHBITS)
+#define PTIRQ_VM_HASHBITS_MIN	4U
 
 #define PTIRQ_BITMAP_ARRAY_SIZE	INT_DIV_ROUNDUP(CONFIG_MAX_PT_IRQ_ENTRIES, 64U)
+
+/* adaptive storm mitigation: the rate window and the first delay, doubled for every storm window */
+#define PTIRQ_STORM_WINDOW_US		1000U
+#define PTIRQ_STORM_BASE_DELAY_US	50U
 struct ptirq_remapping_info ptirq_entries[CONFIG_MAX_PT_IRQ_ENTRIES];
 static uint64_t ptirq_entry_bitmaps[PTIRQ_BITMAP_ARRAY_SIZE];
 spinlock_t ptdev_lock = { .head = 0U, .tail = 0U, };
 
-static struct ptirq_entry_head {
-	struct hlist_head list;
-} ptirq_entry_heads[PTIRQ_ENTRY_HASHSIZE];
+/* active entries hashed by physical SID, the virtual SIDs are hashed per VM */
+static struct hlist_head ptirq_phys_heads[PTIRQ_PHYS_HASHSIZE];
+/* active entries indexed by their allocated physical irq */
+static struct ptirq_remapping_info *ptirq_irq_entries[NR_IRQS];
 
 static inline uint16_t ptirq_alloc_entry_id(void)
 {
@@ -40,35 +47,179 @@ static inline uint16_t ptirq_alloc_entry_id(void)
 	return (id < CONFIG_MAX_PT_IRQ_ENTRIES) ? id: INVALID_PTDEV_ENTRY_ID;
 }
 
-struct ptirq_remapping_info *find_ptirq_entry(uint32_t intr_type,
-		const union source_id *sid, const struct acrn_vm *vm)
+static struct ptirq_remapping_info *find_phys_entry(uint32_t intr_type, const union source_id *sid)
 {
 	struct hlist_node *p;
 	struct ptirq_remapping_info *n, *entry = NULL;
-	uint64_t key = hash64(sid->value, PTIRQ_ENTRY_HASHBITS);
-	struct ptirq_entry_head *b = &ptirq_entry_heads[key];
+	uint64_t key = hash64(sid->value, PTIRQ_PHYS_HASHBITS);
 
-	hlist_for_each(p, &b->list) {
-		if (vm == NULL) {
-			n = hlist_entry(p, struct ptirq_remapping_info, phys_link);
-		} else {
-			n = hlist_entry(p, struct ptirq_remapping_info, virt_link);
+	hlist_for_each(p, &ptirq_phys_heads[key]) {
+		n = hlist_entry(p, struct ptirq_remapping_info, phys_link);
+		if (is_entry_active(n) && (intr_type == n->intr_type) && (sid->value == n->phys_sid.value)) {
+			entry = n;
+			break;
 		}
+	}
 
-		if (is_entry_active(n)) {
-			if ((intr_type == n->intr_type) &&
-				((vm == NULL) ?
-				(sid->value == n->phys_sid.value) :
-				((vm == n->vm) && (sid->value == n->virt_sid.value)))) {
-				entry = n;
-				break;
+	return entry;
+}
+
+/*
+ * Lookups by virtual SID run without ptdev_lock, e.g. on vIOAPIC EOI. They
+ * retry if the hash has been resized meanwhile, like a seqlock reader. The
+ * chain walk is bounded because a resize may move the node being visited.
+ */
+static struct ptirq_remapping_info *find_virt_entry(uint32_t intr_type,
+		const union source_id *sid, const struct acrn_vm *vm)
+{
+	const struct hlist_node *p;
+	struct ptirq_remapping_info *n, *entry;
+	uint32_t seq, walked;
+
+	do {
+		seq = vm->ptirq_hash_seq;
+		cpu_compiler_barrier();
+		entry = NULL;
+		if ((seq & 1U) == 0U) {
+			p = vm->ptirq_virt_heads[hash64(sid->value, vm->ptirq_hash_bits)].first;
+			for (walked = 0U; (p != NULL) && (walked < CONFIG_MAX_PT_IRQ_ENTRIES); walked++) {
+				n = hlist_entry(p, struct ptirq_remapping_info, virt_link);
+				if (is_entry_active(n) && (intr_type == n->intr_type) &&
+						(vm == n->vm) && (sid->value == n->virt_sid.value)) {
+					entry = n;
+					break;
+				}
+				p = p->next;
 			}
 		}
+		cpu_compiler_barrier();
+	} while (((seq & 1U) != 0U) || (seq != vm->ptirq_hash_seq));
+
+	return entry;
+}
+
+struct ptirq_remapping_info *find_ptirq_entry(uint32_t intr_type,
+		const union source_id *sid, const struct acrn_vm *vm)
+{
+	struct ptirq_remapping_info *entry;
+
+	if (vm == NULL) {
+		entry = find_phys_entry(intr_type, sid);
+	} else {
+		entry = find_virt_entry(intr_type, sid, vm);
 	}
 
 	return entry;
 }
 
+struct ptirq_remapping_info *ptirq_find_entry_by_irq(uint32_t irq)
+{
+	return (irq < NR_IRQS) ? ptirq_irq_entries[irq] : NULL;
+}
+
+void ptirq_init_vm_hash(struct acrn_vm *vm)
+{
+	(void)memset(vm->ptirq_virt_heads, 0U, sizeof(vm->ptirq_virt_heads));
+	vm->ptirq_hash_bits = PTIRQ_VM_HASHBITS_MIN;
+	vm->ptirq_hash_num = 0U;
+}
+
+/*
+ * Double the number of buckets in use: unlink all the entries, then hash
+ * them again with the new size.
+ *
+ * @pre ptdev_lock is held
+ */
+static void ptirq_resize_vm_hash(struct acrn_vm *vm, uint16_t bits)
+{
+	struct hlist_head moved = { .first = NULL };
+	struct hlist_node *p;
+	struct ptirq_remapping_info *entry;
+	uint32_t i;
+
+	vm->ptirq_hash_seq++;
+	cpu_compiler_barrier();
+
+	for (i = 0U; i < (1U << vm->ptirq_hash_bits); i++) {
+		while (vm->ptirq_virt_heads[i].first != NULL) {
+			p = vm->ptirq_virt_heads[i].first;
+			hlist_del(p);
+			hlist_add_head(p, &moved);
+		}
+	}
+
+	vm->ptirq_hash_bits = bits;
+	while (moved.first != NULL) {
+		p = moved.first;
+		hlist_del(p);
+		entry = hlist_entry(p, struct ptirq_remapping_info, virt_link);
+		hlist_add_head(p, &vm->ptirq_virt_heads[hash64(entry->virt_sid.value, bits)]);
+	}
+
+	cpu_compiler_barrier();
+	vm->ptirq_hash_seq++;
+}
+
+/* @pre ptdev_lock is held */
+static void ptirq_hash_add_virt(struct ptirq_remapping_info *entry)
+{
+	struct acrn_vm *vm = entry->vm;
+
+	if ((vm->ptirq_hash_num >= (1U << vm->ptirq_hash_bits)) && (vm->ptirq_hash_bits < PTIRQ_VM_HASHBITS_MAX)) {
+		ptirq_resize_vm_hash(vm, vm->ptirq_hash_bits + 1U);
+	}
+	hlist_add_head(&entry->virt_link, &vm->ptirq_virt_heads[hash64(entry->virt_sid.value, vm->ptirq_hash_bits)]);
+	vm->ptirq_hash_num++;
+}
+
+/* @pre ptdev_lock is held */
+static void ptirq_hash_del_virt(struct ptirq_remapping_info *entry)
+{
+	hlist_del(&entry->virt_link);
+	entry->vm->ptirq_hash_num--;
+}
+
+void ptirq_change_entry_owner(struct ptirq_remapping_info *entry, struct acrn_vm *vm,
+		const union source_id *virt_sid)
+{
+	ptirq_hash_del_virt(entry);
+	entry->vm = vm;
+	entry->virt_sid.value = virt_sid->value;
+	ptirq_hash_add_virt(entry);
+}
+
+static void ptirq_get_chain_stats(const struct hlist_head *heads, uint32_t nr_heads,
+		struct ptirq_hash_stats *stats)
+{
+	const struct hlist_node *p;
+	uint32_t i, len;
+
+	stats->buckets = nr_heads;
+	stats->used_buckets = 0U;
+	stats->entries = 0U;
+	stats->max_chain = 0U;
+	for (i = 0U; i < nr_heads; i++) {
+		len = 0U;
+		hlist_for_each(p, &heads[i]) {
+			len++;
+		}
+		if (len != 0U) {
+			stats->used_buckets++;
+			stats->entries += len;
+			stats->max_chain = max(stats->max_chain, len);
+		}
+	}
+}
+
+void ptirq_get_hash_stats(const struct acrn_vm *vm, struct ptirq_hash_stats *stats)
+{
+	if (vm == NULL) {
+		ptirq_get_chain_stats(ptirq_phys_heads, PTIRQ_PHYS_HASHSIZE, stats);
+	} else {
+		ptirq_get_chain_stats(vm->ptirq_virt_heads, 1U << vm->ptirq_hash_bits, stats);
+	}
+}
+
 static void ptirq_enqueue_softirq(struct ptirq_remapping_info *entry)
 {
 	uint64_t rflags;
@@ -91,30 +242,31 @@ static void ptirq_intr_delay_callback(void *data)
 	ptirq_enqueue_softirq(entry);
 }
 
-struct ptirq_remapping_info *ptirq_dequeue_softirq(uint16_t pcpu_id)
+uint32_t ptirq_dequeue_softirq(uint16_t pcpu_id, struct ptirq_remapping_info **entries, uint32_t max_num)
 {
 	uint64_t rflags;
-	struct ptirq_remapping_info *entry = NULL;
+	struct ptirq_remapping_info *entry;
+	uint32_t num = 0U;
 
 	CPU_INT_ALL_DISABLE(&rflags);
 
-	while (!list_empty(&get_cpu_var(softirq_dev_entry_list))) {
+	while (!list_empty(&per_cpu(softirq_dev_entry_list, pcpu_id)) && (num < max_num)) {
 		entry = get_first_item(&per_cpu(softirq_dev_entry_list, pcpu_id), struct ptirq_remapping_info, softirq_node);
 
 		list_del_init(&entry->softirq_node);
 
 		/* if Service VM, just dequeue, if User VM, check delay timer */
 		if (is_service_vm(entry->vm) || timer_expired(&entry->intr_delay_timer, cpu_ticks(), NULL)) {
-			break;
+			entries[num] = entry;
+			num++;
 		} else {
 			/* add it into timer list; dequeue next one */
 			(void)add_timer(&entry->intr_delay_timer);
-			entry = NULL;
 		}
 	}
 
 	CPU_INT_ALL_RESTORE(rflags);
-	return entry;
+	return num;
 }
 
 struct ptirq_remapping_info *ptirq_alloc_entry(struct acrn_vm *vm, uint32_t intr_type)
@@ -157,11 +309,51 @@ void ptirq_release_entry(struct ptirq_remapping_info *entry)
 	(void)memset((void *)entry, 0U, sizeof(struct ptirq_remapping_info));
 }
 
+/*
+ * Update the interrupt rate of the entry, double its injection delay at the end of each
+ * window above the threshold and halve it for each window below, idle windows included.
+ *
+ * interrupt context
+ */
+static void ptirq_update_storm_delay(struct ptirq_remapping_info *entry)
+{
+	const struct acrn_vm *vm = entry->vm;
+	uint64_t now = cpu_ticks();
+	uint64_t window = us_to_ticks(PTIRQ_STORM_WINDOW_US);
+	uint64_t elapsed = (now - entry->intr_window_start) / window;
+
+	if (elapsed != 0UL) {
+		if (entry->intr_window_count > vm->intr_storm_threshold) {
+			entry->intr_storm_count++;
+			if (entry->intr_storm_delay == 0UL) {
+				entry->intr_storm_delay = us_to_ticks(PTIRQ_STORM_BASE_DELAY_US);
+			} else {
+				entry->intr_storm_delay <<= 1U;
+			}
+			entry->intr_storm_delay = min(entry->intr_storm_delay, vm->intr_storm_max_delay);
+			/* the storm window itself is not a quiet one */
+			elapsed--;
+		}
+
+		if (elapsed != 0UL) {
+			entry->intr_storm_delay = (elapsed < 64UL) ? (entry->intr_storm_delay >> elapsed) : 0UL;
+			if (entry->intr_storm_delay < us_to_ticks(PTIRQ_STORM_BASE_DELAY_US)) {
+				entry->intr_storm_delay = 0UL;
+			}
+		}
+
+		entry->intr_window_start = now;
+		entry->intr_window_count = 0U;
+	}
+	entry->intr_window_count++;
+}
+
 /* interrupt context */
 static void ptirq_interrupt_handler(__unused uint32_t irq, void *data)
 {
 	struct ptirq_remapping_info *entry = (struct ptirq_remapping_info *) data;
 	bool to_enqueue = true;
+	uint64_t delay;
 
 	/*
 	 * "interrupt storm" detection & delay intr injection just for User VM
@@ -170,15 +362,21 @@ static void ptirq_interrupt_handler(__unused uint32_t irq, void *data)
 	if (!is_service_vm(entry->vm)) {
 		entry->intr_count++;
 
-		/* if delta > 0, set the delay TSC, dequeue to handle */
-		if (entry->vm->intr_inject_delay_delta > 0UL) {
+		delay = entry->vm->intr_inject_delay_delta;
+		/* never enabled for RT VMs */
+		if (entry->vm->intr_storm_threshold != 0U) {
+			ptirq_update_storm_delay(entry);
+			delay = max(delay, entry->intr_storm_delay);
+		}
+
+		/* if delay > 0, set the delay TSC, dequeue to handle */
+		if (delay > 0UL) {
 
 			/* if the timer started (entry is in timer-list), not need enqueue again */
 			if (timer_is_started(&entry->intr_delay_timer)) {
 				to_enqueue = false;
 			} else {
-				update_timer(&entry->intr_delay_timer,
-					     cpu_ticks() + entry->vm->intr_inject_delay_delta, 0UL);
+				update_timer(&entry->intr_delay_timer, cpu_ticks() + delay, 0UL);
 			}
 		} else {
 			update_timer(&entry->intr_delay_timer, 0UL, 0UL);
@@ -205,10 +403,10 @@ int32_t ptirq_activate_entry(struct ptirq_remapping_info *entry, uint32_t phys_i
 		entry->allocated_pirq = (uint32_t)retval;
 		entry->active = true;
 
-		key = hash64(entry->phys_sid.value, PTIRQ_ENTRY_HASHBITS);
-		hlist_add_head(&entry->phys_link, &(ptirq_entry_heads[key].list));
-		key = hash64(entry->virt_sid.value, PTIRQ_ENTRY_HASHBITS);
-		hlist_add_head(&entry->virt_link, &(ptirq_entry_heads[key].list));
+		key = hash64(entry->phys_sid.value, PTIRQ_PHYS_HASHBITS);
+		hlist_add_head(&entry->phys_link, &ptirq_phys_heads[key]);
+		ptirq_hash_add_virt(entry);
+		ptirq_irq_entries[entry->allocated_pirq] = entry;
 	}
 
 	return retval;
@@ -217,7 +415,8 @@ int32_t ptirq_activate_entry(struct ptirq_remapping_info *entry, uint32_t phys_i
 void ptirq_deactivate_entry(struct ptirq_remapping_info *entry)
 {
 	hlist_del(&entry->phys_link);
-	hlist_del(&entry->virt_link);
+	ptirq_hash_del_virt(entry);
+	ptirq_irq_entries[entry->allocated_pirq] = NULL;
 	entry->active = false;
 	free_irq(entry->allocated_pirq);
 }
@@ -251,13 +450,15 @@ void ptdev_release_all_entries(const struct acrn_vm *vm)
 
 }
 
-uint32_t ptirq_get_intr_data(const struct acrn_vm *target_vm, uint64_t *buffer, uint32_t buffer_cnt)
+uint32_t ptirq_get_intr_data(const struct acrn_vm *target_vm, uint64_t *buffer, uint32_t buffer_cnt,
+		bool storm_data)
 {
 	uint32_t index = 0U;
+	uint32_t stride = storm_data ? 4U : 2U;
 	uint16_t i;
 	struct ptirq_remapping_info *entry;
 
-	for (i = 0U; i < CONFIG_MAX_PT_IRQ_ENTRIES; i++) {
+	for (i = 0U; (i < CONFIG_MAX_PT_IRQ_ENTRIES) && ((index + stride) <= buffer_cnt); i++) {
 		entry = &ptirq_entries[i];
 		if (!is_entry_active(entry)) {
 			continue;
@@ -265,13 +466,29 @@ uint32_t ptirq_get_intr_data(const struct acrn_vm *target_vm, uint64_t *buffer,
 		if (entry->vm == target_vm) {
 			buffer[index] = entry->allocated_pirq;
 			buffer[index + 1U] = entry->intr_count;
-
-			index += 2U;
-			if (index > (buffer_cnt - 2U)) {
-				break;
+			if (storm_data) {
+				buffer[index + 2U] = entry->intr_storm_count;
+				buffer[index + 3U] = (target_vm->intr_storm_threshold != 0U) ?
+						ticks_to_us(entry->intr_storm_delay) : 0UL;
 			}
+
+			index += stride;
 		}
 	}
 
 	return index;
 }
+
+int32_t ptirq_set_storm_adaptive(struct acrn_vm *vm, uint32_t threshold, uint32_t max_delay_us)
+{
+	int32_t ret = 0;
+
+	if (is_rt_vm(vm)) {
+		ret = -EINVAL;
+	} else {
+		vm->intr_storm_max_delay = us_to_ticks(max_delay_us);
+		vm->intr_storm_threshold = threshold;
+	}
+
+	return ret;
+}
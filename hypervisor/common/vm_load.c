@@ -15,7 +15,8 @@
 void load_sw_module(struct acrn_vm *vm, struct sw_module_info *sw_module)
 {
 	if ((sw_module->size != 0) && (sw_module->load_addr != NULL)) {
-		(void)copy_to_gpa(vm, sw_module->src_addr, (uint64_t)sw_module->load_addr, sw_module->size);
+		(void)copy_to_gpa_parallel(vm, sw_module->src_addr, (uint64_t)sw_module->load_addr,
+			sw_module->size, vm->launch_helpers);
 	}
 }
 
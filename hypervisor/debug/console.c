@@ -23,6 +23,7 @@ struct hv_timer console_timer;
 #define CONSOLE_KICK_TIMER_TIMEOUT  40UL /* timeout is 40ms*/
 /* Switching key combinations for shell and uart console */
 #define GUEST_CONSOLE_TO_HV_SWITCH_KEY      0       /* CTRL + SPACE */
+#define CONSOLE_RX_BATCH		16U	/* max chars moved to the vuart per kick */
 uint16_t console_vmid = ACRN_INVALID_VMID;
 
 static void parse_hvdbg_cmdline(void)
@@ -92,21 +93,29 @@ struct acrn_vuart *vm_console_vuart(struct acrn_vm *vm)
  */
 static void vuart_console_rx_chars(struct acrn_vuart *vu)
 {
-	char ch = -1;
-
-	/* Get data from physical uart */
-	ch = uart16550_getc();
-
-	if (ch == GUEST_CONSOLE_TO_HV_SWITCH_KEY) {
-		/* Switch the console */
-		console_vmid = ACRN_INVALID_VMID;
-		printf("\r\n\r\n ---Entering ACRN SHELL---\r\n");
-	}
-	if (ch != -1) {
-		vuart_putchar(vu, ch);
-		vuart_toggle_intr(vu);
+	char buf[CONSOLE_RX_BATCH];
+	uint32_t num = 0U;
+	char ch;
+
+	/* Drain the available data from physical uart */
+	while (num < CONSOLE_RX_BATCH) {
+		ch = uart16550_getc();
+		if (ch == -1) {
+			break;
+		}
+		buf[num] = ch;
+		num++;
+		if (ch == GUEST_CONSOLE_TO_HV_SWITCH_KEY) {
+			/* Switch the console */
+			console_vmid = ACRN_INVALID_VMID;
+			printf("\r\n\r\n ---Entering ACRN SHELL---\r\n");
+			break;
+		}
 	}
 
+	if (num > 0U) {
+		vuart_putchars(vu, buf, num);
+	}
 }
 
 /**
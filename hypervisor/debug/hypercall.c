@@ -10,7 +10,9 @@
 #include <sbuf.h>
 #include <hypercall.h>
 #include <npk_log.h>
+#include <vmexit_latency.h>
 #include <asm/guest/vm.h>
+#include <asm/guest/ept.h>
 #include <logmsg.h>
 
 #ifdef PROFILING_ON
@@ -146,3 +148,55 @@ int32_t hcall_get_hw_info(struct acrn_vcpu *vcpu, __unused struct acrn_vm *targe
 	hw_info.cpu_num = get_pcpu_nums();
 	return copy_to_gpa(vcpu->vm, &hw_info, param1, sizeof(hw_info));
 }
+
+/**
+ * @brief Get the VM exit latency histogram of one exit reason of one vCPU
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param2 guest physical address. This gpa points to
+ *              struct acrn_vmexit_latency
+ *
+ * @pre is_service_vm(vcpu->vm)
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_get_vmexit_latency(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm,
+		__unused uint64_t param1, uint64_t param2)
+{
+	struct acrn_vm *vm = vcpu->vm;
+	struct acrn_vmexit_latency latency;
+	int32_t ret = -EINVAL;
+
+	if (copy_from_gpa(vm, &latency, param2, sizeof(latency)) == 0) {
+		if (get_vmexit_latency(target_vm->vm_id, &latency) == 0) {
+			ret = copy_to_gpa(vm, &latency, param2, sizeof(latency));
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Get the number of the pages of each size in the EPT of a VM
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param2 guest physical address. This gpa points to
+ *              struct acrn_ept_page_sizes
+ *
+ * @pre is_service_vm(vcpu->vm)
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_get_ept_page_sizes(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm,
+		__unused uint64_t param1, uint64_t param2)
+{
+	struct acrn_ept_page_sizes sizes;
+	int32_t ret = -EINVAL;
+
+	if (!is_poweroff_vm(target_vm)) {
+		ept_get_page_sizes(target_vm, &sizes);
+		ret = copy_to_gpa(vcpu->vm, &sizes, param2, sizeof(sizes));
+	}
+
+	return ret;
+}
@@ -21,7 +21,12 @@
 #include <version.h>
 #include <shell.h>
 #include <asm/guest/vmcs.h>
+#include <asm/guest/vmexit.h>
+#include <asm/guest/ept.h>
 #include <asm/host_pm.h>
+#include <vmexit_latency.h>
+#include <asm/vtd.h>
+#include <ticks.h>
 
 #define TEMP_STR_SIZE		60U
 #define MAX_STR_SIZE		256U
@@ -38,13 +43,19 @@ static char shell_log_buf[SHELL_LOG_BUF_SIZE];
 static int32_t shell_cmd_help(__unused int32_t argc, __unused char **argv);
 static int32_t shell_version(__unused int32_t argc, __unused char **argv);
 static int32_t shell_list_vm(__unused int32_t argc, __unused char **argv);
+static int32_t shell_show_vm_launch(__unused int32_t argc, __unused char **argv);
 static int32_t shell_list_vcpu(__unused int32_t argc, __unused char **argv);
 static int32_t shell_vcpu_dumpreg(int32_t argc, char **argv);
 static int32_t shell_dump_host_mem(int32_t argc, char **argv);
 static int32_t shell_dump_guest_mem(int32_t argc, char **argv);
 static int32_t shell_to_vm_console(int32_t argc, char **argv);
 static int32_t shell_show_cpu_int(__unused int32_t argc, __unused char **argv);
+static int32_t shell_show_ctx_switch(__unused int32_t argc, __unused char **argv);
+static int32_t shell_show_vmexit_latency(int32_t argc, char **argv);
+static int32_t shell_show_ept_page_sizes(int32_t argc, char **argv);
+static int32_t shell_show_iommu_qi(__unused int32_t argc, __unused char **argv);
 static int32_t shell_show_ptdev_info(__unused int32_t argc, __unused char **argv);
+static int32_t shell_show_ptdev_stat(__unused int32_t argc, __unused char **argv);
 static int32_t shell_show_vioapic_info(int32_t argc, char **argv);
 static int32_t shell_show_ioapic_info(__unused int32_t argc, __unused char **argv);
 static int32_t shell_loglevel(int32_t argc, char **argv);
@@ -72,6 +83,12 @@ static struct shell_cmd shell_cmds[] = {
 		.help_str	= SHELL_CMD_VM_LIST_HELP,
 		.fcn		= shell_list_vm,
 	},
+	{
+		.str		= SHELL_CMD_VM_LAUNCH,
+		.cmd_param	= SHELL_CMD_VM_LAUNCH_PARAM,
+		.help_str	= SHELL_CMD_VM_LAUNCH_HELP,
+		.fcn		= shell_show_vm_launch,
+	},
 	{
 		.str		= SHELL_CMD_VCPU_LIST,
 		.cmd_param	= SHELL_CMD_VCPU_LIST_PARAM,
@@ -108,12 +125,42 @@ static struct shell_cmd shell_cmds[] = {
 		.help_str	= SHELL_CMD_INTERRUPT_HELP,
 		.fcn		= shell_show_cpu_int,
 	},
+	{
+		.str		= SHELL_CMD_CTX_SWITCH,
+		.cmd_param	= SHELL_CMD_CTX_SWITCH_PARAM,
+		.help_str	= SHELL_CMD_CTX_SWITCH_HELP,
+		.fcn		= shell_show_ctx_switch,
+	},
+	{
+		.str		= SHELL_CMD_VMEXIT_LAT,
+		.cmd_param	= SHELL_CMD_VMEXIT_LAT_PARAM,
+		.help_str	= SHELL_CMD_VMEXIT_LAT_HELP,
+		.fcn		= shell_show_vmexit_latency,
+	},
+	{
+		.str		= SHELL_CMD_EPT_PGSIZE,
+		.cmd_param	= SHELL_CMD_EPT_PGSIZE_PARAM,
+		.help_str	= SHELL_CMD_EPT_PGSIZE_HELP,
+		.fcn		= shell_show_ept_page_sizes,
+	},
+	{
+		.str		= SHELL_CMD_IOMMU_QI,
+		.cmd_param	= SHELL_CMD_IOMMU_QI_PARAM,
+		.help_str	= SHELL_CMD_IOMMU_QI_HELP,
+		.fcn		= shell_show_iommu_qi,
+	},
 	{
 		.str		= SHELL_CMD_PTDEV,
 		.cmd_param	= SHELL_CMD_PTDEV_PARAM,
 		.help_str	= SHELL_CMD_PTDEV_HELP,
 		.fcn		= shell_show_ptdev_info,
 	},
+	{
+		.str		= SHELL_CMD_PTDEV_STAT,
+		.cmd_param	= SHELL_CMD_PTDEV_STAT_PARAM,
+		.help_str	= SHELL_CMD_PTDEV_STAT_HELP,
+		.fcn		= shell_show_ptdev_stat,
+	},
 	{
 		.str		= SHELL_CMD_VIOAPIC,
 		.cmd_param	= SHELL_CMD_VIOAPIC_PARAM,
@@ -625,6 +672,38 @@ static int32_t shell_list_vm(__unused int32_t argc, __unused char **argv)
 	return 0;
 }
 
+static int32_t shell_show_vm_launch(__unused int32_t argc, __unused char **argv)
+{
+	char temp_str[MAX_STR_SIZE];
+	struct acrn_vm *vm;
+	uint16_t vm_id;
+	uint64_t begin;
+
+	shell_puts("\r\nVM_ID   BEGIN(us)       CREATE(us)  LOAD(us)    START(us)"
+		   "\r\n=====   =============   ==========  ==========  ==========\r\n");
+
+	for (vm_id = 0U; vm_id < CONFIG_MAX_VM_NUM; vm_id++) {
+		vm = get_vm_from_vmid(vm_id);
+		begin = vm->launch_tsc[VM_LAUNCH_BEGIN];
+		/* Only the VMs launched by the hypervisor itself are recorded */
+		if (begin == 0UL) {
+			continue;
+		}
+
+		snprintf(temp_str, MAX_STR_SIZE, "  %-3d   %-13lu   %-10lu  %-10lu  %-10lu\r\n", vm_id,
+			ticks_to_us(begin),
+			(vm->launch_tsc[VM_LAUNCH_CREATED] >= begin) ?
+				ticks_to_us(vm->launch_tsc[VM_LAUNCH_CREATED] - begin) : 0UL,
+			(vm->launch_tsc[VM_LAUNCH_LOADED] >= begin) ?
+				ticks_to_us(vm->launch_tsc[VM_LAUNCH_LOADED] - begin) : 0UL,
+			(vm->launch_tsc[VM_LAUNCH_STARTED] >= begin) ?
+				ticks_to_us(vm->launch_tsc[VM_LAUNCH_STARTED] - begin) : 0UL);
+		shell_puts(temp_str);
+	}
+
+	return 0;
+}
+
 static int32_t shell_list_vcpu(__unused int32_t argc, __unused char **argv)
 {
 	char temp_str[MAX_STR_SIZE];
@@ -1048,6 +1127,148 @@ static int32_t shell_show_cpu_int(__unused int32_t argc, __unused char **argv)
 	return 0;
 }
 
+static int32_t shell_show_ctx_switch(__unused int32_t argc, __unused char **argv)
+{
+	char temp_str[MAX_STR_SIZE];
+	uint16_t pcpu_id, pcpu_nums = get_pcpu_nums();
+	uint64_t switches, lazy, avg_cycles;
+	struct acrn_vcpu *owner;
+
+	shell_puts("\r\nCPU\tSWITCHES\tLAZY\t\tAVG CYCLES\tOWNER\r\n");
+	shell_puts("===\t========\t====\t\t==========\t=====\r\n");
+	for (pcpu_id = 0U; pcpu_id < pcpu_nums; pcpu_id++) {
+		switches = per_cpu(ext_ctx_switch_count, pcpu_id);
+		lazy = per_cpu(ext_ctx_lazy_count, pcpu_id);
+		avg_cycles = ((switches + lazy) != 0UL) ? (per_cpu(ext_ctx_switch_tsc, pcpu_id) / (switches + lazy)) : 0UL;
+		owner = per_cpu(whose_ext_ctx, pcpu_id);
+		if (owner != NULL) {
+			snprintf(temp_str, MAX_STR_SIZE, "%hu\t%-16lu%-16lu%-16luvm%hu:vcpu%hu\r\n", pcpu_id,
+				switches, lazy, avg_cycles, owner->vm->vm_id, owner->vcpu_id);
+		} else {
+			snprintf(temp_str, MAX_STR_SIZE, "%hu\t%-16lu%-16lu%-16lu-\r\n", pcpu_id,
+				switches, lazy, avg_cycles);
+		}
+		shell_puts(temp_str);
+	}
+
+	return 0;
+}
+
+/* Upper bound in TSC cycles of the first bucket reaching permille of the VM exits, 0 for no upper bound */
+static uint64_t vmexit_latency_percentile(const struct acrn_vmexit_latency *latency, uint64_t permille)
+{
+	uint32_t i;
+	uint64_t sum = 0UL, bound = 0UL;
+
+	for (i = 0U; i < (ACRN_VMEXIT_LATENCY_BUCKETS - 1U); i++) {
+		sum += latency->buckets[i];
+		if ((sum * 1000UL) >= (latency->count * permille)) {
+			bound = 1UL << (ACRN_VMEXIT_LATENCY_SHIFT + i);
+			break;
+		}
+	}
+
+	return bound;
+}
+
+static int32_t shell_show_vmexit_latency(int32_t argc, char **argv)
+{
+	char temp_str[MAX_STR_SIZE];
+	uint16_t vm_id;
+	uint16_t vcpu_id;
+	uint16_t reason;
+	int32_t ret;
+	struct acrn_vm *vm;
+	struct acrn_vmexit_latency latency;
+
+	/* User input invalidation */
+	if (argc != 2) {
+		return -EINVAL;
+	}
+	ret = strtol_deci(argv[1]);
+	if (ret < 0) {
+		return -EINVAL;
+	}
+	vm_id = sanitize_vmid((uint16_t)ret);
+	vm = get_vm_from_vmid(vm_id);
+	if (is_poweroff_vm(vm)) {
+		shell_puts("No vm found in the input <vm_id>\r\n");
+		return -EINVAL;
+	}
+
+	shell_puts("\r\nVCPU\tREASON\tCOUNT\t\tAVG CYCLES\tP50 <\t\tP99 <\r\n");
+	shell_puts("====\t======\t=====\t\t==========\t=====\t\t=====\r\n");
+	for (vcpu_id = 0U; vcpu_id < vm->hw.created_vcpus; vcpu_id++) {
+		for (reason = 0U; reason < NR_VMX_EXIT_REASONS; reason++) {
+			latency.vcpu_id = vcpu_id;
+			latency.exit_reason = reason;
+			if ((get_vmexit_latency(vm_id, &latency) != 0) || (latency.count == 0UL)) {
+				continue;
+			}
+			/* 0 means the P50/P99 falls into the last bucket, which has no upper bound */
+			snprintf(temp_str, MAX_STR_SIZE, "%hu\t%hu\t%-16lu%-16lu%-16lu%lu\r\n", vcpu_id, reason,
+				latency.count, latency.sum_cycles / latency.count,
+				vmexit_latency_percentile(&latency, 500UL),
+				vmexit_latency_percentile(&latency, 990UL));
+			shell_puts(temp_str);
+		}
+	}
+
+	return 0;
+}
+
+static int32_t shell_show_ept_page_sizes(int32_t argc, char **argv)
+{
+	char temp_str[MAX_STR_SIZE];
+	uint16_t vm_id;
+	int32_t ret;
+	struct acrn_vm *vm;
+	struct acrn_ept_page_sizes sizes;
+
+	/* User input invalidation */
+	if (argc != 2) {
+		return -EINVAL;
+	}
+	ret = strtol_deci(argv[1]);
+	if (ret < 0) {
+		return -EINVAL;
+	}
+	vm_id = sanitize_vmid((uint16_t)ret);
+	vm = get_vm_from_vmid(vm_id);
+	if (is_poweroff_vm(vm)) {
+		shell_puts("No vm found in the input <vm_id>\r\n");
+		return -EINVAL;
+	}
+
+	ept_get_page_sizes(vm, &sizes);
+	shell_puts("\r\n4KB PAGES\t2MB PAGES\t1GB PAGES\tTABLE PAGES\r\n");
+	shell_puts("=========\t=========\t=========\t===========\r\n");
+	snprintf(temp_str, MAX_STR_SIZE, "%-16lu%-16lu%-16lu%lu\r\n",
+		sizes.pages_4k, sizes.pages_2m, sizes.pages_1g, sizes.table_pages);
+	shell_puts(temp_str);
+
+	return 0;
+}
+
+static int32_t shell_show_iommu_qi(__unused int32_t argc, __unused char **argv)
+{
+	char temp_str[MAX_STR_SIZE];
+	uint32_t i;
+	struct iommu_qi_stats stats;
+
+	shell_puts("\r\nDMAR\tSUBMITS\t\tDESCS\t\tASYNC\t\tTIMEOUTS\tAVG WAIT(us)\tMAX WAIT(us)\r\n");
+	shell_puts("====\t=======\t\t=====\t\t=====\t\t========\t============\t============\r\n");
+	for (i = 0U; get_iommu_qi_stats(i, &stats) == 0; i++) {
+		snprintf(temp_str, MAX_STR_SIZE, "%u\t%-16lu%-16lu%-16lu%-16lu%-16lu%lu\r\n", i,
+			stats.submits, stats.descs, stats.async_submits, stats.timeouts,
+			(stats.sync_waits != 0UL) ? ticks_to_us(stats.total_wait_ticks / stats.sync_waits) : 0UL,
+			ticks_to_us(stats.max_wait_ticks));
+		shell_puts(temp_str);
+	}
+
+	return 0;
+}
+
 static void get_entry_info(const struct ptirq_remapping_info *entry, char *type,
 		uint32_t *irq, uint32_t *vector, uint64_t *dest, bool *lvl_tm,
 		uint32_t *pgsi, uint32_t *vgsi, uint32_t *bdf, uint32_t *vbdf)
@@ -1101,6 +1322,26 @@ static void get_entry_info(const struct ptirq_remapping_info *entry, char *type,
 	}
 }
 
+static int32_t shell_show_ptdev_stat(__unused int32_t argc, __unused char **argv)
+{
+	char temp_str[MAX_STR_SIZE];
+	uint16_t pcpu_id, pcpu_nums = get_pcpu_nums();
+
+	/* sample twice to get the rates, the time is printed as their base */
+	snprintf(temp_str, MAX_STR_SIZE, "\r\nTIME(us): %lu\r\n", ticks_to_us(cpu_ticks()));
+	shell_puts(temp_str);
+	shell_puts("CPU\tBATCHES\t\tINJECTED\tPI NOTIFY\tPI WAKEUP\r\n");
+	shell_puts("===\t=======\t\t========\t=========\t=========\r\n");
+	for (pcpu_id = 0U; pcpu_id < pcpu_nums; pcpu_id++) {
+		snprintf(temp_str, MAX_STR_SIZE, "%hu\t%-16lu%-16lu%-16lu%lu\r\n", pcpu_id,
+			per_cpu(ptirq_batch_count, pcpu_id), per_cpu(ptirq_inject_count, pcpu_id),
+			per_cpu(pi_notify_count, pcpu_id), per_cpu(pi_wakeup_count, pcpu_id));
+		shell_puts(temp_str);
+	}
+
+	return 0;
+}
+
 static void get_ptdev_info(char *str_arg, size_t str_max)
 {
 	char *str = str_arg;
@@ -1113,6 +1354,9 @@ static void get_ptdev_info(char *str_arg, size_t str_max)
 	bool lvl_tm;
 	uint32_t pgsi, vgsi;
 	union pci_bdf bdf, vbdf;
+	struct ptirq_hash_stats stats;
+	struct acrn_vm *vm;
+	uint16_t vm_id;
 
 	len = snprintf(str, size, "\r\nVM\tTYPE\tIRQ\tVEC\tDEST\tTM\tGSI\tVGSI\tBDF\tVBDF");
 	if (len >= size) {
@@ -1146,6 +1390,43 @@ static void get_ptdev_info(char *str_arg, size_t str_max)
 		}
 	}
 
+	len = snprintf(str, size, "\r\n\r\nHASH\tBUCKETS\tUSED\tENTRIES\tMAX_CHAIN");
+	if (len >= size) {
+		goto overflow;
+	}
+	size -= len;
+	str += len;
+
+	spinlock_obtain(&ptdev_lock);
+	ptirq_get_hash_stats(NULL, &stats);
+	spinlock_release(&ptdev_lock);
+	len = snprintf(str, size, "\r\nphys\t%u\t%u\t%u\t%u", stats.buckets, stats.used_buckets,
+			stats.entries, stats.max_chain);
+	if (len >= size) {
+		goto overflow;
+	}
+	size -= len;
+	str += len;
+
+	for (vm_id = 0U; vm_id < CONFIG_MAX_VM_NUM; vm_id++) {
+		vm = get_vm_from_vmid(vm_id);
+		if (is_poweroff_vm(vm)) {
+			continue;
+		}
+		spinlock_obtain(&ptdev_lock);
+		ptirq_get_hash_stats(vm, &stats);
+		spinlock_release(&ptdev_lock);
+		if (stats.entries != 0U) {
+			len = snprintf(str, size, "\r\nvm%hu\t%u\t%u\t%u\t%u", vm_id, stats.buckets,
+					stats.used_buckets, stats.entries, stats.max_chain);
+			if (len >= size) {
+				goto overflow;
+			}
+			size -= len;
+			str += len;
+		}
+	}
+
 	snprintf(str, size, "\r\n");
 	return;
 
@@ -1170,6 +1451,8 @@ static void get_vioapic_info(char *str_arg, size_t str_max, uint16_t vmid)
 	bool level, phys, remote_irr, mask;
 	struct acrn_vm *vm = get_vm_from_vmid(vmid);
 	uint32_t gsi, gsi_count;
+	const struct acrn_single_vioapic *vioapic;
+	uint8_t i;
 
 	if (is_poweroff_vm(vm)) {
 		len = snprintf(str, size, "\r\nvm is not exist for vmid %hu", vmid);
@@ -1212,6 +1495,24 @@ static void get_vioapic_info(char *str_arg, size_t str_max, uint16_t vmid)
 		size -= len;
 		str += len;
 	}
+
+	len = snprintf(str, size, "\r\n\r\nIOAPIC\tFAST\t\tLOCKED\t\tCONTENDED");
+	if (len >= size) {
+		goto overflow;
+	}
+	size -= len;
+	str += len;
+
+	for (i = 0U; i < vm->arch_vm.vioapics.ioapic_num; i++) {
+		vioapic = &vm->arch_vm.vioapics.vioapic_array[i];
+		len = snprintf(str, size, "\r\n%hhu\t%-16lu%-16lu%lu", i, vioapic->fast_count,
+				vioapic->lock_count, vioapic->lock_contended);
+		if (len >= size) {
+			goto overflow;
+		}
+		size -= len;
+		str += len;
+	}
 END:
 	snprintf(str, size, "\r\n");
 	return;
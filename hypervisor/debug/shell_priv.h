@@ -48,6 +48,10 @@ struct shell {
 #define SHELL_CMD_VM_LIST_PARAM		NULL
 #define SHELL_CMD_VM_LIST_HELP		"List all VMs, displaying the VM UUID, ID, name and state"
 
+#define SHELL_CMD_VM_LAUNCH		"vm_launch"
+#define SHELL_CMD_VM_LAUNCH_PARAM	NULL
+#define SHELL_CMD_VM_LAUNCH_HELP	"List the launch time (in us) of the pre-launched VMs and Service VM, per phase"
+
 #define SHELL_CMD_VCPU_LIST		"vcpu_list"
 #define SHELL_CMD_VCPU_LIST_PARAM	NULL
 #define SHELL_CMD_VCPU_LIST_HELP	"List all vCPUs in all VMs"
@@ -73,10 +77,32 @@ struct shell {
 #define SHELL_CMD_INTERRUPT_PARAM	NULL
 #define SHELL_CMD_INTERRUPT_HELP	"List interrupt information per CPU"
 
+#define SHELL_CMD_CTX_SWITCH		"ctx_switch"
+#define SHELL_CMD_CTX_SWITCH_PARAM	NULL
+#define SHELL_CMD_CTX_SWITCH_HELP	"List vCPU context switch statistics per CPU"
+
+#define SHELL_CMD_VMEXIT_LAT		"vmexit_lat"
+#define SHELL_CMD_VMEXIT_LAT_PARAM	"<vm id>"
+#define SHELL_CMD_VMEXIT_LAT_HELP	"List VM exit count and latency (TSC cycles from VM exit to VM entry) per vCPU "\
+					"and exit reason"
+
+#define SHELL_CMD_EPT_PGSIZE		"ept_pgsize"
+#define SHELL_CMD_EPT_PGSIZE_PARAM	"<vm id>"
+#define SHELL_CMD_EPT_PGSIZE_HELP	"List the number of 4KB, 2MB and 1GB pages mapping the VM memory in its EPT"
+
+#define SHELL_CMD_IOMMU_QI		"iommu_qi"
+#define SHELL_CMD_IOMMU_QI_PARAM	NULL
+#define SHELL_CMD_IOMMU_QI_HELP		"List invalidation queue submissions and wait latency per DMAR unit"
+
 #define SHELL_CMD_PTDEV			"pt"
 #define SHELL_CMD_PTDEV_PARAM		NULL
 #define SHELL_CMD_PTDEV_HELP		"Show pass-through device information"
 
+#define SHELL_CMD_PTDEV_STAT		"pt_stat"
+#define SHELL_CMD_PTDEV_STAT_PARAM	NULL
+#define SHELL_CMD_PTDEV_STAT_HELP	"List pass-through interrupt softirq batches, injections and posted interrupt "\
+					"notifications per CPU"
+
 #define SHELL_CMD_REBOOT		"reboot"
 #define SHELL_CMD_REBOOT_PARAM		NULL
 #define SHELL_CMD_REBOOT_HELP		"Trigger a system reboot (immediately)"
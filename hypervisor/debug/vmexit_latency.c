@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2022 Intel Corporation.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <types.h>
+#include <errno.h>
+#include <asm/lib/bits.h>
+#include <asm/guest/vm.h>
+#include <asm/guest/vmexit.h>
+#include <asm/tsc.h>
+#include <vmexit_latency.h>
+
+/*
+ * Log2 histograms of the time from VM exit to the next VM entry, per exit reason.
+ * Each one is only updated by the pCPU running the vCPU, readers may see a
+ * histogram in the middle of an update.
+ */
+struct vmexit_latency_hist {
+	uint64_t exit_tsc;	/* TSC of the last VM exit, 0 before the first one */
+	uint64_t count[NR_VMX_EXIT_REASONS];
+	uint64_t sum_cycles[NR_VMX_EXIT_REASONS];
+	uint32_t buckets[NR_VMX_EXIT_REASONS][ACRN_VMEXIT_LATENCY_BUCKETS];
+};
+
+static struct vmexit_latency_hist vmexit_latency[CONFIG_MAX_VM_NUM][MAX_VCPUS_PER_VM];
+
+static inline struct vmexit_latency_hist *get_hist(const struct acrn_vcpu *vcpu)
+{
+	return &vmexit_latency[vcpu->vm->vm_id][vcpu->vcpu_id];
+}
+
+void vmexit_latency_reset(const struct acrn_vcpu *vcpu)
+{
+	(void)memset(get_hist(vcpu), 0U, sizeof(struct vmexit_latency_hist));
+}
+
+void vmexit_latency_exit(const struct acrn_vcpu *vcpu)
+{
+	get_hist(vcpu)->exit_tsc = rdtsc();
+}
+
+void vmexit_latency_enter(const struct acrn_vcpu *vcpu)
+{
+	struct vmexit_latency_hist *hist = get_hist(vcpu);
+	uint32_t reason = vcpu->arch.exit_reason & 0xFFFFU;
+	uint64_t cycles, scaled;
+	uint32_t bucket = 0U;
+
+	if ((hist->exit_tsc != 0UL) && (reason < NR_VMX_EXIT_REASONS)) {
+		cycles = rdtsc() - hist->exit_tsc;
+		scaled = cycles >> ACRN_VMEXIT_LATENCY_SHIFT;
+		if (scaled != 0UL) {
+			bucket = min((uint32_t)fls64(scaled) + 1U, ACRN_VMEXIT_LATENCY_BUCKETS - 1U);
+		}
+
+		hist->count[reason]++;
+		hist->sum_cycles[reason] += cycles;
+		hist->buckets[reason][bucket]++;
+		hist->exit_tsc = 0UL;
+	}
+}
+
+/**
+ * @pre vm_id < CONFIG_MAX_VM_NUM && latency != NULL
+ */
+int32_t get_vmexit_latency(uint16_t vm_id, struct acrn_vmexit_latency *latency)
+{
+	const struct vmexit_latency_hist *hist;
+	int32_t ret = -EINVAL;
+
+	if ((latency->vcpu_id < MAX_VCPUS_PER_VM) && (latency->exit_reason < NR_VMX_EXIT_REASONS)) {
+		hist = &vmexit_latency[vm_id][latency->vcpu_id];
+		latency->tsc_khz = get_tsc_khz();
+		latency->count = hist->count[latency->exit_reason];
+		latency->sum_cycles = hist->sum_cycles[latency->exit_reason];
+		(void)memcpy_s(latency->buckets, sizeof(latency->buckets),
+			hist->buckets[latency->exit_reason], sizeof(latency->buckets));
+		ret = 0;
+	}
+
+	return ret;
+}
@@ -36,6 +36,7 @@
 #include <asm/guest/assign.h>
 #include <logmsg.h>
 #include <asm/ioapic.h>
+#include <asm/lib/atomic.h>
 
 #define	RTBL_RO_BITS	((uint32_t)0x00004000U | (uint32_t)0x00001000U) /*Remote IRR and Delivery Status bits*/
 
@@ -49,6 +50,23 @@ static inline struct acrn_vioapics *vm_ioapics(const struct acrn_vm *vm)
 	return (struct acrn_vioapics *)&(vm->arch_vm.vioapics);
 }
 
+static inline void vioapic_lock(struct acrn_single_vioapic *vioapic, uint64_t *rflags)
+{
+	/* A ticket lock is held when its head is ahead of its tail */
+	bool contended = (vioapic->lock.head != vioapic->lock.tail);
+
+	spinlock_irqsave_obtain(&(vioapic->lock), rflags);
+	vioapic->lock_count++;
+	if (contended) {
+		vioapic->lock_contended++;
+	}
+}
+
+static inline void vioapic_unlock(struct acrn_single_vioapic *vioapic, uint64_t rflags)
+{
+	spinlock_irqrestore_release(&(vioapic->lock), rflags);
+}
+
 /**
  * @pre pin < vioapic->chipinfo.nr_pins
  */
@@ -93,17 +111,22 @@ vioapic_set_pinstate(struct acrn_single_vioapic *vioapic, uint32_t pin, uint32_t
 
 	if (pin < vioapic->chipinfo.nr_pins) {
 		rte = vioapic->rtbl[pin];
-		old_lvl = (uint32_t)bitmap_test((uint16_t)(pin & 0x3FU), &vioapic->pin_state[pin >> 6U]);
+		/*
+		 * pin_state is also updated by the lockless edge path, so always
+		 * use the atomic bit operations on it.
+		 */
 		if (level == 0U) {
 			/* clear pin_state and deliver interrupt according to polarity */
-			bitmap_clear_nolock((uint16_t)(pin & 0x3FU), &vioapic->pin_state[pin >> 6U]);
+			old_lvl = (uint32_t)bitmap_test_and_clear_lock((uint16_t)(pin & 0x3FU),
+					&vioapic->pin_state[pin >> 6U]);
 			if ((rte.bits.intr_polarity == IOAPIC_RTE_INTPOL_ALO)
 				&& (old_lvl != level)) {
 				vioapic_generate_intr(vioapic, pin);
 			}
 		} else {
 			/* set pin_state and deliver intrrupt according to polarity */
-			bitmap_set_nolock((uint16_t)(pin & 0x3FU), &vioapic->pin_state[pin >> 6U]);
+			old_lvl = (uint32_t)bitmap_test_and_set_lock((uint16_t)(pin & 0x3FU),
+					&vioapic->pin_state[pin >> 6U]);
 			if ((rte.bits.intr_polarity == IOAPIC_RTE_INTPOL_AHI)
 				&& (old_lvl != level)) {
 				vioapic_generate_intr(vioapic, pin);
@@ -112,6 +135,80 @@ vioapic_set_pinstate(struct acrn_single_vioapic *vioapic, uint32_t pin, uint32_t
 	}
 }
 
+/**
+ * @pre pin < vioapic->chipinfo.nr_pins
+ */
+static void
+vioapic_set_pinstate_fast(struct acrn_single_vioapic *vioapic, uint32_t pin, union ioapic_rte rte, uint32_t level)
+{
+	bool old_lvl;
+
+	if (level == 0U) {
+		old_lvl = bitmap_test_and_clear_lock((uint16_t)(pin & 0x3FU), &vioapic->pin_state[pin >> 6U]);
+		if (old_lvl && (rte.bits.intr_polarity == IOAPIC_RTE_INTPOL_ALO)) {
+			vlapic_receive_intr(vioapic->vm, false, (uint32_t)rte.bits.dest_field,
+				(rte.bits.dest_mode == IOAPIC_RTE_DESTMODE_PHY),
+				(uint32_t)rte.bits.delivery_mode, (uint32_t)rte.bits.vector, false);
+			atomic_inc64(&vioapic->fast_count);
+		}
+	} else {
+		old_lvl = bitmap_test_and_set_lock((uint16_t)(pin & 0x3FU), &vioapic->pin_state[pin >> 6U]);
+		if (!old_lvl && (rte.bits.intr_polarity == IOAPIC_RTE_INTPOL_AHI)) {
+			vlapic_receive_intr(vioapic->vm, false, (uint32_t)rte.bits.dest_field,
+				(rte.bits.dest_mode == IOAPIC_RTE_DESTMODE_PHY),
+				(uint32_t)rte.bits.delivery_mode, (uint32_t)rte.bits.vector, false);
+			atomic_inc64(&vioapic->fast_count);
+		}
+	}
+}
+
+/*
+ * Lockless path for edge-triggered, unmasked pins.
+ *
+ * An edge interrupt only depends on the pin state and on the RTE: the pin
+ * state is updated with atomic bit operations, and the RTE is taken as a
+ * single 64-bit snapshot, which vioapic_indirect_write() publishes with one
+ * store. A level-triggered or masked pin, including one which is being
+ * reprogrammed to such a state, goes through the locked path because it
+ * also needs to update Remote IRR or to be re-evaluated at unmask time.
+ *
+ * @return true if the operation has been handled.
+ */
+static bool
+vioapic_set_irqline_fast(struct acrn_single_vioapic *vioapic, uint32_t pin, uint32_t operation)
+{
+	union ioapic_rte rte;
+	bool ret = false;
+
+	if (pin < vioapic->chipinfo.nr_pins) {
+		rte.full = *(volatile const uint64_t *)&vioapic->rtbl[pin].full;
+		if ((rte.bits.trigger_mode == IOAPIC_RTE_TRGRMODE_EDGE) &&
+				(rte.bits.intr_mask == IOAPIC_RTE_MASK_CLR)) {
+			ret = true;
+			switch (operation) {
+			case GSI_SET_HIGH:
+				vioapic_set_pinstate_fast(vioapic, pin, rte, 1U);
+				break;
+			case GSI_SET_LOW:
+				vioapic_set_pinstate_fast(vioapic, pin, rte, 0U);
+				break;
+			case GSI_RAISING_PULSE:
+				vioapic_set_pinstate_fast(vioapic, pin, rte, 1U);
+				vioapic_set_pinstate_fast(vioapic, pin, rte, 0U);
+				break;
+			case GSI_FALLING_PULSE:
+				vioapic_set_pinstate_fast(vioapic, pin, rte, 0U);
+				vioapic_set_pinstate_fast(vioapic, pin, rte, 1U);
+				break;
+			default:
+				ret = false;
+				break;
+			}
+		}
+	}
+
+	return ret;
+}
 
 struct acrn_single_vioapic *
 vgsi_to_vioapic_and_vpin(const struct acrn_vm *vm, uint32_t vgsi, uint32_t *vpin)
@@ -200,11 +297,14 @@ vioapic_set_irqline_lock(const struct acrn_vm *vm, uint32_t vgsi, uint32_t opera
 {
 	uint64_t rflags;
 	struct acrn_single_vioapic *vioapic;
+	uint32_t pin;
 
-	vioapic = vgsi_to_vioapic_and_vpin(vm, vgsi, NULL);
-	spinlock_irqsave_obtain(&(vioapic->lock), &rflags);
-	vioapic_set_irqline_nolock(vm, vgsi, operation);
-	spinlock_irqrestore_release(&(vioapic->lock), rflags);
+	vioapic = vgsi_to_vioapic_and_vpin(vm, vgsi, &pin);
+	if (!vioapic_set_irqline_fast(vioapic, pin, operation)) {
+		vioapic_lock(vioapic, &rflags);
+		vioapic_set_irqline_nolock(vm, vgsi, operation);
+		vioapic_unlock(vioapic, rflags);
+	}
 }
 
 static uint32_t
@@ -362,7 +462,8 @@ static void vioapic_indirect_write(struct acrn_single_vioapic *vioapic, uint32_t
 		}
 
 		if (wire_mode_valid) {
-			vioapic->rtbl[pin] = new;
+			/* Publish with one store, for vioapic_set_irqline_fast() */
+			vioapic->rtbl[pin].full = new.full;
 			dev_dbg(DBG_LEVEL_VIOAPIC, "ioapic pin%hhu: redir table entry %#lx",
 				pin, vioapic->rtbl[pin].full);
 
@@ -399,7 +500,7 @@ vioapic_mmio_rw(struct acrn_single_vioapic *vioapic, uint64_t gpa,
 
 	offset = (uint32_t)(gpa - vioapic->chipinfo.addr);
 
-	spinlock_irqsave_obtain(&(vioapic->lock), &rflags);
+	vioapic_lock(vioapic, &rflags);
 
 	/* The IOAPIC specification allows 32-bit wide accesses to the
 	 * IOAPIC_REGSEL (offset 0) and IOAPIC_WINDOW (offset 16) registers.
@@ -428,7 +529,7 @@ vioapic_mmio_rw(struct acrn_single_vioapic *vioapic, uint64_t gpa,
 		break;
 	}
 
-	spinlock_irqrestore_release(&(vioapic->lock), rflags);
+	vioapic_unlock(vioapic, rflags);
 }
 
 /*
@@ -462,7 +563,7 @@ vioapic_process_eoi(struct acrn_single_vioapic *vioapic, uint32_t vector)
 	 * XXX keep track of the pins associated with this vector instead
 	 * of iterating on every single pin each time.
 	 */
-	spinlock_irqsave_obtain(&(vioapic->lock), &rflags);
+	vioapic_lock(vioapic, &rflags);
 	for (pin = 0U; pin < pincount; pin++) {
 		rte = vioapic->rtbl[pin];
 		if ((rte.bits.vector != vector) ||
@@ -477,7 +578,7 @@ vioapic_process_eoi(struct acrn_single_vioapic *vioapic, uint32_t vector)
 			vioapic_generate_intr(vioapic, pin);
 		}
 	}
-	spinlock_irqrestore_release(&(vioapic->lock), rflags);
+	vioapic_unlock(vioapic, rflags);
 }
 
 void vioapic_broadcast_eoi(const struct acrn_vm *vm, uint32_t vector)
@@ -542,6 +643,9 @@ vioapic_init(struct acrn_vm *vm)
 		vioapic = &vm->arch_vm.vioapics.vioapic_array[vioapic_index];
 		spinlock_init(&(vioapic->lock));
 		vioapic->chipinfo = vioapic_info[vioapic_index];
+		vioapic->fast_count = 0UL;
+		vioapic->lock_count = 0UL;
+		vioapic->lock_contended = 0UL;
 
 		vioapic->vm = vm;
 		reset_one_vioapic(vioapic);
@@ -609,3 +713,52 @@ void vioapic_get_rte(const struct acrn_vm *vm, uint32_t vgsi, union ioapic_rte *
 
 	*rte = vioapic->rtbl[pin];
 }
+
+/**
+ * @pre vm != NULL && state != NULL
+ * @pre vm is a post-launched VM, which has only one vIOAPIC
+ */
+void vioapic_get_state(const struct acrn_vm *vm, struct acrn_vioapic_state *state)
+{
+	struct acrn_single_vioapic *vioapic = &(vm_ioapics(vm)->vioapic_array[0]);
+	uint64_t rflags;
+	uint32_t pin;
+
+	spinlock_irqsave_obtain(&(vioapic->lock), &rflags);
+	state->id = vioapic->chipinfo.id;
+	state->ioregsel = vioapic->ioregsel;
+	for (pin = 0U; pin < VIOAPIC_RTE_NUM; pin++) {
+		state->rtes[pin] = vioapic->rtbl[pin].full;
+	}
+	for (pin = 0U; pin < VIOAPIC_RTE_NUM; pin += 64U) {
+		state->pin_state[pin >> 6U] = vioapic->pin_state[pin >> 6U];
+	}
+	spinlock_irqrestore_release(&(vioapic->lock), rflags);
+}
+
+/**
+ * @pre vm != NULL && state != NULL
+ * @pre vm is a post-launched VM, which has only one vIOAPIC
+ */
+void vioapic_set_state(const struct acrn_vm *vm, const struct acrn_vioapic_state *state)
+{
+	struct acrn_single_vioapic *vioapic = &(vm_ioapics(vm)->vioapic_array[0]);
+	union ioapic_rte rte;
+	uint64_t rflags;
+	uint32_t pin;
+
+	spinlock_irqsave_obtain(&(vioapic->lock), &rflags);
+	/* replay the RTE writes for the vPIC wire mode and the passthrough INTx remapping */
+	for (pin = 0U; pin < VIOAPIC_RTE_NUM; pin++) {
+		rte.full = state->rtes[pin];
+		vioapic_indirect_write(vioapic, IOAPIC_REDTBL + (pin << 1U) + 1U, rte.u.hi_32);
+		vioapic_indirect_write(vioapic, IOAPIC_REDTBL + (pin << 1U), rte.u.lo_32);
+		vioapic->rtbl[pin].bits.remote_irr = rte.bits.remote_irr;
+	}
+	for (pin = 0U; pin < VIOAPIC_RTE_NUM; pin += 64U) {
+		vioapic->pin_state[pin >> 6U] = state->pin_state[pin >> 6U];
+	}
+	vioapic->chipinfo.id = (uint8_t)state->id;
+	vioapic->ioregsel = state->ioregsel;
+	spinlock_irqrestore_release(&(vioapic->lock), rflags);
+}
@@ -8,10 +8,13 @@
 #include <asm/guest/vm.h>
 #include <asm/mmu.h>
 #include <asm/guest/ept.h>
+#include <asm/lib/atomic.h>
+#include <asm/lib/bits.h>
 #include <logmsg.h>
 #include <errno.h>
 #include <ivshmem.h>
 #include <ivshmem_cfg.h>
+#include <ptdev.h>
 #include "vpci_priv.h"
 
 /* config space of ivshmem device */
@@ -34,6 +37,24 @@
 #define	IVSHMEM_IV_POS_REG	0x8U
 #define	IVSHMEM_DOORBELL_REG	0xcU
 
+/*
+ * Polled mode doorbells: a peer posts a doorbell by setting bit <vector index> of the
+ * 64-bit word <peer id> in the last page of the shared memory (BAR2). Receivers may poll
+ * their word, and writing IVSHMEM_DOORBELL_FLUSH as the vector index of the doorbell
+ * register delivers the interrupts of all the posted doorbells with a single VM exit.
+ */
+#define IVSHMEM_DOORBELL_FLUSH		0xffffU
+#define IVSHMEM_DOORBELL_BITMAP_SIZE	PAGE_SIZE
+
+/*
+ * Doorbell destination resolved from an MSI-X entry: bits 0-7 hold the vector, bits 8-23 the
+ * destination vCPU ID, bits 32-63 the msix_gen of the device when the entry was resolved.
+ * IVSHMEM_MSIX_CACHE_SLOW means the entry can't be resolved to a single vCPU and has to go
+ * through vlapic_inject_msi.
+ */
+#define IVSHMEM_MSIX_CACHE_VALID	(1UL << 30U)
+#define IVSHMEM_MSIX_CACHE_SLOW		(1UL << 31U)
+
 static struct ivshmem_shm_region mem_regions[8] = {
 	IVSHMEM_SHM_REGIONS
 };
@@ -64,6 +85,8 @@ struct ivshmem_device {
 		} regs;
 	} mmio;
 	struct ivshmem_shm_region *region;
+	uint64_t msix_cache[MAX_IVSHMEM_MSIX_TBL_ENTRY_NUM];
+	uint32_t msix_gen;	/* atomically bumped after any MSI-X table write, stale msix_cache entries mismatch */
 };
 
 /* IVSHMEM_SHM_SIZE is provided by offline tool */
@@ -132,14 +155,75 @@ static void ivshmem_server_unbind_peer(struct pci_vdev *vdev)
 }
 
 /*
+ * Resolve the MSI-X entry to a single destination vCPU and vector, tagged with gen.
+ *
+ * @pre vm != NULL && entry != NULL
+ */
+static uint64_t ivshmem_resolve_msix(struct acrn_vm *vm, const struct msix_table_entry *entry, uint32_t gen)
+{
+	union msi_addr_reg addr;
+	union msi_data_reg data;
+	uint64_t dmask, cache = IVSHMEM_MSIX_CACHE_SLOW;
+
+	addr.full = entry->addr;
+	data.full = entry->data;
+
+	/*
+	 * Only the physical destination mode is cached, as the logical destination of a
+	 * vCPU changes with its LDR. VMs with LAPIC passthrough take the IPI path.
+	 */
+	if ((addr.bits.addr_base == MSI_ADDR_BASE) && (addr.bits.dest_mode == MSI_ADDR_DESTMODE_PHYS)
+			&& (addr.bits.rh == 0U) && (data.bits.delivery_mode == MSI_DATA_DELMODE_FIXED)
+			&& (data.bits.vector >= 16U) && !is_lapic_pt_configured(vm)) {
+		dmask = vlapic_calc_dest_noshort(vm, false, addr.bits.dest_field, true, false);
+		if ((dmask != 0UL) && ((dmask & (dmask - 1UL)) == 0UL)) {
+			cache = IVSHMEM_MSIX_CACHE_VALID | ((uint64_t)ffs64(dmask) << 8U) | data.bits.vector;
+		}
+	}
+
+	return cache | ((uint64_t)gen << 32U);
+}
+
+/*
+ * @pre ivs_dev != NULL
+ * @pre vector_index < ivs_dev->pcidev->msix.table_count
+ */
+static void ivshmem_inject_msix(struct ivshmem_device *ivs_dev, uint16_t vector_index)
+{
+	struct acrn_vm *vm = vpci2vm(ivs_dev->pcidev->vpci);
+	const struct msix_table_entry *entry = &(ivs_dev->pcidev->msix.table_entries[vector_index]);
+	/* gen is read before the entry is, a table write in between leaves a mismatching tag */
+	uint32_t gen = *(volatile const uint32_t *)&ivs_dev->msix_gen;
+	uint64_t cache;
+
+	cpu_compiler_barrier();
+	cache = ivs_dev->msix_cache[vector_index];
+
+	if (((cache >> 32U) != gen) || ((cache & (IVSHMEM_MSIX_CACHE_VALID | IVSHMEM_MSIX_CACHE_SLOW)) == 0UL)) {
+		cache = ivshmem_resolve_msix(vm, entry, gen);
+		ivs_dev->msix_cache[vector_index] = cache;
+	}
+
+	if ((cache & IVSHMEM_MSIX_CACHE_VALID) != 0UL) {
+		vlapic_set_intr(vcpu_from_vid(vm, (uint16_t)(cache >> 8U)), (uint32_t)(cache & 0xffUL), LAPIC_TRIG_EDGE);
+	} else {
+		(void)vlapic_inject_msi(vm, entry->addr, entry->data);
+	}
+}
+
+/*
+ * Return -EBUSY if the target MSI-X entry is masked, -EINVAL if the peer, the vector
+ * index or the MSI-X state of the target is invalid, the callers do the logging.
+ *
  * @pre src_ivs_dev != NULL
  */
-static void ivshmem_server_notify_peer(struct ivshmem_device *src_ivs_dev, uint16_t dest_peer_id, uint16_t vector_index)
+static int32_t ivshmem_server_notify_peer(struct ivshmem_device *src_ivs_dev, uint16_t dest_peer_id,
+	uint16_t vector_index)
 {
-	struct acrn_vm *dest_vm;
 	struct ivshmem_device *dest_ivs_dev;
 	struct msix_table_entry *entry;
 	struct ivshmem_shm_region *region = src_ivs_dev->region;
+	int32_t ret = 0;
 
 	if (dest_peer_id < MAX_IVSHMEM_PEER_NUM) {
 
@@ -149,18 +233,52 @@ static void ivshmem_server_notify_peer(struct ivshmem_device *src_ivs_dev, uint1
 
 			entry = &(dest_ivs_dev->pcidev->msix.table_entries[vector_index]);
 			if ((entry->vector_control & PCIM_MSIX_VCTRL_MASK) == 0U) {
-
-				dest_vm = vpci2vm(dest_ivs_dev->pcidev->vpci);
-				vlapic_inject_msi(dest_vm, entry->addr, entry->data);
+				ivshmem_inject_msix(dest_ivs_dev, vector_index);
 			} else {
-				pr_err("%s,target msix entry [%d] is masked.\n",
-					__func__, vector_index);
+				ret = -EBUSY;
 			}
 		} else {
-			pr_err("%s,Invalid peer, ID = %d, vector index [%d] or MSI-X is disabled.\n",
-				__func__, dest_peer_id, vector_index);
+			ret = -EINVAL;
 		}
 	}
+
+	return ret;
+}
+
+/*
+ * Deliver the doorbells posted in the bitmap at the end of the shared memory.
+ * Any guest sharing the memory can set any bit, the undeliverable ones are only
+ * reported once per flush at debug level.
+ *
+ * @pre src_ivs_dev != NULL
+ */
+static void ivshmem_server_flush_doorbells(struct ivshmem_device *src_ivs_dev)
+{
+	struct ivshmem_shm_region *region = src_ivs_dev->region;
+	uint64_t *bitmap;
+	uint64_t pending;
+	uint16_t peer_id, vector_index;
+	uint32_t dropped = 0U;
+
+	if (region->size >= IVSHMEM_DOORBELL_BITMAP_SIZE) {
+		bitmap = (uint64_t *)hpa2hva(region->hpa + region->size - IVSHMEM_DOORBELL_BITMAP_SIZE);
+		for (peer_id = 0U; peer_id < MAX_IVSHMEM_PEER_NUM; peer_id++) {
+			if (bitmap[peer_id] != 0UL) {
+				pending = atomic_readandclear64(&bitmap[peer_id]);
+				while (pending != 0UL) {
+					vector_index = ffs64(pending);
+					bitmap_clear_nolock(vector_index, &pending);
+					if (ivshmem_server_notify_peer(src_ivs_dev, peer_id, vector_index) != 0) {
+						dropped++;
+					}
+				}
+			}
+		}
+	}
+
+	if (dropped != 0U) {
+		pr_dbg("%s, %u doorbells to masked or invalid peer vectors dropped\n", __func__, dropped);
+	}
 }
 
 /*
@@ -192,6 +310,7 @@ static int32_t ivshmem_mmio_handler(struct io_request *io_req, void *data)
 	struct pci_vdev *vdev = (struct pci_vdev *) data;
 	struct ivshmem_device *ivs_dev = (struct ivshmem_device *) vdev->priv_data;
 	uint64_t offset = mmio->address - vdev->vbars[IVSHMEM_MMIO_BAR].base_gpa;
+	int32_t err;
 
 	if ((mmio->size == 4U) && ((offset & 0x3U) == 0U)) {
 		/*
@@ -210,8 +329,21 @@ static int32_t ivshmem_mmio_handler(struct io_request *io_req, void *data)
 			if (offset != IVSHMEM_IV_POS_REG) {
 				if (offset == IVSHMEM_DOORBELL_REG) {
 					doorbell.val = mmio->value;
-					ivshmem_server_notify_peer(ivs_dev, doorbell.reg.peer_id,
-						doorbell.reg.vector_index);
+					if (doorbell.reg.vector_index == IVSHMEM_DOORBELL_FLUSH) {
+						ivshmem_server_flush_doorbells(ivs_dev);
+					} else {
+						err = ivshmem_server_notify_peer(ivs_dev, doorbell.reg.peer_id,
+							doorbell.reg.vector_index);
+						if (err == -EBUSY) {
+							pr_err("%s,target msix entry [%d] is masked.\n",
+								__func__, doorbell.reg.vector_index);
+						} else if (err != 0) {
+							pr_err("%s,Invalid peer, ID = %d, vector index [%d] or MSI-X is disabled.\n",
+								__func__, doorbell.reg.peer_id, doorbell.reg.vector_index);
+						} else {
+							/* delivered */
+						}
+					}
 				} else {
 					ivs_dev->mmio.data[offset >> 2U] = mmio->value;
 				}
@@ -221,6 +353,23 @@ static int32_t ivshmem_mmio_handler(struct io_request *io_req, void *data)
 	return 0;
 }
 
+/*
+ * @pre vdev->priv_data != NULL
+ */
+static int32_t ivshmem_msix_mmio_handler(struct io_request *io_req, void *data)
+{
+	struct pci_vdev *vdev = (struct pci_vdev *) data;
+	struct ivshmem_device *ivs_dev = (struct ivshmem_device *) vdev->priv_data;
+
+	(void)vmsix_handle_table_mmio_access(io_req, data);
+	if (io_req->reqs.mmio_request.direction == ACRN_IOREQ_DIR_WRITE) {
+		/* doorbell destinations resolved from the old entries are stale now */
+		atomic_inc32(&ivs_dev->msix_gen);
+	}
+
+	return 0;
+}
+
 static int32_t read_ivshmem_vdev_cfg(const struct pci_vdev *vdev, uint32_t offset, uint32_t bytes, uint32_t *val)
 {
 	*val = pci_vdev_read_vcfg(vdev, offset, bytes);
@@ -259,7 +408,7 @@ static void ivshmem_vbar_map(struct pci_vdev *vdev, uint32_t idx)
 				(vbar->base_gpa + vbar->size), vdev, false);
 		ept_del_mr(vm, (uint64_t *)vm->arch_vm.nworld_eptp, vbar->base_gpa, round_page_up(vbar->size));
 	} else if ((idx == IVSHMEM_MSIX_BAR) && (vbar->base_gpa != 0UL)) {
-		register_mmio_emulation_handler(vm, vmsix_handle_table_mmio_access, vbar->base_gpa,
+		register_mmio_emulation_handler(vm, ivshmem_msix_mmio_handler, vbar->base_gpa,
 			(vbar->base_gpa + vbar->size), vdev, false);
 		ept_del_mr(vm, (uint64_t *)vm->arch_vm.nworld_eptp, vbar->base_gpa, vbar->size);
 		vdev->msix.mmio_gpa = vbar->base_gpa;
@@ -325,7 +474,12 @@ static void init_ivshmem_bar(struct pci_vdev *vdev, uint32_t bar_idx)
 
 static void init_ivshmem_vdev(struct pci_vdev *vdev)
 {
+	struct ivshmem_device *ivs_dev;
+
 	create_ivshmem_device(vdev);
+	ivs_dev = (struct ivshmem_device *)vdev->priv_data;
+	/* drop the doorbell destinations cached by a previous user of the device */
+	atomic_inc32(&ivs_dev->msix_gen);
 
 	/* initialize ivshmem config */
 	pci_vdev_write_vcfg(vdev, PCIR_VENDOR, 2U, IVSHMEM_VENDOR_ID);
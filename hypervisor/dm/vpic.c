@@ -1000,3 +1000,69 @@ void vpic_init(struct acrn_vm *vm)
 
 	spinlock_init(&(vpic->lock));
 }
+
+/**
+ * @pre vpic != NULL && state != NULL
+ */
+void vpic_get_state(struct acrn_vpic *vpic, struct acrn_i8259_state state[2])
+{
+	const struct i8259_reg_state *i8259;
+	uint64_t rflags;
+	uint32_t i;
+
+	spinlock_irqsave_obtain(&(vpic->lock), &rflags);
+	for (i = 0U; i < 2U; i++) {
+		i8259 = &vpic->i8259[i];
+		state[i].ready = i8259->ready ? 1U : 0U;
+		state[i].icw_num = i8259->icw_num;
+		state[i].rd_cmd_reg = i8259->rd_cmd_reg;
+		state[i].aeoi = i8259->aeoi ? 1U : 0U;
+		state[i].poll = i8259->poll ? 1U : 0U;
+		state[i].rotate = i8259->rotate ? 1U : 0U;
+		state[i].sfn = i8259->sfn ? 1U : 0U;
+		state[i].request = i8259->request;
+		state[i].service = i8259->service;
+		state[i].mask = i8259->mask;
+		state[i].smm = i8259->smm;
+		state[i].elc = i8259->elc;
+		state[i].irq_base = i8259->irq_base;
+		state[i].lowprio = i8259->lowprio;
+		(void)memcpy_s(state[i].pin_state, sizeof(state[i].pin_state),
+				i8259->pin_state, sizeof(i8259->pin_state));
+	}
+	spinlock_irqrestore_release(&(vpic->lock), rflags);
+}
+
+/**
+ * @pre vpic != NULL && state != NULL
+ */
+void vpic_set_state(struct acrn_vpic *vpic, const struct acrn_i8259_state state[2])
+{
+	struct i8259_reg_state *i8259;
+	uint64_t rflags;
+	uint32_t i;
+
+	spinlock_irqsave_obtain(&(vpic->lock), &rflags);
+	for (i = 0U; i < 2U; i++) {
+		i8259 = &vpic->i8259[i];
+		i8259->ready = (state[i].ready != 0U);
+		i8259->icw_num = state[i].icw_num;
+		i8259->rd_cmd_reg = state[i].rd_cmd_reg;
+		i8259->aeoi = (state[i].aeoi != 0U);
+		i8259->poll = (state[i].poll != 0U);
+		i8259->rotate = (state[i].rotate != 0U);
+		i8259->sfn = (state[i].sfn != 0U);
+		i8259->request = state[i].request;
+		i8259->service = state[i].service;
+		i8259->mask = state[i].mask;
+		i8259->smm = state[i].smm;
+		i8259->elc = state[i].elc;
+		i8259->irq_base = state[i].irq_base;
+		i8259->lowprio = state[i].lowprio & 0x7U;
+		(void)memcpy_s(i8259->pin_state, sizeof(i8259->pin_state),
+				state[i].pin_state, sizeof(state[i].pin_state));
+		i8259->intr_raised = false;
+	}
+	vpic_notify_intr(vpic);
+	spinlock_irqrestore_release(&(vpic->lock), rflags);
+}
@@ -40,6 +40,11 @@
 #define obtain_vuart_lock(vu, flags)	spinlock_irqsave_obtain(&((vu)->lock), &(flags))
 #define release_vuart_lock(vu, flags)	spinlock_irqrestore_release(&((vu)->lock), (flags))
 
+#ifdef CONFIG_VUART_HIGH_THROUGHPUT_ENABLED
+/* RX FIFO interrupt trigger levels, indexed by FCR[7:6] */
+static const uint32_t rx_trigger_levels[4] = { 1U, 4U, 8U, 14U };
+#endif
+
 static inline void reset_fifo(struct vuart_fifo *fifo)
 {
 	fifo->rindex = 0U;
@@ -94,12 +99,45 @@ static inline bool fifo_isfull(const struct vuart_fifo *fifo)
 	return ret;
 }
 
-void vuart_putchar(struct acrn_vuart *vu, char ch)
+/*
+ * Report the received data regardless of the RX trigger level, as the
+ * character timeout of a 16550 would do.
+ */
+static inline void vuart_rx_timeout(__unused struct acrn_vuart *vu)
+{
+#ifdef CONFIG_VUART_HIGH_THROUGHPUT_ENABLED
+	vu->rx_timeout = true;
+#endif
+}
+
+static inline bool vuart_rx_ready(const struct acrn_vuart *vu)
+{
+#ifdef CONFIG_VUART_HIGH_THROUGHPUT_ENABLED
+	uint32_t num = fifo_numchars(&vu->rxfifo);
+
+	return (num >= vu->rx_trigger) || ((num > 0U) && vu->rx_timeout);
+#else
+	return (fifo_numchars(&vu->rxfifo) > 0U);
+#endif
+}
+
+static void vuart_update_intr(struct acrn_vuart *vu);
+
+/*
+ * Bulk path: queue a run of characters with one lock round trip and at most
+ * one interrupt.
+ */
+void vuart_putchars(struct acrn_vuart *vu, const char *buf, uint32_t len)
 {
 	uint64_t rflags;
+	uint32_t i;
 
 	obtain_vuart_lock(vu, rflags);
-	fifo_putchar(&vu->rxfifo, ch);
+	for (i = 0U; i < len; i++) {
+		fifo_putchar(&vu->rxfifo, buf[i]);
+	}
+	vuart_rx_timeout(vu);
+	vuart_update_intr(vu);
 	release_vuart_lock(vu, rflags);
 }
 
@@ -137,8 +175,12 @@ static uint8_t vuart_intr_reason(const struct acrn_vuart *vu)
 
 	if (((vu->lsr & LSR_OE) != 0U) && ((vu->ier & IER_ELSI) != 0U)) {
 		ret = IIR_RLS;
-	} else if ((fifo_numchars(&vu->rxfifo) > 0U) && ((vu->ier & IER_ERBFI) != 0U)) {
+	} else if (vuart_rx_ready(vu) && ((vu->ier & IER_ERBFI) != 0U)) {
+#ifdef CONFIG_VUART_HIGH_THROUGHPUT_ENABLED
+		ret = (fifo_numchars(&vu->rxfifo) >= vu->rx_trigger) ? IIR_RXRDY : IIR_RXTOUT;
+#else
 		ret = IIR_RXTOUT;
+#endif
 	} else if (vu->thre_int_pending && ((vu->ier & IER_ETBEI) != 0U)) {
 		ret = IIR_TXRDY;
 	} else if(((vu->msr & MSR_DELTA_MASK) != 0U) && ((vu->ier & IER_EMSC) != 0U)) {
@@ -210,6 +252,48 @@ void vuart_toggle_intr(const struct acrn_vuart *vu)
 	}
 }
 
+/*
+ * In high-throughput mode the interrupt is only signaled when the interrupt
+ * reason changes, so a burst of characters which keeps the same reason
+ * pending is delivered with a single interrupt.
+ */
+static void vuart_update_intr(struct acrn_vuart *vu)
+{
+#ifdef CONFIG_VUART_HIGH_THROUGHPUT_ENABLED
+	uint8_t intr_reason = vuart_intr_reason(vu);
+
+	if (intr_reason != vu->intr_reason) {
+		vu->intr_reason = intr_reason;
+		vuart_toggle_intr(vu);
+	}
+#else
+	vuart_toggle_intr(vu);
+#endif
+}
+
+#ifdef CONFIG_VUART_HIGH_THROUGHPUT_ENABLED
+/*
+ * Characters sent to the target vuart below its RX trigger level are held
+ * back until the sender accesses any other register, e.g. the IIR read which
+ * ends a 16550 TX interrupt burst. This stands in for the character timeout.
+ */
+static void vuart_flush_target(struct acrn_vuart *vu)
+{
+	struct acrn_vuart *t_vu = vu->target_vu;
+	uint64_t rflags;
+
+	if (vu->tx_flush_pending && (t_vu != NULL)) {
+		vu->tx_flush_pending = false;
+		obtain_vuart_lock(t_vu, rflags);
+		if (t_vu->active) {
+			t_vu->rx_timeout = true;
+			vuart_update_intr(t_vu);
+		}
+		release_vuart_lock(t_vu, rflags);
+	}
+}
+#endif
+
 static bool send_to_target(struct acrn_vuart *vu, uint8_t value_u8)
 {
 	uint64_t rflags;
@@ -219,9 +303,11 @@ static bool send_to_target(struct acrn_vuart *vu, uint8_t value_u8)
 	if (vu->active) {
 		fifo_putchar(&vu->rxfifo, (char)value_u8);
 		if (fifo_isfull(&vu->rxfifo)) {
+			/* The sender stalls until the data is read out, report it now */
+			vuart_rx_timeout(vu);
 			ret = true;
 		}
-		vuart_toggle_intr(vu);
+		vuart_update_intr(vu);
 	}
 	release_vuart_lock(vu, rflags);
 	return ret;
@@ -306,6 +392,7 @@ static void write_reg(struct acrn_vuart *vu, uint16_t reg, uint8_t value_u8)
 		case UART16550_THR:
 			if ((vu->mcr & MCR_LOOPBACK) != 0U) {
 				fifo_putchar(&vu->rxfifo, (char)value_u8);
+				vuart_rx_timeout(vu);
 				vu->lsr |= LSR_OE;
 			} else {
 				fifo_putchar(&vu->txfifo, (char)value_u8);
@@ -335,6 +422,16 @@ static void write_reg(struct acrn_vuart *vu, uint16_t reg, uint8_t value_u8)
 				}
 				vu->fcr = value_u8 & (FCR_FIFOE | FCR_DMA | FCR_RX_MASK);
 			}
+#ifdef CONFIG_VUART_HIGH_THROUGHPUT_ENABLED
+			if ((vu->fcr & FCR_FIFOE) != 0U) {
+				vu->rx_trigger = rx_trigger_levels[(vu->fcr & FCR_RX_MASK) >> 6U];
+			} else {
+				vu->rx_trigger = 1U;
+			}
+			if (fifo_numchars(&vu->rxfifo) == 0U) {
+				vu->rx_timeout = false;
+			}
+#endif
 			break;
 		case UART16550_LCR:
 			vu->lcr = value_u8;
@@ -372,7 +469,7 @@ static void write_reg(struct acrn_vuart *vu, uint16_t reg, uint8_t value_u8)
 			break;
 		}
 	}
-	vuart_toggle_intr(vu);
+	vuart_update_intr(vu);
 	release_vuart_lock(vu, rflags);
 }
 
@@ -392,10 +489,16 @@ void vuart_write_reg(struct acrn_vuart *vu, uint16_t offset, uint8_t value_u8)
 			/* FIFO is not full, raise THRE interrupt */
 			obtain_vuart_lock(vu, rflags);
 			vu->thre_int_pending = true;
-			vuart_toggle_intr(vu);
+			vuart_update_intr(vu);
 			release_vuart_lock(vu, rflags);
 		}
+#ifdef CONFIG_VUART_HIGH_THROUGHPUT_ENABLED
+		vu->tx_flush_pending = true;
+#endif
 	} else {
+#ifdef CONFIG_VUART_HIGH_THROUGHPUT_ENABLED
+		vuart_flush_target(vu);
+#endif
 		write_reg(vu, offset, value_u8);
 	}
 }
@@ -428,7 +531,7 @@ static void notify_target(const struct acrn_vuart *vu)
 		if ((t_vu != NULL) && !fifo_isfull(&vu->rxfifo)) {
 			obtain_vuart_lock(t_vu, rflags);
 			t_vu->thre_int_pending = true;
-			vuart_toggle_intr(t_vu);
+			vuart_update_intr(t_vu);
 			release_vuart_lock(t_vu, rflags);
 		}
 	}
@@ -442,8 +545,12 @@ uint8_t vuart_read_reg(struct acrn_vuart *vu, uint16_t offset)
 	struct acrn_vuart *t_vu;
 	uint8_t iir, reg = 0U, intr_reason;
 	uint64_t rflags;
+	bool notify = false;
 
 	t_vu = vu->target_vu;
+#ifdef CONFIG_VUART_HIGH_THROUGHPUT_ENABLED
+	vuart_flush_target(vu);
+#endif
 	obtain_vuart_lock(vu, rflags);
 	/*
 	 * Take care of the special case DLAB accesses first
@@ -460,7 +567,21 @@ uint8_t vuart_read_reg(struct acrn_vuart *vu, uint16_t offset)
 		switch (offset) {
 		case UART16550_RBR:
 			vu->lsr &= ~LSR_OE;
+#ifdef CONFIG_VUART_HIGH_THROUGHPUT_ENABLED
+			/*
+			 * Only wake up the sender when it may be stalled on a
+			 * full FIFO or when all the data has been consumed.
+			 */
+			notify = fifo_isfull(&vu->rxfifo);
 			reg = (uint8_t)fifo_getchar(&vu->rxfifo);
+			if (fifo_numchars(&vu->rxfifo) == 0U) {
+				vu->rx_timeout = false;
+				notify = true;
+			}
+#else
+			reg = (uint8_t)fifo_getchar(&vu->rxfifo);
+			notify = true;
+#endif
 			break;
 		case UART16550_IER:
 			reg = vu->ier;
@@ -516,12 +637,12 @@ uint8_t vuart_read_reg(struct acrn_vuart *vu, uint16_t offset)
 			break;
 		}
 	}
-	vuart_toggle_intr(vu);
+	vuart_update_intr(vu);
 	release_vuart_lock(vu, rflags);
 
 	/* For commnunication vuart, when the data in FIFO is read out, should
 	 * notify the target vuart to send more data. */
-	if (offset == UART16550_RBR) {
+	if (notify) {
 		notify_target(vu);
 	}
 
@@ -580,6 +701,12 @@ static void setup_vuart(struct acrn_vm *vm, uint16_t vuart_idx)
 	init_vuart_lock(vu);
 	vu->thre_int_pending = true;
 	vu->ier = 0U;
+#ifdef CONFIG_VUART_HIGH_THROUGHPUT_ENABLED
+	vu->rx_trigger = 1U;
+	vu->rx_timeout = false;
+	vu->tx_flush_pending = false;
+	vu->intr_reason = IIR_NOPEND;
+#endif
 	vuart_toggle_intr(vu);
 	vu->target_vu = NULL;
 }
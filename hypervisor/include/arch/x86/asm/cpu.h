@@ -98,6 +98,8 @@
 #define XCR0_BNDREGS		(1UL<<3U)
 /* XCR0_BNDCSR */
 #define XCR0_BNDCSR		(1UL<<4U)
+/* XCR0_OPMASK, XCR0_ZMM_HI256 and XCR0_HI16_ZMM, the AVX-512 state */
+#define XCR0_AVX512		((1UL<<5U) | (1UL<<6U) | (1UL<<7U))
 /* According to SDM Vol1 13.3:
  *   XCR0[63:10] and XCR0[8] are reserved. Executing the XSETBV instruction causes
  *   a general-protection fault if ECX = 0 and any corresponding bit in EDX:EAX
@@ -567,6 +569,12 @@ static inline void cpu_sp_write(uint64_t *stack_ptr)
 	asm volatile ("movq %0, %%rsp" : : "r"(rsp));
 }
 
+/* Prevents the compiler from reordering memory accesses across it */
+static inline void cpu_compiler_barrier(void)
+{
+	asm volatile ("" : : : "memory");
+}
+
 /* Synchronizes all write accesses to memory */
 static inline void cpu_write_memory_barrier(void)
 {
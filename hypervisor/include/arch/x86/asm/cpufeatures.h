@@ -102,6 +102,7 @@
 
 /* Intel-defined CPU features, CPUID level 0x0000000D, sub 0x1 */
 #define X86_FEATURE_COMPACTION_EXT	((FEAT_D_1_EAX << 5U) + 1U)
+#define X86_FEATURE_XGETBV1		((FEAT_D_1_EAX << 5U) + 2U)
 #define X86_FEATURE_XSAVES		((FEAT_D_1_EAX << 5U) + 3U)
 
 #endif /* CPUFEATURES_H */
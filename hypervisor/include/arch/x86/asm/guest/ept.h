@@ -18,7 +18,13 @@ typedef void (*pge_handler)(uint64_t *pgentry, uint64_t size);
 #define INVALID_HPA	(0x1UL << 52U)
 #define INVALID_GPA	(0x1UL << 52U)
 
+/* EPTP bit 6: enable accessed and dirty flags for EPT */
+#define EPTP_AD_ENABLE	(1UL << 6U)
+
 struct acrn_vm;
+struct acrn_vcpu;
+struct acrn_dirty_bitmap;
+struct acrn_ept_page_sizes;
 
 /* External Interfaces */
 /**
@@ -105,6 +111,34 @@ void ept_add_mr(struct acrn_vm *vm, uint64_t *pml4_page, uint64_t hpa,
  */
 void ept_modify_mr(struct acrn_vm *vm, uint64_t *pml4_page, uint64_t gpa,
 		uint64_t size, uint64_t prot_set, uint64_t prot_clr);
+/**
+ * @brief Guest-physical memory region mapping, shared with helper pCPUs
+ *
+ * Same as ept_add_mr(), the region is split into 1G GPA slots mapped in
+ * parallel by current pCPU and the helper pCPUs, see smp_call_split().
+ *
+ * @param[in] helper_mask The pCPUs helping to map the region, may be 0
+ *
+ * @return None
+ *
+ * @pre helper_mask doesn't include current pCPU
+ */
+void ept_add_mr_parallel(struct acrn_vm *vm, uint64_t *pml4_page, uint64_t hpa,
+		uint64_t gpa, uint64_t size, uint64_t prot, uint64_t helper_mask);
+/**
+ * @brief Guest-physical memory region updating, shared with helper pCPUs
+ *
+ * Same as ept_modify_mr(), the region is split into 1G GPA slots updated in
+ * parallel by current pCPU and the helper pCPUs, see smp_call_split().
+ *
+ * @param[in] helper_mask The pCPUs helping to update the region, may be 0
+ *
+ * @return None
+ *
+ * @pre helper_mask doesn't include current pCPU
+ */
+void ept_modify_mr_parallel(struct acrn_vm *vm, uint64_t *pml4_page, uint64_t gpa,
+		uint64_t size, uint64_t prot_set, uint64_t prot_clr, uint64_t helper_mask);
 /**
  * @brief Guest-physical memory region unmapping
  *
@@ -132,6 +166,57 @@ void ept_del_mr(struct acrn_vm *vm, uint64_t *pml4_page, uint64_t gpa,
  */
 void ept_flush_leaf_page(uint64_t *pge, uint64_t size);
 
+/**
+ * @brief Write back and invalidate the cache of the guest memory of the vm
+ *
+ * Flush the cache lines of the pages mapped in the current EPT of vm. If the EPT
+ * accessed and dirty flags are enabled for vm, only the pages written since the
+ * last flush are flushed, so the caller must make sure that no vCPU of vm is in
+ * non-root mode during the flush. The pCPUs in helper_mask run part of the walk
+ * in parallel with the current pCPU.
+ *
+ * @param[in] vm the pointer that points to VM data structure
+ * @param[in] helper_mask bitmap of the pCPUs helping to flush, not including the current pCPU
+ *
+ * @return None
+ */
+void ept_flush_guest_cache(struct acrn_vm *vm, uint64_t helper_mask);
+
+/**
+ * @brief Check whether WBINVD of the vm can flush only the pages written since the last one
+ *
+ * The EPT dirty flags only record the writes of the vCPUs through the EPT of the vm,
+ * so it's the case only if the hypervisor is the only other writer of its memory.
+ *
+ * @param[in] vm the pointer that points to VM data structure
+ *
+ * @return true if the dirty flags of the vm may reduce the flush of WBINVD
+ */
+bool ept_wbinvd_dirty_only_usable(const struct acrn_vm *vm);
+
+/**
+ * @brief Report a write of the hypervisor to the guest memory of the vm
+ *
+ * The EPT dirty flags don't see it, so the next WBINVD of the vm flushes all its memory.
+ * It's called once the write is done, by copy_to_gpa() and by the writers through gpa2hva().
+ *
+ * @param[in] vm the pointer that points to VM data structure
+ *
+ * @return None
+ */
+void ept_hv_write_done(struct acrn_vm *vm);
+
+/**
+ * @brief Get the value of VMCS EPT pointer for the EPT
+ *
+ * @param[in] vm the pointer that points to VM data structure
+ * @param[in] ept_root the PML4 page of the EPT
+ *
+ * @return the HPA of ept_root with the memory type, page walk length and
+ *         the accessed and dirty flags enabling of vm
+ */
+uint64_t get_ept_pointer(const struct acrn_vm *vm, const void *ept_root);
+
 /**
  * @brief Get EPT pointer of the vm
  *
@@ -154,6 +239,16 @@ void *get_eptp(struct acrn_vm *vm);
  */
 void walk_ept_table(struct acrn_vm *vm, pge_handler cb);
 
+/**
+ * @brief Count the pages of each size mapping the normal world of the vm
+ *
+ * @param[in] vm the pointer that points to VM data structure
+ * @param[out] sizes the page counts, see struct acrn_ept_page_sizes
+ *
+ * @return None
+ */
+void ept_get_page_sizes(struct acrn_vm *vm, struct acrn_ept_page_sizes *sizes);
+
 /**
  * @brief EPT misconfiguration handling
  *
@@ -164,6 +259,80 @@ void walk_ept_table(struct acrn_vm *vm, pge_handler cb);
  */
 int32_t ept_misconfig_vmexit_handler(__unused struct acrn_vcpu *vcpu);
 
+/**
+ * @brief Page-modification log full handling
+ *
+ * Move the GPAs logged by the PML of the vCPU to the dirty log of its VM.
+ *
+ * @param[in] vcpu the pointer that points to vcpu data structure
+ *
+ * @retval 0 Success to handle the PML full
+ */
+int32_t pml_full_vmexit_handler(struct acrn_vcpu *vcpu);
+
+/**
+ * @brief Reset the dirty page logging of the vm to disabled
+ *
+ * @param[in] vm the pointer that points to VM data structure
+ *
+ * @return None
+ */
+void ept_dirty_log_init(struct acrn_vm *vm);
+
+/**
+ * @brief Start or stop the dirty page logging of the vm
+ *
+ * Once started, the first harvest of a range reports all the pages of the range
+ * written since the EPT dirty flags were last cleared. The vCPUs log the writes
+ * with PML if the platform supports it, otherwise each harvest walks the EPT.
+ *
+ * @param[in] vm the pointer that points to VM data structure
+ * @param[in] enable start the logging if true, stop it otherwise
+ *
+ * @retval 0 on success
+ * @retval -EINVAL if the EPT dirty flags are not enabled for the vm, e.g. a post-launched
+ *	   VM created without GUEST_FLAG_DIRTY_LOG
+ * @retval -EBUSY if another change or harvest of the log is in progress
+ * @retval -EAGAIN if a WBINVD emulation is clearing the dirty flags, the log is left
+ *	   disabled and the start can be tried again
+ */
+int32_t ept_set_dirty_log(struct acrn_vm *vm, bool enable);
+
+/**
+ * @brief Harvest the pages written in a range of the vm since the last harvest
+ *
+ * Set the bits of the written pages in the bitmap, and clear their EPT dirty
+ * flags. Before the function returns, no vCPU of the vm runs with a cached
+ * translation of a harvested page, so each write is reported by a harvest.
+ *
+ * @param[in] vm the pointer that points to VM data structure
+ * @param[in] bitmap_vm the VM owning the bitmap
+ * @param[in] param the range and the bitmap, see struct acrn_dirty_bitmap
+ *
+ * @retval 0 on success
+ * @retval -EINVAL if the logging is stopped, the range is invalid or the bitmap is not mapped
+ * @retval -EBUSY if another change or harvest of the log is in progress
+ */
+int32_t ept_get_dirty_bitmap(struct acrn_vm *vm, struct acrn_vm *bitmap_vm, const struct acrn_dirty_bitmap *param);
+
+/**
+ * @brief Turn the PML of the vcpu on or off as the dirty log of its VM, on the pCPU of the vcpu
+ *
+ * @param[in] vcpu the pointer that points to vcpu data structure
+ *
+ * @return None
+ */
+void ept_dirty_log_sync_vcpu(struct acrn_vcpu *vcpu);
+
+/**
+ * @brief Forget the PML of the vcpu before its VMCS is reset, the next harvests walk the EPT instead
+ *
+ * @param[in] vcpu the pointer that points to vcpu data structure
+ *
+ * @return None
+ */
+void ept_dirty_log_stop_vcpu(struct acrn_vcpu *vcpu);
+
 void init_ept_pgtable(struct pgtable *table, uint16_t vm_id);
 void reserve_buffer_for_ept_pages(void);
 #endif /* EPT_H */
@@ -80,6 +80,18 @@ int32_t copy_from_gpa(struct acrn_vm *vm, void *h_ptr, uint64_t gpa, uint32_t si
  * @pre Pointer vm is non-NULL
  */
 int32_t copy_to_gpa(struct acrn_vm *vm, void *h_ptr, uint64_t gpa, uint32_t size);
+/**
+ * @brief Copy data from HV address space to VM GPA space, shared with helper pCPUs
+ *
+ * Same as copy_to_gpa(), the region is split into 2M chunks copied in parallel
+ * by current pCPU and the helper pCPUs, see smp_call_split().
+ *
+ * @param[in] helper_mask The pCPUs helping to copy the data, may be 0
+ *
+ * @pre Pointer vm is non-NULL
+ * @pre helper_mask doesn't include current pCPU
+ */
+int32_t copy_to_gpa_parallel(struct acrn_vm *vm, void *h_ptr, uint64_t gpa, uint32_t size, uint64_t helper_mask);
 /**
  * @brief Copy data from VM GVA space to HV address space
  *
@@ -21,6 +21,7 @@
 #include <asm/guest/virtual_cr.h>
 #include <asm/guest/vlapic.h>
 #include <asm/guest/vmtrr.h>
+#include <asm/guest/vcpuid.h>
 #include <schedule.h>
 #include <event.h>
 #include <io_req.h>
@@ -105,6 +106,11 @@
  */
 #define ACRN_REQUEST_SPLIT_LOCK			10U
 
+/**
+ * @brief Request for turning on or off the PML of the vCPU
+ */
+#define ACRN_REQUEST_DIRTY_LOG			11U
+
 /**
  * @}
  */
@@ -238,11 +244,17 @@ struct acrn_vcpu_arch {
 	/* MSR bitmap region for this vcpu, MUST be 4-Kbyte aligned */
 	uint8_t msr_bitmap[PAGE_SIZE];
 
+	/* Page Modification Log of this vcpu, MUST be 4-Kbyte aligned */
+	uint64_t pml_buffer[PML_ENTRY_NUM];
+
 	/* per vcpu lapic */
 	struct acrn_vlapic vlapic;
 
 	/* pid MUST be 64 bytes aligned */
 	struct pi_desc pid __aligned(64);
+	/* node in pi_blocked_vcpus of the pCPU while the PID's NV is POSTED_INTR_WAKEUP_VECTOR */
+	struct list_head pi_blocked_node;
+	volatile bool pi_blocked;
 
 	struct acrn_vmtrr vmtrr;
 
@@ -268,6 +280,7 @@ struct acrn_vcpu_arch {
 	bool irq_window_enabled;
 	bool emulating_lock;
 	bool xsave_enabled;
+	bool pml_enabled;	/* protected by the dirty_log.lock of the VM */
 
 	/* VCPU context state information */
 	uint32_t exit_reason;
@@ -280,6 +293,13 @@ struct acrn_vcpu_arch {
 	enum vm_cpu_mode cpu_mode;
 	uint8_t nr_sipi;
 
+	/* guest state set by set_vcpu_state(), loaded on the first VM entry */
+	struct {
+		bool pending;
+		uint32_t interruptibility;
+		uint64_t apic_base;
+	} restore;
+
 	/* interrupt injection information */
 	uint64_t pending_req;
 
@@ -292,6 +312,9 @@ struct acrn_vcpu_arch {
 	/* Keylocker */
 	struct iwkey IWKey;
 	bool cr4_kl_enabled;
+#ifdef CONFIG_CPUID_PRECOMPUTE_ENABLED
+	struct vcpuid_cache vcpuid_cache;
+#endif
 	/*
 	 * Keylocker spec 4.4:
 	 * Bit 0 - Status of most recent copy to or from IWKeyBackup.
@@ -356,6 +379,11 @@ static inline struct acrn_vlapic *vcpu_vlapic(struct acrn_vcpu *vcpu)
 	return &(vcpu->arch.vlapic);
 }
 
+static inline struct xsave_area *vcpu_xsave_area(struct acrn_vcpu *vcpu)
+{
+	return &(vcpu->arch.contexts[vcpu->arch.cur_context].ext_ctx.xs_area);
+}
+
 /**
  * @brief Get pointer to PI description.
  *
@@ -573,6 +601,35 @@ void vcpu_clear_eoi_exit_bitmap(struct acrn_vcpu *vcpu, uint32_t vector);
  */
 void set_vcpu_regs(struct acrn_vcpu *vcpu, struct acrn_regs *vcpu_regs);
 
+/**
+ * @brief get the complete architectural state of a paused vcpu
+ *
+ * Read the registers of the vCPU on its pCPU, and write its extended context
+ * (including the XSAVE area) back to the vcpu data structure.
+ *
+ * @param[in] vcpu pointer to vcpu data structure
+ * @param[out] state the registers' value
+ *
+ * @return None
+ */
+void get_vcpu_state(struct acrn_vcpu *vcpu, struct acrn_cpu_state *state);
+
+/**
+ * @brief set the complete architectural state of a vcpu before it's launched
+ *
+ * The XSAVE area (compacted format) is expected in vcpu_xsave_area() already.
+ * The state which isn't taken from the vcpu context by init_vmcs is loaded
+ * by vcpu_load_restored_state() on the first VM entry.
+ *
+ * @param[inout] vcpu pointer to vcpu data structure
+ * @param[in] state the registers' value
+ *
+ * @retval 0 on success
+ * @retval -EINVAL if the XSAVE state, XCR0 or a syscall MSR can't be loaded for the vcpu
+ */
+int32_t set_vcpu_state(struct acrn_vcpu *vcpu, const struct acrn_cpu_state *state);
+void vcpu_load_restored_state(struct acrn_vcpu *vcpu);
+
 /**
  * @brief reset all the vcpu registers
  *
@@ -587,6 +644,21 @@ void reset_vcpu_regs(struct acrn_vcpu *vcpu, enum reset_mode mode);
 
 bool sanitize_cr0_cr4_pattern(void);
 
+/**
+ * @brief check a value the vcpu may load to XCR0
+ *
+ * XSETBV faults on an XCR0 value with a reserved bit set, with bit 0 (x87 state)
+ * cleared, with AVX enabled without SSE, or with the AVX-512 bits enabled partially
+ * or without AVX. Besides, the vcpu may only enable the state components reported
+ * in its CPUID.(EAX=0DH,ECX=0), which never include the MPX ones.
+ *
+ * @param[in] vcpu pointer to vcpu data structure
+ * @param[in] xcr0 the value to check
+ *
+ * @return true if the value can be loaded to XCR0 for the vcpu
+ */
+bool is_guest_xcr0_valid(struct acrn_vcpu *vcpu, uint64_t xcr0);
+
 /**
  * @brief Initialize the protect mode vcpu registers
  *
@@ -631,6 +703,7 @@ struct acrn_vcpu *get_ever_run_vcpu(uint16_t pcpu_id);
 
 void save_xsave_area(struct acrn_vcpu *vcpu, struct ext_context *ectx);
 void rstore_xsave_area(const struct acrn_vcpu *vcpu, const struct ext_context *ectx);
+void flush_lazy_ext_context(void);
 void load_iwkey(struct acrn_vcpu *vcpu);
 
 /**
@@ -772,6 +845,43 @@ static inline bool is_lapic_pt_enabled(struct acrn_vcpu *vcpu)
  */
 void vcpu_handle_pi_notification(uint32_t vcpu_index);
 
+/**
+ * @brief handle posted interrupt wakeup notification
+ *
+ * VT-d PI wakeup handler, wake up the vCPUs blocked on current pCPU whose
+ * PID's bit ON is set. Only the blocked vCPUs are walked.
+ *
+ * @return None
+ */
+void vcpu_handle_pi_wakeup(void);
+
+/**
+ * @brief prepare the posted interrupt descriptor of a vCPU going to block
+ *
+ * Switch the NV of the PID to POSTED_INTR_WAKEUP_VECTOR and queue the vCPU
+ * on the blocked list of its pCPU.
+ *
+ * @param[inout] vcpu pointer to vcpu data structure
+ * @pre vcpu != NULL
+ * @pre pcpuid_from_vcpu(vcpu) == get_pcpu_id()
+ *
+ * @return true if an interrupt has already been posted and the vCPU shall not block
+ */
+bool vcpu_pi_pre_block(struct acrn_vcpu *vcpu);
+
+/**
+ * @brief restore the posted interrupt descriptor of a vCPU after blocking
+ *
+ * Restore the per-VM NV of the PID and dequeue the vCPU from the blocked
+ * list of its pCPU. Does nothing if the vCPU is not blocked.
+ *
+ * @param[inout] vcpu pointer to vcpu data structure
+ * @pre vcpu != NULL
+ *
+ * @return None
+ */
+void vcpu_pi_post_block(struct acrn_vcpu *vcpu);
+
 /*
  * @brief Update the state of vCPU and state of vlapic
  *
@@ -7,9 +7,28 @@
 #ifndef VCPUID_H_
 #define VCPUID_H_
 
+struct acrn_vm;
+struct acrn_vcpu;
+
 #define CPUID_CHECK_SUBLEAF	(1U << 0U)
 #define MAX_VM_VCPUID_ENTRIES	64U
 
+/*
+ * Ranges of CPUID leaves which are direct-mapped to the per-VM vcpuid
+ * entries, leaves out of these ranges fall back to a binary search.
+ */
+#define VCPUID_BASIC_LEAF_NUM		0x40U
+#define VCPUID_HV_LEAF_BASE		0x40000000U
+#define VCPUID_HV_LEAF_NUM		0x20U
+#define VCPUID_EXT_LEAF_BASE		0x80000000U
+#define VCPUID_EXT_LEAF_NUM		0x20U
+#define VCPUID_INDEX_NUM		(VCPUID_BASIC_LEAF_NUM + VCPUID_HV_LEAF_NUM + VCPUID_EXT_LEAF_NUM)
+
+#ifdef CONFIG_CPUID_PRECOMPUTE_ENABLED
+/* Max cached sub-leaves of CPUID.0BH, including the terminating invalid level */
+#define VCPUID_CACHE_0BH_SUBLEAF_NUM	8U
+#endif
+
 /* Guest capability flags reported by CPUID */
 #define GUEST_CAPS_PRIVILEGE_VM	(1U << 0U)
 
@@ -24,6 +43,36 @@ struct vcpuid_entry {
 	uint32_t padding;
 };
 
+/* vcpuid_entries[first, first + nr) are the entries of one CPUID leaf, nr is 0 if the leaf is absent */
+struct vcpuid_leaf_index {
+	uint8_t first;
+	uint8_t nr;
+};
+
+#ifdef CONFIG_CPUID_PRECOMPUTE_ENABLED
+struct vcpuid_regs {
+	uint32_t eax;
+	uint32_t ebx;
+	uint32_t ecx;
+	uint32_t edx;
+};
+
+/*
+ * Per-vCPU precomputed response of the vCPU related CPUID leaves, with the
+ * APIC ID already patched. Only the bits depending on guest runtime state
+ * (CR4, MSR_IA32_MISC_ENABLE, keylocker) are fixed up at CPUID exit.
+ */
+struct vcpuid_cache {
+	struct vcpuid_regs leaf_01h;
+	struct vcpuid_regs leaf_19h;
+	struct vcpuid_regs leaf_80000001h;
+	uint32_t nr_0bh;
+	struct vcpuid_regs leaf_0bh[VCPUID_CACHE_0BH_SUBLEAF_NUM];
+};
+
+void init_vcpuid_cache(struct acrn_vcpu *vcpu);
+#endif
+
 int32_t set_vcpuid_entries(struct acrn_vm *vm);
 void guest_cpuid(struct acrn_vcpu *vcpu,
 			uint32_t *eax, uint32_t *ebx,
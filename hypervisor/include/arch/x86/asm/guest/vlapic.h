@@ -163,6 +163,23 @@ static inline uint32_t prio(uint32_t x)
  */
 int32_t vlapic_set_local_intr(struct acrn_vm *vm, uint16_t vcpu_id_arg, uint32_t lvt_index);
 
+/**
+ * @brief Defer posted interrupt notifications sent by the current pCPU.
+ *
+ * Till vlapic_flush_pi_notification, posted interrupt notifications to vCPUs on
+ * other pCPUs are collected instead of being sent, so interrupts posted to one
+ * vCPU in between raise one notification.
+ */
+void vlapic_defer_pi_notification(void);
+
+/**
+ * @brief Send the posted interrupt notifications deferred on the current pCPU.
+ *
+ * Send one notification to each vCPU collected since vlapic_defer_pi_notification
+ * and stop deferring.
+ */
+void vlapic_flush_pi_notification(void);
+
 /**
  * @brief Inject MSI to target VM.
  *
@@ -197,6 +214,9 @@ void vlapic_free(struct acrn_vcpu *vcpu);
 
 void vlapic_reset(struct acrn_vlapic *vlapic, const struct acrn_apicv_ops *ops, enum reset_mode mode);
 void vlapic_restore(struct acrn_vlapic *vlapic, const struct lapic_regs *regs);
+void vlapic_get_state(const struct acrn_vlapic *vlapic, struct acrn_vlapic_state *state);
+void vlapic_set_state(struct acrn_vlapic *vlapic, const struct acrn_vlapic_state *state);
+void vlapic_load_restored_state(struct acrn_vlapic *vlapic);
 uint64_t vlapic_apicv_get_apic_access_addr(void);
 uint64_t vlapic_apicv_get_apic_page_addr(struct acrn_vlapic *vlapic);
 int32_t apic_access_vmexit_handler(struct acrn_vcpu *vcpu);
@@ -14,6 +14,7 @@
 #ifndef ASSEMBLER
 
 #include <asm/lib/bits.h>
+#include <list.h>
 #include <asm/lib/spinlock.h>
 #include <asm/pgtable.h>
 #include <asm/guest/vcpu.h>
@@ -31,6 +32,44 @@
 #include <asm/guest/hyperv.h>
 #endif
 
+/* max size of the per-VM hash of ptirq entries by virtual SID */
+#define PTIRQ_VM_HASHBITS_MAX	9U
+#define PTIRQ_VM_HASHSIZE_MAX	(1U << PTIRQ_VM_HASHBITS_MAX)
+
+/* # of EPT locks of a VM, the 1G GPA slot n (a PDPTE subtree) is protected by ept_lock[n % EPT_LOCK_SHARDS] */
+#define EPT_LOCK_SHARDS		16U
+
+/* # of GPAs drained from the PML of the vCPUs that a VM keeps till the next dirty bitmap harvest */
+#define EPT_DIRTY_LOG_ENTRIES	1024U
+/* # of GPA ranges that a VM keeps to be harvested by walking the EPT dirty flags */
+#define EPT_DIRTY_WALK_RANGES	8U
+
+struct ept_dirty_range {
+	uint64_t start;
+	uint64_t end;
+};
+
+/*
+ * Dirty page logging of the normal world memory of a VM. The EPT dirty flags record
+ * the written pages, the pages written since the last harvest are found either from
+ * the GPAs logged by PML or by walking the EPT. The latter is needed for the ranges
+ * in walk[], i.e. all the guest memory when logging starts or when gpa[] overflows.
+ */
+struct ept_dirty_log {
+	bool enabled;
+	bool use_pml;
+	uint32_t busy;		/* a hypercall is changing or harvesting the log */
+	uint32_t flushing;	/* # of ept_flush_guest_cache() which may clear the dirty flags */
+
+	spinlock_t lock;	/* protects the fields below and the PML of the vCPUs */
+	uint32_t nr_walk;
+	struct ept_dirty_range walk[EPT_DIRTY_WALK_RANGES];
+	/* GPAs are logged into gpa[cur], the other one is being harvested */
+	uint32_t cur;
+	uint32_t count;
+	uint64_t gpa[2][EPT_DIRTY_LOG_ENTRIES];
+};
+
 enum reset_mode {
 	POWER_ON_RESET,		/* reset by hardware Power-on */
 	COLD_RESET,		/* hardware cold reset */
@@ -89,6 +128,15 @@ enum vm_state {
 	VM_PAUSED,	/* VM paused */
 };
 
+/* phases of a pre-launched or Service VM launched by launch_vms() */
+enum vm_launch_phase {
+	VM_LAUNCH_BEGIN = 0,	/* prepare_vm() entered */
+	VM_LAUNCH_CREATED,	/* create_vm() done, EPT populated */
+	VM_LAUNCH_LOADED,	/* OS image loaded */
+	VM_LAUNCH_STARTED,	/* start_vm() done */
+	VM_LAUNCH_PHASES
+};
+
 enum vm_vlapic_mode {
 	VM_VLAPIC_DISABLED = 0U,
 	VM_VLAPIC_XAPIC,
@@ -130,6 +178,15 @@ struct vm_arch {
 
 	/* reference to virtual platform to come here (as needed) */
 	bool vm_mwait_cap;
+
+	/* EPT accessed and dirty flags are enabled, used by WBINVD emulation and dirty page logging */
+	bool ept_ad_enabled;
+	/* the dirty flags of the normal world EPT track all the writes since the last WBINVD */
+	bool wbinvd_dirty_tracked;
+	/* bumped by ept_hv_write_done(), the writes the dirty flags miss */
+	uint32_t hv_write_gen;
+	uint32_t wbinvd_hv_write_gen;	/* hv_write_gen at the last WBINVD */
+	struct ept_dirty_log dirty_log;
 } __aligned(PAGE_SIZE);
 
 struct acrn_vm {
@@ -149,7 +206,8 @@ struct acrn_vm {
 	 */
 	spinlock_t vm_state_lock;
 	spinlock_t vlapic_mode_lock;	/* Spin-lock used to protect vlapic_mode modifications for a VM */
-	spinlock_t ept_lock;	/* Spin-lock used to protect ept add/modify/remove for a VM */
+	/* Spin-locks used to protect ept add/modify/remove for a VM, one per group of 1G GPA slots */
+	spinlock_t ept_lock[EPT_LOCK_SHARDS];
 	spinlock_t emul_mmio_lock;	/* Used to protect emulation mmio_node concurrent access for a VM */
 	uint16_t nr_emul_mmio_regions;	/* the emulated mmio_region number */
 	struct mem_io_node emul_mmio[CONFIG_MAX_EMULATED_MMIO_REGIONS];
@@ -168,10 +226,27 @@ struct acrn_vm {
 
 	uint32_t vcpuid_entry_nr, vcpuid_level, vcpuid_xlevel;
 	struct vcpuid_entry vcpuid_entries[MAX_VM_VCPUID_ENTRIES];
+	struct vcpuid_leaf_index vcpuid_index[VCPUID_INDEX_NUM];
 	struct acrn_vpci vpci;
 	uint8_t vrtc_offset;
 
 	uint64_t intr_inject_delay_delta; /* delay of intr injection */
+	uint32_t intr_storm_threshold;	/* interrupts per window of one ptirq source to start coalescing, 0: off */
+	uint64_t intr_storm_max_delay;	/* max adaptive delay of intr injection */
+
+	/*
+	 * ptirq entries of this VM hashed by virtual SID. The hash uses the
+	 * first (1 << ptirq_hash_bits) heads and is doubled as entries are
+	 * added; ptirq_hash_seq is odd while it is being resized.
+	 */
+	volatile uint32_t ptirq_hash_seq;
+	uint16_t ptirq_hash_bits;
+	uint16_t ptirq_hash_num;
+	struct hlist_head ptirq_virt_heads[PTIRQ_VM_HASHSIZE_MAX];
+
+	/* pCPUs sharing the EPT population and image copy of launch_vms(), 0 out of it */
+	uint64_t launch_helpers;
+	uint64_t launch_tsc[VM_LAUNCH_PHASES];	/* TSC at the end of each launch phase */
 } __aligned(PAGE_SIZE);
 
 /*
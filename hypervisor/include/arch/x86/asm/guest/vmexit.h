@@ -7,6 +7,12 @@
 #ifndef VMEXIT_H_
 #define VMEXIT_H_
 
+/*
+ * According to "SDM APPENDIX C VMX BASIC EXIT REASONS",
+ * there are 65 Basic Exit Reasons.
+ */
+#define NR_VMX_EXIT_REASONS	70U
+
 struct vm_exit_dispatch {
 	int32_t (*handler)(struct acrn_vcpu *);
 	uint32_t need_exit_qualification;
@@ -37,8 +37,11 @@
  * This reduces # of pre-allocated ANVs for posted interrupts to CONFIG_MAX_VM_NUM,
  * and enables ACRN to avoid switching between active and wake-up vector values
  * in the posted interrupt descriptor on vCPU scheduling state changes.
+ *
+ * 1 entry for the posted interrupt wakeup vector, which replaces the ANV of a
+ * vCPU only while it is blocked in HLT, see vcpu_pi_pre_block().
  */
-#define NR_STATIC_MAPPINGS	(NR_STATIC_MAPPINGS_1 + CONFIG_MAX_VM_NUM)
+#define NR_STATIC_MAPPINGS	(NR_STATIC_MAPPINGS_1 + CONFIG_MAX_VM_NUM + 1U)
 
 #define HYPERVISOR_CALLBACK_HSM_VECTOR	0xF3U
 
@@ -59,6 +62,16 @@
  * consecutive vectors reserved for posted interrupts
  */
 #define POSTED_INTR_VECTOR	(VECTOR_FIXED_START + NR_STATIC_MAPPINGS_1)
+/* notification vector of the posted interrupt descriptors of blocked vCPUs */
+#define POSTED_INTR_WAKEUP_VECTOR	(POSTED_INTR_VECTOR + CONFIG_MAX_VM_NUM)
+
+/* the posted interrupt vectors follow PMI_VECTOR and must fit in the fixed vectors range */
+#if POSTED_INTR_VECTOR <= PMI_VECTOR
+#error "POSTED_INTR_VECTOR overlaps the timer, vCPU notify or PMI vector"
+#endif
+#if POSTED_INTR_WAKEUP_VECTOR > VECTOR_FIXED_END
+#error "CONFIG_MAX_VM_NUM is too large for the posted interrupt vectors"
+#endif
 
 #define TIMER_IRQ		(NR_IRQS - 1U)
 #define NOTIFY_VCPU_IRQ		(NR_IRQS - 2U)
@@ -69,6 +82,7 @@
  * consecutive IRQs reserved for posted interrupts
  */
 #define POSTED_INTR_IRQ	(NR_IRQS - NR_STATIC_MAPPINGS_1 - CONFIG_MAX_VM_NUM)
+#define POSTED_INTR_WAKEUP_IRQ	(POSTED_INTR_IRQ - 1U)
 
 /* the maximum number of msi entry is 2048 according to PCI
  * local bus specification
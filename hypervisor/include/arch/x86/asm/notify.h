@@ -8,13 +8,41 @@
 #define NOTIFY_H
 
 typedef void (*smp_call_func_t)(void *data);
+
+/* Completion token of a cross-CPU call, a bit is cleared once that pCPU has run the call */
+struct smp_call_token {
+	volatile uint64_t pending_mask;
+};
+
 struct smp_call_info_data {
 	smp_call_func_t func;
 	void *data;
+	struct smp_call_token *token;
+};
+
+/* Each pCPU owns a lock-free queue of the calls targeting it, any pCPU can be a producer */
+#define SMP_CALL_QUEUE_SIZE	64U
+struct smp_call_queue {
+	volatile uint64_t busy_bitmap;		/* slots allocated by producers */
+	volatile uint64_t pending_bitmap;	/* slots ready to be run by the owner pCPU */
+	struct smp_call_info_data slots[SMP_CALL_QUEUE_SIZE];
+};
+
+/* Work split into nr_chunks chunks, claimed one by one by the pCPUs sharing it */
+typedef void (*smp_split_func_t)(void *data, uint64_t chunk);
+struct smp_split_work {
+	smp_split_func_t func;
+	void *data;
+	uint64_t nr_chunks;
+	int64_t next_chunk;	/* the next chunk to be claimed */
 };
 
 struct acrn_vm;
 void smp_call_function(uint64_t mask, smp_call_func_t func, void *data);
+void smp_call_function_async(uint64_t mask, smp_call_func_t func, void *data, struct smp_call_token *token);
+bool smp_call_done(const struct smp_call_token *token);
+void smp_call_wait(struct smp_call_token *token);
+void smp_call_split(uint64_t helper_mask, smp_split_func_t func, void *data, uint64_t nr_chunks);
 
 void setup_notification(void);
 void setup_pi_notification(void);
@@ -20,6 +20,9 @@
 #include <asm/security.h>
 #include <asm/vm_config.h>
 
+/* max distinct vCPUs whose posted interrupt notification can be deferred on a pCPU */
+#define MAX_DEFERRED_PI_NOTIFY	16U
+
 struct per_cpu_region {
 	/* vmxon_region MUST be 4KB-aligned */
 	uint8_t vmxon_region[PAGE_SIZE];
@@ -54,14 +57,33 @@ struct per_cpu_region {
 	uint32_t lapic_id;
 	uint32_t lapic_ldr;
 	uint32_t softirq_servicing;
-	struct smp_call_info_data smp_call_info;
+	struct smp_call_queue smp_call_queue;
 	struct list_head softirq_dev_entry_list;
+	uint64_t ptirq_batch_count;	/* drains of softirq_dev_entry_list by SOFTIRQ_PTDEV */
+	uint64_t ptirq_inject_count;	/* ptirq entries handled by SOFTIRQ_PTDEV */
+	/* posted interrupt notifications deferred till the end of a ptirq softirq batch */
+	bool pi_notify_deferred;
+	uint16_t pi_notify_num;
+	struct acrn_vcpu *pi_notify_vcpus[MAX_DEFERRED_PI_NOTIFY];
+	uint64_t pi_notify_count;	/* deferred notifications sent, one per destination vCPU and batch */
+	/* vCPUs blocked in HLT whose posted interrupt descriptor notifies POSTED_INTR_WAKEUP_VECTOR */
+	struct list_head pi_blocked_vcpus;
+	spinlock_t pi_blocked_lock;
+	uint64_t pi_wakeup_count;	/* vCPUs woken up by the posted interrupt wakeup handler */
 #ifdef PROFILING_ON
 	struct profiling_info_wrapper profiling_info;
 #endif
 	uint64_t shutdown_vm_bitmap;
 	uint64_t tsc_suspend;
 	struct acrn_vcpu *whose_iwkey;
+	/*
+	 * The vCPU whose syscall MSRs and XSAVE state are currently live on this pCPU.
+	 * They are only written back when another vCPU is switched in (lazy context switch).
+	 */
+	struct acrn_vcpu *whose_ext_ctx;
+	uint64_t ext_ctx_switch_count;	/* switch-ins that had to save/restore the extended context */
+	uint64_t ext_ctx_lazy_count;	/* switch-ins that reused the live extended context */
+	uint64_t ext_ctx_switch_tsc;	/* TSC cycles spent in vCPU switch_out/switch_in */
 	/*
 	 * We maintain a per-pCPU array of vCPUs. vCPUs of a VM won't
 	 * share same pCPU. So the maximum possible # of vCPUs that can
@@ -116,6 +116,10 @@
 
 #define EPT_MT_MASK		(7UL << EPT_MT_SHIFT)
 #define EPT_VE			(1UL << 63U)
+/* EPT accessed and dirty flags, only updated by the processor when bit 6 of EPTP is set */
+#define EPT_ACCESSED		(1UL << 8U)
+#define EPT_DIRTY_POS		9U
+#define EPT_DIRTY		(1UL << EPT_DIRTY_POS)
 /* EPT leaf entry bits (bit 52 - bit 63) should be maksed  when calculate PFN */
 #define EPT_PFN_HIGH_MASK	0xFFF0000000000000UL
 
@@ -176,6 +180,14 @@ struct pgtable {
 	void (*clflush_pagewalk)(const void *p);
 	void (*tweak_exe_right)(uint64_t *entry);
 	void (*recover_exe_right)(uint64_t *entry);
+	/* merge a PD page into a 1GB page once it maps one, the PD pages must not be shared */
+	bool merge_pd_pages;
+};
+
+/* page table walk summary, see pgtable_get_stats() */
+struct pgtable_stats {
+	uint64_t leaves[IA32E_PT + 1];	/* present leaf entries per level, 1GB pages at IA32E_PDPT */
+	uint64_t table_pages;		/* paging-structure pages, the root included */
 };
 
 /**
@@ -330,6 +342,8 @@ void pgtable_add_map(uint64_t *pml4_page, uint64_t paddr_base,
 void pgtable_modify_or_del_map(uint64_t *pml4_page, uint64_t vaddr_base,
 		uint64_t size, uint64_t prot_set, uint64_t prot_clr,
 		const struct pgtable *table, uint32_t type);
+void pgtable_get_stats(const uint64_t *pml4_page, const struct pgtable *table,
+		struct pgtable_stats *stats);
 /**
  * @}
  */
@@ -59,7 +59,8 @@
 #define DM_OWNED_GUEST_FLAG_MASK	0UL
 #else
 #define DM_OWNED_GUEST_FLAG_MASK	(GUEST_FLAG_SECURE_WORLD_ENABLED | GUEST_FLAG_LAPIC_PASSTHROUGH \
-					| GUEST_FLAG_RT | GUEST_FLAG_IO_COMPLETION_POLLING | GUEST_FLAG_PMU_PASSTHROUGH)
+					| GUEST_FLAG_RT | GUEST_FLAG_IO_COMPLETION_POLLING | GUEST_FLAG_PMU_PASSTHROUGH \
+					| GUEST_FLAG_DIRTY_LOG)
 #endif
 
 /* ACRN guest severity */
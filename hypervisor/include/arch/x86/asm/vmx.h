@@ -340,6 +340,9 @@
 #define VMX_PROCBASED_CTLS2_ENCLV_EXIT (1U<<28U)
 #define VMX_PROCBASED_CTLS3_LOADIWKEY  (1U<<0U)
 
+/* Page Modification Log: a 4K page of 512 GPAs, the index counts down from 511 */
+#define PML_ENTRY_NUM			512U
+
 /* MSR_IA32_VMX_EPT_VPID_CAP: EPT and VPID capability bits */
 #define VMX_EPT_EXECUTE_ONLY		(1UL << 0U)
 #define VMX_EPT_PAGE_WALK_4		(1UL << 6U)
@@ -564,6 +564,17 @@ union dmar_ir_entry {
 	} bits __packed;
 };
 
+/* invalidation queue statistics of one DMAR unit */
+struct iommu_qi_stats {
+	uint64_t submits;		/* tail register writes, each followed by one wait descriptor */
+	uint64_t descs;			/* invalidation descriptors, wait descriptors excluded */
+	uint64_t async_submits;		/* submissions not waited for */
+	uint64_t sync_waits;
+	uint64_t timeouts;
+	uint64_t total_wait_ticks;	/* from posting the descriptors to the completion of the wait descriptor */
+	uint64_t max_wait_ticks;
+};
+
 #ifdef CONFIG_ACPI_PARSE_ENABLED
 int32_t parse_dmar_table(struct dmar_info *plat_dmar_info);
 #endif
@@ -641,6 +652,22 @@ struct iommu_domain *create_iommu_domain(uint16_t vm_id, uint64_t translation_ta
  */
 void destroy_iommu_domain(struct iommu_domain *domain);
 
+/**
+ * @brief Invalidate the IOTLB entries of a guest physical address range of an iommu domain.
+ *
+ * Invalidate the range on the IOMMUs with devices assigned to the domain, with page-selective
+ * invalidations of naturally aligned power-of-two chunks, or a domain-selective invalidation
+ * if the range needs too many of them.
+ *
+ * @param[in] domain iommu domain whose translation table was changed
+ * @param[in] gpa start guest physical address of the changed range
+ * @param[in] size size of the changed range
+ *
+ * @pre domain != NULL
+ *
+ */
+void iommu_invalidate_range(const struct iommu_domain *domain, uint64_t gpa, uint64_t size);
+
 /**
  * @brief Enable translation of IOMMUs.
  *
@@ -728,6 +755,19 @@ void dmar_free_irte(const struct intr_source *intr_src, uint16_t index);
  *
  */
 void iommu_flush_cache(const void *p, uint32_t size);
+
+/**
+ * @brief Get the invalidation queue statistics of a DMAR unit.
+ *
+ * @param[in] dmar_index index of the DMAR unit on the platform
+ * @param[out] stats buffer to hold the statistics
+ *
+ * @retval 0 on success
+ * @retval -ENODEV if there is no DMAR unit with the index
+ *
+ * @pre stats != NULL
+ */
+int32_t get_iommu_qi_stats(uint32_t dmar_index, struct iommu_qi_stats *stats);
 /**
   * @}
   */
@@ -153,6 +153,36 @@ int32_t hcall_pause_vm(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm, uint64
  */
 int32_t hcall_set_vcpu_regs(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm, uint64_t param1, uint64_t param2);
 
+/**
+ * @brief get vcpu state
+ *
+ * Get the complete architectural state of a vCPU of a paused VM.
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param1 not used
+ * @param param2 guest physical address. This gpa points to
+ *              struct acrn_vcpu_state
+ *
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_get_vcpu_state(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm, uint64_t param1, uint64_t param2);
+
+/**
+ * @brief set vcpu state
+ *
+ * Set the complete architectural state of a vCPU before the VM is started.
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param1 not used
+ * @param param2 guest physical address. This gpa points to
+ *              struct acrn_vcpu_state
+ *
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_set_vcpu_state(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm, uint64_t param1, uint64_t param2);
+
 /**
  * @brief set or clear IRQ line
  *
@@ -170,6 +200,38 @@ int32_t hcall_set_vcpu_regs(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm, u
  */
 int32_t hcall_set_irqline(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm, uint64_t param1, uint64_t param2);
 
+/**
+ * @brief get irqchip state
+ *
+ * Get the state of a vLAPIC, the vIOAPIC or the vPIC of a paused VM.
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param1 not used
+ * @param param2 guest physical address. This gpa points to
+ *              struct acrn_irqchip_state
+ *
+ * @pre is_service_vm(vcpu->vm)
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_get_irqchip_state(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm, uint64_t param1, uint64_t param2);
+
+/**
+ * @brief set irqchip state
+ *
+ * Set the state of a vLAPIC, the vIOAPIC or the vPIC before the VM is started.
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param1 not used
+ * @param param2 guest physical address. This gpa points to
+ *              struct acrn_irqchip_state
+ *
+ * @pre is_service_vm(vcpu->vm)
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_set_irqchip_state(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm, uint64_t param1, uint64_t param2);
+
 /**
  * @brief inject MSI interrupt
  *
@@ -262,6 +324,33 @@ int32_t hcall_write_protect_page(struct acrn_vcpu *vcpu, struct acrn_vm *target_
  */
 int32_t hcall_gpa_to_hpa(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm, uint64_t param1, uint64_t param2);
 
+/**
+ * @brief start or stop the dirty page logging of a VM
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param1 not used
+ * @param param2 1 to start the logging, 0 to stop it
+ *
+ * @pre is_service_vm(vcpu->vm)
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_set_dirty_log(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm, uint64_t param1, uint64_t param2);
+
+/**
+ * @brief get and clear the dirty pages of a VM
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param1 not used
+ * @param param2 guest physical address. This gpa points to
+ *              struct acrn_dirty_bitmap
+ *
+ * @pre is_service_vm(vcpu->vm)
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_get_dirty_bitmap(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm, uint64_t param1, uint64_t param2);
+
 /**
  * @brief Assign one PCI dev to VM.
  *
@@ -554,6 +643,34 @@ int32_t hcall_setup_hv_npk_log(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm
  */
 int32_t hcall_get_hw_info(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm, uint64_t param1, uint64_t param2);
 
+/**
+ * @brief Get the VM exit latency histogram of one exit reason of one vCPU
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param1 relative vmid to service vm
+ * @param param2 guest physical address. This gpa points to
+ *              struct acrn_vmexit_latency
+ *
+ * @pre is_service_vm(vcpu->vm)
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_get_vmexit_latency(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm, uint64_t param1, uint64_t param2);
+
+/**
+ * @brief Get the number of the pages of each size in the EPT of a VM
+ *
+ * @param vcpu Pointer to vCPU that initiates the hypercall
+ * @param target_vm Pointer to target VM data structure
+ * @param param1 relative vmid to service vm
+ * @param param2 guest physical address. This gpa points to
+ *              struct acrn_ept_page_sizes
+ *
+ * @pre is_service_vm(vcpu->vm)
+ * @return 0 on success, non-zero on error.
+ */
+int32_t hcall_get_ept_page_sizes(struct acrn_vcpu *vcpu, struct acrn_vm *target_vm, uint64_t param1, uint64_t param2);
+
 /**
  * @brief Execute profiling operation
  *
@@ -143,9 +143,23 @@ struct ptirq_remapping_info {
 
 	uint64_t intr_count;
 	struct hv_timer intr_delay_timer; /* used for delay intr injection */
+
+	/* adaptive interrupt storm mitigation, only touched in the interrupt handler */
+	uint64_t intr_window_start;	/* tick the current rate window started at */
+	uint32_t intr_window_count;	/* interrupts in the current rate window */
+	uint64_t intr_storm_delay;	/* adaptive delay of intr injection, 0: not coalesced */
+	uint64_t intr_storm_count;	/* rate windows above the threshold */
 	ptirq_arch_release_fn_t release_cb;
 };
 
+/* occupancy of a ptirq entry hash */
+struct ptirq_hash_stats {
+	uint32_t buckets;	/* buckets in use by the hash */
+	uint32_t used_buckets;	/* non-empty buckets */
+	uint32_t entries;
+	uint32_t max_chain;	/* longest chain */
+};
+
 static inline bool is_entry_active(const struct ptirq_remapping_info *entry)
 {
 	return entry->active;
@@ -184,6 +198,42 @@ extern spinlock_t ptdev_lock;
 struct ptirq_remapping_info *find_ptirq_entry(uint32_t intr_type,
 		const union source_id *sid, const struct acrn_vm *vm);
 
+/*
+ * @brief Find the active ptdev entry a physical irq is allocated to
+ *
+ * param[in] irq physical irq
+ *
+ * @retval NULL when no active ptirq entry owns the irq
+ * @retval ptirq entry which owns the irq
+ */
+struct ptirq_remapping_info *ptirq_find_entry_by_irq(uint32_t irq);
+
+/*
+ * @brief Move an active ptdev entry to another VM
+ *
+ * Rehash the entry with its new owner and virtual sid.
+ *
+ * @pre ptdev_lock is held
+ */
+void ptirq_change_entry_owner(struct ptirq_remapping_info *entry, struct acrn_vm *vm,
+		const union source_id *virt_sid);
+
+/*
+ * @brief Initialize the virtual sid hash of a VM
+ */
+void ptirq_init_vm_hash(struct acrn_vm *vm);
+
+/*
+ * @brief Get the occupancy of a ptirq entry hash
+ *
+ * param[in] vm the VM whose virtual sid hash is inspected, NULL for the
+ *	physical sid hash
+ * param[out] stats the occupancy
+ *
+ * @pre ptdev_lock is held
+ */
+void ptirq_get_hash_stats(const struct acrn_vm *vm, struct ptirq_hash_stats *stats);
+
 /**
  * @brief Handler of softirq for passthrough device.
  *
@@ -222,17 +272,19 @@ void ptdev_init(void);
 void ptdev_release_all_entries(const struct acrn_vm *vm);
 
 /**
- * @brief Dequeue an entry from per cpu ptdev softirq queue.
+ * @brief Dequeue entries from per cpu ptdev softirq queue.
  *
- * Dequeue an entry from the ptdev softirq queue on the specific physical cpu.
+ * Dequeue up to max_num entries from the ptdev softirq queue on the specific physical cpu
+ * with interrupts disabled once, entries whose injection is delayed are moved to their timer.
  *
  * @param[in]    pcpu_id physical cpu id
+ * @param[out]   entries array to store the dequeued entries
+ * @param[in]    max_num size of the entries array
  *
- * @retval NULL when the queue is empty
- * @retval !NULL when there is available ptirq_remapping_info entry in the queue
+ * @return the number of entries dequeued, less than max_num when the queue is drained
  *
  */
-struct ptirq_remapping_info *ptirq_dequeue_softirq(uint16_t pcpu_id);
+uint32_t ptirq_dequeue_softirq(uint16_t pcpu_id, struct ptirq_remapping_info **entries, uint32_t max_num);
 /**
  * @brief Allocate a ptirq_remapping_info entry.
  *
@@ -279,14 +331,33 @@ void ptirq_deactivate_entry(struct ptirq_remapping_info *entry);
 /**
  * @brief Get the interrupt information and store to the buffer provided.
  *
+ * Each interrupt source takes 2 elements of the buffer: the physical irq and the interrupt count,
+ * followed by the adaptive storm mitigation counters if storm_data is true: the count of windows
+ * above the threshold and the current adaptive delay in us.
+ *
  * @param[in]    target_vm the VM to get the interrupt information.
  * @param[out]   buffer where interrupt information is stored.
  * @param[in]    buffer_cnt the size of the buffer.
+ * @param[in]    storm_data whether to store the adaptive storm mitigation counters.
  *
  * @retval the actual size the buffer filled with the interrupt information
  *
  */
-uint32_t ptirq_get_intr_data(const struct acrn_vm *target_vm, uint64_t *buffer, uint32_t buffer_cnt);
+uint32_t ptirq_get_intr_data(const struct acrn_vm *target_vm, uint64_t *buffer, uint32_t buffer_cnt,
+		bool storm_data);
+
+/**
+ * @brief Set the adaptive interrupt storm mitigation of a VM.
+ *
+ * @param[in]    vm the VM whose passthrough interrupts are monitored.
+ * @param[in]    threshold interrupts per ms of one source above which its injection is coalesced, 0 to disable.
+ * @param[in]    max_delay_us max delay in us of the coalesced injection.
+ *
+ * @retval 0 on success
+ * @retval -EINVAL for RT VMs, whose interrupt injection is never delayed
+ *
+ */
+int32_t ptirq_set_storm_adaptive(struct acrn_vm *vm, uint32_t threshold, uint32_t max_delay_us);
 
 /**
   * @}
@@ -0,0 +1,24 @@
+/*
+ * Copyright (C) 2022 Intel Corporation.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef VMEXIT_LATENCY_H
+#define VMEXIT_LATENCY_H
+
+#include <types.h>
+
+struct acrn_vcpu;
+struct acrn_vmexit_latency;
+
+/* Clear the histograms of a newly created vCPU */
+void vmexit_latency_reset(const struct acrn_vcpu *vcpu);
+/* Called right after a VM exit of vcpu */
+void vmexit_latency_exit(const struct acrn_vcpu *vcpu);
+/* Called right before a VM entry of vcpu, accounts the time since the last VM exit */
+void vmexit_latency_enter(const struct acrn_vcpu *vcpu);
+
+int32_t get_vmexit_latency(uint16_t vm_id, struct acrn_vmexit_latency *latency);
+
+#endif /* VMEXIT_LATENCY_H */
@@ -60,6 +60,11 @@ struct acrn_single_vioapic {
 	union ioapic_rte rtbl[REDIR_ENTRIES_HW];
 	/* pin_state status bitmap: 1 - high, 0 - low */
 	uint64_t pin_state[STATE_BITMAP_SIZE];
+
+	/* irqline statistics */
+	uint64_t fast_count;		/* edge interrupts delivered without the lock */
+	uint64_t lock_count;		/* acquisitions of the lock */
+	uint64_t lock_contended;	/* acquisitions which found the lock held */
 };
 
 /*
@@ -117,6 +122,8 @@ void	vioapic_set_irqline_nolock(const struct acrn_vm *vm, uint32_t vgsi, uint32_
 uint32_t get_vm_gsicount(const struct acrn_vm *vm);
 void	vioapic_broadcast_eoi(const struct acrn_vm *vm, uint32_t vector);
 void	vioapic_get_rte(const struct acrn_vm *vm, uint32_t vgsi, union ioapic_rte *rte);
+void	vioapic_get_state(const struct acrn_vm *vm, struct acrn_vioapic_state *state);
+void	vioapic_set_state(const struct acrn_vm *vm, const struct acrn_vioapic_state *state);
 int32_t	vioapic_mmio_access_handler(struct io_request *io_req, void *handler_private_data);
 struct acrn_single_vioapic *vgsi_to_vioapic_and_vpin(const struct acrn_vm *vm, uint32_t vgsi, uint32_t *vpin);
 
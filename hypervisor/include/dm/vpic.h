@@ -180,6 +180,8 @@ void vpic_pending_intr(struct acrn_vpic *vpic, uint32_t *vecptr);
 void vpic_intr_accepted(struct acrn_vpic *vpic, uint32_t vector);
 void vpic_get_irqline_trigger_mode(const struct acrn_vpic *vpic, uint32_t vgsi, enum vpic_trigger *trigger);
 uint32_t vpic_pincount(void);
+void vpic_get_state(struct acrn_vpic *vpic, struct acrn_i8259_state state[2]);
+void vpic_set_state(struct acrn_vpic *vpic, const struct acrn_i8259_state state[2]);
 struct acrn_vpic *vm_pic(const struct acrn_vm *vm);
 
 /**
@@ -32,7 +32,11 @@
 #include <asm/lib/spinlock.h>
 #include <asm/vm_config.h>
 
+#ifdef CONFIG_VUART_HIGH_THROUGHPUT_ENABLED
+#define RX_BUF_SIZE		4096U
+#else
 #define RX_BUF_SIZE		256U
+#endif
 #define TX_BUF_SIZE		8192U
 #define INVAILD_VUART_IDX	0xFFU
 
@@ -75,6 +79,12 @@ struct acrn_vuart {
 	char vuart_tx_buf[TX_BUF_SIZE];
 	bool thre_int_pending;	/* THRE interrupt pending */
 	bool active;
+#ifdef CONFIG_VUART_HIGH_THROUGHPUT_ENABLED
+	uint32_t rx_trigger;	/* RX FIFO interrupt trigger level selected by FCR */
+	bool rx_timeout;	/* report RX data below the trigger level */
+	bool tx_flush_pending;	/* data sent to target vuart is not reported yet */
+	uint8_t intr_reason;	/* last signaled interrupt reason */
+#endif
 	struct acrn_vuart *target_vu; /* Pointer to target vuart */
 	struct acrn_vm *vm;
 	struct pci_vdev *vdev;	/* pci vuart */
@@ -86,7 +96,7 @@ void deinit_legacy_vuarts(struct acrn_vm *vm);
 void init_pci_vuart(struct pci_vdev *vdev);
 void deinit_pci_vuart(struct pci_vdev *vdev);
 
-void vuart_putchar(struct acrn_vuart *vu, char ch);
+void vuart_putchars(struct acrn_vuart *vu, const char *buf, uint32_t len);
 char vuart_getchar(struct acrn_vuart *vu);
 void vuart_toggle_intr(const struct acrn_vuart *vu);
 
@@ -11,6 +11,8 @@
 #define EPERM		1
 /** Indicates that there is IO error. */
 #define EIO		5
+/** Indicates that the operation should be tried again. */
+#define EAGAIN		11
 /** Indicates that not enough memory. */
 #define ENOMEM		12
 /** Indicates Permission denied */
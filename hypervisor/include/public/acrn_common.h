@@ -62,6 +62,7 @@
 #define GUEST_FLAG_TEE				(1UL << 9U)	/* Whether the VM is TEE VM */
 #define GUEST_FLAG_REE				(1UL << 10U)	/* Whether the VM is REE VM */
 #define GUEST_FLAG_PMU_PASSTHROUGH	(1UL << 11U)    /* Whether PMU is passed through */
+#define GUEST_FLAG_DIRTY_LOG		(1UL << 12U)	/* Whether the dirty pages of the VM can be logged, for migration */
 
 
 /* TODO: We may need to get this addr from guest ACPI instead of hardcode here */
@@ -456,6 +457,195 @@ struct acrn_vcpu_regs {
 	struct acrn_regs vcpu_regs;
 };
 
+/**
+ * @brief Segment register of a vCPU, as held in the VMCS guest-state area
+ */
+struct acrn_segment_state {
+	uint64_t base;
+	uint32_t limit;
+	uint32_t attr;
+	uint16_t selector;
+	uint16_t reserved[3];
+};
+
+#define ACRN_XSAVE_AREA_SIZE	4096U
+
+/**
+ * @brief Architectural registers of a vCPU, besides the XSAVE state
+ */
+struct acrn_cpu_state {
+	struct acrn_gp_regs gprs;
+
+	/** the next instruction to execute */
+	uint64_t rip;
+	uint64_t rflags;
+	uint64_t cr0;
+	uint64_t cr2;
+	uint64_t cr3;
+	uint64_t cr4;
+	uint64_t ia32_efer;
+	uint64_t dr7;
+
+	struct acrn_segment_state cs;
+	struct acrn_segment_state ss;
+	struct acrn_segment_state ds;
+	struct acrn_segment_state es;
+	struct acrn_segment_state fs;
+	struct acrn_segment_state gs;
+	struct acrn_segment_state ldtr;
+	struct acrn_segment_state tr;
+	/** only base and limit are valid for GDTR and IDTR */
+	struct acrn_segment_state gdtr;
+	struct acrn_segment_state idtr;
+
+	uint64_t ia32_pat;
+	uint64_t ia32_debugctl;
+	uint64_t ia32_sysenter_cs;
+	uint64_t ia32_sysenter_esp;
+	uint64_t ia32_sysenter_eip;
+	uint64_t ia32_star;
+	uint64_t ia32_cstar;
+	uint64_t ia32_lstar;
+	uint64_t ia32_fmask;
+	uint64_t ia32_kernel_gs_base;
+	uint64_t ia32_tsc_aux;
+	uint64_t ia32_xss;
+
+	/** the guest TSC, the TSC offset is rebuilt from it */
+	uint64_t guest_tsc;
+
+	/** VMX guest interruptibility state */
+	uint32_t interruptibility;
+
+	/** event to deliver on next VM entry, in VM-entry interruption-information format */
+	uint32_t pending_event;
+	uint32_t pending_event_error;
+
+	uint32_t reserved;
+
+	uint64_t xcr0;
+};
+
+/**
+ * @brief Complete architectural state of a paused vCPU
+ *
+ * the parameter for HC_GET_VCPU_STATE and HC_SET_VCPU_STATE hypercalls.
+ * Unlike struct acrn_vcpu_regs, which only holds the boot state of the BSP,
+ * it covers everything the guest can observe, so that a vCPU can be resumed
+ * in another VM on the same platform.
+ */
+#define ACRN_VCPU_STATE_LAUNCHED	(1U << 0U)
+
+struct acrn_vcpu_state {
+	/** the virtual CPU ID, set by the caller */
+	uint16_t vcpu_id;
+
+	/**
+	 * ACRN_VCPU_STATE_LAUNCHED if the vCPU has been started, otherwise it's
+	 * still waiting for INIT-SIPI and the rest of the state is not valid.
+	 */
+	uint16_t flags;
+
+	uint16_t reserved[2];
+
+	struct acrn_cpu_state regs;
+
+	/** XSAVES compacted format, only portable between platforms with the same XSAVE layout */
+	uint8_t xsave_area[ACRN_XSAVE_AREA_SIZE];
+};
+
+#define ACRN_IRQCHIP_VLAPIC	0U
+#define ACRN_IRQCHIP_VIOAPIC	1U
+#define ACRN_IRQCHIP_VPIC	2U
+
+/**
+ * @brief vLAPIC state of a vCPU
+ *
+ * regs[i] is the 32-bit register at offset (i << 4) of the local APIC page.
+ */
+struct acrn_vlapic_state {
+	uint64_t apic_base;
+
+	/** the guest TSC value of the armed TSC deadline, 0 if not armed */
+	uint64_t tsc_deadline;
+
+	uint32_t regs[256];
+};
+
+/**
+ * @brief vIOAPIC state of a VM
+ */
+struct acrn_vioapic_state {
+	uint32_t id;
+	uint32_t ioregsel;
+	uint64_t rtes[VIOAPIC_RTE_NUM];
+	/** pin level bitmap, 1 - high, 0 - low */
+	uint64_t pin_state[(VIOAPIC_RTE_NUM + 63U) / 64U];
+};
+
+/**
+ * @brief State of one i8259 of the vPIC
+ */
+struct acrn_i8259_state {
+	uint8_t ready;
+	uint8_t icw_num;
+	uint8_t rd_cmd_reg;
+	uint8_t aeoi;
+	uint8_t poll;
+	uint8_t rotate;
+	uint8_t sfn;
+	uint8_t request;
+	uint8_t service;
+	uint8_t mask;
+	uint8_t smm;
+	uint8_t elc;
+	uint32_t irq_base;
+	uint32_t lowprio;
+	uint8_t pin_state[8];
+};
+
+/**
+ * @brief State of an interrupt controller of a VM
+ *
+ * the parameter for HC_GET_IRQCHIP_STATE and HC_SET_IRQCHIP_STATE hypercalls
+ */
+struct acrn_irqchip_state {
+	/** ACRN_IRQCHIP_*, set by the caller */
+	uint32_t type;
+
+	/** the virtual CPU ID for ACRN_IRQCHIP_VLAPIC, set by the caller */
+	uint16_t vcpu_id;
+
+	uint16_t reserved;
+
+	union {
+		struct acrn_vlapic_state vlapic;
+		struct acrn_vioapic_state vioapic;
+		/** primary and secondary i8259 */
+		struct acrn_i8259_state vpic[2];
+	} chip;
+};
+
+/**
+ * @brief Dirty pages of a guest physical address range of a VM
+ *
+ * the parameter for HC_VM_GET_DIRTY_BITMAP hypercall
+ */
+struct acrn_dirty_bitmap {
+	/** start of the range, 4K aligned */
+	uint64_t gpa;
+
+	/** size of the range, 4K aligned */
+	uint64_t size;
+
+	/**
+	 * Service VM guest physical address of a zeroed and contiguous bitmap of
+	 * (size / 4K) bits rounded up to 64 bits, bit n of the 64 bits word w
+	 * is set if the page at gpa + (w * 64 + n) * 4K was written.
+	 */
+	uint64_t bitmap_gpa;
+};
+
 /** Operation types for setting IRQ line */
 #define GSI_SET_HIGH		0U
 #define GSI_SET_LOW		1U
@@ -582,6 +772,17 @@ struct acrn_intr_monitor {
 /** cmd for intr monitor **/
 #define INTR_CMD_GET_DATA 0U
 #define INTR_CMD_DELAY_INT 1U
+/*
+ * buffer[0] is the interrupt count per ms of a passthrough interrupt source above which
+ * its injection is coalesced, 0 to disable the adaptive delay; buffer[1] is the max delay
+ * in us. Not allowed for RT VMs.
+ */
+#define INTR_CMD_SET_ADAPTIVE 2U
+/*
+ * like INTR_CMD_GET_DATA, with 4 elements per interrupt source: physical irq, interrupt count,
+ * count of the 1 ms windows above the adaptive threshold, current adaptive delay in us
+ */
+#define INTR_CMD_GET_STORM_DATA 3U
 
 /*
  * PRE_LAUNCHED_VM is launched by ACRN hypervisor, with LAPIC_PT;
@@ -39,12 +39,16 @@
 #define HC_CREATE_VCPU              BASE_HC_ID(HC_ID, HC_ID_VM_BASE + 0x04UL)
 #define HC_RESET_VM                 BASE_HC_ID(HC_ID, HC_ID_VM_BASE + 0x05UL)
 #define HC_SET_VCPU_REGS            BASE_HC_ID(HC_ID, HC_ID_VM_BASE + 0x06UL)
+#define HC_GET_VCPU_STATE           BASE_HC_ID(HC_ID, HC_ID_VM_BASE + 0x07UL)
+#define HC_SET_VCPU_STATE           BASE_HC_ID(HC_ID, HC_ID_VM_BASE + 0x08UL)
 
 /* IRQ and Interrupts */
 #define HC_ID_IRQ_BASE              0x20UL
 #define HC_INJECT_MSI               BASE_HC_ID(HC_ID, HC_ID_IRQ_BASE + 0x03UL)
 #define HC_VM_INTR_MONITOR          BASE_HC_ID(HC_ID, HC_ID_IRQ_BASE + 0x04UL)
 #define HC_SET_IRQLINE              BASE_HC_ID(HC_ID, HC_ID_IRQ_BASE + 0x05UL)
+#define HC_GET_IRQCHIP_STATE        BASE_HC_ID(HC_ID, HC_ID_IRQ_BASE + 0x06UL)
+#define HC_SET_IRQCHIP_STATE        BASE_HC_ID(HC_ID, HC_ID_IRQ_BASE + 0x07UL)
 
 /* DM ioreq management */
 #define HC_ID_IOREQ_BASE            0x30UL
@@ -56,6 +60,8 @@
 #define HC_VM_GPA2HPA               BASE_HC_ID(HC_ID, HC_ID_MEM_BASE + 0x01UL)
 #define HC_VM_SET_MEMORY_REGIONS    BASE_HC_ID(HC_ID, HC_ID_MEM_BASE + 0x02UL)
 #define HC_VM_WRITE_PROTECT_PAGE    BASE_HC_ID(HC_ID, HC_ID_MEM_BASE + 0x03UL)
+#define HC_VM_SET_DIRTY_LOG         BASE_HC_ID(HC_ID, HC_ID_MEM_BASE + 0x04UL)
+#define HC_VM_GET_DIRTY_BITMAP      BASE_HC_ID(HC_ID, HC_ID_MEM_BASE + 0x05UL)
 
 /* PCI assignment*/
 #define HC_ID_PCI_BASE              0x50UL
@@ -77,6 +83,8 @@
 #define HC_SETUP_HV_NPK_LOG         BASE_HC_ID(HC_ID, HC_ID_DBG_BASE + 0x01UL)
 #define HC_PROFILING_OPS            BASE_HC_ID(HC_ID, HC_ID_DBG_BASE + 0x02UL)
 #define HC_GET_HW_INFO              BASE_HC_ID(HC_ID, HC_ID_DBG_BASE + 0x03UL)
+#define HC_GET_VMEXIT_LATENCY       BASE_HC_ID(HC_ID, HC_ID_DBG_BASE + 0x04UL)
+#define HC_GET_EPT_PAGE_SIZES       BASE_HC_ID(HC_ID, HC_ID_DBG_BASE + 0x05UL)
 
 /* Trusty */
 #define HC_ID_TRUSTY_BASE           0x70UL
@@ -230,6 +238,56 @@ struct acrn_hw_info {
 	uint16_t reserved[3];
 } __aligned(8);
 
+#define ACRN_VMEXIT_LATENCY_BUCKETS	20U
+#define ACRN_VMEXIT_LATENCY_SHIFT	9U
+
+/**
+ * VM exit latency histogram of one exit reason of one vCPU,
+ * the parameter for HC_GET_VMEXIT_LATENCY hypercall
+ */
+struct acrn_vmexit_latency {
+	/** vCPU id in the target VM, set by the caller */
+	uint16_t vcpu_id;
+
+	/** basic VM exit reason, set by the caller */
+	uint16_t exit_reason;
+
+	/** TSC frequency in kHz, to convert the cycles to time */
+	uint32_t tsc_khz;
+
+	/** number of the VM exits */
+	uint64_t count;
+
+	/** sum of the latency of the VM exits in TSC cycles */
+	uint64_t sum_cycles;
+
+	/**
+	 * Bucket i counts the VM exits which take less than
+	 * 2^(ACRN_VMEXIT_LATENCY_SHIFT + i) TSC cycles from VM exit to
+	 * the next VM entry and are not counted by bucket i - 1. The last
+	 * bucket has no upper bound. The counters wrap around.
+	 */
+	uint32_t buckets[ACRN_VMEXIT_LATENCY_BUCKETS];
+} __aligned(8);
+
+/**
+ * Number of the pages of each size mapping the normal world memory of a VM
+ * in its EPT, the parameter for HC_GET_EPT_PAGE_SIZES hypercall
+ */
+struct acrn_ept_page_sizes {
+	/** number of 4KB pages */
+	uint64_t pages_4k;
+
+	/** number of 2MB pages */
+	uint64_t pages_2m;
+
+	/** number of 1GB pages */
+	uint64_t pages_1g;
+
+	/** number of EPT paging-structure pages, the root included */
+	uint64_t table_pages;
+} __aligned(8);
+
 /**
  * Gpa to hpa translation parameter, used for HC_VM_GPA2HPA hypercall
  */
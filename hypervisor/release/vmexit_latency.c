@@ -0,0 +1,14 @@
+/*
+ * Copyright (C) 2022 Intel Corporation.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <types.h>
+#include <vmexit_latency.h>
+
+void vmexit_latency_reset(__unused const struct acrn_vcpu *vcpu) {}
+
+void vmexit_latency_exit(__unused const struct acrn_vcpu *vcpu) {}
+
+void vmexit_latency_enter(__unused const struct acrn_vcpu *vcpu) {}
@@ -136,6 +136,14 @@
       <xsl:with-param name="value" select="MCE_ON_PSC_DISABLED" />
     </xsl:call-template>
 
+    <xsl:call-template name="boolean-by-key">
+      <xsl:with-param name="key" select="'CPUID_PRECOMPUTE_ENABLED'" />
+    </xsl:call-template>
+
+    <xsl:call-template name="boolean-by-key">
+      <xsl:with-param name="key" select="'VUART_HIGH_THROUGHPUT_ENABLED'" />
+    </xsl:call-template>
+
     <xsl:call-template name="boolean-by-key-value">
       <xsl:with-param name="key" select="'SSRAM_ENABLED'" />
       <xsl:with-param name="value" select="SSRAM/SSRAM_ENABLED" />
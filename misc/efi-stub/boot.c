@@ -395,6 +395,9 @@ static uint32_t
 get_mbi2_size(HV_LOADER hvld, struct efi_memmap_info *mmap_info, uint32_t rsdp_length)
 {
 	uint32_t mmap_entry_count = mmap_info->map_size / mmap_info->desc_size;
+	UINTN load_count;
+
+	(void)hvld->get_load_times(hvld, &load_count);
 
 	return 2 * sizeof(uint32_t) \
 		/* Boot command line */
@@ -409,6 +412,10 @@ get_mbi2_size(HV_LOADER hvld, struct efi_memmap_info *mmap_info, uint32_t rsdp_l
 		+ (hvld->get_mod_count(hvld) * sizeof(struct multiboot2_tag_module) + \
 			hvld->get_total_modcmdsize(hvld)) \
 
+		/* Load times */
+		+ ALIGN_UP(sizeof(struct multiboot2_tag_acrn_load_times) + \
+			load_count * sizeof(struct multiboot2_acrn_load_time), MULTIBOOT2_TAG_ALIGN) \
+
 		/* Memory Map */
 		+ ALIGN_UP((sizeof(struct multiboot2_tag_mmap) + \
 			mmap_entry_count * sizeof(struct multiboot2_mmap_entry)), MULTIBOOT2_TAG_ALIGN) \
@@ -510,6 +517,20 @@ construct_mbi2(struct hv_loader *hvld, void **mbi_addr, struct efi_memmap_info *
 		}
 	}
 
+	/* Load times, for the hypervisor to print */
+	{
+		struct multiboot2_tag_acrn_load_times *tag = (struct multiboot2_tag_acrn_load_times *)p;
+		const struct multiboot2_acrn_load_time *times;
+		UINTN load_count;
+
+		times = hvld->get_load_times(hvld, &load_count);
+		tag->type = MULTIBOOT2_TAG_TYPE_ACRN_LOAD_TIMES;
+		tag->size = sizeof(struct multiboot2_tag_acrn_load_times) +
+			load_count * sizeof(struct multiboot2_acrn_load_time);
+		memcpy((char *)tag->entries, (const char *)times, load_count * sizeof(struct multiboot2_acrn_load_time));
+		p += ALIGN_UP(tag->size, MULTIBOOT2_TAG_ALIGN) / sizeof(uint64_t);
+	}
+
 	/* Memory map */
 	{
 		unsigned i;
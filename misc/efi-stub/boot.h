@@ -208,6 +208,9 @@ struct hv_loader {
 	/* Get the supported multiboot version of ACRN hypervisor image */
 	int (*get_multiboot_version)(IN HV_LOADER hvld);
 
+	/* Get the load times of the hv image and the modules, NULL if none */
+	const struct multiboot2_acrn_load_time *(*get_load_times)(IN HV_LOADER hvld, UINTN *count);
+
 	/* free up memory allocated by hypervisor loader */
 	void (*deinit)(IN HV_LOADER hvld);
 };
@@ -223,4 +226,12 @@ msr_read(uint32_t reg_num)
 	return msr_val;
 }
 
+static inline uint64_t rdtsc(void)
+{
+	uint32_t lo, hi;
+
+	asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((uint64_t)hi << 32U) | lo;
+}
+
 #endif
@@ -44,6 +44,7 @@
 #include "multiboot.h"
 #include "container.h"
 #include "elf32.h"
+#include "sbl_container.h"
 
 #define LZH_BOOT_CMD	0u
 #define LZH_BOOT_IMG	1u
@@ -51,43 +52,15 @@
 
 #define MAX_BOOTCMD_SIZE	(2048 + 256)    /* Max linux command line size plus uefi boot options */
 #define MAX_MODULE_COUNT	32
+/* hv_cmdline, acrn.32.out, a tag and a file per module, then the SBL signature */
+#define MAX_COMPONENT_COUNT	(3 + 2 * MAX_MODULE_COUNT)
+
+/* The modules are loaded in one region aligned to a large page */
+#define MOD_REGION_ALIGN	(2UL * 1024 * 1024)
 
 typedef struct multiboot2_header_tag_relocatable RELOC_INFO;
 typedef struct multiboot2_header_tag_address LADDR_INFO;
 
-typedef struct {
-  UINT32           Signature;
-  UINT8            Version;
-  UINT8            Svn;
-  UINT16           DataOffset;
-  UINT32           DataSize;
-  UINT8            AuthType;
-  UINT8            ImageType;
-  UINT8            Flags;
-  UINT8            Count;
-} CONTAINER_HDR;
-
-typedef struct {
-  UINT32           Name;
-  UINT32           Offset;
-  UINT32           Size;
-  UINT8            Attribute;
-  UINT8            Alignment;
-  UINT8            AuthType;
-  UINT8            HashSize;
-  UINT8            HashData[0];
-} COMPONENT_ENTRY;
-
-typedef struct {
-  UINT32        Signature;
-  UINT32        CompressedSize;
-  UINT32        Size;
-  UINT16        Version;
-  UINT8         Svn;
-  UINT8         Attribute;
-  UINT8         Data[];
-} LOADER_COMPRESSED_HEADER;
-
 struct container {
 	struct hv_loader ops;   /* loader operation table */
 
@@ -110,10 +83,29 @@ struct container {
 	UINTN total_modsize;    /* memory size allocated to load modules */
 	UINTN total_modcmdsize; /* memory size to store module commands */
 
-	UINTN lzh_count;        /* num of files in container */
-	LOADER_COMPRESSED_HEADER *lzh_ptr[];	/* cache of each file header in container */
+	struct multiboot2_acrn_load_time load_times[MAX_MODULE_COUNT + 1]; /* hv image and modules load times */
+	UINTN load_count;       /* num of load times */
+
+	UINT32 comp_count;      /* num of files in container */
+	struct sbl_component comps[MAX_COMPONENT_COUNT];	/* each file in container */
 };
 
+static void container_copy(void *dst, const void *src, uint64_t len)
+{
+	copy_mem(dst, src, len);
+}
+
+static void add_load_time(struct container *ctr, UINT32 mod_idx, const struct sbl_component *comp,
+	UINT64 start_tsc)
+{
+	struct multiboot2_acrn_load_time *t = &ctr->load_times[ctr->load_count++];
+
+	t->mod_idx = mod_idx;
+	t->flags = (comp->digest != NULL) ? MULTIBOOT2_ACRN_LOAD_VERIFIED : 0U;
+	t->size = comp->lzh->Size;
+	t->tsc_cycles = rdtsc() - start_tsc;
+}
+
 /**
  * @brief Load acrn.32.out ELF file. If the hv_ram_start and hv_ram_size are both zero,
  * these two parameters will be obtained from the ELF header.
@@ -238,11 +230,16 @@ static EFI_STATUS container_load_boot_image(HV_LOADER hvld)
 	EFI_STATUS err = EFI_SUCCESS;
 	struct container *ctr = (struct container *)hvld;
 	const void *mb_hdr;
+	UINT64 start_tsc;
 
-	LOADER_COMPRESSED_HEADER *lzh = NULL;
+	const LOADER_COMPRESSED_HEADER *lzh = NULL;
 
 	/* prepare boot command line: stitched from hv_cmdline.txt and argument from efibootmgr -u */
-	lzh = ctr->lzh_ptr[LZH_BOOT_CMD];
+	if (sbl_component_verify(&ctr->comps[LZH_BOOT_CMD]) != 0) {
+		Print(L"Digest mismatch of the boot command line\n");
+		return EFI_SECURITY_VIOLATION;
+	}
+	lzh = ctr->comps[LZH_BOOT_CMD].lzh;
 	ctr->boot_cmdsize = lzh->Size + StrnLen(ctr->options, ctr->options_size);
 	if (ctr->boot_cmdsize >= MAX_BOOTCMD_SIZE) {
 		Print(L"Boot command size 0x%x exceeding limit 0x%x\n", ctr->boot_cmdsize, MAX_BOOTCMD_SIZE);
@@ -256,8 +253,14 @@ static EFI_STATUS container_load_boot_image(HV_LOADER hvld)
 		}
 	}
 
-	/* parse and load boot image */
-	lzh = ctr->lzh_ptr[LZH_BOOT_IMG];
+	/* parse and load boot image, its headers are only used once its digest is checked */
+	start_tsc = rdtsc();
+	if (sbl_component_verify(&ctr->comps[LZH_BOOT_IMG]) != 0) {
+		Print(L"Digest mismatch of the ACRN HV image\n");
+		err = EFI_SECURITY_VIOLATION;
+		goto out;
+	}
+	lzh = ctr->comps[LZH_BOOT_IMG].lzh;
 
 	if (parse_boot_image((const UINT8 *)lzh->Data, &ctr->hv_entry, &ctr->mb_version,
 		&ctr->laddr, &ctr->reloc, &mb_hdr) < 0) {
@@ -313,6 +316,8 @@ static EFI_STATUS container_load_boot_image(HV_LOADER hvld)
 		ctr->hv_entry = elf_get_entry((Elf32_Ehdr *)lzh->Data);
 	}
 
+	add_load_time(ctr, MULTIBOOT2_ACRN_LOAD_HV_IMAGE, &ctr->comps[LZH_BOOT_IMG], start_tsc);
+
 out:
 	return err;
 }
@@ -332,22 +337,23 @@ out:
 	UINTN i, j;
 
 	UINT8 * p = NULL;
-	LOADER_COMPRESSED_HEADER *lzh = NULL;
-	LOADER_COMPRESSED_HEADER *cmd_lzh = NULL;
+	const struct sbl_component *comp = NULL;
+	const LOADER_COMPRESSED_HEADER *cmd_lzh = NULL;
+	UINT64 start_tsc;
 
 	/* scan module headers to calculate required memory size to store files */
-	for (i = LZH_MOD0_CMD; i < ctr->lzh_count - 1; i++) {
+	for (i = LZH_MOD0_CMD; i < ctr->comp_count - 1; i++) {
 		if ((i % 2) == 0) {	/* vm0_tag.txt, vm1_tag.txt, acpi_vm0.txt ... */
-			ctr->total_modcmdsize += ctr->lzh_ptr[i]->Size;
+			ctr->total_modcmdsize += ctr->comps[i].lzh->Size;
 		} else {	/* vm0_kernel, vm1_kernel, vm0_acpi.bin ... */
-			ctr->total_modsize += ALIGN_UP(ctr->lzh_ptr[i]->Size, EFI_PAGE_SIZE);
+			ctr->total_modsize += ALIGN_UP(ctr->comps[i].lzh->Size, EFI_PAGE_SIZE);
 		}
 	}
 	/* exclude hypervisor and SBL signature files. e.g.)
-	 *    lzh_count = 9 (hv_cmdline, acrn.32.out, vm0_tag, vm0_kernel, vm1_tag, vm1_kernel, vm0_acpi_tag, vm0_acpi, sig)
+	 *    comp_count = 9 (hv_cmdline, acrn.32.out, vm0_tag, vm0_kernel, vm1_tag, vm1_kernel, vm0_acpi_tag, vm0_acpi, sig)
 	 *    mod_count = 3 (vm0_tag + vm0_kernel, vm1_tag + vm1_kernel, vm0_acpi_tag + vm0_acpi)
 	 */
-	ctr->mod_count = (ctr->lzh_count - 3) / 2;
+	ctr->mod_count = (ctr->comp_count - 3) / 2;
 
 	if (ctr->mod_count >= MAX_MODULE_COUNT) {
 		Print(L"Too many modules: 0x%x\n", ctr->mod_count);
@@ -357,27 +363,42 @@ out:
 	/* allocate single memory region to store all binary files to avoid mmap fragmentation */
 	if (ctr->reloc) {
 		err = emalloc_reserved_aligned(&(ctr->mod_hpa), ctr->total_modsize,
-								EFI_PAGE_SIZE, ctr->reloc->min_addr, ctr->reloc->max_addr);
+								MOD_REGION_ALIGN, ctr->reloc->min_addr, ctr->reloc->max_addr);
 	} else {
 		/* We put modules after hv */
-		UINTN hv_ram_size = ctr->laddr->load_end_addr - ctr->laddr->load_addr;
-		err = emalloc_fixed_addr(&(ctr->mod_hpa), hv_ram_size, ctr->hv_hpa + ALIGN_UP(hv_ram_size, EFI_PAGE_SIZE));
+		UINTN hv_ram_size = ctr->laddr ? ctr->laddr->load_end_addr - ctr->laddr->load_addr : ctr->est_hv_ram_size;
+		err = emalloc_fixed_addr(&(ctr->mod_hpa), ctr->total_modsize,
+								ctr->hv_hpa + ALIGN_UP(hv_ram_size, EFI_PAGE_SIZE));
 	}
 	if (err != EFI_SUCCESS) {
 		Print(L"Failed to allocate memory for modules %r\n", err);
 		goto out;
 	}
 
+	/* each file is copied at once, and checked against its digest as it is copied */
 	p = (UINT8 *)ctr->mod_hpa;
-	for (i = LZH_BOOT_IMG + 2, j = 0; i < ctr->lzh_count - 1; i = i + 2) {
-		lzh = ctr->lzh_ptr[i];
-		cmd_lzh = ctr->lzh_ptr[i - 1];
-		memcpy((char *)p, (const char *)lzh->Data, lzh->Size);
+	for (i = LZH_BOOT_IMG + 2, j = 0; i < ctr->comp_count - 1; i = i + 2) {
+		comp = &ctr->comps[i];
+		if (sbl_component_verify(&ctr->comps[i - 1]) != 0) {
+			Print(L"Digest mismatch of the tag of module %d\n", j);
+			err = EFI_SECURITY_VIOLATION;
+			goto out;
+		}
+		cmd_lzh = ctr->comps[i - 1].lzh;
+
+		start_tsc = rdtsc();
+		if (sbl_component_load(comp, p, container_copy) != 0) {
+			Print(L"Digest mismatch of module %d\n", j);
+			err = EFI_SECURITY_VIOLATION;
+			goto out;
+		}
+		add_load_time(ctr, j, comp, start_tsc);
+
 		ctr->mod_info[j].mod_start = (EFI_PHYSICAL_ADDRESS)p;
-		ctr->mod_info[j].mod_end = (EFI_PHYSICAL_ADDRESS)p + lzh->Size;
+		ctr->mod_info[j].mod_end = (EFI_PHYSICAL_ADDRESS)p + comp->lzh->Size;
 		ctr->mod_info[j].cmd = (const char *)cmd_lzh->Data;
 		ctr->mod_info[j].cmdsize = cmd_lzh->Size;
-		p += ALIGN_UP(lzh->Size, EFI_PAGE_SIZE);
+		p += ALIGN_UP(comp->lzh->Size, EFI_PAGE_SIZE);
 		j++;
 	}
 
@@ -524,6 +545,22 @@ static UINTN container_get_hv_ram_size(HV_LOADER hvld)
 	return ctr->est_hv_ram_size;
 }
 
+/**
+ * @brief Get the load times of the hv image and the modules
+ *
+ * @param[in]  hvld  Loader handle
+ * @param[out] count The number of load times
+ *
+ * @return the load times, the hv image first then each module
+ */
+static const struct multiboot2_acrn_load_time *container_get_load_times(HV_LOADER hvld, UINTN *count)
+{
+	struct container *ctr = (struct container *)hvld;
+
+	*count = ctr->load_count;
+	return ctr->load_times;
+}
+
 /**
  * @brief Free up memory allocated by the container loader
  *
@@ -535,14 +572,11 @@ static void container_deinit(HV_LOADER hvld)
 {
 	struct container *ctr = (struct container *)hvld;
 
-	if (ctr->lzh_ptr) {
-		free_pool(ctr->lzh_ptr);
-		free_pool(ctr);
-	}
-
 	if (ctr->mod_hpa) {
 		free_pages(ctr->mod_hpa, EFI_SIZE_TO_PAGES(ctr->total_modsize));
 	}
+
+	free_pool(ctr);
 }
 
 /* hypervisor loader operation table */
@@ -560,6 +594,7 @@ static struct hv_loader container_ops = {
 	.get_hv_entry = container_get_hv_entry,
 	.get_multiboot_version = container_get_multiboot_version,
 	.get_hv_ram_size = container_get_hv_ram_size,
+	.get_load_times = container_get_load_times,
 	.deinit = container_deinit,
 };
 
@@ -581,11 +616,7 @@ EFI_STATUS container_init(EFI_LOADED_IMAGE *info, HV_LOADER *hvld)
 	UINTN sec_size = 0u;
 	char *section  = ".hv";
 
-	UINTN i;
-	CONTAINER_HDR   *hdr  = NULL;
-	COMPONENT_ENTRY *comp = NULL;
-
-	UINTN offset = 0u;
+	UINT32 i;
 
 	err = allocate_pool(EfiLoaderData, sizeof(struct container), (void **)&ctr);
 	if (EFI_ERROR(err)) {
@@ -607,22 +638,19 @@ EFI_STATUS container_init(EFI_LOADED_IMAGE *info, HV_LOADER *hvld)
 		goto out;
 	}
 
-	hdr = (CONTAINER_HDR*)(info->ImageBase + sec_addr);
-	ctr->lzh_count = hdr->Count;
-
-	err = allocate_pool(EfiLoaderData, sizeof(LOADER_COMPRESSED_HEADER *) * hdr->Count, (void **)&ctr->lzh_ptr);
-	if (EFI_ERROR(err)) {
-		Print(L"Failed to allocate memory for Container Library %r\n", err);
+	/* cache each file for later use */
+	if ((sbl_container_parse(info->ImageBase + sec_addr, sec_size, ctr->comps,
+			MAX_COMPONENT_COUNT, &ctr->comp_count) != 0) || (ctr->comp_count < 3)) {
+		Print(L"Malformed ACRNHV Container\n");
+		err = EFI_LOAD_ERROR;
 		goto out;
 	}
 
-	/* cache each file's header point for later use */
-	comp = (COMPONENT_ENTRY *)(hdr + 1);
-	for (i = 0; i < hdr->Count; i++) {
-		offset = hdr->DataOffset + comp->Offset;
-		ctr->lzh_ptr[i] = (LOADER_COMPRESSED_HEADER *)((UINT8 *)(hdr) + offset);
-
-		comp = (COMPONENT_ENTRY *)((UINT8 *)(comp + 1) + comp->HashSize);
+	for (i = 0; i < ctr->comp_count; i++) {
+		if ((ctr->comps[i].auth_type != SBL_AUTH_TYPE_NONE) && (ctr->comps[i].digest == NULL)) {
+			Print(L"Warning: auth type %d of container file %d not supported, not checked\n",
+				ctr->comps[i].auth_type, i);
+		}
 	}
 
 	*hvld = (struct hv_loader *)ctr;
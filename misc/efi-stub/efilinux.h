@@ -92,6 +92,32 @@ free_pages(EFI_PHYSICAL_ADDRESS memory, UINTN num_pages)
 	return uefi_call_wrapper(boot->FreePages, 2, memory, num_pages);
 }
 
+/**
+ * copy_mem - Copy memory with the firmware routine
+ * @dst: the destination buffer
+ * @src: the source buffer
+ * @size: number of bytes to copy
+ *
+ * The buffers may overlap. The firmware copies a word, or more, at a time
+ * where the byte loop of memcpy() doesn't, so large copies such as the
+ * images to boot go through copy_mem().
+ */
+static inline void copy_mem(void *dst, const void *src, UINTN size)
+{
+	uefi_call_wrapper(boot->CopyMem, 3, dst, (void *)src, size);
+}
+
+/**
+ * set_mem - Fill memory with the firmware routine
+ * @buffer: the buffer to fill
+ * @size: number of bytes to fill
+ * @value: the value to fill @buffer with
+ */
+static inline void set_mem(void *buffer, UINTN size, UINT8 value)
+{
+	uefi_call_wrapper(boot->SetMem, 3, buffer, size, value);
+}
+
 /**
  * allocate_pool - Allocate pool memory
  * @type: the type of pool to allocate
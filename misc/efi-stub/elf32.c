@@ -33,6 +33,7 @@
 #include <elf.h>
 #include <stdint.h>
 #include "stdlib.h"
+#include "efilinux.h"
 #include "boot.h"
 
 #define MAX(a, b) (((a) > (b)) ? (a) : (b))
@@ -66,11 +67,11 @@ int elf_load(Elf32_Ehdr *ehdr, uint64_t load_addr, uint64_t link_addr)
 		}
 
 		addr = (uint64_t)(load_addr + (phdr->p_paddr - link_addr));
-		memcpy((char *)addr, (const char *)((char *)ehdr + phdr->p_offset), phdr->p_filesz);
+		copy_mem((void *)addr, (const void *)((char *)ehdr + phdr->p_offset), phdr->p_filesz);
 
 		if (phdr->p_memsz > phdr->p_filesz) {
 			addr = (uint64_t)(load_addr + (phdr->p_paddr - link_addr + phdr->p_filesz));
-			(void)memset((void *)addr, 0x0, (phdr->p_memsz - phdr->p_filesz));
+			set_mem((void *)addr, (phdr->p_memsz - phdr->p_filesz), 0x0);
 		}
 	}
 
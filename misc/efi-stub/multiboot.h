@@ -226,6 +226,11 @@ struct multiboot2_header
 #define MULTIBOOT2_TAG_TYPE_EFI64_IH			20U
 #define MULTIBOOT2_TAG_TYPE_LOAD_BASE_ADDR		21U
 
+/* ACRN specific tag: how long the loader took to load the hv image and each module */
+#define MULTIBOOT2_TAG_TYPE_ACRN_LOAD_TIMES		0x4e524341U	/* "ACRN" */
+#define MULTIBOOT2_ACRN_LOAD_HV_IMAGE			0xffffffffU	/* mod_idx of the hv image */
+#define MULTIBOOT2_ACRN_LOAD_VERIFIED			0x1U		/* digest checked while loading */
+
 #define MULTIBOOT2_HEADER_TAG_END			0
 #define MULTIBOOT2_HEADER_TAG_INFORMATION_REQUEST	1
 #define MULTIBOOT2_HEADER_TAG_ADDRESS			2
@@ -373,6 +378,19 @@ struct multiboot2_tag_efi_mmap {
 	uint32_t	descr_vers;
 	uint8_t		efi_mmap[0];
 };
+
+struct multiboot2_acrn_load_time {
+	uint32_t	mod_idx;
+	uint32_t	flags;
+	uint64_t	size;		/* bytes loaded */
+	uint64_t	tsc_cycles;
+};
+
+struct multiboot2_tag_acrn_load_times {
+	uint32_t	type;
+	uint32_t	size;
+	struct multiboot2_acrn_load_time entries[0];
+};
 #endif
 
 struct hv_mb2header_tag_list {
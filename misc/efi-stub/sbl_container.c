@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2022, Intel Corporation.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer
+ *      in the documentation and/or other materials provided with the
+ *      distribution.
+ *    * Neither the name of Intel Corporation nor the names of its
+ *      contributors may be used to endorse or promote products
+ *      derived from this software without specific prior written
+ *      permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sha256.h"
+#include "sbl_container.h"
+
+/* Copied and hashed at a time, to hash the data while it is still cached */
+#define SBL_LOAD_CHUNK_SIZE	(64U * 1024U)
+
+int sbl_container_parse(const void *base, uint64_t size,
+	struct sbl_component *comps, uint32_t max_count, uint32_t *count)
+{
+	const CONTAINER_HDR *hdr = base;
+	const COMPONENT_ENTRY *entry;
+	const LOADER_COMPRESSED_HEADER *lzh;
+	uint64_t entry_off, comp_off;
+	uint32_t i;
+
+	if ((size < sizeof(CONTAINER_HDR)) || (hdr->DataOffset > size) || (hdr->Count > max_count))
+		return SBL_CTR_ERR_FORMAT;
+
+	entry_off = sizeof(CONTAINER_HDR);
+	for (i = 0; i < hdr->Count; i++) {
+		if (entry_off + sizeof(COMPONENT_ENTRY) > hdr->DataOffset)
+			return SBL_CTR_ERR_FORMAT;
+		entry = (const COMPONENT_ENTRY *)((const uint8_t *)base + entry_off);
+		entry_off += sizeof(COMPONENT_ENTRY) + entry->HashSize;
+		if (entry_off > hdr->DataOffset)
+			return SBL_CTR_ERR_FORMAT;
+
+		comp_off = (uint64_t)hdr->DataOffset + entry->Offset;
+		if ((entry->Size < sizeof(LOADER_COMPRESSED_HEADER)) || (comp_off + entry->Size > size))
+			return SBL_CTR_ERR_FORMAT;
+
+		lzh = (const LOADER_COMPRESSED_HEADER *)((const uint8_t *)base + comp_off);
+		if (sizeof(LOADER_COMPRESSED_HEADER) + (uint64_t)lzh->Size > entry->Size)
+			return SBL_CTR_ERR_FORMAT;
+
+		comps[i].blob = (const uint8_t *)lzh;
+		comps[i].blob_size = entry->Size;
+		comps[i].lzh = lzh;
+		comps[i].auth_type = entry->AuthType;
+		comps[i].digest = NULL;
+		if (entry->AuthType == SBL_AUTH_TYPE_SHA2_256) {
+			if (entry->HashSize != SHA256_DIGEST_SIZE)
+				return SBL_CTR_ERR_FORMAT;
+			comps[i].digest = entry->HashData;
+		}
+	}
+
+	*count = hdr->Count;
+	return 0;
+}
+
+static int digest_match(const struct sbl_component *comp, struct sha256_ctx *ctx)
+{
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	uint8_t diff = 0;
+	uint32_t i;
+
+	sha256_final(ctx, digest);
+	for (i = 0; i < SHA256_DIGEST_SIZE; i++)
+		diff |= digest[i] ^ comp->digest[i];
+
+	return (diff == 0) ? 0 : SBL_CTR_ERR_DIGEST;
+}
+
+int sbl_component_verify(const struct sbl_component *comp)
+{
+	struct sha256_ctx ctx;
+
+	if (comp->digest == NULL)
+		return 0;
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, comp->blob, comp->blob_size);
+	return digest_match(comp, &ctx);
+}
+
+int sbl_component_load(const struct sbl_component *comp, void *dst, sbl_copy_fn copy)
+{
+	struct sha256_ctx ctx;
+	const uint8_t *src = comp->lzh->Data;
+	uint8_t *d = dst;
+	uint64_t left = comp->lzh->Size;
+	uint64_t len;
+
+	if (comp->digest == NULL) {
+		copy(dst, src, left);
+		return 0;
+	}
+
+	/* the blob is the header, the file, then maybe some padding */
+	sha256_init(&ctx);
+	sha256_update(&ctx, comp->blob, src - comp->blob);
+	while (left != 0) {
+		len = (left < SBL_LOAD_CHUNK_SIZE) ? left : SBL_LOAD_CHUNK_SIZE;
+		copy(d, src, len);
+		sha256_update(&ctx, d, len);
+		d += len;
+		src += len;
+		left -= len;
+	}
+	sha256_update(&ctx, src, comp->blob + comp->blob_size - src);
+
+	return digest_match(comp, &ctx);
+}
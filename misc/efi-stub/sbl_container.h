@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2022, Intel Corporation.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer
+ *      in the documentation and/or other materials provided with the
+ *      distribution.
+ *    * Neither the name of Intel Corporation nor the names of its
+ *      contributors may be used to endorse or promote products
+ *      derived from this software without specific prior written
+ *      permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Slim Bootloader container, as stitched at the .hv section of acrn.efi
+ *
+ * The container header is followed by a COMPONENT_ENTRY per file, each with
+ * an optional digest of the component, then by the components. A component
+ * is a LOADER_COMPRESSED_HEADER followed by the file, which must not be
+ * compressed as it is used in place.
+ *
+ * Parsing and checking a container only depends on <stdint.h>, the memory
+ * copies go through a callback given by the caller.
+ */
+
+#ifndef __SBL_CONTAINER_H__
+#define __SBL_CONTAINER_H__
+
+#include <stdint.h>
+
+/* AuthType of a component */
+#define SBL_AUTH_TYPE_NONE	0U
+#define SBL_AUTH_TYPE_SHA2_256	1U
+
+#define SBL_CTR_ERR_FORMAT	(-1)
+#define SBL_CTR_ERR_DIGEST	(-2)
+
+typedef struct {
+  uint32_t         Signature;
+  uint8_t          Version;
+  uint8_t          Svn;
+  uint16_t         DataOffset;
+  uint32_t         DataSize;
+  uint8_t          AuthType;
+  uint8_t          ImageType;
+  uint8_t          Flags;
+  uint8_t          Count;
+} CONTAINER_HDR;
+
+typedef struct {
+  uint32_t         Name;
+  uint32_t         Offset;
+  uint32_t         Size;
+  uint8_t          Attribute;
+  uint8_t          Alignment;
+  uint8_t          AuthType;
+  uint8_t          HashSize;
+  uint8_t          HashData[0];
+} COMPONENT_ENTRY;
+
+typedef struct {
+  uint32_t      Signature;
+  uint32_t      CompressedSize;
+  uint32_t      Size;
+  uint16_t      Version;
+  uint8_t       Svn;
+  uint8_t       Attribute;
+  uint8_t       Data[];
+} LOADER_COMPRESSED_HEADER;
+
+struct sbl_component {
+	const uint8_t *blob;			/* the component as stored, covered by the digest */
+	uint32_t blob_size;
+	const LOADER_COMPRESSED_HEADER *lzh;	/* header of the file */
+	uint8_t auth_type;
+	const uint8_t *digest;			/* SHA-256 digest of blob, NULL if none */
+};
+
+typedef void (*sbl_copy_fn)(void *dst, const void *src, uint64_t len);
+
+/**
+ * @brief Parse the container at base, of size bytes, and check that each
+ * component lies within it.
+ *
+ * @param[out] comps  The components, in container order.
+ * @param[out] count  The number of components.
+ *
+ * @return 0 on success, SBL_CTR_ERR_FORMAT on a malformed container or one
+ * with more than max_count components.
+ */
+int sbl_container_parse(const void *base, uint64_t size,
+	struct sbl_component *comps, uint32_t max_count, uint32_t *count);
+
+/**
+ * @brief Check the digest of a component used in place.
+ *
+ * @return 0 on success or if the component has no digest,
+ * SBL_CTR_ERR_DIGEST on mismatch.
+ */
+int sbl_component_verify(const struct sbl_component *comp);
+
+/**
+ * @brief Copy the file of a component to dst and check the digest of the
+ * component in the same pass, on the data just copied.
+ *
+ * @return 0 on success, SBL_CTR_ERR_DIGEST on mismatch.
+ */
+int sbl_component_load(const struct sbl_component *comp, void *dst, sbl_copy_fn copy);
+
+#endif /* __SBL_CONTAINER_H__ */
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2022, Intel Corporation.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer
+ *      in the documentation and/or other materials provided with the
+ *      distribution.
+ *    * Neither the name of Intel Corporation nor the names of its
+ *      contributors may be used to endorse or promote products
+ *      derived from this software without specific prior written
+ *      permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * SHA-256 (FIPS 180-4), used to check the digests of the container
+ * components. Only depends on <stdint.h>.
+ */
+
+#include <stdint.h>
+#include "sha256.h"
+
+static const uint32_t k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR32(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(uint32_t *state, const uint8_t *p)
+{
+	uint32_t w[64];
+	uint32_t a, b, c, d, e, f, g, h, t1, t2;
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		w[i] = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16) |
+			((uint32_t)p[4 * i + 2] << 8) | (uint32_t)p[4 * i + 3];
+	}
+	for (i = 16; i < 64; i++) {
+		w[i] = w[i - 16] + (ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3)) +
+			w[i - 7] + (ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10));
+	}
+
+	a = state[0]; b = state[1]; c = state[2]; d = state[3];
+	e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+	for (i = 0; i < 64; i++) {
+		t1 = h + (ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+		t2 = (ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+	state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void sha256_init(struct sha256_ctx *ctx)
+{
+	ctx->state[0] = 0x6a09e667;
+	ctx->state[1] = 0xbb67ae85;
+	ctx->state[2] = 0x3c6ef372;
+	ctx->state[3] = 0xa54ff53a;
+	ctx->state[4] = 0x510e527f;
+	ctx->state[5] = 0x9b05688c;
+	ctx->state[6] = 0x1f83d9ab;
+	ctx->state[7] = 0x5be0cd19;
+	ctx->len = 0;
+}
+
+void sha256_update(struct sha256_ctx *ctx, const void *data, uint64_t len)
+{
+	const uint8_t *p = data;
+	uint32_t used = ctx->len % SHA256_BLOCK_SIZE;
+
+	ctx->len += len;
+
+	if (used != 0) {
+		while ((used < SHA256_BLOCK_SIZE) && (len != 0)) {
+			ctx->buf[used++] = *p++;
+			len--;
+		}
+		if (used < SHA256_BLOCK_SIZE)
+			return;
+		sha256_block(ctx->state, ctx->buf);
+	}
+
+	/* hash the full blocks in place */
+	while (len >= SHA256_BLOCK_SIZE) {
+		sha256_block(ctx->state, p);
+		p += SHA256_BLOCK_SIZE;
+		len -= SHA256_BLOCK_SIZE;
+	}
+
+	for (used = 0; used < len; used++)
+		ctx->buf[used] = p[used];
+}
+
+void sha256_final(struct sha256_ctx *ctx, uint8_t digest[SHA256_DIGEST_SIZE])
+{
+	uint64_t bits = ctx->len * 8;
+	uint32_t used = ctx->len % SHA256_BLOCK_SIZE;
+	int i;
+
+	ctx->buf[used++] = 0x80;
+	if (used > SHA256_BLOCK_SIZE - 8) {
+		while (used < SHA256_BLOCK_SIZE)
+			ctx->buf[used++] = 0;
+		sha256_block(ctx->state, ctx->buf);
+		used = 0;
+	}
+	while (used < SHA256_BLOCK_SIZE - 8)
+		ctx->buf[used++] = 0;
+	for (i = 0; i < 8; i++)
+		ctx->buf[SHA256_BLOCK_SIZE - 1 - i] = (uint8_t)(bits >> (8 * i));
+	sha256_block(ctx->state, ctx->buf);
+
+	for (i = 0; i < 8; i++) {
+		digest[4 * i] = (uint8_t)(ctx->state[i] >> 24);
+		digest[4 * i + 1] = (uint8_t)(ctx->state[i] >> 16);
+		digest[4 * i + 2] = (uint8_t)(ctx->state[i] >> 8);
+		digest[4 * i + 3] = (uint8_t)ctx->state[i];
+	}
+}
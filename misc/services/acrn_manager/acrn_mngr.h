@@ -23,13 +23,27 @@ header file.
 #define ACRN_CONF_PATH			"/usr/share/acrn/conf"
 #define ACRN_CONF_PATH_ADD		ACRN_CONF_PATH "/add"
 #define ACRN_CONF_TIMER_LIST	ACRN_CONF_PATH "/timer_list"
+#define ACRN_CONF_POOL_LIST	ACRN_CONF_PATH "/pool_list"
 
 #define ACRN_DM_BASE_PATH	"/run/acrn"
 #define ACRN_DM_SOCK_PATH	"/run/acrn/mngr"
 
+/*
+ * Set in the environment of acrn-dm to hold the VM once it is set up, until
+ * a DM_CONTINUE message or a DM_STOP one. DM_QUERY reports VM_SUSPEND_HOLD
+ * meanwhile.
+ */
+#define ACRN_DM_HOLD_ENV	"ACRN_DM_HOLD"
+
 /* TODO: Revisit PARAM_LEN and see if size can be reduced */
 #define PARAM_LEN	256
 
+#define ACRND_NAME	"acrnd"
+
+/* limits of the VM pools kept by acrnd */
+#define POOL_NUM_MAX		8U
+#define POOL_VM_NUM_MAX		8U
+
 struct mngr_msg {
 	unsigned long long magic;	/* Make sure you get a mngr_msg */
 	unsigned int msgid;
@@ -79,6 +93,44 @@ struct mngr_msg {
 			time_t t;
 		} rtc_timer;
 
+		/* req of ACRND_POOL_SET */
+		struct req_acrnd_pool_set {
+			char name[MAX_VM_NAME_LEN];
+			unsigned size;		/* VMs to keep held, 0 to remove */
+			unsigned vm_num;
+			char vms[POOL_VM_NUM_MAX][MAX_VM_NAME_LEN];
+		} pool_set;
+
+		/* req of ACRND_POOL_TAKE and ACRND_POOL_QUERY */
+		struct req_acrnd_pool {
+			char name[MAX_VM_NAME_LEN];	/* "" to query by index */
+			unsigned index;
+		} pool;
+
+		/* ack of ACRND_POOL_TAKE */
+		struct ack_acrnd_pool_take {
+			int err;
+			int hit;		/* handed out a held VM */
+			char vmname[MAX_VM_NAME_LEN];
+		} pool_take;
+
+		/* ack of ACRND_POOL_QUERY */
+		struct ack_acrnd_pool_query {
+			int err;
+			char name[MAX_VM_NAME_LEN];
+			unsigned size;
+			unsigned vm_num;
+			unsigned held;
+			unsigned warming;
+			unsigned taken;
+			unsigned long hits;
+			unsigned long misses;
+			unsigned long warmups;
+			unsigned long warmup_fails;
+			unsigned long warmup_avg_ms;
+			unsigned long warmup_max_ms;
+		} pool_query;
+
 	} data;
 };
 
@@ -127,6 +179,48 @@ enum sos_lcs_msgid {
 	REBOOT,
 };
 
+/*
+ * Message event types added later, numbered after the ones above so that
+ * those keep their values for the clients built out of this tree.
+ */
+enum mngr_ext_msgid {
+	/* DM handled */
+	DM_CONTINUE = REBOOT + 1,	/* Start this UOS held by ACRN_DM_HOLD_ENV */
+
+	/* Acrnctl -> Acrnd */
+	ACRND_POOL_SET,		/* Set, or remove, a pool of held User VMs */
+	ACRND_POOL_TAKE,	/* Hand a User VM of a pool out */
+	ACRND_POOL_QUERY,	/* Ask the settings and counters of a pool */
+};
+
+/*
+ * Hugetlb broker of acrnd, see acrnd_hugetlb.h
+ *
+ * acrn-dm connects to the broker socket and sends a struct hugetlb_broker_req
+ * with the memory it needs from each hugepage level, 2M then 1G. The struct
+ * hugetlb_broker_ack comes back with, as SCM_RIGHTS, the memfd of each level
+ * asked for, in level order. The memory of the VM is [offset, offset + size)
+ * of the memfd, leased until acrn-dm closes the connection. The broker gives
+ * each lease a memfd of its own, at offset 0.
+ */
+#define ACRN_HUGETLB_BROKER_SOCK	ACRN_DM_BASE_PATH "/hugetlb_broker.socket"
+#define ACRN_CONF_HUGETLB_BROKER	ACRN_CONF_PATH "/hugetlb_broker"
+
+#define HUGETLB_BROKER_MAGIC	0x726b6f72626c7468UL	/* char[8] "htlbrokr" */
+#define HUGETLB_BROKER_LV_MAX	2U
+
+struct hugetlb_broker_req {
+	unsigned long long magic;
+	char vmname[MAX_VM_NAME_LEN];
+	unsigned long long size[HUGETLB_BROKER_LV_MAX];
+};
+
+struct hugetlb_broker_ack {
+	unsigned long long magic;
+	int err;		/* 0 or -errno, no memfd is passed on error */
+	unsigned long long offset[HUGETLB_BROKER_LV_MAX];
+};
+
 /* helper functions */
 #define MNGR_SERVER	1	/* create a server fd, which you can add handlers onto it */
 #define MNGR_CLIENT	0	/* create a client, just send req and read ack */
@@ -22,6 +22,7 @@ const char *state_str[] = {
 	[VM_STATE_UNKNOWN] = "unknown",
 	[VM_CREATED] = "stopped",
 	[VM_STARTED] = "started",
+	[VM_PAUSED] = "paused",
 	[VM_SUSPENDED] = "suspended",
 	[VM_UNTRACKED] = "untracked",
 };
@@ -164,6 +165,9 @@ static void _scan_alive_vm(void)
 			case VM_SUSPEND_SUSPEND:
 				vm->state_tmp = VM_SUSPENDED;
 				break;
+			case VM_SUSPEND_HOLD:
+				vm->state_tmp = VM_PAUSED;
+				break;
 			default:
 				fprintf(stderr, "Warnning: unknow vm state:0x%lx\n",
 										vm->state);
@@ -409,6 +413,27 @@ int resume_vm(const char *vmname, unsigned reason)
 	return ack.data.err;
 }
 
+int continue_vm(const char *vmname)
+{
+	struct mngr_msg req;
+	struct mngr_msg ack;
+	int ret;
+
+	req.magic = MNGR_MSG_MAGIC;
+	req.msgid = DM_CONTINUE;
+	req.timestamp = time(NULL);
+
+	ret = send_msg(vmname, &req, &ack);
+	if (ret)
+		return ret;
+
+	if (ack.data.err) {
+		printf("Unable to continue vm. errno(%d)\n", ack.data.err);
+	}
+
+	return ack.data.err;
+}
+
 int blkrescan_vm(const char *vmname, char *devargs)
 {
 	struct mngr_msg req;
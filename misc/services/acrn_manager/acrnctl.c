@@ -19,6 +19,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <stdbool.h>
+#include <time.h>
 #include "acrn_mngr.h"
 #include "acrnctl.h"
 #include "ioc.h"
@@ -34,11 +35,13 @@
 #define ADD_DESC       "Add one virtual machine with SCRIPTS and OPTIONS"
 #define RESET_DESC     "Stop and then start virtual machine VM_NAME"
 #define BLKRESCAN_DESC  "Rescan virtio-blk device attached to a virtual machine"
+#define POOL_DESC      "Set, take a virtual machine from, or show the pools of acrnd"
 
 #define VM_NAME (1)
 #define CMD_ARGS (2)
 
 #define STOP_TIMEOUT	30U
+#define ACRND_TIMEOUT	5U
 
 struct acrnctl_cmd {
 	const char *cmd;
@@ -427,6 +430,128 @@ static int acrnctl_do_blkrescan(int argc, char *argv[])
 	return 0;
 }
 
+static int send_acrnd_msg(struct mngr_msg *req, struct mngr_msg *ack)
+{
+	int fd, ret;
+
+	fd = mngr_open_un(ACRND_NAME, MNGR_CLIENT);
+	if (fd < 0) {
+		printf("Unable to open %s socket. Make sure the acrnd daemon is running\n",
+			ACRND_NAME);
+		return -1;
+	}
+
+	req->magic = MNGR_MSG_MAGIC;
+	req->timestamp = time(NULL);
+	ret = mngr_send_msg(fd, req, ack, ACRND_TIMEOUT);
+	mngr_close(fd);
+	if (ret <= 0) {
+		printf("Unable to send msg to %s socket\n", ACRND_NAME);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int pool_set_args(int argc, char *argv[])
+{
+	struct mngr_msg req;
+	struct mngr_msg ack;
+	int i;
+
+	memset(&req, 0, sizeof(req));
+	req.msgid = ACRND_POOL_SET;
+	strncpy(req.data.pool_set.name, argv[2], MAX_VM_NAME_LEN - 1);
+	req.data.pool_set.size = strtoul(argv[3], NULL, 10);
+	req.data.pool_set.vm_num = argc - 4;
+	for (i = 4; i < argc; i++)
+		strncpy(req.data.pool_set.vms[i - 4], argv[i], MAX_VM_NAME_LEN - 1);
+
+	if (send_acrnd_msg(&req, &ack))
+		return -1;
+
+	if (ack.data.err) {
+		printf("Unable to set pool %s. errno(%d)\n", argv[2], ack.data.err);
+	}
+
+	return ack.data.err;
+}
+
+static int pool_take_vm(const char *name)
+{
+	struct mngr_msg req;
+	struct mngr_msg ack;
+
+	memset(&req, 0, sizeof(req));
+	req.msgid = ACRND_POOL_TAKE;
+	strncpy(req.data.pool.name, name, MAX_VM_NAME_LEN - 1);
+
+	if (send_acrnd_msg(&req, &ack))
+		return -1;
+
+	if (ack.data.pool_take.err) {
+		printf("Unable to take a vm from pool %s. errno(%d)\n", name,
+			ack.data.pool_take.err);
+		return ack.data.pool_take.err;
+	}
+
+	printf("%s %s\n", ack.data.pool_take.vmname,
+		ack.data.pool_take.hit ? "started" : "launched");
+	return 0;
+}
+
+/* show the pool name, or all the pools if name is NULL */
+static int pool_show(const char *name)
+{
+	struct ack_acrnd_pool_query *query;
+	struct mngr_msg req;
+	struct mngr_msg ack;
+	unsigned i;
+
+	printf("%-16s%6s%6s%6s%9s%7s%8s%8s%9s%7s%8s%8s\n", "POOL", "SIZE", "VMS",
+		"HELD", "WARMING", "TAKEN", "HITS", "MISSES", "WARMUPS", "FAILS",
+		"AVG_MS", "MAX_MS");
+
+	for (i = 0; ; i++) {
+		memset(&req, 0, sizeof(req));
+		req.msgid = ACRND_POOL_QUERY;
+		if (name)
+			strncpy(req.data.pool.name, name, MAX_VM_NAME_LEN - 1);
+		req.data.pool.index = i;
+
+		if (send_acrnd_msg(&req, &ack))
+			return -1;
+
+		query = &ack.data.pool_query;
+		if (query->err) {
+			if (name || i == 0)
+				printf("There are no pools\n");
+			break;
+		}
+
+		query->name[MAX_VM_NAME_LEN - 1] = '\0';
+		printf("%-16s%6u%6u%6u%9u%7u%8lu%8lu%9lu%7lu%8lu%8lu\n", query->name,
+			query->size, query->vm_num, query->held, query->warming,
+			query->taken, query->hits, query->misses, query->warmups,
+			query->warmup_fails, query->warmup_avg_ms, query->warmup_max_ms);
+		if (name)
+			break;
+	}
+
+	return 0;
+}
+
+/* command: pool */
+static int acrnctl_do_pool(int argc, char *argv[])
+{
+	if (!strcmp(argv[1], "set"))
+		return pool_set_args(argc, argv);
+	if (!strcmp(argv[1], "take"))
+		return pool_take_vm(argv[2]);
+
+	return pool_show(argc == 3 ? argv[2] : NULL);
+}
+
 static int acrnctl_do_stop(int argc, char *argv[])
 {
 	struct vmmngr_struct *s;
@@ -641,6 +766,22 @@ static int valid_blkrescan_args(struct acrnctl_cmd *cmd, int argc, char *argv[])
 	return 0;
 }
 
+static int valid_pool_args(struct acrnctl_cmd *cmd, int argc, char *argv[])
+{
+	char df_opt[] = "{ set POOL_NAME SIZE VM_NAME ... | take POOL_NAME | show [POOL_NAME] }";
+
+	if (argc >= 2 && !strcmp(argv[1], "set") && argc >= 4 && argc <= 4 + POOL_VM_NUM_MAX)
+		return 0;
+	if (argc == 3 && !strcmp(argv[1], "take"))
+		return 0;
+	if ((argc == 2 || argc == 3) && !strcmp(argv[1], "show"))
+		return 0;
+
+	printf("acrnctl %s %s\n", cmd->cmd, df_opt);
+	printf("\tSIZE held VMs are kept among the VM_NAMEs, SIZE 0 removes the pool\n");
+	return -1;
+}
+
 static int valid_add_args(struct acrnctl_cmd *cmd, int argc, char *argv[])
 {
 	char df_opt[32] = "launch_scripts options";
@@ -683,6 +824,7 @@ struct acrnctl_cmd acmds[] = {
 	ACMD("add", acrnctl_do_add, ADD_DESC, valid_add_args),
 	ACMD("reset", acrnctl_do_reset, RESET_DESC, df_valid_args),
 	ACMD("blkrescan", acrnctl_do_blkrescan, BLKRESCAN_DESC, valid_blkrescan_args),
+	ACMD("pool", acrnctl_do_pool, POOL_DESC, valid_pool_args),
 };
 
 #define NCMD	(sizeof(acmds)/sizeof(struct acrnctl_cmd))
@@ -8,6 +8,7 @@
 #include <signal.h>
 #include <sys/queue.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -16,12 +17,15 @@
 #include <stdbool.h>
 #include <errno.h>
 #include <limits.h>
+#include <sys/mman.h>
+#include <linux/memfd.h>
 #include "mevent.h"
 #include "acrnctl.h"
 #include "acrn_mngr.h"
+#include "acrnd_pool.h"
+#include "acrnd_hugetlb.h"
 #include "ioc.h"
 
-#define ACRND_NAME		"acrnd"
 #define SERVICE_VM_LCS_SOCK	"service-vm-lcs"
 #define HW_IOC_PATH		"/dev/cbc-early-signals"
 #define VMS_STOP_TIMEOUT	20U /* Time to wait VMs to stop */
@@ -263,6 +267,9 @@ static int active_all_vms(void)
 	LIST_FOREACH(vm, &vmmngr_head, list) {
 		switch (vm->state) {
 		case VM_CREATED:
+			/* launched by their pool */
+			if (pool_has_vm(vm->name))
+				break;
 			pid = fork();
 			if (!pid)
 				acrnd_run_vm(vm->name);
@@ -542,6 +549,9 @@ static void _handle_acrnd_stop(unsigned int timeout)
 
 		acrnd_stop_timeout = timeout;
 
+		/* held VMs have no guest to stop, and must not be launched again */
+		pool_suspend(true);
+
 		/*
 		 * Due to acrnd only has one main thread, and acrnd stop flow
 		 * probably blocks main thread, so a detached thread is created
@@ -622,15 +632,295 @@ void handle_acrnd_resume(struct mngr_msg *msg, int client_fd, void *param)
 
 reply_ack:
 	unlink(ACRN_CONF_TIMER_LIST);
+	pool_suspend(false);
 
 	if (client_fd > 0)
 		mngr_send_msg(client_fd, &ack, NULL, 0);
 }
 
+/* acrn-dm launches and queries of the VM pools */
+static int pool_launch_vm(const char *vmname, bool hold)
+{
+	char name[MAX_VM_NAME_LEN] = {};
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0) {
+		perror("Fork to launch pooled vm fail:");
+		return -1;
+	}
+
+	if (!pid) {
+		if (hold)
+			setenv(ACRN_DM_HOLD_ENV, "1", 1);
+		strncpy(name, vmname, sizeof(name) - 1);
+		acrnd_run_vm(name);
+	}
+
+	return 0;
+}
+
+static int pool_stop_vm(const char *vmname)
+{
+	return stop_vm(vmname, 0);
+}
+
+/* vmmngr_update() is called by acrnd_pool_refill() and the pool handlers */
+static enum pool_vm_state pool_vm_state(const char *vmname)
+{
+	struct vmmngr_struct *vm;
+
+	vm = vmmngr_find(vmname);
+	if (!vm || vm->state == VM_CREATED)
+		return POOL_VM_STOPPED;
+	if (vm->state == VM_PAUSED)
+		return POOL_VM_HELD;
+	return POOL_VM_RUNNING;
+}
+
+static unsigned long pool_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000UL;
+}
+
+static const struct pool_vm_ops acrnd_pool_ops = {
+	.launch = pool_launch_vm,
+	.start = continue_vm,
+	.stop = pool_stop_vm,
+	.state = pool_vm_state,
+	.now_ms = pool_now_ms,
+};
+
+static void acrnd_pool_refill(void)
+{
+	/* reap the acrn-dm launchers which exited */
+	while (waitpid(-1, NULL, WNOHANG) > 0)
+		;
+
+	vmmngr_update();
+	pool_refill();
+}
+
+/* pool list file has a "[name] [size] [vmname]..." line per pool */
+static int load_pool_list(void)
+{
+	char vms[POOL_VM_NUM_MAX][MAX_VM_NAME_LEN];
+	char name[MAX_VM_NAME_LEN];
+	char l[256], *word, *p;
+	unsigned size, vm_num;
+	FILE *fp;
+
+	fp = fopen(ACRN_CONF_POOL_LIST, "r");
+	if (!fp)
+		return 0;
+
+	while (fgets(l, sizeof(l), fp)) {
+		p = NULL;
+		word = strtok_r(l, " \t\n", &p);
+		if (!word)
+			continue;
+		memset(name, 0, sizeof(name));
+		strncpy(name, word, sizeof(name) - 1);
+
+		word = strtok_r(NULL, " \t\n", &p);
+		if (!word)
+			continue;
+		size = strtoul(word, NULL, 10);
+
+		memset(vms, 0, sizeof(vms));
+		vm_num = 0;
+		while ((word = strtok_r(NULL, " \t\n", &p)) && vm_num < POOL_VM_NUM_MAX)
+			strncpy(vms[vm_num++], word, MAX_VM_NAME_LEN - 1);
+
+		if (pool_set(name, size, vm_num, (const char (*)[MAX_VM_NAME_LEN])vms))
+			fprintf(stderr, "Invalid pool %s from pool list file\n", name);
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+static int store_pool_list(void)
+{
+	char vms[POOL_VM_NUM_MAX][MAX_VM_NAME_LEN];
+	char name[MAX_VM_NAME_LEN];
+	unsigned i, j, size, vm_num;
+	FILE *fp;
+
+	fp = fopen(ACRN_CONF_POOL_LIST, "w");
+	if (!fp) {
+		perror("Open pool list file");
+		return -1;
+	}
+
+	for (i = 0; !pool_get_settings(i, name, &size, &vm_num, vms); i++) {
+		fprintf(fp, "%s %u", name, size);
+		for (j = 0; j < vm_num; j++)
+			fprintf(fp, " %s", vms[j]);
+		fprintf(fp, "\n");
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+static void handle_pool_set(struct mngr_msg *msg, int client_fd, void *param)
+{
+	struct req_acrnd_pool_set *set = &msg->data.pool_set;
+	struct mngr_msg ack;
+	unsigned i;
+
+	ack.msgid = msg->msgid;
+	ack.timestamp = msg->timestamp;
+	ack.data.err = -EINVAL;
+
+	set->name[MAX_VM_NAME_LEN - 1] = '\0';
+	if (set->vm_num > POOL_VM_NUM_MAX)
+		goto reply_ack;
+
+	/* only the VMs added by acrnctl can be launched */
+	vmmngr_update();
+	for (i = 0; i < set->vm_num; i++) {
+		set->vms[i][MAX_VM_NAME_LEN - 1] = '\0';
+		if (!vmmngr_find(set->vms[i])) {
+			printf("%s: Can't find %s\n", __func__, set->vms[i]);
+			goto reply_ack;
+		}
+	}
+
+	ack.data.err = pool_set(set->name, set->size, set->vm_num,
+				(const char (*)[MAX_VM_NAME_LEN])set->vms);
+	if (!ack.data.err)
+		store_pool_list();
+
+ reply_ack:
+	if (client_fd > 0)
+		mngr_send_msg(client_fd, &ack, NULL, 0);
+}
+
+static void handle_pool_take(struct mngr_msg *msg, int client_fd, void *param)
+{
+	struct mngr_msg ack;
+	bool hit = false;
+
+	ack.msgid = msg->msgid;
+	ack.timestamp = msg->timestamp;
+	memset(&ack.data.pool_take, 0, sizeof(ack.data.pool_take));
+
+	msg->data.pool.name[MAX_VM_NAME_LEN - 1] = '\0';
+	vmmngr_update();
+	ack.data.pool_take.err = pool_take(msg->data.pool.name,
+					   ack.data.pool_take.vmname, &hit);
+	ack.data.pool_take.hit = hit;
+
+	if (client_fd > 0)
+		mngr_send_msg(client_fd, &ack, NULL, 0);
+
+	/* top the pool back up without waiting for the next round */
+	if (!ack.data.pool_take.err)
+		acrnd_pool_refill();
+}
+
+static void handle_pool_query(struct mngr_msg *msg, int client_fd, void *param)
+{
+	struct ack_acrnd_pool_query *query;
+	struct pool_stats stats;
+	struct mngr_msg ack;
+
+	ack.msgid = msg->msgid;
+	ack.timestamp = msg->timestamp;
+	query = &ack.data.pool_query;
+	memset(query, 0, sizeof(*query));
+
+	msg->data.pool.name[MAX_VM_NAME_LEN - 1] = '\0';
+	query->err = pool_get_stats(msg->data.pool.name, msg->data.pool.index, &stats);
+	if (!query->err) {
+		memcpy(query->name, stats.name, sizeof(query->name));
+		query->size = stats.size;
+		query->vm_num = stats.vm_num;
+		query->held = stats.held;
+		query->warming = stats.warming;
+		query->taken = stats.taken;
+		query->hits = stats.hits;
+		query->misses = stats.misses;
+		query->warmups = stats.warmups;
+		query->warmup_fails = stats.warmup_fails;
+		query->warmup_avg_ms = stats.warmup_avg_ms;
+		query->warmup_max_ms = stats.warmup_max_ms;
+	}
+
+	if (client_fd > 0)
+		mngr_send_msg(client_fd, &ack, NULL, 0);
+}
+
+/* hugepage levels of the broker, the pages come from ACRN_CONF_HUGETLB_BROKER */
+static struct hugetlb_broker_level broker_levels[HUGETLB_BROKER_LV_MAX] = {
+	{
+		.pg_size = 2UL << 20,
+		.memfd_flags = MFD_HUGETLB | MFD_HUGE_2MB,
+		.sys_path = "/sys/kernel/mm/hugepages/hugepages-2048kB",
+	},
+	{
+		.pg_size = 1UL << 30,
+		.memfd_flags = MFD_HUGETLB | MFD_HUGE_1GB,
+		.sys_path = "/sys/kernel/mm/hugepages/hugepages-1048576kB",
+	},
+};
+
+/* each line of the file is "2M <pages>" or "1G <pages>" */
+static int start_hugetlb_broker(void)
+{
+	char l[256], *word, *p;
+	bool wanted = false;
+	unsigned lv;
+	FILE *fp;
+	int ret;
+
+	fp = fopen(ACRN_CONF_HUGETLB_BROKER, "r");
+	if (!fp)
+		return 0;
+
+	while (fgets(l, sizeof(l), fp)) {
+		p = NULL;
+		word = strtok_r(l, " \t\n", &p);
+		if (!word || word[0] == '#')
+			continue;
+		if (!strcmp(word, "2M"))
+			lv = 0;
+		else if (!strcmp(word, "1G"))
+			lv = 1;
+		else
+			lv = HUGETLB_BROKER_LV_MAX;
+
+		word = strtok_r(NULL, " \t\n", &p);
+		if (lv == HUGETLB_BROKER_LV_MAX || !word) {
+			fprintf(stderr, "Invalid line in %s\n", ACRN_CONF_HUGETLB_BROKER);
+			continue;
+		}
+		broker_levels[lv].pages = strtoul(word, NULL, 10);
+		if (broker_levels[lv].pages)
+			wanted = true;
+	}
+	fclose(fp);
+
+	if (!wanted)
+		return 0;
+
+	/* acrn-dm falls back to reserving its hugepages itself */
+	ret = hugetlb_broker_start(ACRN_HUGETLB_BROKER_SOCK, broker_levels);
+	if (ret)
+		fprintf(stderr, "Failed to start the hugetlb broker: %s\n", strerror(-ret));
+	return ret;
+}
+
 static void handle_on_exit(void)
 {
 	printf("Exiting from acrnd\n");
 	store_timer_list();
+	hugetlb_broker_stop();
 
 	if (acrnd_fd > 0) {
 		mngr_close(acrnd_fd);
@@ -771,6 +1061,13 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	/* before any VM is launched, so that they lease their memory */
+	start_hugetlb_broker();
+
+	/* the pooled VMs are left out of the auto-start */
+	pool_init(&acrnd_pool_ops);
+	load_pool_list();
+
 	if (init_vm()) {
 		printf("%s: Failed to init_vm\n", __func__);
 		return -1;
@@ -787,10 +1084,14 @@ int main(int argc, char *argv[])
 	mngr_add_handler(acrnd_fd, ACRND_TIMER, handle_timer_req, NULL);
 	mngr_add_handler(acrnd_fd, ACRND_STOP, handle_acrnd_stop, NULL);
 	mngr_add_handler(acrnd_fd, ACRND_RESUME, handle_acrnd_resume, NULL);
+	mngr_add_handler(acrnd_fd, ACRND_POOL_SET, handle_pool_set, NULL);
+	mngr_add_handler(acrnd_fd, ACRND_POOL_TAKE, handle_pool_take, NULL);
+	mngr_add_handler(acrnd_fd, ACRND_POOL_QUERY, handle_pool_query, NULL);
 
-	/* Last thing, run our timer works */
+	/* Last thing, run our timer works, and keep the VM pools filled */
 	while (!sigterm) {
 		try_do_works();
+		acrnd_pool_refill();
 		sleep(1);
 	}
 
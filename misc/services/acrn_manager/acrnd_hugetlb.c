@@ -0,0 +1,422 @@
+/*
+ * Copyright (C) 2022 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "acrnd_hugetlb.h"
+
+/* time for a connected acrn-dm to send its request */
+#define BROKER_REQ_TIMEOUT	1
+
+int htlb_area_init(struct htlb_area *area, size_t pg_size,
+		   unsigned int memfd_flags, size_t size)
+{
+	memset(area, 0, sizeof(*area));
+	if (!pg_size || !size || (size % pg_size))
+		return -EINVAL;
+
+	area->pg_size = pg_size;
+	area->memfd_flags = memfd_flags;
+	area->size = size;
+	area->free_size = size;
+	return 0;
+}
+
+void htlb_area_deinit(struct htlb_area *area)
+{
+	memset(area, 0, sizeof(*area));
+}
+
+int htlb_area_alloc(struct htlb_area *area, size_t size, const char *name)
+{
+	unsigned int seals = F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL;
+	int fd;
+
+	if (!area->size)
+		return -ENOMEM;
+	if (!size || (size % area->pg_size))
+		return -EINVAL;
+	if (size > area->free_size)
+		return -ENOMEM;
+
+	fd = memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING | area->memfd_flags);
+	if (fd < 0)
+		return -errno;
+
+	/* the pages come from the pool, zeroed, or not at all */
+	if ((ftruncate(fd, size) < 0) || (fallocate(fd, 0, 0, size) < 0) ||
+	    (fcntl(fd, F_ADD_SEALS, seals) < 0)) {
+		close(fd);
+		return -ENOMEM;
+	}
+
+	area->free_size -= size;
+	return fd;
+}
+
+void htlb_area_free(struct htlb_area *area, size_t size)
+{
+	area->free_size += size;
+}
+
+struct broker_client {
+	int sock;		/* -1 if the entry is unused */
+	bool leased;
+	char vmname[MAX_VM_NAME_LEN];
+	size_t size[HUGETLB_BROKER_LV_MAX];
+};
+
+static struct htlb_area areas[HUGETLB_BROKER_LV_MAX];
+static struct broker_client clients[HUGETLB_BROKER_CLIENT_MAX];
+static struct sockaddr_un broker_addr;
+static int listen_fd = -1;
+static int stop_pipe[2] = { -1, -1 };
+static pthread_t broker_tid;
+static bool broker_started;
+
+static long read_sys_pages(const char *sys_path, const char *file)
+{
+	char path[PATH_MAX];
+	long pages = -1;
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s", sys_path, file);
+	fp = fopen(path, "r");
+	if (!fp)
+		return -1;
+	if (fscanf(fp, "%ld", &pages) != 1)
+		pages = -1;
+	fclose(fp);
+	return pages;
+}
+
+/* grow the hugepage pool of the level by the pages missing */
+static void reserve_sys_pages(const struct hugetlb_broker_level *level)
+{
+	char path[PATH_MAX];
+	long nr, free_pages;
+	FILE *fp;
+
+	nr = read_sys_pages(level->sys_path, "nr_hugepages");
+	free_pages = read_sys_pages(level->sys_path, "free_hugepages");
+	if ((nr < 0) || (free_pages < 0) || (free_pages >= (long)level->pages))
+		return;
+
+	snprintf(path, sizeof(path), "%s/nr_hugepages", level->sys_path);
+	fp = fopen(path, "w");
+	if (!fp) {
+		fprintf(stderr, "hugetlb broker: can't open %s: %s\n", path, strerror(errno));
+		return;
+	}
+	fprintf(fp, "%ld", nr + (long)level->pages - free_pages);
+	fclose(fp);
+
+	/* the kernel may not have found them all, the leases would then fail */
+	free_pages = read_sys_pages(level->sys_path, "free_hugepages");
+	if (free_pages < (long)level->pages)
+		fprintf(stderr, "hugetlb broker: only %ld free pages of 0x%zx for %zu\n",
+			free_pages, level->pg_size, level->pages);
+}
+
+static void release_memory(struct broker_client *c)
+{
+	unsigned lv;
+
+	for (lv = 0; lv < HUGETLB_BROKER_LV_MAX; lv++) {
+		if (c->size[lv])
+			htlb_area_free(&areas[lv], c->size[lv]);
+		c->size[lv] = 0;
+	}
+}
+
+static void drop_client(struct broker_client *c, bool release)
+{
+	if (c->leased && release) {
+		release_memory(c);
+		printf("hugetlb broker: released the memory of %s\n", c->vmname);
+	}
+	close(c->sock);
+	memset(c, 0, sizeof(*c));
+	c->sock = -1;
+}
+
+static int send_ack(int sock, struct hugetlb_broker_ack *ack,
+		    const int *fds, unsigned nr_fds)
+{
+	char buf[CMSG_SPACE(sizeof(int) * HUGETLB_BROKER_LV_MAX)];
+	struct iovec iov = { .iov_base = ack, .iov_len = sizeof(*ack) };
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	if (nr_fds) {
+		memset(buf, 0, sizeof(buf));
+		msg.msg_control = buf;
+		msg.msg_controllen = CMSG_SPACE(sizeof(int) * nr_fds);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nr_fds);
+		memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nr_fds);
+	}
+
+	return (sendmsg(sock, &msg, MSG_NOSIGNAL) == sizeof(*ack)) ? 0 : -1;
+}
+
+/*
+ * All the levels asked for, or none. Each level is a memfd of its own, holding
+ * only the memory of the VM, which the broker closes once it is sent.
+ */
+static void lease(struct broker_client *c, const struct hugetlb_broker_req *req)
+{
+	struct hugetlb_broker_ack ack;
+	int fds[HUGETLB_BROKER_LV_MAX];
+	unsigned lv, i, nr_fds = 0;
+	int fd, ret = 0;
+
+	memset(&ack, 0, sizeof(ack));
+	ack.magic = HUGETLB_BROKER_MAGIC;
+	strncpy(c->vmname, req->vmname, MAX_VM_NAME_LEN - 1);
+
+	for (lv = 0; lv < HUGETLB_BROKER_LV_MAX; lv++) {
+		if (!req->size[lv])
+			continue;
+		fd = htlb_area_alloc(&areas[lv], req->size[lv], c->vmname);
+		if (fd < 0) {
+			ret = fd;
+			break;
+		}
+		c->size[lv] = req->size[lv];
+		fds[nr_fds++] = fd;
+	}
+
+	if (ret) {
+		for (i = 0; i < nr_fds; i++)
+			close(fds[i]);
+		release_memory(c);
+		ack.err = ret;
+		printf("hugetlb broker: can't lease 0x%llx/0x%llx to %s: %s\n",
+			req->size[0], req->size[1], c->vmname, strerror(-ret));
+		send_ack(c->sock, &ack, NULL, 0);
+		drop_client(c, false);
+		return;
+	}
+
+	c->leased = true;
+	ret = send_ack(c->sock, &ack, fds, nr_fds);
+	for (i = 0; i < nr_fds; i++)
+		close(fds[i]);
+	if (ret < 0) {
+		drop_client(c, true);
+		return;
+	}
+	printf("hugetlb broker: leased 0x%llx/0x%llx to %s\n",
+		req->size[0], req->size[1], c->vmname);
+}
+
+static void handle_client(struct broker_client *c)
+{
+	struct hugetlb_broker_req req;
+	char buf[64];
+	ssize_t ret;
+
+	if (!c->leased) {
+		ret = recv(c->sock, &req, sizeof(req), MSG_WAITALL);
+		if ((ret != sizeof(req)) || (req.magic != HUGETLB_BROKER_MAGIC)) {
+			drop_client(c, false);
+			return;
+		}
+		req.vmname[MAX_VM_NAME_LEN - 1] = '\0';
+		lease(c, &req);
+		return;
+	}
+
+	/* the lease lasts as long as the connection, nothing else is expected */
+	ret = recv(c->sock, buf, sizeof(buf), MSG_DONTWAIT);
+	if ((ret == 0) || ((ret < 0) && (errno != EAGAIN) && (errno != EINTR)))
+		drop_client(c, true);
+}
+
+static void accept_client(void)
+{
+	struct timeval tv = { .tv_sec = BROKER_REQ_TIMEOUT };
+	unsigned i;
+	int sock;
+
+	sock = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+	if (sock < 0)
+		return;
+
+	for (i = 0; i < HUGETLB_BROKER_CLIENT_MAX; i++)
+		if (clients[i].sock < 0)
+			break;
+	if (i == HUGETLB_BROKER_CLIENT_MAX) {
+		fprintf(stderr, "hugetlb broker: too many VMs\n");
+		close(sock);
+		return;
+	}
+
+	/* don't let a stuck acrn-dm block the others */
+	setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	clients[i].sock = sock;
+}
+
+static void *broker_thread(void *arg)
+{
+	struct pollfd pfds[HUGETLB_BROKER_CLIENT_MAX + 2];
+	unsigned map[HUGETLB_BROKER_CLIENT_MAX + 2];
+	unsigned i, n;
+
+	while (1) {
+		pfds[0].fd = stop_pipe[0];
+		pfds[0].events = POLLIN;
+		pfds[1].fd = listen_fd;
+		pfds[1].events = POLLIN;
+		for (i = 0, n = 2; i < HUGETLB_BROKER_CLIENT_MAX; i++) {
+			if (clients[i].sock < 0)
+				continue;
+			pfds[n].fd = clients[i].sock;
+			pfds[n].events = POLLIN;
+			map[n++] = i;
+		}
+
+		if (poll(pfds, n, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "hugetlb broker: poll failed: %s\n", strerror(errno));
+			break;
+		}
+		if (pfds[0].revents)
+			break;
+
+		for (i = 2; i < n; i++)
+			if (pfds[i].revents)
+				handle_client(&clients[map[i]]);
+		if (pfds[1].revents & POLLIN)
+			accept_client();
+	}
+
+	return NULL;
+}
+
+int hugetlb_broker_start(const char *sock_path,
+			 const struct hugetlb_broker_level *levels)
+{
+	const struct hugetlb_broker_level *level;
+	unsigned lv, i;
+	int ret;
+
+	if (broker_started)
+		return -EBUSY;
+
+	for (i = 0; i < HUGETLB_BROKER_CLIENT_MAX; i++) {
+		memset(&clients[i], 0, sizeof(clients[i]));
+		clients[i].sock = -1;
+	}
+	for (lv = 0; lv < HUGETLB_BROKER_LV_MAX; lv++) {
+		level = &levels[lv];
+		htlb_area_deinit(&areas[lv]);
+		if (!level->pages)
+			continue;
+
+		if (level->sys_path)
+			reserve_sys_pages(level);
+
+		ret = htlb_area_init(&areas[lv], level->pg_size, level->memfd_flags,
+				level->pages * level->pg_size);
+		if (ret)
+			goto err;
+		printf("hugetlb broker: reserved %zu pages of 0x%zx\n",
+			level->pages, level->pg_size);
+	}
+
+	if (strnlen(sock_path, sizeof(broker_addr.sun_path)) >= sizeof(broker_addr.sun_path)) {
+		ret = -ENAMETOOLONG;
+		goto err;
+	}
+	memset(&broker_addr, 0, sizeof(broker_addr));
+	broker_addr.sun_family = AF_UNIX;
+	strncpy(broker_addr.sun_path, sock_path, sizeof(broker_addr.sun_path) - 1);
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listen_fd < 0) {
+		ret = -errno;
+		goto err;
+	}
+	unlink(broker_addr.sun_path);
+	if ((bind(listen_fd, (struct sockaddr *)&broker_addr, sizeof(broker_addr)) < 0) ||
+	    (chmod(broker_addr.sun_path, S_IRUSR | S_IWUSR) < 0) ||
+	    (listen(listen_fd, HUGETLB_BROKER_CLIENT_MAX) < 0)) {
+		ret = -errno;
+		goto err_sock;
+	}
+
+	if (pipe2(stop_pipe, O_CLOEXEC) < 0) {
+		ret = -errno;
+		goto err_sock;
+	}
+
+	ret = -pthread_create(&broker_tid, NULL, broker_thread, NULL);
+	if (ret)
+		goto err_pipe;
+
+	broker_started = true;
+	return 0;
+
+err_pipe:
+	close(stop_pipe[0]);
+	close(stop_pipe[1]);
+	stop_pipe[0] = stop_pipe[1] = -1;
+err_sock:
+	close(listen_fd);
+	listen_fd = -1;
+	unlink(broker_addr.sun_path);
+err:
+	for (lv = 0; lv < HUGETLB_BROKER_LV_MAX; lv++)
+		htlb_area_deinit(&areas[lv]);
+	return ret;
+}
+
+void hugetlb_broker_stop(void)
+{
+	unsigned lv, i;
+	char c = 0;
+
+	if (!broker_started)
+		return;
+
+	if (write(stop_pipe[1], &c, 1) == 1)
+		pthread_join(broker_tid, NULL);
+
+	/* acrn-dm keeps the memfd of its lease open */
+	for (i = 0; i < HUGETLB_BROKER_CLIENT_MAX; i++)
+		if (clients[i].sock >= 0)
+			drop_client(&clients[i], false);
+
+	close(stop_pipe[0]);
+	close(stop_pipe[1]);
+	stop_pipe[0] = stop_pipe[1] = -1;
+	close(listen_fd);
+	listen_fd = -1;
+	unlink(broker_addr.sun_path);
+
+	for (lv = 0; lv < HUGETLB_BROKER_LV_MAX; lv++)
+		htlb_area_deinit(&areas[lv]);
+	broker_started = false;
+}
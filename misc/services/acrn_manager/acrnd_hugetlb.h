@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2022 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Hugetlb broker kept by acrnd
+ *
+ * The broker grows the hugepage pool of the kernel once, when it starts, to
+ * hold the pages of each level, and leases them to acrn-dm over a unix
+ * socket, see struct hugetlb_broker_req in acrn_mngr.h. acrn-dm then neither
+ * writes the hugepage counts in sysfs nor takes the hugetlb lock file when it
+ * sets up the memory of a VM.
+ *
+ * Each lease is a memfd of its own, allocated from the pool when it is
+ * leased, so that acrn-dm can only map the memory of its VM. The kernel
+ * zeroes the pages when they are allocated. The broker only accounts for the
+ * pages of each level, a lease is given back when its connection is closed,
+ * that is when acrn-dm is gone, and its pages go back to the pool once acrn-dm
+ * and the VM have released them.
+ *
+ * The broker only uses memfd calls, a regular memfd (memfd_flags 0 and a 4K
+ * page size) works the same way as a hugetlb one.
+ */
+
+#ifndef _ACRND_HUGETLB_H_
+#define _ACRND_HUGETLB_H_
+
+#include <stddef.h>
+#include "acrn_mngr.h"
+
+/* VMs holding a lease at once */
+#define HUGETLB_BROKER_CLIENT_MAX	64U
+
+/* the pages of a hugepage level kept for the leases */
+struct htlb_area {
+	size_t pg_size;
+	unsigned int memfd_flags;
+	size_t size;		/* 0 if the level is left out */
+	size_t free_size;
+};
+
+/**
+ * @brief Keep size bytes of pages of pg_size for the leases, all of it is then
+ * free.
+ *
+ * @return 0 on success, -EINVAL on a size not aligned to pg_size.
+ */
+int htlb_area_init(struct htlb_area *area, size_t pg_size,
+		   unsigned int memfd_flags, size_t size);
+
+/**
+ * @brief Forget the pages of the area.
+ */
+void htlb_area_deinit(struct htlb_area *area);
+
+/**
+ * @brief Allocate size bytes in a sealed memfd of their own, named name.
+ *
+ * @return the memfd on success, -EINVAL on a size not aligned to the page
+ * size, -ENOMEM if the area or the hugepage pool has too few free pages.
+ */
+int htlb_area_alloc(struct htlb_area *area, size_t size, const char *name);
+
+/**
+ * @brief Give size bytes back to the area. The pages themselves go back to
+ * the hugepage pool once all the users of their memfd have closed it.
+ */
+void htlb_area_free(struct htlb_area *area, size_t size);
+
+struct hugetlb_broker_level {
+	size_t pg_size;
+	unsigned int memfd_flags;	/* MFD_HUGETLB | MFD_HUGE_*, or 0 */
+	const char *sys_path;		/* sysfs dir of the hugepage size, or NULL */
+	size_t pages;			/* pages to reserve, 0 to leave the level out */
+};
+
+/**
+ * @brief Reserve the pages of each level and serve the leases on sock_path,
+ * from a thread of its own.
+ *
+ * The hugepage pool of a level with a sys_path is grown, once, when it has
+ * fewer free pages than needed. The pages stay in the pool until leased.
+ *
+ * @param levels HUGETLB_BROKER_LV_MAX levels, 2M then 1G.
+ *
+ * @return 0 on success, -errno on fail.
+ */
+int hugetlb_broker_start(const char *sock_path,
+			 const struct hugetlb_broker_level *levels);
+
+/**
+ * @brief Stop serving, the memory still leased stays with its VMs.
+ */
+void hugetlb_broker_stop(void);
+
+#endif
@@ -0,0 +1,446 @@
+/*
+ * Copyright (C) 2022 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "acrnd_pool.h"
+
+/* what the pool did with a VM, the acrn-dm state is asked to pool_vm_ops */
+enum pooled_vm_state {
+	POOLED_VM_IDLE = 0,	/* not launched by the pool, or given back */
+	POOLED_VM_WARMING,	/* launched held, not held yet */
+	POOLED_VM_HELD,
+	POOLED_VM_TAKEN,	/* handed out */
+};
+
+struct pooled_vm {
+	char name[MAX_VM_NAME_LEN];
+	enum pooled_vm_state state;
+	bool alive;		/* acrn-dm seen running since launched */
+	unsigned long launched_ms;
+};
+
+struct vm_pool {
+	bool used;
+	char name[MAX_VM_NAME_LEN];
+	unsigned size;
+	unsigned vm_num;
+	struct pooled_vm vms[POOL_VM_NUM_MAX];
+
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long warmups;
+	unsigned long warmup_fails;
+	unsigned long warmup_total_ms;
+	unsigned long warmup_max_ms;
+};
+
+static struct vm_pool pools[POOL_NUM_MAX];
+static const struct pool_vm_ops *vm_ops;
+static bool suspended;
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void pool_init(const struct pool_vm_ops *ops)
+{
+	pthread_mutex_lock(&pool_mutex);
+	memset(pools, 0, sizeof(pools));
+	vm_ops = ops;
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+static struct vm_pool *find_pool(const char *name)
+{
+	int i;
+
+	for (i = 0; i < POOL_NUM_MAX; i++)
+		if (pools[i].used && !strncmp(pools[i].name, name, MAX_VM_NAME_LEN))
+			return &pools[i];
+	return NULL;
+}
+
+static struct pooled_vm *find_vm(struct vm_pool *pool, const char *vmname)
+{
+	int i;
+
+	for (i = 0; i < pool->vm_num; i++)
+		if (!strncmp(pool->vms[i].name, vmname, MAX_VM_NAME_LEN))
+			return &pool->vms[i];
+	return NULL;
+}
+
+static struct vm_pool *find_vm_pool(const char *vmname)
+{
+	int i;
+
+	for (i = 0; i < POOL_NUM_MAX; i++)
+		if (pools[i].used && find_vm(&pools[i], vmname))
+			return &pools[i];
+	return NULL;
+}
+
+/* the acrn-dm is left to stop, it isn't launched again until it is seen stopped */
+static void stop_held_vm(struct pooled_vm *vm)
+{
+	if (vm->state == POOLED_VM_HELD || vm->state == POOLED_VM_WARMING) {
+		if (vm_ops->stop(vm->name))
+			printf("%s: Failed to stop %s\n", __func__, vm->name);
+	}
+	vm->state = POOLED_VM_IDLE;
+}
+
+static int check_pool_settings(const char *name, unsigned size, unsigned vm_num,
+			       const char (*vms)[MAX_VM_NAME_LEN])
+{
+	struct vm_pool *pool, *other;
+	int i, j;
+
+	if (!name[0] || strnlen(name, MAX_VM_NAME_LEN) >= MAX_VM_NAME_LEN)
+		return -EINVAL;
+	if (vm_num > POOL_VM_NUM_MAX || size > vm_num)
+		return -EINVAL;
+
+	pool = find_pool(name);
+	for (i = 0; i < vm_num; i++) {
+		if (!vms[i][0] || strnlen(vms[i], MAX_VM_NAME_LEN) >= MAX_VM_NAME_LEN)
+			return -EINVAL;
+		for (j = 0; j < i; j++)
+			if (!strncmp(vms[i], vms[j], MAX_VM_NAME_LEN))
+				return -EINVAL;
+		other = find_vm_pool(vms[i]);
+		if (other && other != pool) {
+			printf("%s: %s is already in pool %s\n", __func__, vms[i], other->name);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+int pool_set(const char *name, unsigned size, unsigned vm_num,
+	     const char (*vms)[MAX_VM_NAME_LEN])
+{
+	struct pooled_vm new_vms[POOL_VM_NUM_MAX];
+	struct pooled_vm *vm;
+	struct vm_pool *pool;
+	int i, ret;
+
+	pthread_mutex_lock(&pool_mutex);
+
+	if (size == 0) {
+		pool = find_pool(name);
+		if (!pool) {
+			ret = -ENOENT;
+			goto out;
+		}
+		for (i = 0; i < pool->vm_num; i++)
+			stop_held_vm(&pool->vms[i]);
+		memset(pool, 0, sizeof(*pool));
+		ret = 0;
+		goto out;
+	}
+
+	ret = check_pool_settings(name, size, vm_num, vms);
+	if (ret)
+		goto out;
+
+	pool = find_pool(name);
+	if (!pool) {
+		for (i = 0; i < POOL_NUM_MAX; i++)
+			if (!pools[i].used)
+				break;
+		if (i == POOL_NUM_MAX) {
+			ret = -ENOSPC;
+			goto out;
+		}
+		pool = &pools[i];
+		memset(pool, 0, sizeof(*pool));
+		pool->used = true;
+		strncpy(pool->name, name, sizeof(pool->name) - 1);
+	}
+
+	/* keep the state of the VMs staying in the pool */
+	memset(new_vms, 0, sizeof(new_vms));
+	for (i = 0; i < vm_num; i++) {
+		vm = find_vm(pool, vms[i]);
+		if (vm) {
+			new_vms[i] = *vm;
+			vm->name[0] = '\0';
+		} else {
+			strncpy(new_vms[i].name, vms[i], sizeof(new_vms[i].name) - 1);
+		}
+	}
+	for (i = 0; i < pool->vm_num; i++)
+		if (pool->vms[i].name[0])
+			stop_held_vm(&pool->vms[i]);
+
+	memcpy(pool->vms, new_vms, sizeof(new_vms));
+	pool->vm_num = vm_num;
+	pool->size = size;
+	ret = 0;
+
+out:
+	pthread_mutex_unlock(&pool_mutex);
+	return ret;
+}
+
+int pool_take(const char *name, char *vmname, bool *hit)
+{
+	struct pooled_vm *vm;
+	struct vm_pool *pool;
+	int i, ret = -EBUSY;
+
+	pthread_mutex_lock(&pool_mutex);
+
+	pool = find_pool(name);
+	if (!pool) {
+		ret = -ENOENT;
+		goto out;
+	}
+
+	for (i = 0; i < pool->vm_num; i++) {
+		vm = &pool->vms[i];
+		if (vm->state != POOLED_VM_HELD)
+			continue;
+		if (vm_ops->start(vm->name)) {
+			/* broken acrn-dm, wait for it to go away */
+			printf("%s: Failed to start held %s\n", __func__, vm->name);
+			vm->state = POOLED_VM_IDLE;
+			continue;
+		}
+		vm->state = POOLED_VM_TAKEN;
+		vm->alive = true;
+		pool->hits++;
+		*hit = true;
+		ret = 0;
+		break;
+	}
+
+	for (i = 0; ret && i < pool->vm_num; i++) {
+		vm = &pool->vms[i];
+		if (vm->state != POOLED_VM_IDLE || vm_ops->state(vm->name) != POOL_VM_STOPPED)
+			continue;
+		if (vm_ops->launch(vm->name, false))
+			continue;
+		vm->state = POOLED_VM_TAKEN;
+		vm->alive = false;
+		vm->launched_ms = vm_ops->now_ms();
+		pool->misses++;
+		*hit = false;
+		ret = 0;
+	}
+
+	if (!ret)
+		memcpy(vmname, vm->name, MAX_VM_NAME_LEN);
+
+out:
+	pthread_mutex_unlock(&pool_mutex);
+	return ret;
+}
+
+static void update_vm(struct vm_pool *pool, struct pooled_vm *vm)
+{
+	enum pool_vm_state state;
+	unsigned long now, elapsed;
+
+	state = vm_ops->state(vm->name);
+	now = vm_ops->now_ms();
+	elapsed = now - vm->launched_ms;
+
+	switch (vm->state) {
+	case POOLED_VM_WARMING:
+		if (state == POOL_VM_HELD) {
+			vm->state = POOLED_VM_HELD;
+			pool->warmups++;
+			pool->warmup_total_ms += elapsed;
+			if (elapsed > pool->warmup_max_ms)
+				pool->warmup_max_ms = elapsed;
+			break;
+		}
+		if (state == POOL_VM_RUNNING)
+			vm->alive = true;
+		/* acrn-dm exited, or never showed up, or is stuck */
+		if ((state == POOL_VM_STOPPED && vm->alive) || elapsed > POOL_WARMUP_TIMEOUT_MS) {
+			printf("%s: %s failed to warm up\n", __func__, vm->name);
+			pool->warmup_fails++;
+			stop_held_vm(vm);
+		}
+		break;
+	case POOLED_VM_HELD:
+		/* started or stopped behind the pool */
+		if (state != POOL_VM_HELD)
+			vm->state = POOLED_VM_IDLE;
+		break;
+	case POOLED_VM_IDLE:
+		/* a stop sent before acrn-dm could take it, hold it no longer */
+		if (state == POOL_VM_HELD && vm_ops->stop(vm->name))
+			printf("%s: Failed to stop %s\n", __func__, vm->name);
+		break;
+	case POOLED_VM_TAKEN:
+		if (state != POOL_VM_STOPPED)
+			vm->alive = true;
+		else if (vm->alive || elapsed > POOL_WARMUP_TIMEOUT_MS)
+			vm->state = POOLED_VM_IDLE;
+		break;
+	default:
+		break;
+	}
+}
+
+static void refill_pool(struct vm_pool *pool)
+{
+	struct pooled_vm *vm;
+	unsigned ready = 0;
+	int i;
+
+	for (i = 0; i < pool->vm_num; i++) {
+		vm = &pool->vms[i];
+		update_vm(pool, vm);
+		if (vm->state == POOLED_VM_HELD || vm->state == POOLED_VM_WARMING)
+			ready++;
+	}
+
+	/* the pool was shrunk */
+	for (i = 0; ready > pool->size && i < pool->vm_num; i++) {
+		vm = &pool->vms[i];
+		if (vm->state == POOLED_VM_HELD) {
+			stop_held_vm(vm);
+			ready--;
+		}
+	}
+
+	for (i = 0; ready < pool->size && i < pool->vm_num; i++) {
+		vm = &pool->vms[i];
+		if (vm->state != POOLED_VM_IDLE || vm_ops->state(vm->name) != POOL_VM_STOPPED)
+			continue;
+		if (vm_ops->launch(vm->name, true)) {
+			printf("%s: Failed to launch %s\n", __func__, vm->name);
+			continue;
+		}
+		vm->state = POOLED_VM_WARMING;
+		vm->alive = false;
+		vm->launched_ms = vm_ops->now_ms();
+		ready++;
+	}
+}
+
+void pool_refill(void)
+{
+	int i;
+
+	pthread_mutex_lock(&pool_mutex);
+	for (i = 0; !suspended && i < POOL_NUM_MAX; i++)
+		if (pools[i].used)
+			refill_pool(&pools[i]);
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+void pool_suspend(bool suspend)
+{
+	int i, j;
+
+	pthread_mutex_lock(&pool_mutex);
+	suspended = suspend;
+	for (i = 0; suspend && i < POOL_NUM_MAX; i++) {
+		if (!pools[i].used)
+			continue;
+		for (j = 0; j < pools[i].vm_num; j++)
+			if (pools[i].vms[j].state != POOLED_VM_TAKEN)
+				stop_held_vm(&pools[i].vms[j]);
+	}
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+static struct vm_pool *find_pool_by_index(unsigned index)
+{
+	int i;
+
+	for (i = 0; i < POOL_NUM_MAX; i++) {
+		if (!pools[i].used)
+			continue;
+		if (!index)
+			return &pools[i];
+		index--;
+	}
+	return NULL;
+}
+
+int pool_get_stats(const char *name, unsigned index, struct pool_stats *stats)
+{
+	struct vm_pool *pool;
+	int i;
+
+	pthread_mutex_lock(&pool_mutex);
+
+	pool = name[0] ? find_pool(name) : find_pool_by_index(index);
+	if (!pool) {
+		pthread_mutex_unlock(&pool_mutex);
+		return -ENOENT;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	memcpy(stats->name, pool->name, sizeof(stats->name));
+	stats->size = pool->size;
+	stats->vm_num = pool->vm_num;
+	for (i = 0; i < pool->vm_num; i++) {
+		switch (pool->vms[i].state) {
+		case POOLED_VM_WARMING:
+			stats->warming++;
+			break;
+		case POOLED_VM_HELD:
+			stats->held++;
+			break;
+		case POOLED_VM_TAKEN:
+			stats->taken++;
+			break;
+		default:
+			break;
+		}
+	}
+	stats->hits = pool->hits;
+	stats->misses = pool->misses;
+	stats->warmups = pool->warmups;
+	stats->warmup_fails = pool->warmup_fails;
+	stats->warmup_avg_ms = pool->warmups ? pool->warmup_total_ms / pool->warmups : 0;
+	stats->warmup_max_ms = pool->warmup_max_ms;
+
+	pthread_mutex_unlock(&pool_mutex);
+	return 0;
+}
+
+int pool_get_settings(unsigned index, char *name, unsigned *size,
+		      unsigned *vm_num, char (*vms)[MAX_VM_NAME_LEN])
+{
+	struct vm_pool *pool;
+	int i;
+
+	pthread_mutex_lock(&pool_mutex);
+
+	pool = find_pool_by_index(index);
+	if (!pool) {
+		pthread_mutex_unlock(&pool_mutex);
+		return -ENOENT;
+	}
+
+	memcpy(name, pool->name, MAX_VM_NAME_LEN);
+	*size = pool->size;
+	*vm_num = pool->vm_num;
+	for (i = 0; i < pool->vm_num; i++)
+		memcpy(vms[i], pool->vms[i].name, MAX_VM_NAME_LEN);
+
+	pthread_mutex_unlock(&pool_mutex);
+	return 0;
+}
+
+bool pool_has_vm(const char *vmname)
+{
+	bool ret;
+
+	pthread_mutex_lock(&pool_mutex);
+	ret = (find_vm_pool(vmname) != NULL);
+	pthread_mutex_unlock(&pool_mutex);
+	return ret;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2022 Intel Corporation
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Pools of pre-warmed User VMs kept by acrnd
+ *
+ * A pool is a set of added User VMs with the same launch settings. acrnd
+ * launches up to "size" of them with ACRN_DM_HOLD_ENV set, so each acrn-dm
+ * sets up the memory, the devices and the guest software and then waits.
+ * Taking a VM from the pool hands a held one out by letting it start, or
+ * launches a stopped one when none is held. The pool is topped back up by
+ * pool_refill().
+ *
+ * The pool logic doesn't launch or query acrn-dm itself, it goes through
+ * struct pool_vm_ops, so it can be driven by fake VMs.
+ */
+
+#ifndef _ACRND_POOL_H_
+#define _ACRND_POOL_H_
+
+#include <stdbool.h>
+#include "acrn_mngr.h"
+
+enum pool_vm_state {
+	POOL_VM_STOPPED = 0,	/* no acrn-dm running */
+	POOL_VM_HELD,		/* acrn-dm waiting to start the VM */
+	POOL_VM_RUNNING,	/* acrn-dm setting up or running the VM */
+};
+
+struct pool_vm_ops {
+	/* launch acrn-dm for vmname, held or not, without waiting for it */
+	int (*launch)(const char *vmname, bool hold);
+	/* start the VM of a held acrn-dm */
+	int (*start)(const char *vmname);
+	/* stop a held acrn-dm */
+	int (*stop)(const char *vmname);
+	enum pool_vm_state (*state)(const char *vmname);
+	/* monotonic time in ms */
+	unsigned long (*now_ms)(void);
+};
+
+struct pool_stats {
+	char name[MAX_VM_NAME_LEN];
+	unsigned size;
+	unsigned vm_num;
+	unsigned held;
+	unsigned warming;
+	unsigned taken;
+	unsigned long hits;		/* takes served by a held VM */
+	unsigned long misses;		/* takes served by launching a VM */
+	unsigned long warmups;		/* VMs which reached the held state */
+	unsigned long warmup_fails;	/* VMs which stopped or timed out before */
+	unsigned long warmup_avg_ms;
+	unsigned long warmup_max_ms;
+};
+
+/* time for a launched VM to be held before it is given up on */
+#define POOL_WARMUP_TIMEOUT_MS	120000UL
+
+void pool_init(const struct pool_vm_ops *ops);
+
+/**
+ * @brief Create or update the pool name, or remove it if size is 0.
+ *
+ * The counters of an existing pool are kept. A VM can only be in one pool.
+ * The held VMs left out of the pool are stopped.
+ *
+ * @return 0 on success, -EINVAL on bad settings, -ENOSPC if too many pools.
+ */
+int pool_set(const char *name, unsigned size, unsigned vm_num,
+	     const char (*vms)[MAX_VM_NAME_LEN]);
+
+/**
+ * @brief Hand a VM of the pool name out.
+ *
+ * @param vmname Filled with the name of the VM.
+ * @param hit Set if a held VM was started, cleared if a stopped one was
+ *	      launched.
+ *
+ * @return 0 on success, -ENOENT if no such pool, -EBUSY if all the VMs of
+ * the pool are taken.
+ */
+int pool_take(const char *name, char *vmname, bool *hit);
+
+/**
+ * @brief Update the state of the pooled VMs and launch held ones, until
+ * each pool has as many held or warming VMs as its size.
+ */
+void pool_refill(void);
+
+/**
+ * @brief Stop the held VMs and stop refilling the pools, or go on refilling
+ * them, when the Service VM is stopped and resumed.
+ */
+void pool_suspend(bool suspend);
+
+/**
+ * @brief Get the settings and counters of the pool name, or of the
+ * index-th pool if name is empty.
+ *
+ * @return 0 on success, -ENOENT if no such pool.
+ */
+int pool_get_stats(const char *name, unsigned index, struct pool_stats *stats);
+
+/**
+ * @brief Get the settings of the index-th pool, to store them.
+ *
+ * @return 0 on success, -ENOENT if no such pool.
+ */
+int pool_get_settings(unsigned index, char *name, unsigned *size,
+		      unsigned *vm_num, char (*vms)[MAX_VM_NAME_LEN]);
+
+/**
+ * @brief Check whether vmname belongs to a pool, as pooled VMs are only
+ * launched by the pool.
+ */
+bool pool_has_vm(const char *vmname);
+
+#endif